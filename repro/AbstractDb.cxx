@@ -216,6 +216,14 @@ AbstractDb::getUserAuthInfo(  const AbstractDb::Key& key ) const
 }
 
 
+bool
+AbstractDb::lookupUserAuthInfo( const AbstractDb::Key& key, Data& a1 ) const
+{ 
+   a1 = getUserAuthInfo(key);
+   return true;
+}
+
+
 AbstractDb::Key 
 AbstractDb::firstUserKey()
 {
@@ -110,6 +110,9 @@ class AbstractDb
       virtual void eraseUser(const Key& key);
       virtual UserRecord getUser(const Key& key) const;
       virtual resip::Data getUserAuthInfo(const Key& key) const;
+      // As getUserAuthInfo, but returns false if the lookup itself failed
+      // (e.g. the database is unreachable); a1 is empty for no such user
+      virtual bool lookupUserAuthInfo(const Key& key, resip::Data& a1) const;
       virtual Key firstUserKey();// return empty if no more
       virtual Key nextUserKey(); // return empty if no more 
          
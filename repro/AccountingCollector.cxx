@@ -13,10 +13,12 @@
 #include "repro/RequestContext.hxx"
 #include "repro/ProxyConfig.hxx"
 #include "repro/PersistentMessageQueue.hxx"
+#include "repro/SegmentedMessageLog.hxx"
 #include "resip/stack/Tuple.hxx"
 #include "resip/stack/Helper.hxx"
 #include "resip/stack/SipMessage.hxx"
 #include "rutil/Logger.hxx"
+#include "rutil/Timer.hxx"
 
 #include "rutil/WinLeakCheck.hxx"
 
@@ -32,6 +34,10 @@ const static Data registrationEventQueueName = "regeventqueue";
 
 AccountingCollector::AccountingCollector(ProxyConfig& config) :
    mDbBaseDir(config.getConfigData("DatabasePath", "./", true)),
+   mUseSegmentedLog(isEqualNoCase(config.getConfigData("AccountingQueueType", "BerkeleyDb"), "SegmentedLog")),
+   mSegmentSize((UInt64)config.getConfigUnsignedLong("AccountingSegmentSize", 64) * 1024 * 1024),
+   mBatchSize(config.getConfigUnsignedLong("AccountingBatchSize", 100)),
+   mBatchLinger(config.getConfigUnsignedLong("AccountingBatchLinger", 0)),
    mSessionEventQueue(0),
    mRegistrationEventQueue(0),
    mSessionAccountingAddRoutingHeaders(config.getConfigBool("SessionAccountingAddRoutingHeaders", false)),
@@ -41,6 +47,10 @@ AccountingCollector::AccountingCollector(ProxyConfig& config) :
    mRegistrationAccountingLogRefreshes(config.getConfigBool("RegistrationAccountingLogRefreshes", false)),
    mFifo(0, 0)  // not limited by time or size
 {
+   if(mBatchSize == 0)
+   {
+      mBatchSize = 1;
+   }
    if(config.getConfigBool("SessionAccountingEnabled", false))
    {
       if(!initializeEventQueue(SessionEventType))
@@ -590,7 +600,27 @@ AccountingCollector::doSessionAccounting(const resip::SipMessage& msg, bool rece
    }
 }
 
-PersistentMessageEnqueue* 
+MessageEnqueueIf*
+AccountingCollector::createEventQueue(const Data& queueName)
+{
+   MessageEnqueueIf* queue;
+   if(mUseSegmentedLog)
+   {
+      queue = new SegmentedMessageLogEnqueue(mDbBaseDir, mSegmentSize);
+   }
+   else
+   {
+      queue = new PersistentMessageEnqueue(mDbBaseDir);
+   }
+   if(!queue->init(true, queueName))
+   {
+      delete queue;
+      return 0;
+   }
+   return queue;
+}
+
+MessageEnqueueIf*
 AccountingCollector::initializeEventQueue(FifoEventType type, bool destroyFirst)
 {
    switch(type)
@@ -603,12 +633,7 @@ AccountingCollector::initializeEventQueue(FifoEventType type, bool destroyFirst)
       }
       if(!mSessionEventQueue)
       {
-         mSessionEventQueue = new PersistentMessageEnqueue(mDbBaseDir);
-         if(!mSessionEventQueue->init(true, sessionEventQueueName))
-         {
-            delete mSessionEventQueue;
-            mSessionEventQueue = 0;
-         }
+         mSessionEventQueue = createEventQueue(sessionEventQueueName);
       }
       return mSessionEventQueue;
    case RegistrationEventType:
@@ -619,12 +644,7 @@ AccountingCollector::initializeEventQueue(FifoEventType type, bool destroyFirst)
       }
       if(!mRegistrationEventQueue)
       {
-         mRegistrationEventQueue = new PersistentMessageEnqueue(mDbBaseDir);
-         if(!mRegistrationEventQueue->init(true, registrationEventQueueName))
-         {
-            delete mRegistrationEventQueue;
-            mRegistrationEventQueue = 0;
-         }
+         mRegistrationEventQueue = createEventQueue(registrationEventQueueName);
       }
       return mRegistrationEventQueue;
    default:
@@ -650,39 +670,46 @@ AccountingCollector::pushEventObjectToQueue(Object& eventObject, AccountingColle
 }
 
 void 
-AccountingCollector::internalProcess(std::auto_ptr<FifoEvent> eventData)
+AccountingCollector::internalProcess(FifoEventType type, const std::vector<Data>& events)
 {
-   InfoLog(<< "AccountingCollector::internalProcess: JSON=" << endl << eventData->mData);
+   if(events.empty())
+   {
+      return;
+   }
+   for(size_t i = 0; i < events.size(); i++)
+   {
+      InfoLog(<< "AccountingCollector::internalProcess: JSON=" << endl << events[i]);
+   }
 
-   PersistentMessageEnqueue* queue = initializeEventQueue(eventData->mType);
+   MessageEnqueueIf* queue = initializeEventQueue(type);
 
    if(!queue)
    {
-      ErrLog(<< "AccountingCollector: cannot initialize PersistentMessageQueue - dropping event!");
+      ErrLog(<< "AccountingCollector: cannot initialize message queue - dropping " << events.size() << " event(s)!");
       return;
    }
 
-   if(!queue->push(eventData->mData))
+   if(!queue->push(events))
    {
       // Error pushing - see if db recovery is needed
       if(queue->isRecoveryNeeded())
       {
-         if((queue = initializeEventQueue(eventData->mType, true /* destoryFirst */)) == 0)
+         if((queue = initializeEventQueue(type, true /* destoryFirst */)) == 0)
          {
-            ErrLog(<< "AccountingCollector: cannot initialize PersistentMessageQueue - dropping event!");
+            ErrLog(<< "AccountingCollector: cannot initialize message queue - dropping " << events.size() << " event(s)!");
             return;
          }
          else
          {
-            if(!queue->push(eventData->mData))
+            if(!queue->push(events))
             {
-               ErrLog(<< "AccountingCollector: error pushing event to queue - dropping event!");
+               ErrLog(<< "AccountingCollector: error pushing events to queue - dropping " << events.size() << " event(s)!");
             }
          }
       }
       else
       {
-         ErrLog(<< "AccountingCollector: error pushing event to queue - dropping event!");
+         ErrLog(<< "AccountingCollector: error pushing events to queue - dropping " << events.size() << " event(s)!");
       }
    }
 }
@@ -690,15 +717,46 @@ AccountingCollector::internalProcess(std::auto_ptr<FifoEvent> eventData)
 void 
 AccountingCollector::thread()
 {
+   std::vector<Data> sessionEvents;
+   std::vector<Data> registrationEvents;
    while (!isShutdown() || !mFifo.empty())  // Ensure we drain the queue before shutting down
    {
       try
       {
          std::auto_ptr<FifoEvent> eventData(mFifo.getNext(1000));  // Only need to wake up to see if we are shutdown
-         if (eventData.get())
+         if (!eventData.get())
          {
-            internalProcess(eventData);
+            continue;
          }
+
+         sessionEvents.clear();
+         registrationEvents.clear();
+
+         // Group commit: collect whatever else is queued, waiting up to
+         // mBatchLinger ms for more, and write each queue's events at once
+         UInt64 lingerEnd = Timer::getTimeMs() + mBatchLinger;
+         unsigned int count = 0;
+         while(eventData.get())
+         {
+            if(eventData->mType == SessionEventType)
+            {
+               sessionEvents.push_back(eventData->mData);
+            }
+            else
+            {
+               registrationEvents.push_back(eventData->mData);
+            }
+            if(++count >= mBatchSize)
+            {
+               break;
+            }
+            UInt64 now = Timer::getTimeMs();
+            int wait = (now < lingerEnd && !isShutdown()) ? (int)(lingerEnd - now) : RESIP_FIFO_NOWAIT;
+            eventData.reset(mFifo.getNext(wait));
+         }
+
+         internalProcess(SessionEventType, sessionEvents);
+         internalProcess(RegistrationEventType, registrationEvents);
       }
       catch (BaseException& e)
       {
@@ -2,6 +2,7 @@
 #define RESIP_ACCOUNTINGCOLLECTOR_HXX 
 
 #include <memory>
+#include <vector>
 #include "rutil/ThreadIf.hxx"
 #include "rutil/TimeLimitFifo.hxx"
 #include "resip/stack/SipMessage.hxx"
@@ -14,7 +15,7 @@ namespace json
 namespace repro
 {
 class RequestContext;
-class PersistentMessageEnqueue;
+class MessageEnqueueIf;
 class ProxyConfig;
 
 class AccountingCollector : public resip::ThreadIf
@@ -47,8 +48,12 @@ public:
 
 private:
    resip::Data mDbBaseDir;
-   PersistentMessageEnqueue* mSessionEventQueue;
-   PersistentMessageEnqueue* mRegistrationEventQueue;
+   bool mUseSegmentedLog;
+   UInt64 mSegmentSize;
+   unsigned int mBatchSize;
+   unsigned int mBatchLinger;  // ms
+   MessageEnqueueIf* mSessionEventQueue;
+   MessageEnqueueIf* mRegistrationEventQueue;
    bool mSessionAccountingAddRoutingHeaders;
    bool mSessionAccountingAddViaHeaders;
    bool mRegistrationAccountingAddRoutingHeaders;
@@ -69,9 +74,10 @@ private:
       resip::Data mData;
    };
    resip::TimeLimitFifo<FifoEvent> mFifo;
-   PersistentMessageEnqueue* initializeEventQueue(FifoEventType type, bool destroyFirst=false);
+   MessageEnqueueIf* initializeEventQueue(FifoEventType type, bool destroyFirst=false);
+   MessageEnqueueIf* createEventQueue(const resip::Data& queueName);
    void pushEventObjectToQueue(json::Object& object, FifoEventType type);
-   void internalProcess(std::auto_ptr<FifoEvent> eventData);
+   void internalProcess(FifoEventType type, const std::vector<resip::Data>& events);
 };
 
 }
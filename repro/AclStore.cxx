@@ -28,7 +28,8 @@ using namespace std;
 #define RESIPROCATE_SUBSYSTEM Subsystem::REPRO
 
 AclStore::AclStore(AbstractDb& db):
-   mDb(db)
+   mDb(db),
+   mTrustedPeersStale(false)
 {  
    AbstractDb::Key key = mDb.firstAclKey();
    while ( !key.empty() )
@@ -52,6 +53,7 @@ AclStore::AclStore(AbstractDb& db):
    } 
    mTlsPeerNameCursor = mTlsPeerNameList.begin();
    mAddressCursor = mAddressList.begin();
+   updateTrustedPeers();
 }
 
 AclStore::~AclStore()
@@ -115,6 +117,7 @@ AclStore::addAcl(const resip::Data& tlsPeerName,
          mAddressList.push_back(addressRecord);
          mAddressCursor = mAddressList.begin();  // Put cursor back at start
       }
+      mTrustedPeersStale.store(true);
    }
    else
    {
@@ -126,6 +129,7 @@ AclStore::addAcl(const resip::Data& tlsPeerName,
          mTlsPeerNameList.push_back(tlsPeerNameRecord); 
          mTlsPeerNameCursor = mTlsPeerNameList.begin(); // Put cursor back at start
       }
+      mTrustedPeersStale.store(true);
    }
    return true;
 }
@@ -311,6 +315,7 @@ AclStore::eraseAcl(const resip::Data& key)
       if(findAddressKey(key))
       {
          mAddressCursor = mAddressList.erase(mAddressCursor);
+         mTrustedPeersStale.store(true);
       }
    }
    else
@@ -319,6 +324,7 @@ AclStore::eraseAcl(const resip::Data& key)
       if(findTlsPeerNameKey(key))
       {
          mTlsPeerNameCursor = mTlsPeerNameList.erase(mTlsPeerNameCursor);
+         mTrustedPeersStale.store(true);
       }
    }
 }
@@ -496,12 +502,14 @@ AclStore::getAddressMask( const resip::Data& key )
 bool 
 AclStore::isTlsPeerNameTrusted(const std::list<Data>& tlsPeerNames)
 {
-   ReadLock lock(mMutex);
+   refreshTrustedPeers();
+
+   Snapshot<TrustedPeers>::Reader trusted(mTrustedPeers);
    for(std::list<Data>::const_iterator it = tlsPeerNames.begin(); it != tlsPeerNames.end(); it++)
    {
-      for(TlsPeerNameList::iterator i = mTlsPeerNameList.begin(); i != mTlsPeerNameList.end(); i++)
+      for(std::vector<Data>::const_iterator i = trusted->mTlsPeerNames.begin(); i != trusted->mTlsPeerNames.end(); i++)
       {
-         if(isEqualNoCase(i->mTlsPeerName, *it))
+         if(isEqualNoCase(*i, *it))
          {
             InfoLog (<< "AclStore - Tls peer name IS trusted: " << *it);
             return true;
@@ -515,12 +523,140 @@ AclStore::isTlsPeerNameTrusted(const std::list<Data>& tlsPeerNames)
 bool 
 AclStore::isAddressTrusted(const Tuple& address)
 {
-   ReadLock lock(mMutex);
-   for(AddressList::iterator i = mAddressList.begin(); i != mAddressList.end(); i++)
+   refreshTrustedPeers();
+
+   Snapshot<TrustedPeers>::Reader trusted(mTrustedPeers);
+   return trusted->mAddresses.isTrusted(address);
+}
+
+
+void
+AclStore::refreshTrustedPeers()
+{
+   bool stale = true;
+   if(mTrustedPeersStale.compareExchange(stale, false))
    {
-      if(i->mAddressTuple.isEqualWithMask(address, i->mMask, i->mAddressTuple.getPort() == 0))
+      updateTrustedPeers();
+   }
+}
+
+
+void
+AclStore::updateTrustedPeers()
+{
+   Lock updateLock(mTrustedPeersUpdateMutex);
+
+   TrustedPeers* trusted = new TrustedPeers;
+   {
+      ReadLock lock(mMutex);
+      for(AddressList::const_iterator i = mAddressList.begin(); i != mAddressList.end(); i++)
       {
-         return true;
+         trusted->mAddresses.add(*i);
+      }
+      for(TlsPeerNameList::const_iterator i = mTlsPeerNameList.begin(); i != mTlsPeerNameList.end(); i++)
+      {
+         trusted->mTlsPeerNames.push_back(i->mTlsPeerName);
+      }
+   }
+   mTrustedPeers.publish(trusted);
+}
+
+
+// Returns the address in network byte order and sets family (0 for IPv4,
+// 1 for IPv6) and its length in bits; 0 if neither
+static const unsigned char*
+addressBits(const Tuple& address, int& family, int& bits)
+{
+   if(address.getSockaddr().sa_family == AF_INET)
+   {
+      family = 0;
+      bits = 32;
+      return (const unsigned char*)&reinterpret_cast<const sockaddr_in&>(address.getSockaddr()).sin_addr;
+   }
+#ifdef USE_IPV6
+   if(address.getSockaddr().sa_family == AF_INET6)
+   {
+      family = 1;
+      bits = 128;
+      return reinterpret_cast<const sockaddr_in6&>(address.getSockaddr()).sin6_addr.s6_addr;
+   }
+#endif
+   return 0;
+}
+
+
+AclStore::AddressTrie::AddressTrie()
+{
+   mNodes[0].push_back(Node());
+   mNodes[1].push_back(Node());
+}
+
+void
+AclStore::AddressTrie::add(const AddressRecord& record)
+{
+   int family;
+   int bits;
+   const unsigned char* address = addressBits(record.mAddressTuple, family, bits);
+   if(!address)
+   {
+      return;
+   }
+   int mask = resipMax(0, resipMin((int)record.mMask, bits));
+
+   std::vector<Node>& nodes = mNodes[family];
+   unsigned int node = 0;
+   for(int i = 0; i < mask; i++)
+   {
+      int bit = (address[i / 8] >> (7 - i % 8)) & 1;
+      if(nodes[node].mChild[bit] == 0)
+      {
+         nodes[node].mChild[bit] = (unsigned int)nodes.size();
+         nodes.push_back(Node());
+      }
+      node = nodes[node].mChild[bit];
+   }
+
+   Entry entry;
+   entry.mPort = record.mAddressTuple.getPort();
+   entry.mType = record.mAddressTuple.getType();
+   entry.mNext = nodes[node].mFirstEntry;
+   nodes[node].mFirstEntry = (int)mEntries.size();
+   mEntries.push_back(entry);
+}
+
+bool
+AclStore::AddressTrie::isTrusted(const Tuple& address) const
+{
+   int family;
+   int bits;
+   const unsigned char* addr = addressBits(address, family, bits);
+   if(!addr)
+   {
+      return false;
+   }
+
+   // Check the ACLs of every prefix of the address that has any
+   const std::vector<Node>& nodes = mNodes[family];
+   unsigned int node = 0;
+   for(int i = 0; ; i++)
+   {
+      for(int e = nodes[node].mFirstEntry; e != -1; e = mEntries[e].mNext)
+      {
+         const Entry& entry = mEntries[e];
+         if(entry.mType == address.getType() &&
+            (entry.mPort == 0 || entry.mPort == address.getPort()))
+         {
+            return true;
+         }
+      }
+      if(i == bits)
+      {
+         break;
+      }
+      node = nodes[node].mChild[(addr[i / 8] >> (7 - i % 8)) & 1];
+      if(node == 0)
+      {
+         break;
       }
    }
    return false;
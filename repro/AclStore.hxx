@@ -2,11 +2,15 @@
 #define REPRO_ACLSTORE_HXX
 
 #include <list>
+#include <vector>
+#include "rutil/Atomic.hxx"
 #include "rutil/Data.hxx"
+#include "rutil/Mutex.hxx"
 #include "rutil/RWMutex.hxx"
 #include "resip/stack/SipMessage.hxx"
 #include "resip/stack/Tuple.hxx"
 #include "repro/AbstractDb.hxx"
+#include "repro/Snapshot.hxx"
 
 namespace repro
 {
@@ -88,6 +92,52 @@ class AclStore
       TlsPeerNameList::iterator mTlsPeerNameCursor;
       AddressList mAddressList;
       AddressList::iterator mAddressCursor;
+
+      // The address ACLs as one binary trie per address family, so checking
+      // an address takes at most one step per address bit however many ACLs
+      // there are.  Never changed once built.
+      class AddressTrie
+      {
+         public:
+            AddressTrie();
+            void add(const AddressRecord& record);
+            bool isTrusted(const resip::Tuple& address) const;
+
+         private:
+            class Node
+            {
+               public:
+                  Node() : mFirstEntry(-1) { mChild[0] = mChild[1] = 0; }
+                  unsigned int mChild[2];  // 0 if none; the root is never a child
+                  int mFirstEntry;  // ACLs whose address and mask end here
+            };
+            class Entry
+            {
+               public:
+                  int mPort;  // 0 matches any port
+                  resip::TransportType mType;
+                  int mNext;
+            };
+            std::vector<Node> mNodes[2];  // IPv4 and IPv6, each rooted at [0]
+            std::vector<Entry> mEntries;
+      };
+
+      // What isTlsPeerNameTrusted() and isAddressTrusted() check against,
+      // read through mTrustedPeers without taking mMutex.  Changes to the
+      // ACL lists only mark it stale; the next check builds and publishes a
+      // new one, so a reload of many ACLs costs one rebuild.
+      class TrustedPeers
+      {
+         public:
+            AddressTrie mAddresses;
+            std::vector<resip::Data> mTlsPeerNames;
+      };
+      void refreshTrustedPeers();
+      void updateTrustedPeers();
+
+      resip::Mutex mTrustedPeersUpdateMutex;  // publishes must not overlap
+      Snapshot<TrustedPeers> mTrustedPeers;
+      resip::Atomic<bool> mTrustedPeersStale;
 };
 
 }
@@ -5,6 +5,7 @@
 #include <resip/stack/Symbols.hxx>
 #include <resip/stack/Tuple.hxx>
 #include <resip/stack/SipStack.hxx>
+#include <resip/stack/ConnectionManager.hxx>
 #include <rutil/GeneralCongestionManager.hxx>
 #include <rutil/Data.hxx>
 #include <rutil/DnsUtil.hxx>
@@ -18,6 +19,13 @@
 #include "repro/XmlRpcConnection.hxx"
 #include "repro/ReproRunner.hxx"
 #include "repro/CommandServer.hxx"
+#include "repro/Proxy.hxx"
+#include "repro/UserStore.hxx"
+
+#if defined(USE_SSL)
+#include "resip/stack/ssl/TlsConnection.hxx"
+#include "resip/stack/ssl/TlsHandshakePool.hxx"
+#endif
 
 using namespace repro;
 using namespace resip;
@@ -93,6 +101,10 @@ CommandServer::handleRequest(unsigned int connectionId, unsigned int requestId,
       {
          handleClearDnsCacheRequest(connectionId, requestId, xml);
       }
+      else if(isEqualNoCase(xml.getTag(), "ClearUserAuthCache"))
+      {
+         handleClearUserAuthCacheRequest(connectionId, requestId, xml);
+      }
       else if(isEqualNoCase(xml.getTag(), "GetDnsCache"))
       {
          handleGetDnsCacheRequest(connectionId, requestId, xml);
@@ -176,6 +188,40 @@ CommandServer::handleStatisticsMessage(resip::StatisticsMessage &statsMessage)
       StatisticsMessage::Payload payload;
       statsMessage.loadOut(payload);  // !slg! could optimize by providing stream operator on StatisticsMessage
       strm << payload << endl;
+#if defined(USE_SSL)
+      TlsConnection::HandshakeStatistics tlsStats = TlsConnection::getHandshakeStatistics();
+      strm << "TLS handshakes: server full=" << tlsStats.serverFull
+           << " resumed=" << tlsStats.serverResumed
+           << ", client full=" << tlsStats.clientFull
+           << " resumed=" << tlsStats.clientResumed
+           << ", failed=" << tlsStats.failed << endl;
+      TlsHandshakePool::Statistics poolStats = TlsHandshakePool::getTotalStatistics();
+      if(poolStats.threads > 0)
+      {
+         strm << "TLS handshake workers: threads=" << poolStats.threads
+              << " queued=" << poolStats.queued
+              << " running=" << poolStats.running
+              << " max queued=" << poolStats.maxQueued
+              << " submitted=" << poolStats.submitted
+              << " rejected=" << poolStats.rejected << endl;
+      }
+#endif
+      unsigned long writes = 0;
+      unsigned long writeMessages = 0;
+      ConnectionManager::getWriteStatistics(writes, writeMessages);
+      strm << "Stream writes: " << writes << ", messages=" << writeMessages;
+      if(writes > 0)
+      {
+         strm << ", messages per write=" << (double)writeMessages / writes;
+      }
+      strm << endl;
+      if(mReproRunner.getProxy())
+      {
+         UserStore& userStore = mReproRunner.getProxy()->getUserStore();
+         strm << "User auth cache: size=" << userStore.getAuthCacheSize()
+              << " hits=" << userStore.getAuthCacheHits()
+              << " misses=" << userStore.getAuthCacheMisses() << endl;
+      }
 
       StatisticsWaitersList::iterator it = mStatisticsWaiters.begin();
       for(; it != mStatisticsWaiters.end(); it++)
@@ -212,6 +258,75 @@ CommandServer::handleClearDnsCacheRequest(unsigned int connectionId, unsigned in
    sendResponse(connectionId, requestId, Data::Empty, 200, "DNS cache cleared.");
 }
 
+void 
+CommandServer::handleClearUserAuthCacheRequest(unsigned int connectionId, unsigned int requestId, XMLCursor& xml)
+{
+   InfoLog(<< "CommandServer::handleClearUserAuthCacheRequest");
+
+   Data user;
+   Data realm;
+
+   // Check for Parameters
+   if(xml.firstChild())
+   {
+      if(isEqualNoCase(xml.getTag(), "request"))
+      {
+         if(xml.firstChild())
+         {
+            while(true)
+            {
+               if(isEqualNoCase(xml.getTag(), "user"))
+               {
+                  if(xml.firstChild())
+                  {
+                     user = xml.getValue();
+                     xml.parent();
+                  }
+               }
+               else if(isEqualNoCase(xml.getTag(), "realm"))
+               {
+                  if(xml.firstChild())
+                  {
+                     realm = xml.getValue();
+                     xml.parent();
+                  }
+               }
+               if(!xml.nextSibling())
+               {
+                  // break on no more sibilings
+                  break;
+               }
+            }
+            xml.parent();
+         }
+      }
+      xml.parent();
+   }
+
+   Proxy* proxy = mReproRunner.getProxy();
+   if(!proxy)
+   {
+      sendResponse(connectionId, requestId, Data::Empty, 400, "Proxy not running.");
+      return;
+   }
+
+   UserStore& userStore = proxy->getUserStore();
+   if(user.empty())
+   {
+      userStore.clearAuthCache();
+      sendResponse(connectionId, requestId, Data::Empty, 200, "User auth cache cleared.");
+   }
+   else if(realm.empty())
+   {
+      sendResponse(connectionId, requestId, Data::Empty, 400, "Invalid parameters: realm is required with user.");
+   }
+   else
+   {
+      userStore.clearAuthCache(user, realm);
+      sendResponse(connectionId, requestId, Data::Empty, 200, "User removed from auth cache.");
+   }
+}
+
 void 
 CommandServer::handleGetDnsCacheRequest(unsigned int connectionId, unsigned int requestId, XMLCursor& xml)
 {
@@ -1,6 +1,7 @@
 #include "repro/Dispatcher.hxx"
 #include "resip/stack/Message.hxx"
 #include "resip/stack/SipStack.hxx"
+#include "rutil/CongestionManager.hxx"
 #include "rutil/WinLeakCheck.hxx"
 
 
@@ -10,17 +11,27 @@ namespace repro
 Dispatcher::Dispatcher(std::auto_ptr<Worker> prototype,
                         resip::SipStack* stack,
                         int workers, 
-                        bool startImmediately):
+                        bool startImmediately,
+                        bool workStealing):
    mStack(stack),
    mFifo(0,0),
+   mWorkQueues(workStealing ? new WorkStealingQueue(workers > 0 ? workers : 1) : 0),
    mAcceptingWork(false),
    mShutdown(false),
    mStarted(false),
-   mWorkerPrototype(prototype.release())
+   mWorkerPrototype(prototype.release()),
+   mCongestionManager(0)
 {
    for(int i=0; i<workers;i++)
    {
-      mWorkerThreads.push_back(new WorkerThread(mWorkerPrototype->clone(),mFifo,mStack));
+      if(mWorkQueues)
+      {
+         mWorkerThreads.push_back(new WorkerThread(mWorkerPrototype->clone(),*mWorkQueues,i,mStack));
+      }
+      else
+      {
+         mWorkerThreads.push_back(new WorkerThread(mWorkerPrototype->clone(),mFifo,mStack));
+      }
    }
    
    if(startImmediately)
@@ -31,6 +42,7 @@ Dispatcher::Dispatcher(std::auto_ptr<Worker> prototype,
 
 Dispatcher::~Dispatcher()
 {
+   setCongestionManager(0);
    shutdownAll();
    
    std::vector<WorkerThread*>::iterator i;
@@ -45,6 +57,7 @@ Dispatcher::~Dispatcher()
    {
       delete mFifo.getNext();
    }
+   delete mWorkQueues;
    
    delete mWorkerPrototype;
    
@@ -56,8 +69,15 @@ Dispatcher::post(std::auto_ptr<resip::ApplicationMessage>& work)
    resip::ReadLock r(mMutex);
    if(mAcceptingWork)
    {
-      mFifo.add(work.release(),
-                  resip::TimeLimitFifo<resip::ApplicationMessage>::InternalElement);
+      if(mWorkQueues)
+      {
+         mWorkQueues->add(work.release());
+      }
+      else
+      {
+         mFifo.add(work.release(),
+                     resip::TimeLimitFifo<resip::ApplicationMessage>::InternalElement);
+      }
       return true;
    }
    
@@ -68,16 +88,59 @@ Dispatcher::post(std::auto_ptr<resip::ApplicationMessage>& work)
    // auto_ptr)
 }
 
+bool
+Dispatcher::post(std::auto_ptr<resip::ApplicationMessage>& work,
+                 const resip::Data& affinityKey)
+{
+   if(!mWorkQueues)
+   {
+      return post(work);
+   }
+
+   resip::ReadLock r(mMutex);
+   if(mAcceptingWork)
+   {
+      mWorkQueues->add(work.release(), affinityKey);
+      return true;
+   }
+   
+   return false;
+}
+
 size_t
 Dispatcher::fifoCountDepth() const 
 {
-   return mFifo.getCountDepth();
+   return mWorkQueues ? mWorkQueues->getCountDepth() : mFifo.getCountDepth();
 }
 
 time_t
 Dispatcher::fifoTimeDepth() const 
 {
-   return mFifo.getTimeDepth();
+   return mWorkQueues ? mWorkQueues->getTimeDepth() : mFifo.getTimeDepth();
+}
+
+resip::FifoStatsInterface&
+Dispatcher::fifoStats()
+{
+   if(mWorkQueues)
+   {
+      return *mWorkQueues;
+   }
+   return mFifo;
+}
+
+void
+Dispatcher::setCongestionManager(resip::CongestionManager* manager)
+{
+   if(mCongestionManager)
+   {
+      mCongestionManager->unregisterFifo(&fifoStats());
+   }
+   mCongestionManager = manager;
+   if(mCongestionManager)
+   {
+      mCongestionManager->registerFifo(&fifoStats());
+   }
 }
 
 int
@@ -3,6 +3,7 @@
 
 #include "repro/WorkerThread.hxx"
 #include "repro/Worker.hxx"
+#include "repro/WorkStealingQueue.hxx"
 #include "resip/stack/ApplicationMessage.hxx"
 #include "rutil/TimeLimitFifo.hxx"
 #include "rutil/RWMutex.hxx"
@@ -13,6 +14,7 @@ namespace resip
 { 
    class SipStack; 
    class ApplicationMessage; 
+   class CongestionManager;
 };
 
 namespace repro
@@ -35,6 +37,11 @@ namespace repro
    of this class when constructing the Dispatcher. Dispatcher will clone this
    Worker as many times as needed to fill the thread bank. 
    
+   By default all of the workers take their work from one shared fifo.  In
+   work stealing mode each worker has its own queue and takes work from the
+   others when its own is empty (see WorkStealingQueue); work posted with an
+   affinity key is then always done by the same worker, in order.
+   
    @note The functions in this class are intended to be thread-safe.
 */
 
@@ -51,11 +58,15 @@ class Dispatcher
          
          @param startImmediately Whether to start this thread bank on 
             construction.
+         
+         @param workStealing Whether to give each worker its own queue and
+            let idle workers steal work from the others.
       */
       Dispatcher(std::auto_ptr<Worker> prototype, 
                   resip::SipStack* stack,
                   int workers=2, 
-                  bool startImmediately=true);
+                  bool startImmediately=true,
+                  bool workStealing=false);
 
       virtual ~Dispatcher();
       
@@ -72,6 +83,14 @@ class Dispatcher
       */
       virtual bool post(std::auto_ptr<resip::ApplicationMessage>& work);
 
+      /**
+         Posts a message to this thread bank.  In work stealing mode all 
+         messages posted with the same affinityKey are processed by the same
+         worker, in the order they were posted; otherwise the key is ignored.
+      */
+      virtual bool post(std::auto_ptr<resip::ApplicationMessage>& work,
+                        const resip::Data& affinityKey);
+
       /**
          @returns The number of messages in this Dispatcher's queue
       */
@@ -82,6 +101,19 @@ class Dispatcher
             the back of the queue was posted.
       */ 
       time_t fifoTimeDepth() const;
+
+      /**
+         @returns The statistics of this Dispatcher's queue, for instance to
+            register it with a CongestionManager.
+      */
+      resip::FifoStatsInterface& fifoStats();
+
+      /**
+         Registers fifoStats() with manager, so that this Dispatcher's queue
+         is reported and managed along with the stack's fifos.  0 unregisters
+         it; the destructor does too.
+      */
+      void setCongestionManager(resip::CongestionManager* manager);
       
       /**
          @returns The number of workers in this thread bank.
@@ -117,12 +149,14 @@ class Dispatcher
    protected:
 
       resip::TimeLimitFifo<resip::ApplicationMessage> mFifo;
+      WorkStealingQueue* mWorkQueues;   // used instead of mFifo in work stealing mode
       bool mAcceptingWork;
       bool mShutdown;
       bool mStarted;
       Worker* mWorkerPrototype;
 
       resip::RWMutex mMutex;
+      resip::CongestionManager* mCongestionManager;
 
       std::vector<WorkerThread*> mWorkerThreads;
 
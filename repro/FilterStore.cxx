@@ -7,6 +7,7 @@
 #include "resip/stack/ExtensionHeader.hxx"
 
 #include "repro/FilterStore.hxx"
+#include "repro/RegexLiterals.hxx"
 #include "rutil/WinLeakCheck.hxx"
 
 
@@ -34,6 +35,7 @@ FilterStore::FilterStore(AbstractDb& db):
       filter.key = key;
       filter.pcond1 = 0;
       filter.pcond2 = 0;
+      filter.hits = new Atomic<unsigned long>(0);
       
       int flags = REG_EXTENDED;
       if(filter.filterRecord.mActionData.find("$") == Data::npos)
@@ -71,6 +73,7 @@ FilterStore::FilterStore(AbstractDb& db):
 
       key = mDb.nextFilterKey();
    } 
+   compileFilters();
    mCursor = mFilterOperators.begin();
 }
 
@@ -89,6 +92,7 @@ FilterStore::~FilterStore()
          regfree(i->pcond2);
          delete i->pcond2;
       }
+      delete i->hits;
    }
    mFilterOperators.clear();
 }
@@ -131,6 +135,7 @@ FilterStore::addFilter(const resip::Data& cond1Header,
    filter.key = key;
    filter.pcond1 = 0;
    filter.pcond2 = 0;
+   filter.hits = new Atomic<unsigned long>(0);
    int flags = REG_EXTENDED;
    if(filter.filterRecord.mActionData.find("$") == Data::npos)
    {
@@ -160,6 +165,7 @@ FilterStore::addFilter(const resip::Data& cond1Header,
    {
       WriteLock lock(mMutex);
       mFilterOperators.insert( filter );
+      compileFilters();
    }
    mCursor = mFilterOperators.begin(); 
 
@@ -205,6 +211,7 @@ FilterStore::eraseFilter(const resip::Data& key)
    {
       WriteLock lock(mMutex);
 
+      std::vector<FilterOp> erased;
       FilterOpList::iterator it = mFilterOperators.begin();
       while (it != mFilterOperators.end())
       {
@@ -212,16 +219,7 @@ FilterStore::eraseFilter(const resip::Data& key)
          {
             FilterOpList::iterator i = it;
             it++;
-            if(i->pcond1)
-            {
-               regfree(i->pcond1);
-               delete i->pcond1;
-            }
-            if(i->pcond2)
-            {
-               regfree(i->pcond2);
-               delete i->pcond2;
-            }
+            erased.push_back(*i);
             mFilterOperators.erase(i);
          }
          else
@@ -229,6 +227,23 @@ FilterStore::eraseFilter(const resip::Data& key)
             it++;
          }
       }
+      compileFilters();
+
+      // No reader can be using the erased filters' regexes and counters any more
+      for (std::vector<FilterOp>::iterator i = erased.begin(); i != erased.end(); i++)
+      {
+         if(i->pcond1)
+         {
+            regfree(i->pcond1);
+            delete i->pcond1;
+         }
+         if(i->pcond2)
+         {
+            regfree(i->pcond2);
+            delete i->pcond2;
+         }
+         delete i->hits;
+      }
    }
    mCursor = mFilterOperators.begin();  // reset the cursor since it may have been on deleted filter
 }
@@ -340,6 +355,10 @@ FilterStore::getHeaderFromSipMessage(const SipMessage& msg, const Data& headerNa
    {
       Data headerData;
       const HeaderFieldValueList* hfv = msg.getRawHeader(headerType);
+      if(!hfv)
+      {
+         return;
+      }
       for(HeaderFieldValueList::const_iterator it = hfv->begin(); it != hfv->end(); it++)
       {
          it->toShareData(headerData);
@@ -421,22 +440,71 @@ FilterStore::applyRegex(int conditionNum, const Data& header, const Data& match,
    return true;
 }
 
+bool
+FilterStore::matchCondition(const CompiledFilters& compiled,
+                            int conditionNum,
+                            unsigned int condition,
+                            const SipMessage& request,
+                            RequestHeaders& headers,
+                            Data& actionData)
+{
+   const CompiledCondition& cond = compiled.conditions[condition];
+   const HeaderMatcher& matcher = compiled.headerMatchers[cond.header];
+   std::list<Data>& values = headers.values[cond.header];
+   if(!headers.fetched[cond.header])
+   {
+      // First condition on this header - get its values and look for the
+      // literal text of every condition on it
+      getHeaderFromSipMessage(request, matcher.headerName, values);
+      for(list<Data>::const_iterator vit = values.begin(); vit != values.end(); vit++)
+      {
+         matcher.scan(*vit, headers.literalFound);
+      }
+      headers.fetched[cond.header] = 1;
+   }
+
+   if(!cond.literal.empty() && !headers.literalFound[condition])
+   {
+      DebugLog( << "  Cond" << conditionNum << " HeaderName=" << matcher.headerName << " does not contain " << cond.literal);
+      return false;
+   }
+
+   for(list<Data>::const_iterator vit = values.begin(); vit != values.end(); vit++)
+   {
+      if(!cond.literal.empty() && vit->find(cond.literal) == Data::npos)
+      {
+         continue;
+      }
+      bool match = applyRegex(conditionNum, *vit, cond.regexText, cond.regex, actionData);
+      DebugLog( << "  Cond" << conditionNum << " HeaderName=" << matcher.headerName << ", Value=" << *vit << ", Regex=" << cond.regexText << ", match=" << match);
+      if(match)
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
 bool
 FilterStore::process(const SipMessage& request, 
                      short& action,
                      Data& actionData)
 {
-   if(mFilterOperators.empty()) return false;  // If there are no filters bail early to save a few cycles (size check is atomic enough, we don't need a lock)
-
-   ReadLock lock(mMutex);
+   Snapshot<CompiledFilters>::Reader compiled(mCompiledFilters);
+   if(compiled->filters.empty()) return false;  // If there are no filters bail early to save a few cycles
 
    Data method(request.methodStr());
    Data event(request.exists(h_Event) ? request.header(h_Event).value() : Data::Empty);
 
-   for (FilterOpList::iterator it = mFilterOperators.begin();
-        it != mFilterOperators.end(); it++)
+   RequestHeaders headers;
+   headers.values.resize(compiled->headerMatchers.size());
+   headers.fetched.resize(compiled->headerMatchers.size(), 0);
+   headers.literalFound.resize(compiled->conditions.size(), 0);
+
+   for (std::vector<CompiledFilter>::const_iterator it = compiled->filters.begin();
+        it != compiled->filters.end(); it++)
    {
-      const AbstractDb::FilterRecord& rec = it->filterRecord;
+      const AbstractDb::FilterRecord& rec = it->filter.filterRecord;
 
       if(!rec.mMethod.empty())
       {
@@ -455,48 +523,20 @@ FilterStore::process(const SipMessage& request,
          }
       }
 
-      // Get requests SIP headers from SipMessage
-      list<Data> condition1Headers;
-      list<Data> condition2Headers;
       actionData = rec.mActionData;
-      if(!rec.mCondition1Header.empty() && it->pcond1)
+      if(it->condition[0] != -1 && !matchCondition(*compiled, 1, it->condition[0], request, headers, actionData))
       {
-         getHeaderFromSipMessage(request, rec.mCondition1Header, condition1Headers);
-
-         // Check condition 1 regex
-         list<Data>::iterator hit = condition1Headers.begin();
-         bool match = false;
-         for(; hit != condition1Headers.end() && match == false; hit++)
-         {
-            match = applyRegex(1, *hit, rec.mCondition1Regex, it->pcond1, actionData);
-            DebugLog( << "  Cond1 HeaderName=" << rec.mCondition1Header << ", Value=" << *hit << ", Regex=" << rec.mCondition1Regex << ", match=" << match);
-         }
-         if(!match)
-         {
-            DebugLog( << "  Skipped - request did not match first condition: " << request.brief());
-            continue;
-         }
+         DebugLog( << "  Skipped - request did not match first condition: " << request.brief());
+         continue;
       }
-      if(!rec.mCondition2Header.empty() && it->pcond2)
+      if(it->condition[1] != -1 && !matchCondition(*compiled, 2, it->condition[1], request, headers, actionData))
       {
-         getHeaderFromSipMessage(request, rec.mCondition2Header, condition2Headers);
-
-         // Check condition 2 regex
-         list<Data>::iterator hit = condition2Headers.begin();
-         bool match = false;
-         for(; hit != condition2Headers.end() && match == false; hit++)
-         {
-            match = applyRegex(2, *hit, rec.mCondition2Regex, it->pcond2, actionData);
-            DebugLog( << "  Cond2 HeaderName=" << rec.mCondition2Header << ", Value=" << *hit << ", Regex=" << rec.mCondition2Regex << ", match=" << match);
-         }
-         if(!match)
-         {
-            DebugLog( << "  Skipped - request did not match second condition: " << request.brief());
-            continue;
-         }
+         DebugLog( << "  Skipped - request did not match second condition: " << request.brief());
+         continue;
       }
       // If we make it here Method, Event and both conditions matched - return configured action
       action = rec.mAction;
+      it->filter.hits->fetchAdd(1);
       return true;
    }
 
@@ -547,6 +587,184 @@ FilterStore::test(const resip::Data& cond1Header,
 }
 
 
+unsigned long
+FilterStore::getFilterHits(const resip::Data& key)
+{
+   ReadLock lock(mMutex);
+
+   if (!findKey(key))
+   {
+      return 0;
+   }
+   return mCursor->hits->load();
+}
+
+
+void
+FilterStore::compileFilters()
+{
+   // called with mMutex held for writing (or from the constructor)
+   CompiledFilters* compiled = new CompiledFilters;
+   std::vector<CompiledCondition>& conditions = compiled->conditions;
+   std::vector<HeaderMatcher>& headerMatchers = compiled->headerMatchers;
+
+   std::map<Data, unsigned int> headerIndex;  // by lower case header name
+   for (FilterOpList::const_iterator it = mFilterOperators.begin();
+        it != mFilterOperators.end(); it++)
+   {
+      CompiledFilter filter;
+      filter.filter = *it;
+      for (int i = 0; i < 2; i++)
+      {
+         const Data& header = i == 0 ? it->filterRecord.mCondition1Header : it->filterRecord.mCondition2Header;
+         const Data& regexText = i == 0 ? it->filterRecord.mCondition1Regex : it->filterRecord.mCondition2Regex;
+         regex_t* regex = i == 0 ? it->pcond1 : it->pcond2;
+         filter.condition[i] = -1;
+         if (header.empty() || !regex)
+         {
+            continue;  // condition is not tested
+         }
+
+         Data name(header);
+         name.lowercase();
+         std::map<Data, unsigned int>::iterator hit = headerIndex.find(name);
+         if (hit == headerIndex.end())
+         {
+            hit = headerIndex.insert(std::make_pair(name, (unsigned int)headerMatchers.size())).first;
+            headerMatchers.push_back(HeaderMatcher());
+            headerMatchers.back().headerName = header;
+         }
+
+         CompiledCondition condition;
+         condition.header = hit->second;
+         condition.regexText = regexText;
+         condition.regex = regex;
+         condition.literal = RegexLiterals::requiredLiteral(regexText);
+         if (!condition.literal.empty())
+         {
+            headerMatchers[condition.header].addLiteral(condition.literal, (unsigned int)conditions.size());
+         }
+         filter.condition[i] = (int)conditions.size();
+         conditions.push_back(condition);
+      }
+      compiled->filters.push_back(filter);
+   }
+
+   for (std::vector<HeaderMatcher>::iterator it = headerMatchers.begin(); it != headerMatchers.end(); it++)
+   {
+      it->build();
+   }
+
+   DebugLog( << "Compiled " << compiled->filters.size() << " filters with " << conditions.size()
+             << " conditions on " << headerMatchers.size() << " headers" );
+   mCompiledFilters.publish(compiled);
+}
+
+
+void
+FilterStore::HeaderMatcher::addLiteral(const Data& literal, unsigned int condition)
+{
+   if (mNodes.empty())
+   {
+      mNodes.push_back(Node());
+   }
+   unsigned int node = 0;
+   for (Data::size_type i = 0; i < literal.size(); i++)
+   {
+      std::map<char, unsigned int>::const_iterator next = mNodes[node].next.find(literal[i]);
+      if (next == mNodes[node].next.end())
+      {
+         unsigned int newNode = (unsigned int)mNodes.size();
+         mNodes.push_back(Node());
+         mNodes[node].next[literal[i]] = newNode;
+         node = newNode;
+      }
+      else
+      {
+         node = next->second;
+      }
+   }
+   mNodes[node].conditions.push_back(condition);
+}
+
+void
+FilterStore::HeaderMatcher::build()
+{
+   // Set the failure links breadth first; a node also reports the literals
+   // that end at its failure node, since they are suffixes of its own
+   std::vector<unsigned int> queue;
+   if (!mNodes.empty())
+   {
+      queue.push_back(0);
+   }
+   for (size_t q = 0; q < queue.size(); q++)
+   {
+      unsigned int node = queue[q];
+      for (std::map<char, unsigned int>::const_iterator it = mNodes[node].next.begin();
+           it != mNodes[node].next.end(); it++)
+      {
+         unsigned int child = it->second;
+         unsigned int fail = 0;
+         if (node != 0)
+         {
+            unsigned int f = mNodes[node].fail;
+            while (true)
+            {
+               std::map<char, unsigned int>::const_iterator next = mNodes[f].next.find(it->first);
+               if (next != mNodes[f].next.end())
+               {
+                  fail = next->second;
+                  break;
+               }
+               if (f == 0)
+               {
+                  break;
+               }
+               f = mNodes[f].fail;
+            }
+         }
+         mNodes[child].fail = fail;
+         mNodes[child].conditions.insert(mNodes[child].conditions.end(),
+                                         mNodes[fail].conditions.begin(),
+                                         mNodes[fail].conditions.end());
+         queue.push_back(child);
+      }
+   }
+}
+
+void
+FilterStore::HeaderMatcher::scan(const Data& value, std::vector<char>& found) const
+{
+   if (mNodes.empty())
+   {
+      return;
+   }
+   unsigned int node = 0;
+   for (Data::size_type i = 0; i < value.size(); i++)
+   {
+      while (true)
+      {
+         std::map<char, unsigned int>::const_iterator next = mNodes[node].next.find(value[i]);
+         if (next != mNodes[node].next.end())
+         {
+            node = next->second;
+            break;
+         }
+         if (node == 0)
+         {
+            break;
+         }
+         node = mNodes[node].fail;
+      }
+      const std::vector<unsigned int>& conditions = mNodes[node].conditions;
+      for (std::vector<unsigned int>::const_iterator it = conditions.begin(); it != conditions.end(); it++)
+      {
+         found[*it] = 1;
+      }
+   }
+}
+
+
 FilterStore::Key 
 FilterStore::buildKey(const resip::Data& cond1Header,
                       const resip::Data& cond1Regex,
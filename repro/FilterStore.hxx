@@ -9,11 +9,15 @@
 
 #include <set>
 #include <list>
+#include <map>
+#include <vector>
 
+#include "rutil/Atomic.hxx"
 #include "rutil/Data.hxx"
 #include "rutil/RWMutex.hxx"
 
 #include "repro/AbstractDb.hxx"
+#include "repro/Snapshot.hxx"
 
 namespace resip
 {
@@ -68,6 +72,7 @@ class FilterStore
                         const short order);
       
       AbstractDb::FilterRecord getFilterRecord(const resip::Data& key);
+      unsigned long getFilterHits(const resip::Data& key);  // requests process() applied the filter to
       
       Key getFirstKey();// return empty if no more
       Key getNextKey(Key& key); // return empty if no more 
@@ -108,6 +113,7 @@ class FilterStore
             Key key;
             regex_t *pcond1;
             regex_t *pcond2;
+            resip::Atomic<unsigned long>* hits;
             AbstractDb::FilterRecord filterRecord;
             bool operator<(const FilterOp&) const;
       };
@@ -116,6 +122,81 @@ class FilterStore
       typedef std::multiset<FilterOp> FilterOpList;
       FilterOpList mFilterOperators; 
       FilterOpList::iterator mCursor;
+
+      // Compiled form of mFilterOperators used by process(), which reads it
+      // through mCompiledFilters without taking mMutex.  Rebuilt and
+      // published under the write lock whenever a filter is added or
+      // removed; the filters are copies that share the compiled regexes and
+      // hit counters (see Snapshot about freeing those).  Conditions are
+      // grouped by the header they test.  The first time a request needs a
+      // header, its values are fetched once and scanned in a single pass for
+      // the literal text that each condition's regex requires (an
+      // Aho-Corasick automaton per header), so the regexes of conditions
+      // whose text is missing are never run.
+      class HeaderMatcher
+      {
+         public:
+            resip::Data headerName;
+
+            void addLiteral(const resip::Data& literal, unsigned int condition);
+            void build();
+            void scan(const resip::Data& value, std::vector<char>& found) const;
+
+         private:
+            class Node
+            {
+               public:
+                  Node() : fail(0) {}
+                  std::map<char, unsigned int> next;
+                  unsigned int fail;
+                  std::vector<unsigned int> conditions;  // whose literal ends here
+            };
+            std::vector<Node> mNodes;
+      };
+
+      class CompiledCondition
+      {
+         public:
+            unsigned int header;  // index into CompiledFilters::headerMatchers
+            resip::Data regexText;
+            regex_t* regex;
+            resip::Data literal;  // empty if the regex requires none
+      };
+
+      class CompiledFilter
+      {
+         public:
+            FilterOp filter;
+            int condition[2];  // indexes into CompiledFilters::conditions, -1 if not tested
+      };
+
+      // Header values fetched from one request, and which conditions' literal
+      // text was found in them
+      class RequestHeaders
+      {
+         public:
+            std::vector<std::list<resip::Data> > values;
+            std::vector<char> fetched;
+            std::vector<char> literalFound;
+      };
+
+      class CompiledFilters
+      {
+         public:
+            std::vector<CompiledFilter> filters;  // in the order they are tried
+            std::vector<CompiledCondition> conditions;
+            std::vector<HeaderMatcher> headerMatchers;
+      };
+
+      void compileFilters();
+      bool matchCondition(const CompiledFilters& compiled,
+                          int conditionNum,
+                          unsigned int condition,
+                          const resip::SipMessage& request,
+                          RequestHeaders& headers,
+                          resip::Data& actionData);
+
+      Snapshot<CompiledFilters> mCompiledFilters;
 };
 
  }
@@ -0,0 +1,98 @@
+#if !defined(RESIP_MESSAGEQUEUEIF_HXX)
+#define RESIP_MESSAGEQUEUEIF_HXX 
+
+#include "rutil/Data.hxx"
+#include <vector>
+
+// Producer and consumer sides of a persistent message queue, as used for
+// accounting events.  Implemented by PersistentMessageEnqueue/Dequeue
+// (BerkeleyDb) and SegmentedMessageLogEnqueue/Dequeue (append-only files).
+//
+// If push, pop or commit fail, then isRecoveryNeeded should be called.  If it
+// returns true, then the queue object should be destroyed and a new one
+// created in order to "recover" the backing store.
+
+namespace repro
+{
+
+class MessageEnqueueIf
+{
+public:
+   virtual ~MessageEnqueueIf() {}
+
+   // if sync is true then each push is written to disk before it returns
+   virtual bool init(bool sync, const resip::Data& queueName) = 0;
+   virtual bool isRecoveryNeeded() = 0;
+
+   virtual bool push(const resip::Data& data) = 0;
+   // Adds all records with a single commit (and a single disk sync), either
+   // all of them are queued or none are
+   virtual bool push(const std::vector<resip::Data>& records) = 0;
+};
+
+class MessageDequeueIf
+{
+public:
+   virtual ~MessageDequeueIf() {}
+
+   virtual bool init(bool sync, const resip::Data& queueName) = 0;
+   virtual bool isRecoveryNeeded() = 0;
+
+   // returns true for success, false for failure - can return true and 0 records if none available
+   virtual bool pop(size_t numRecords, std::vector<resip::Data>& records, bool autoCommit) = 0;
+   virtual bool commit() = 0;
+   virtual void abort() = 0;
+};
+
+}
+
+#endif
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
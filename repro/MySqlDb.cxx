@@ -367,6 +367,15 @@ MySqlDb::getUser( const AbstractDb::Key& key ) const
 
 resip::Data 
 MySqlDb::getUserAuthInfo(  const AbstractDb::Key& key ) const
+{ 
+   Data a1;
+   lookupUserAuthInfo(key, a1);
+   return a1;
+}
+
+
+bool
+MySqlDb::lookupUserAuthInfo( const AbstractDb::Key& key, Data& a1 ) const
 { 
    std::vector<Data> ret;
 
@@ -389,14 +398,20 @@ MySqlDb::getUserAuthInfo(  const AbstractDb::Key& key ) const
       }
    }
 
-   if(singleResultQuery(command, ret) != 0 || ret.size() == 0)
+   a1 = Data::Empty;
+   if(singleResultQuery(command, ret) != 0)
    {
-      return Data::Empty;
+      return false;
+   }
+   if(ret.size() == 0)
+   {
+      return true;
    }
    
    DebugLog( << "Auth password is " << ret.front());
    
-   return ret.front();
+   a1 = ret.front();
+   return true;
 }
 
 
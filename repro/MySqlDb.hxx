@@ -33,6 +33,7 @@ class MySqlDb: public SqlDb
       virtual bool addUser( const Key& key, const UserRecord& rec );
       virtual UserRecord getUser( const Key& key ) const;
       virtual resip::Data getUserAuthInfo(  const Key& key ) const;
+      virtual bool lookupUserAuthInfo( const Key& key, resip::Data& a1 ) const;
       virtual Key firstUserKey();// return empty if no more
       virtual Key nextUserKey(); // return empty if no more 
 
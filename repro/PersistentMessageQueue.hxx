@@ -18,6 +18,7 @@
 #endif
 
 #include "rutil/Data.hxx"
+#include "repro/MessageQueueIf.hxx"
 #include <vector>
 
 // This class implements a persistent message queue that utilizes a BerkeleyDb backing store.
@@ -141,19 +142,24 @@ protected:
    bool mRecoveryNeeded;
 };  
 
-class PersistentMessageEnqueue : public PersistentMessageQueue 
+class PersistentMessageEnqueue : public PersistentMessageQueue, public MessageEnqueueIf 
 { 
 public:
    PersistentMessageEnqueue(const resip::Data& baseDir) : 
       PersistentMessageQueue(baseDir) {}
    virtual ~PersistentMessageEnqueue() {}
+
+   virtual bool init(bool sync, const resip::Data& queueName) { return PersistentMessageQueue::init(sync, queueName); }
+   virtual bool isRecoveryNeeded() { return PersistentMessageQueue::isRecoveryNeeded(); }
    
    // Note:  this has a potential to block if the a consumer crashes and leaves a lock open on the database (deadlock)
    // typically restarting the consumer will "recover" the "dead" lock and allow this call to unblock
    bool push(const resip::Data& data);
+   // All records are put in one transaction, so a synchronous queue flushes its log once per batch
+   bool push(const std::vector<resip::Data>& records);
 };  
 
-class PersistentMessageDequeue : public PersistentMessageQueue 
+class PersistentMessageDequeue : public PersistentMessageQueue, public MessageDequeueIf 
 { 
 public:     
    PersistentMessageDequeue(const resip::Data& baseDir) : 
@@ -161,6 +167,9 @@ public:
       mNumRecords(0) {}
    virtual ~PersistentMessageDequeue () {}
 
+   virtual bool init(bool sync, const resip::Data& queueName) { return PersistentMessageQueue::init(sync, queueName); }
+   virtual bool isRecoveryNeeded() { return PersistentMessageQueue::isRecoveryNeeded(); }
+
    // returns true for success, false for failure - can return true and 0 records if none available
    // Note:  if autoCommit is used then it is safe to allow multiple consumers
    bool pop(size_t numRecords, std::vector<resip::Data>& records, bool autoCommit);
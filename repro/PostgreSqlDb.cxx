@@ -377,6 +377,15 @@ PostgreSqlDb::getUser( const AbstractDb::Key& key ) const
 
 resip::Data 
 PostgreSqlDb::getUserAuthInfo(  const AbstractDb::Key& key ) const
+{ 
+   Data a1;
+   lookupUserAuthInfo(key, a1);
+   return a1;
+}
+
+
+bool
+PostgreSqlDb::lookupUserAuthInfo( const AbstractDb::Key& key, Data& a1 ) const
 { 
    std::vector<Data> ret;
 
@@ -399,14 +408,20 @@ PostgreSqlDb::getUserAuthInfo(  const AbstractDb::Key& key ) const
       }
    }
 
-   if(singleResultQuery(command, ret) != 0 || ret.size() == 0)
+   a1 = Data::Empty;
+   if(singleResultQuery(command, ret) != 0)
    {
-      return Data::Empty;
+      return false;
+   }
+   if(ret.size() == 0)
+   {
+      return true;
    }
    
    DebugLog( << "Auth password is " << ret.front());
    
-   return ret.front();
+   a1 = ret.front();
+   return true;
 }
 
 
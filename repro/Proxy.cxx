@@ -191,7 +191,7 @@ Proxy::thread()
 
                   // The TU selector already checks the URI scheme for us (Sect 16.3, Step 2)
                   if(sip->method()==OPTIONS && 
-                     isMyUri(sip->header(h_RequestLine).uri()))
+                     isMyUri(sip->const_header(h_RequestLine).uri()))
                   {
                      if(mOptionsHandler)
                      {
@@ -204,7 +204,7 @@ Proxy::thread()
                            continue;
                         }
                      }
-                     else if(sip->header(h_RequestLine).uri().user().empty())
+                     else if(sip->const_header(h_RequestLine).uri().user().empty())
                      {
                         std::auto_ptr<SipMessage> resp(new SipMessage);
                         Helper::makeResponse(*resp,*sip,200);
@@ -264,8 +264,8 @@ Proxy::thread()
                   {
                      std::auto_ptr<SipMessage> response(0);
 
-                     for(Tokens::iterator i=sip->header(h_ProxyRequires).begin();
-                           i!=sip->header(h_ProxyRequires).end();
+                     for(Tokens::const_iterator i=sip->const_header(h_ProxyRequires).begin();
+                           i!=sip->const_header(h_ProxyRequires).end();
                            ++i)
                      {
                         if(!i->isWellFormed() || 
@@ -0,0 +1,285 @@
+#include <string.h>
+
+#include "repro/RegexLiterals.hxx"
+#include "rutil/WinLeakCheck.hxx"
+
+using namespace resip;
+using namespace repro;
+using namespace std;
+
+static const char* special = ".[]()*+?{}|^$\\";
+
+// p is at the [ of a bracket expression; returns the position of its ]
+static const char*
+skipBracketExpression(const char* p, const char* end)
+{
+   p++;
+   if (p < end && *p == '^') p++;
+   if (p < end && *p == ']') p++;  // a ] right after [ or [^ is literal
+   while (p < end && *p != ']')
+   {
+      if (*p == '[' && p + 1 < end && (p[1] == ':' || p[1] == '.' || p[1] == '='))
+      {
+         // [:class:], [.coll.] or [=equiv=]
+         const char delim = p[1];
+         p += 2;
+         while (p + 1 < end && !(p[0] == delim && p[1] == ']')) p++;
+         p++;
+      }
+      p++;
+   }
+   return p;
+}
+
+// p is just inside a group; returns the position of the ) that closes it (end
+// if there is none), and whether the group has alternatives of its own
+static const char*
+findGroupEnd(const char* p, const char* end, bool& hasAlternatives)
+{
+   hasAlternatives = false;
+   int depth = 0;
+   for (; p < end; p++)
+   {
+      if (*p == '\\')
+      {
+         p++;
+      }
+      else if (*p == '[')
+      {
+         p = skipBracketExpression(p, end);
+      }
+      else if (*p == '(')
+      {
+         depth++;
+      }
+      else if (*p == ')')
+      {
+         if (depth-- == 0)
+         {
+            return p;
+         }
+      }
+      else if (*p == '|' && depth == 0)
+      {
+         hasAlternatives = true;
+      }
+   }
+   return end;
+}
+
+// true if p is at a quantifier that allows fewer than one repetition (or
+// may, as with {m,n})
+static bool
+isOptional(const char* p, const char* end)
+{
+   return p < end && (*p == '*' || *p == '?' || *p == '{');
+}
+
+// returns the position after the quantifier at p, if any
+static const char*
+skipQuantifier(const char* p, const char* end)
+{
+   if (p < end && (*p == '*' || *p == '+' || *p == '?'))
+   {
+      return p + 1;
+   }
+   if (p < end && *p == '{')
+   {
+      const char* close = (const char*)memchr(p, '}', end - p);
+      return close ? close + 1 : end;
+   }
+   return p;
+}
+
+
+Data
+RegexLiterals::requiredPrefix(const Data& pattern)
+{
+   vector<Data> runs;
+   if (literalRuns(pattern, runs))
+   {
+      return runs.front();
+   }
+   return Data::Empty;
+}
+
+
+Data
+RegexLiterals::requiredLiteral(const Data& pattern)
+{
+   vector<Data> runs;
+   literalRuns(pattern, runs);
+   Data longest;
+   for (vector<Data>::const_iterator it = runs.begin(); it != runs.end(); it++)
+   {
+      if (it->size() > longest.size())
+      {
+         longest = *it;
+      }
+   }
+   return longest;
+}
+
+
+bool
+RegexLiterals::literalRuns(const Data& pattern, vector<Data>& runs)
+{
+   runs.clear();
+   const char* start = pattern.c_str();
+   const char* end = start + strlen(start);
+
+   // "^sip:1800|^sip:1888" matches strings without "sip:1800"
+   bool hasAlternatives;
+   if (findGroupEnd(start, end, hasAlternatives) != end || hasAlternatives)
+   {
+      return false;
+   }
+
+   const bool anchored = start < end && *start == '^';
+   bool firstIsPrefix = false;
+   bool interrupted = false;  // anything but literal text since the start
+   Data run;
+   const char* p = anchored ? start + 1 : start;
+   while (true)
+   {
+      char c = p < end ? *p : 0;
+      const char* next = p + 1;
+      bool literal = false;
+
+      if (p == end)
+      {
+      }
+      else if (c == '(')
+      {
+         // A group that must match exactly once, as in "^sip:(1800[0-9]*)@",
+         // does not interrupt the literal text; any other group may match
+         // anything
+         const char* close = findGroupEnd(next, end, hasAlternatives);
+         if (!hasAlternatives && close < end && !isOptional(close + 1, end) &&
+             !(close + 1 < end && close[1] == '+'))
+         {
+            p = next;
+            continue;
+         }
+         next = close < end ? skipQuantifier(close + 1, end) : end;
+      }
+      else if (c == ')')
+      {
+         p = next;  // the end of a group that matches exactly once
+         continue;
+      }
+      else if (c == '[')
+      {
+         const char* close = skipBracketExpression(p, end);
+         next = close < end ? skipQuantifier(close + 1, end) : end;
+      }
+      else if (c == '\\')
+      {
+         // only an escaped special character is known to be literal
+         if (next < end && strchr(special, *next))
+         {
+            c = *next++;
+            literal = true;
+         }
+         else
+         {
+            next = next < end ? skipQuantifier(next + 1, end) : end;
+         }
+      }
+      else if (c == '.')
+      {
+         next = skipQuantifier(next, end);
+      }
+      else if (!strchr(special, c))
+      {
+         literal = true;
+      }
+
+      if (literal && !isOptional(next, end))
+      {
+         if (run.empty() && runs.empty())
+         {
+            firstIsPrefix = anchored && !interrupted;
+         }
+         run += c;
+         if (next < end && *next == '+')
+         {
+            // repeated at least once; what follows is not next to this one
+            next++;
+         }
+         else
+         {
+            p = next;
+            continue;
+         }
+      }
+      else if (literal)
+      {
+         // optional or repeated a variable number of times
+         next = skipQuantifier(next, end);
+      }
+
+      if (!run.empty())
+      {
+         runs.push_back(run);
+         run.clear();
+      }
+      interrupted = true;
+      if (p == end)
+      {
+         break;
+      }
+      p = next;
+   }
+   return firstIsPrefix && !runs.empty();
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -58,7 +58,11 @@ ReproAuthenticatorFactory::init()
          numAuthGrabberWorkerThreads = 1; // must have at least one thread
       }
       std::auto_ptr<Worker> grabber(new UserAuthGrabber(mProxyConfig.getDataStore()->mUserStore));
-      mAuthRequestDispatcher.reset(new Dispatcher(grabber, &mSipStack, numAuthGrabberWorkerThreads));
+      mAuthRequestDispatcher.reset(new Dispatcher(grabber, &mSipStack, numAuthGrabberWorkerThreads,
+                                                  true /* startImmediately */,
+                                                  mProxyConfig.getConfigBool("DispatcherWorkStealing", false)));
+      mAuthRequestDispatcher->fifoStats().setDescription("AuthRequestDispatcher");
+      mAuthRequestDispatcher->setCongestionManager(mSipStack.getCongestionManager());
    }
 
    // TODO: should be implemented using AbstractDb
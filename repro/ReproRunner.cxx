@@ -32,8 +32,10 @@
 #include "rutil/TransportType.hxx"
 
 #include "resip/stack/SipStack.hxx"
+#include "resip/stack/SipMessage.hxx"
 #include "resip/stack/Compression.hxx"
 #include "resip/stack/EventStackThread.hxx"
+#include "resip/stack/TransportThread.hxx"
 #include "resip/stack/InteropHelper.hxx"
 #include "resip/stack/ConnectionManager.hxx"
 #include "resip/stack/WsCookieContextFactory.hxx"
@@ -87,6 +89,8 @@
 #if defined(USE_SSL)
 #include "repro/stateAgents/CertServer.hxx"
 #include "resip/stack/ssl/Security.hxx"
+#include "resip/stack/ssl/TlsBaseTransport.hxx"
+#include "resip/stack/ssl/TlsConnection.hxx"
 #define DEFAULT_TLS_METHOD "SSLv23"
 #endif
 
@@ -156,6 +160,24 @@ public:
    }
 };
 
+// Transport flags for the UDPRxBatch/UDPTxBatch and Transport<Num>RxBatch/TxBatch
+// settings: move datagrams in batches, and keep going until the socket or the
+// transmit queue is drained
+static unsigned
+udpBatchFlags(bool rxBatch, bool txBatch)
+{
+   unsigned flags = 0;
+   if(rxBatch)
+   {
+      flags |= RESIP_TRANSPORT_FLAG_RXBATCH | RESIP_TRANSPORT_FLAG_RXALL;
+   }
+   if(txBatch)
+   {
+      flags |= RESIP_TRANSPORT_FLAG_TXBATCH | RESIP_TRANSPORT_FLAG_TXALL;
+   }
+   return flags;
+}
+
 class MyProxyConfig : public ProxyConfig
 {
 public:
@@ -323,6 +345,10 @@ ReproRunner::run(int argc, char** argv)
                    mProxyConfig->getConfigData("LogFilename", "repro.log", true).c_str(),
                    isEqualNoCase(loggingType, "file") ? &g_ReproLogger : 0, // if logging to file then write WARNINGS, and Errors to console still
                    syslogFacilityName);
+   if(mProxyConfig->getConfigBool("AsyncLogging", false))
+   {
+      Log::startAsyncWriter(mProxyConfig->getConfigUnsignedLong("AsyncLogRingSize", 262144));
+   }
 
    InfoLog( << "Starting repro version " << VersionUtils::instance().releaseVersion() << "...");
 
@@ -389,6 +415,10 @@ ReproRunner::run(int argc, char** argv)
       mSipStack->run();
    }
    mStackThread->run();
+   for(std::vector<ThreadIf*>::iterator it = mTransportThreads.begin(); it != mTransportThreads.end(); it++)
+   {
+      (*it)->run();
+   }
    if(mDumThread)
    {
       mDumThread->run();
@@ -432,6 +462,10 @@ ReproRunner::shutdown()
    }
    mProxy->shutdown();
    mStackThread->shutdown();
+   for(std::vector<ThreadIf*>::iterator it = mTransportThreads.begin(); it != mTransportThreads.end(); it++)
+   {
+      (*it)->shutdown();
+   }
    if(!mRestarting && mCommandServerThread)  // leave command server running if we are restarting
    {
       mCommandServerThread->shutdown();
@@ -452,6 +486,14 @@ ReproRunner::shutdown()
       mSipStack->shutdownAndJoinThreads();
    }
    mStackThread->join();
+   for(std::vector<ThreadIf*>::iterator it = mTransportThreads.begin(); it != mTransportThreads.end(); it++)
+   {
+      (*it)->join();
+   }
+   SipMessage::dumpPoolStatistics();
+#ifdef USE_SSL
+   TlsConnection::dumpHandshakeStatistics();
+#endif
    if(mWebAdminThread) 
    {
       mWebAdminThread->join();
@@ -491,6 +533,10 @@ ReproRunner::shutdown()
    mSipStack->setCongestionManager(0);
 
    cleanupObjects();
+   if(!mRestarting)
+   {
+      Log::stopAsyncWriter();
+   }
    mRunning = false;
 }
 
@@ -560,6 +606,11 @@ ReproRunner::cleanupObjects()
    delete mAbstractDb; mAbstractDb = 0;
    delete mRuntimeAbstractDb; mRuntimeAbstractDb = 0;
    delete mStackThread; mStackThread = 0;
+   for(std::vector<ThreadIf*>::iterator it = mTransportThreads.begin(); it != mTransportThreads.end(); it++)
+   {
+      delete (*it);
+   }
+   mTransportThreads.clear();
    delete mSipStack; mSipStack = 0;
    delete mCongestionManager; mCongestionManager = 0;
    delete mAsyncProcessHandler; mAsyncProcessHandler = 0;
@@ -685,6 +736,11 @@ ReproRunner::createSipStack()
          "OpenSSLCTXSetOptions", BaseSecurity::OpenSSLCTXSetOptions);
    setOpenSSLCTXOptionsFromConfig(
          "OpenSSLCTXClearOptions", BaseSecurity::OpenSSLCTXClearOptions);
+   BaseSecurity::TlsSessionCacheSize = mProxyConfig->getConfigUnsignedLong("TLSSessionCacheSize", BaseSecurity::TlsSessionCacheSize);
+   BaseSecurity::TlsSessionTimeoutSeconds = mProxyConfig->getConfigInt("TLSSessionTimeout", BaseSecurity::TlsSessionTimeoutSeconds);
+   BaseSecurity::TlsTicketKeyLifetimeSeconds = mProxyConfig->getConfigInt("TLSTicketKeyLifetime", BaseSecurity::TlsTicketKeyLifetimeSeconds);
+   TlsBaseTransport::HandshakeWorkerThreads = (unsigned int)mProxyConfig->getConfigUnsignedLong("TLSHandshakeWorkerThreads", TlsBaseTransport::HandshakeWorkerThreads);
+   TlsBaseTransport::MaxPendingHandshakes = (unsigned int)mProxyConfig->getConfigUnsignedLong("TLSMaxPendingHandshakes", TlsBaseTransport::MaxPendingHandshakes);
    Security::CipherList cipherList = Security::StrongestSuite;
    Data ciphers = mProxyConfig->getConfigData("OpenSSLCipherList", Data::Empty);
    if(!ciphers.empty())
@@ -752,13 +808,29 @@ ReproRunner::createSipStack()
 
    // Create the SipStack Object
    resip_assert(!mSipStack);
-   mSipStack = new SipStack(security,
-                            dnsServers,
-                            mAsyncProcessHandler,
-                            /*stateless*/false,
-                            /*socketFunc*/0,
-                            compression,
-                            mFdPollGrp);
+   SipStackOptions options;
+   options.mSecurity = security;
+   options.mExtraNameserverList = &dnsServers;
+   options.mAsyncProcessHandler = mAsyncProcessHandler;
+   options.mCompression = compression;
+   options.mPollGrp = mFdPollGrp;
+   options.mTransactionShards = mProxyConfig->getConfigUnsignedLong("TransactionShards", 1);
+   if(options.mTransactionShards > 1)
+   {
+      InfoLog(<< "Using " << options.mTransactionShards << " transaction shards");
+   }
+   mSipStack = new SipStack(options);
+
+   // Forwarded requests are copied once per target; let the copies refer
+   // to the received message text instead of duplicating it
+   SipMessage::shareReceiveBuffers = mProxyConfig->getConfigBool("ShareReceiveBuffers", false);
+   SipMessage::poolArenaBlockSize = mProxyConfig->getConfigUnsignedLong("SipMessageArenaBlockSize", 4096);
+   SipMessage::poolArenaMaxBytes = mProxyConfig->getConfigUnsignedLong("SipMessageArenaMaxBytes", 65536);
+
+   // Keep answering from the DNS cache while popular records are refreshed
+   mSipStack->getDnsStub().setDnsCacheStaleTime(mProxyConfig->getConfigInt("DNSCacheStaleTime", 0));
+   mSipStack->getDnsStub().setDnsCachePrefetch(mProxyConfig->getConfigInt("DNSCachePrefetchTime", 0),
+                                               mProxyConfig->getConfigUnsignedLong("DNSCachePrefetchHits", 2));
 
    // Set any enum suffixes from configuration
    std::vector<Data> enumSuffixes;
@@ -813,6 +885,8 @@ ReproRunner::createSipStack()
       InteropHelper::setClientNATDetectionMode(InteropHelper::ClientNATDetectionPrivateToPublicOnly);
    }
    ConnectionManager::MinimumGcHeadroom = mProxyConfig->getConfigUnsignedLong("TCPMinimumGCHeadroom", 0);
+   ConnectionManager::AgressiveGcMaxToRemove = mProxyConfig->getConfigUnsignedLong("TCPConnectionGCMaxToRemove", 100);
+   ConnectionManager::MaxWriteCoalesceBytes = mProxyConfig->getConfigUnsignedLong("TCPWriteCoalesceBytes", 16384);
    unsigned long tcpConnectionGCAge = mProxyConfig->getConfigUnsignedLong("TCPConnectionGCAge", 0);
    if(tcpConnectionGCAge > 0)
    {
@@ -981,6 +1055,8 @@ ReproRunner::createDatastore()
       return false;
    }
    mProxyConfig->createDataStore(mAbstractDb, mRuntimeAbstractDb);
+   mProxyConfig->getDataStore()->mUserStore.setAuthCache(mProxyConfig->getConfigUnsignedLong("UserAuthCacheSize", 0),
+                                                         mProxyConfig->getConfigUnsignedLong("UserAuthCacheTTL", 60));
 
    // Create ImMemory Registration Database
    mRegSyncPort = mProxyConfig->getConfigInt("RegSyncPort", 0);
@@ -1161,7 +1237,11 @@ ReproRunner::createProxy()
       resip_assert(!mAsyncProcessorDispatcher);
       mAsyncProcessorDispatcher = new Dispatcher(std::auto_ptr<Worker>(new AsyncProcessorWorker), 
                                                  mSipStack, 
-                                                 numAsyncProcessorWorkerThreads);
+                                                 numAsyncProcessorWorkerThreads,
+                                                 true /* startImmediately */,
+                                                 mProxyConfig->getConfigBool("DispatcherWorkStealing", false));
+      mAsyncProcessorDispatcher->fifoStats().setDescription("AsyncProcessorDispatcher");
+      mAsyncProcessorDispatcher->setCongestionManager(mCongestionManager);
    }
 
    std::vector<Plugin*>::iterator it;
@@ -1595,6 +1675,9 @@ ReproRunner::addTransports(bool& allTransportsSpecifyRecordRoute)
          // Transport1TlsClientVerification = None
          // Transport1RecordRouteUri = sip:sipdomain.com;transport=TLS
          // Transport1RcvBufLen = 2000
+         // Transport1Shards = 4
+         // Transport1RxBatch = true
+         // Transport1TxBatch = true
 
          allTransportsSpecifyRecordRoute = true;
 
@@ -1616,6 +1699,9 @@ ReproRunner::addTransports(bool& allTransportsSpecifyRecordRoute)
             Data tlsConnectionMethodKey(settingKeyBase + "TlsConnectionMethod");
             Data recordRouteUriSettingKey(settingKeyBase + "RecordRouteUri");
             Data rcvBufSettingKey(settingKeyBase + "RcvBufLen");
+            Data shardsSettingKey(settingKeyBase + "Shards");
+            Data rxBatchSettingKey(settingKeyBase + "RxBatch");
+            Data txBatchSettingKey(settingKeyBase + "TxBatch");
 
             // Parse out interface settings
             ParseBuffer pb(interfaceSettings);
@@ -1687,6 +1773,35 @@ ReproRunner::addTransports(bool& allTransportsSpecifyRecordRoute)
                }
 #endif
 
+               // UDP transports can be split into several SO_REUSEPORT sockets on the
+               // same ip:port, each served by its own TransportThread
+               unsigned long shards = mProxyConfig->getConfigUnsignedLong(shardsSettingKey, 1);
+               unsigned transportFlags = 0;
+               if(shards > 1)
+               {
+                  if(tt == UDP)
+                  {
+                     transportFlags = RESIP_TRANSPORT_FLAG_OWNTHREAD | RESIP_TRANSPORT_FLAG_REUSEPORT;
+                  }
+                  else
+                  {
+                     WarningLog(<< shardsSettingKey << " is only supported for UDP transports, ignoring");
+                     shards = 1;
+                  }
+               }
+
+               // recvmmsg/sendmmsg batches, defaulting to the UDPRxBatch/UDPTxBatch settings
+               bool rxBatch = mProxyConfig->getConfigBool(rxBatchSettingKey, mProxyConfig->getConfigBool("UDPRxBatch", false));
+               bool txBatch = mProxyConfig->getConfigBool(txBatchSettingKey, mProxyConfig->getConfigBool("UDPTxBatch", false));
+               if(tt == UDP)
+               {
+                  transportFlags |= udpBatchFlags(rxBatch, txBatch);
+               }
+               else if(mProxyConfig->getConfigBool(rxBatchSettingKey, false) || mProxyConfig->getConfigBool(txBatchSettingKey, false))
+               {
+                  WarningLog(<< settingKeyBase << "RxBatch/TxBatch are only supported for UDP transports, ignoring");
+               }
+
                Transport *t = mSipStack->addTransport(tt,
                                  port,
                                  DnsUtil::isIpV6Address(ipAddr) ? V6 : V4,
@@ -1695,7 +1810,7 @@ ReproRunner::addTransports(bool& allTransportsSpecifyRecordRoute)
                                  tlsDomain,
                                  tlsPrivateKeyPassPhrase,  // private key passphrase
                                  sslType, // sslType
-                                 0,            // transport flags
+                                 transportFlags,
                                  tlsCertificate, tlsPrivateKey,
                                  cvm,          // tls client verification mode
                                  useEmailAsSIP,
@@ -1758,6 +1873,34 @@ ReproRunner::addTransports(bool& allTransportsSpecifyRecordRoute)
                   {
                      allTransportsSpecifyRecordRoute = false;
                   }
+
+                  if(shards > 1)
+                  {
+                     mTransportThreads.push_back(new TransportThread(*t));
+                     for(unsigned long shard = 1; shard < shards; shard++)
+                     {
+                        Transport* s = mSipStack->addTransport(tt,
+                                          port,
+                                          DnsUtil::isIpV6Address(ipAddr) ? V6 : V4,
+                                          StunEnabled,
+                                          ipAddr,
+                                          Data::Empty,
+                                          Data::Empty,
+                                          SecurityTypes::NoSSL,
+                                          transportFlags);
+                        if(rcvBufLen > 0)
+                        {
+                           s->setRcvBufLen(rcvBufLen);
+                        }
+                        TransportRecordRouteMap::iterator rrIt = mStartupTransportRecordRoutes.find(t->getKey());
+                        if(rrIt != mStartupTransportRecordRoutes.end())
+                        {
+                           mStartupTransportRecordRoutes[s->getKey()] = rrIt->second;
+                        }
+                        mTransportThreads.push_back(new TransportThread(*s));
+                     }
+                     InfoLog(<< "Added " << shards << " SO_REUSEPORT shards for " << interfaceSettings);
+                  }
                }
             }
             else
@@ -1783,6 +1926,8 @@ ReproRunner::addTransports(bool& allTransportsSpecifyRecordRoute)
             isV6Address = true;
          }
          int udpPort = mProxyConfig->getConfigInt("UDPPort", 5060);
+         unsigned udpFlags = udpBatchFlags(mProxyConfig->getConfigBool("UDPRxBatch", false),
+                                           mProxyConfig->getConfigBool("UDPTxBatch", false));
          int tcpPort = mProxyConfig->getConfigInt("TCPPort", 5060);
          int tlsPort = mProxyConfig->getConfigInt("TLSPort", 5061);
          int wsPort = mProxyConfig->getConfigInt("WSPort", 80);
@@ -1834,8 +1979,8 @@ ReproRunner::addTransports(bool& allTransportsSpecifyRecordRoute)
 
          if (udpPort)
          {
-            if (mUseV4 && isV4Address) mSipStack->addTransport(UDP, udpPort, V4, StunEnabled, ipAddress);
-            if (mUseV6 && isV6Address) mSipStack->addTransport(UDP, udpPort, V6, StunEnabled, ipAddress);
+            if (mUseV4 && isV4Address) mSipStack->addTransport(UDP, udpPort, V4, StunEnabled, ipAddress, Data::Empty, Data::Empty, SecurityTypes::NoSSL, udpFlags);
+            if (mUseV6 && isV6Address) mSipStack->addTransport(UDP, udpPort, V6, StunEnabled, ipAddress, Data::Empty, Data::Empty, SecurityTypes::NoSSL, udpFlags);
          }
          if (tcpPort)
          {
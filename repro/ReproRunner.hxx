@@ -99,6 +99,7 @@ protected:
    resip::AsyncProcessHandler* mAsyncProcessHandler;
    resip::SipStack* mSipStack;
    resip::ThreadIf* mStackThread;
+   std::vector<resip::ThreadIf*> mTransportThreads;  // for UDP REUSEPORT shards
    AbstractDb* mAbstractDb;
    AbstractDb* mRuntimeAbstractDb;
    resip::RegistrationPersistenceManager* mRegistrationPersistenceManager;
@@ -272,8 +272,8 @@ RequestContext::processRequestInviteTransaction(SipMessage* msg, bool original)
                      "response was a 2xx. Someone didn't change their tid "
                      "like they were supposed to...");
             if((msg->exists(h_Routes) && !msg->header(h_Routes).empty()) ||   // If ACK/200 has a Route header   OR
-               (!getProxy().isMyUri(msg->header(h_RequestLine).uri()) &&      // RequestUri is not us and From Uri is our domain
-                (msg->header(h_From).isWellFormed() && getProxy().isMyUri(msg->header(h_From).uri()))))
+               (!getProxy().isMyUri(msg->const_header(h_RequestLine).uri()) &&      // RequestUri is not us and From Uri is our domain
+                (msg->const_header(h_From).isWellFormed() && getProxy().isMyUri(msg->const_header(h_From).uri()))))
             {
                forwardAck200(*msg);
             }
@@ -379,7 +379,7 @@ RequestContext::processRequestAckTransaction(SipMessage* msg, bool original)
    {
       // .slg. look at mOriginalRequest for Routes since removeTopRouteIfSelf() is only called on mOriginalRequest
       if((!mOriginalRequest->exists(h_Routes) || mOriginalRequest->header(h_Routes).empty()) &&
-          getProxy().isMyUri(msg->header(h_RequestLine).uri()))
+          getProxy().isMyUri(msg->const_header(h_RequestLine).uri()))
       {
          // .bwc. Someone sent an ACK with us in the Request-Uri, and no
          // Route headers (after we have removed ourself). We will never perform 
@@ -388,7 +388,7 @@ RequestContext::processRequestAckTransaction(SipMessage* msg, bool original)
          handleSelfAimedStrayAck(msg);
       }
       // Note: mTopRoute is only populated if RemoveTopRouteIfSelf successfully removes the top route.
-      else if(msg->hasForceTarget() || !mTopRoute.uri().host().empty() || getProxy().isMyUri(msg->header(h_From).uri()))
+      else if(msg->hasForceTarget() || !mTopRoute.uri().host().empty() || getProxy().isMyUri(msg->const_header(h_From).uri()))
       {
          // Top most route is us, or From header uri is ours.  Note:  The From check is 
          // required to interoperate with endpoints that configure outbound proxy 
@@ -1084,21 +1084,21 @@ RequestContext::getDigestRealm()
    }
 
    // (2) Check From domain
-   if (mProxy.isMyDomain(mOriginalRequest->header(h_From).uri().host()))
+   if (mProxy.isMyDomain(mOriginalRequest->const_header(h_From).uri().host()))
    {
-      return mOriginalRequest->header(h_From).uri().host();
+      return mOriginalRequest->const_header(h_From).uri().host();
    }
 
    // (3) Check Top Route Header
    if (mOriginalRequest->exists(h_Routes) &&
-         mOriginalRequest->header(h_Routes).size()!=0 &&
-         mOriginalRequest->header(h_Routes).front().isWellFormed())
+         mOriginalRequest->const_header(h_Routes).size()!=0 &&
+         mOriginalRequest->const_header(h_Routes).front().isWellFormed())
    {
       // !abr! Add this when we get a chance
    }
 
    // (4) Punt: Use Request URI
-   return mOriginalRequest->header(h_RequestLine).uri().host();
+   return mOriginalRequest->const_header(h_RequestLine).uri().host();
 }
 
 EncodeStream&
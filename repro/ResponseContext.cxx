@@ -721,7 +721,7 @@ ResponseContext::getInboundFlowToken(bool doPathInstead)
       else if(doPathInstead)
       {
          // Need to try to detect Path failures
-         if(orig.empty(h_Paths) || !orig.header(h_Paths).back().uri().exists(p_ob))
+         if(orig.empty(h_Paths) || !orig.const_header(h_Paths).back().uri().exists(p_ob))
          {
             // Yikes! Client is trying to use outbound, but edge-proxy did not
             // support it. The registrar will either reject this (if it supports 
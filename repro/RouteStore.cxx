@@ -1,9 +1,12 @@
 
+#include <algorithm>
+
 #include "rutil/Logger.hxx"
 #include "rutil/ParseBuffer.hxx"
 #include "rutil/Lock.hxx"
 #include "resip/stack/Uri.hxx"
 
+#include "repro/RegexLiterals.hxx"
 #include "repro/RouteStore.hxx"
 #include "rutil/WinLeakCheck.hxx"
 
@@ -73,6 +76,8 @@ RouteStore::RouteStore(AbstractDb& db):
       }
    }
 
+   compileRoutes();
+
    // Initialize cursor to the start
    mCursor = mRouteOperators.begin();
 }
@@ -143,6 +148,7 @@ RouteStore::addRoute(const resip::Data& method,
    {
       WriteLock lock(mMutex);
       mRouteOperators.insert( route );
+      compileRoutes();
    }
    mCursor = mRouteOperators.begin(); 
 
@@ -186,6 +192,7 @@ RouteStore::eraseRoute(const resip::Data& key )
    {
       WriteLock lock(mMutex);
 
+      std::vector<regex_t*> erased;
       RouteOpList::iterator it = mRouteOperators.begin();
       while ( it != mRouteOperators.end() )
       {
@@ -195,12 +202,7 @@ RouteStore::eraseRoute(const resip::Data& key )
             it++;
             if ( i->preq )
             {
-               regfree ( i->preq );
-               delete i->preq;
-
-               // !abr! Can't modify elements in a set
-               //i->preq = 0;
-
+               erased.push_back(i->preq);
             }
             mRouteOperators.erase(i);
          }
@@ -209,6 +211,14 @@ RouteStore::eraseRoute(const resip::Data& key )
             it++;
          }
       }
+      compileRoutes();
+
+      // No reader can be using the erased routes' regexes any more
+      for (std::vector<regex_t*>::iterator i = erased.begin(); i != erased.end(); i++)
+      {
+         regfree(*i);
+         delete *i;
+      }
    }
    mCursor = mRouteOperators.begin();  // reset the cursor since it may have been on deleted route
 }
@@ -306,13 +316,44 @@ RouteStore::process(const resip::Uri& ruri,
                     const resip::Data& event)
 {
    RouteStore::UriList targetSet;
-   if(mRouteOperators.empty()) return targetSet;  // If there are no routes bail early to save a few cycles (size check is atomic enough, we don't need a lock)
+   Snapshot<CompiledRoutes>::Reader compiled(mCompiledRoutes);
+   if(compiled->routes.empty()) return targetSet;  // If there are no routes bail early to save a few cycles
 
-   ReadLock lock(mMutex);
+   Data uri;
+   {
+      DataStream s(uri);
+      s << ruri;
+      s.flush();
+   }
 
-   for (RouteOpList::iterator it = mRouteOperators.begin();
-        it != mRouteOperators.end(); it++)
+   // Collect the routes whose required prefix the request URI starts with,
+   // then try them in route order
+   std::vector<unsigned int> candidates;
+   const char* pos = uri.data();
+   const char* end = pos + uri.size();
+   unsigned int node = 0;
+   while (true)
    {
+      const std::vector<unsigned int>& routes = compiled->prefixTrie[node].routes;
+      candidates.insert(candidates.end(), routes.begin(), routes.end());
+      if (pos == end)
+      {
+         break;
+      }
+      std::map<char, unsigned int>::const_iterator child = compiled->prefixTrie[node].children.find(*pos++);
+      if (child == compiled->prefixTrie[node].children.end())
+      {
+         break;
+      }
+      node = child->second;
+   }
+   std::sort(candidates.begin(), candidates.end());
+
+   for (std::vector<unsigned int>::const_iterator c = candidates.begin();
+        c != candidates.end(); c++)
+   {
+      const RouteOp* it = &compiled->routes[*c];
+
       DebugLog( << "Consider route " // << *it
                 << " reqUri=" << ruri
                 << " method=" << method 
@@ -344,13 +385,6 @@ RouteStore::process(const resip::Uri& ruri,
          int ret;
          // TODO - !cj! www.pcre.org looks like it has better performance
          // !mbg! is this true now that the compiled regexp is used?
-         Data uri;
-         {
-            DataStream s(uri);
-            s << ruri;
-            s.flush();
-         }
-         
          const int nmatch=10;
          regmatch_t pmatch[nmatch];
          
@@ -430,6 +464,50 @@ RouteStore::process(const resip::Uri& ruri,
 }
   
 
+void
+RouteStore::compileRoutes()
+{
+   // called with mMutex held for writing (or from the constructor)
+   CompiledRoutes* compiled = new CompiledRoutes;
+   std::vector<PrefixNode>& trie = compiled->prefixTrie;
+   trie.assign(1, PrefixNode());
+
+   for (RouteOpList::const_iterator it = mRouteOperators.begin();
+        it != mRouteOperators.end(); it++)
+   {
+      if (!it->preq)
+      {
+         continue;  // routes without a valid pattern never produce a target
+      }
+      unsigned int index = (unsigned int)compiled->routes.size();
+      compiled->routes.push_back(*it);
+
+      Data prefix = RegexLiterals::requiredPrefix(it->routeRecord.mMatchingPattern);
+      unsigned int node = 0;
+      for (Data::size_type i = 0; i < prefix.size(); i++)
+      {
+         std::map<char, unsigned int>::const_iterator child = trie[node].children.find(prefix[i]);
+         if (child == trie[node].children.end())
+         {
+            unsigned int newNode = (unsigned int)trie.size();
+            trie.push_back(PrefixNode());
+            trie[node].children[prefix[i]] = newNode;
+            node = newNode;
+         }
+         else
+         {
+            node = child->second;
+         }
+      }
+      trie[node].routes.push_back(index);
+   }
+
+   DebugLog( << "Compiled " << compiled->routes.size() << " routes into "
+             << trie.size() << " prefix nodes" );
+   mCompiledRoutes.publish(compiled);
+}
+
+
 RouteStore::Key 
 RouteStore::buildKey(const resip::Data& method,
                      const resip::Data& event,
@@ -7,13 +7,16 @@
 #include <regex.h>
 #endif
 
+#include <map>
 #include <set>
+#include <vector>
 
 #include "rutil/Data.hxx"
 #include "rutil/RWMutex.hxx"
 #include "resip/stack/Uri.hxx"
 
 #include "repro/AbstractDb.hxx"
+#include "repro/Snapshot.hxx"
 
 
 namespace repro
@@ -80,6 +83,31 @@ class RouteStore
       typedef std::multiset<RouteOp> RouteOpList;
       RouteOpList mRouteOperators; 
       RouteOpList::iterator mCursor;
+
+      // Compiled form of mRouteOperators used by process(), which reads it
+      // through mCompiledRoutes without taking mMutex.  Most dial plan
+      // patterns are anchored and start with literal text ("^sip:1800...").
+      // Each route hangs off the trie node for the literal text its pattern
+      // requires at the start of the request URI (the root if none), so
+      // only the routes along the path spelled by the request URI need
+      // their regex run.  Rebuilt and published, under the write lock,
+      // whenever a route is added or removed.  The routes are copies that
+      // share the compiled regexes (see Snapshot about freeing those).
+      class PrefixNode
+      {
+         public:
+            std::map<char, unsigned int> children;
+            std::vector<unsigned int> routes;  // indexes into CompiledRoutes::routes
+      };
+      class CompiledRoutes
+      {
+         public:
+            std::vector<RouteOp> routes;  // in the order they are tried
+            std::vector<PrefixNode> prefixTrie;  // [0] is the root
+      };
+      Snapshot<CompiledRoutes> mCompiledRoutes;
+
+      void compileRoutes();
 };
 
  }
@@ -0,0 +1,617 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "rutil/Data.hxx"
+#include "rutil/DataStream.hxx"
+#include "rutil/FileSystem.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/ParseBuffer.hxx"
+
+#include "repro/SegmentedMessageLog.hxx"
+#include "rutil/WinLeakCheck.hxx"
+
+using namespace resip;
+using namespace repro;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::REPRO
+
+namespace
+{
+
+const Data segmentPrefix("msglog.");
+const Data positionFileName("msglog.pos");
+
+struct RecordHeader
+{
+   UInt32 length;
+   UInt32 checksum;
+};
+
+// FNV-1a
+UInt32
+checksum(const char* data, size_t length)
+{
+   UInt32 hash = 2166136261U;
+   for(size_t i = 0; i < length; i++)
+   {
+      hash ^= (unsigned char)data[i];
+      hash *= 16777619U;
+   }
+   return hash;
+}
+
+Data
+homeDirectory(const Data& baseDir, const Data& queueName)
+{
+   if (baseDir.postfix("/") ||
+       baseDir.postfix("\\") ||
+       baseDir.empty())
+   {
+      return baseDir + queueName;
+   }
+   return baseDir + Data("/") + queueName;
+}
+
+Data
+segmentPath(const Data& homeDir, UInt64 segment)
+{
+   Data number(segment);
+   while(number.size() < 10)
+   {
+      number = "0" + number;
+   }
+   return homeDir + "/" + segmentPrefix + number;
+}
+
+// returns 0 if the directory holds no segments
+UInt64
+findSegment(const Data& homeDir, bool lowest)
+{
+   UInt64 found = 0;
+   FileSystem::Directory dir(homeDir);
+   for(FileSystem::Directory::iterator it = dir.begin(); it != dir.end(); ++it)
+   {
+      if(it->prefix(segmentPrefix) && *it != positionFileName)
+      {
+         UInt64 segment = it->substr(segmentPrefix.size()).convertUInt64();
+         if(segment > 0 && (found == 0 || (lowest ? segment < found : segment > found)))
+         {
+            found = segment;
+         }
+      }
+   }
+   return found;
+}
+
+// Returns the offset following the record at offset in the segment data, or
+// offset if there is no complete record there.
+UInt64
+nextRecord(const char* data, UInt64 size, UInt64 offset)
+{
+   if(size - offset < sizeof(RecordHeader))
+   {
+      return offset;
+   }
+   RecordHeader header;
+   memcpy(&header, data + offset, sizeof(header));
+   if(size - offset - sizeof(header) < header.length ||
+      checksum(data + offset + sizeof(header), header.length) != header.checksum)
+   {
+      return offset;
+   }
+   return offset + sizeof(header) + header.length;
+}
+
+// Returns the offset of the end of the last complete record
+UInt64
+scanRecords(const char* data, UInt64 size)
+{
+   UInt64 offset = 0;
+   UInt64 next;
+   while((next = nextRecord(data, size, offset)) != offset)
+   {
+      offset = next;
+   }
+   return offset;
+}
+
+}
+
+SegmentedMessageLogEnqueue::SegmentedMessageLogEnqueue(const Data& baseDir, UInt64 segmentSize) :
+   mBaseDir(baseDir),
+   mSegmentSize(segmentSize),
+   mSync(true),
+   mFile(0),
+   mSegmentNumber(0),
+   mSegmentOffset(0),
+   mRecoveryNeeded(false)
+{
+}
+
+SegmentedMessageLogEnqueue::~SegmentedMessageLogEnqueue()
+{
+   closeSegment();
+}
+
+bool
+SegmentedMessageLogEnqueue::init(bool sync, const Data& queueName)
+{
+   mSync = sync;
+   mHomeDir = homeDirectory(mBaseDir, queueName);
+
+   // Create directory if it doesn't exist
+   FileSystem::Directory dir(mHomeDir);
+   dir.create();
+
+   UInt64 last = findSegment(mHomeDir, false /* lowest */);
+   if(last == 0)
+   {
+      return openSegment(1);
+   }
+
+   // Continue the last segment, unless it ends with a partly written record
+   // (after a crash); then leave that for the consumer to skip and start a
+   // new one.
+   FILE* file = fopen(segmentPath(mHomeDir, last).c_str(), "rb");
+   if(!file)
+   {
+      WarningLog(<< "SegmentedMessageLogEnqueue::init - cannot read " << segmentPath(mHomeDir, last));
+      return false;
+   }
+   Data contents;
+   char buffer[8192];
+   size_t bytes;
+   while((bytes = fread(buffer, 1, sizeof(buffer), file)) > 0)
+   {
+      contents.append(buffer, (Data::size_type)bytes);
+   }
+   fclose(file);
+
+   if(scanRecords(contents.data(), contents.size()) != contents.size())
+   {
+      WarningLog(<< "SegmentedMessageLogEnqueue::init - " << segmentPath(mHomeDir, last) << " ends with an incomplete record");
+      return openSegment(last + 1);
+   }
+   if(!openSegment(last))
+   {
+      return false;
+   }
+   mSegmentOffset = contents.size();
+   return true;
+}
+
+bool
+SegmentedMessageLogEnqueue::isRecoveryNeeded()
+{
+   return mRecoveryNeeded;
+}
+
+bool
+SegmentedMessageLogEnqueue::push(const Data& data)
+{
+   return push(vector<Data>(1, data));
+}
+
+bool
+SegmentedMessageLogEnqueue::push(const vector<Data>& records)
+{
+   if(!mFile)
+   {
+      return false;
+   }
+
+   mBuffer.clear();
+   for(size_t i = 0; i < records.size(); i++)
+   {
+      RecordHeader header;
+      header.length = records[i].size();
+      header.checksum = checksum(records[i].data(), records[i].size());
+      mBuffer.append((const char*)&header, sizeof(header));
+      mBuffer.append(records[i].data(), records[i].size());
+   }
+   if(mBuffer.empty())
+   {
+      return true;
+   }
+
+   if(mSegmentOffset > 0 && mSegmentOffset + mBuffer.size() > mSegmentSize)
+   {
+      if(!openSegment(mSegmentNumber + 1))
+      {
+         mRecoveryNeeded = true;
+         return false;
+      }
+   }
+
+   if(fwrite(mBuffer.data(), 1, mBuffer.size(), mFile) != mBuffer.size() ||
+      fflush(mFile) != 0)
+   {
+      WarningLog(<< "SegmentedMessageLogEnqueue::push - write to " << segmentPath(mHomeDir, mSegmentNumber) << " failed");
+      mRecoveryNeeded = true;
+      return false;
+   }
+   mSegmentOffset += mBuffer.size();
+
+   if(mSync)
+   {
+#ifdef WIN32
+      int res = _commit(_fileno(mFile));
+#else
+      int res = fsync(fileno(mFile));
+#endif
+      if(res != 0)
+      {
+         WarningLog(<< "SegmentedMessageLogEnqueue::push - sync of " << segmentPath(mHomeDir, mSegmentNumber) << " failed");
+         mRecoveryNeeded = true;
+         return false;
+      }
+   }
+   return true;
+}
+
+bool
+SegmentedMessageLogEnqueue::openSegment(UInt64 number)
+{
+   closeSegment();
+   mFile = fopen(segmentPath(mHomeDir, number).c_str(), "ab");
+   if(!mFile)
+   {
+      WarningLog(<< "SegmentedMessageLogEnqueue::openSegment - cannot open " << segmentPath(mHomeDir, number));
+      return false;
+   }
+   mSegmentNumber = number;
+   mSegmentOffset = 0;
+   return true;
+}
+
+void
+SegmentedMessageLogEnqueue::closeSegment()
+{
+   if(mFile)
+   {
+      fclose(mFile);
+      mFile = 0;
+   }
+}
+
+SegmentedMessageLogDequeue::SegmentedMessageLogDequeue(const Data& baseDir) :
+   mBaseDir(baseDir),
+   mSync(true),
+   mRecoveryNeeded(false),
+   mReadSegment(0),
+   mReadOffset(0),
+   mCommittedSegment(0),
+   mCommittedOffset(0),
+   mMap(0),
+   mMapSize(0),
+   mMapSegment(0)
+{
+}
+
+SegmentedMessageLogDequeue::~SegmentedMessageLogDequeue()
+{
+   unmap();
+}
+
+bool
+SegmentedMessageLogDequeue::init(bool sync, const Data& queueName)
+{
+   mSync = sync;
+   mHomeDir = homeDirectory(mBaseDir, queueName);
+
+   // Create directory if it doesn't exist
+   FileSystem::Directory dir(mHomeDir);
+   dir.create();
+
+   FILE* file = fopen((mHomeDir + "/" + positionFileName).c_str(), "rb");
+   if(file)
+   {
+      char buffer[64];
+      size_t bytes = fread(buffer, 1, sizeof(buffer), file);
+      fclose(file);
+      Data position(buffer, (Data::size_type)bytes);
+      try
+      {
+         ParseBuffer pb(position);
+         mCommittedSegment = pb.uInt64();
+         pb.skipWhitespace();
+         mCommittedOffset = pb.uInt64();
+      }
+      catch(BaseException& e)
+      {
+         WarningLog(<< "SegmentedMessageLogDequeue::init - bad " << positionFileName << ", reading from the oldest segment: " << e);
+         mCommittedSegment = 0;
+         mCommittedOffset = 0;
+      }
+   }
+
+   // Start at the oldest segment if the recorded one is gone (or there is none)
+   UInt64 first = findSegment(mHomeDir, true /* lowest */);
+   if(mCommittedSegment < first || mCommittedSegment == 0)
+   {
+      mCommittedSegment = first ? first : 1;
+      mCommittedOffset = 0;
+   }
+   abort();
+   return true;
+}
+
+bool
+SegmentedMessageLogDequeue::isRecoveryNeeded()
+{
+   return mRecoveryNeeded;
+}
+
+bool
+SegmentedMessageLogDequeue::pop(size_t numRecords, vector<Data>& records, bool autoCommit)
+{
+   records.clear();
+   while(records.size() < numRecords)
+   {
+      if(mMapSegment != mReadSegment || mReadOffset >= mMapSize)
+      {
+         // Nothing more mapped - the segment may have grown since
+         if(!map(mReadSegment))
+         {
+            if(!segmentExists(mReadSegment + 1))
+            {
+               break;
+            }
+            mReadSegment++;
+            mReadOffset = 0;
+            continue;
+         }
+      }
+
+      UInt64 next;
+      while(records.size() < numRecords &&
+            (next = nextRecord(mMap, mMapSize, mReadOffset)) != mReadOffset)
+      {
+         records.push_back(Data(mMap + mReadOffset + sizeof(RecordHeader),
+                                (Data::size_type)(next - mReadOffset - sizeof(RecordHeader))));
+         mReadOffset = next;
+      }
+      if(records.size() == numRecords)
+      {
+         break;
+      }
+
+      // The producer only starts the next segment once it is done with this
+      // one, so if the next one exists, then remap this one to be sure
+      // nothing was added in between, and move on if nothing was.
+      if(!segmentExists(mReadSegment + 1))
+      {
+         break;
+      }
+      if(map(mReadSegment) && nextRecord(mMap, mMapSize, mReadOffset) != mReadOffset)
+      {
+         continue;
+      }
+      if(mReadOffset < mMapSize)
+      {
+         WarningLog(<< "SegmentedMessageLogDequeue::pop - skipping " << mMapSize - mReadOffset
+                    << " bytes of incomplete records at the end of " << segmentPath(mHomeDir, mReadSegment));
+      }
+      mReadSegment++;
+      mReadOffset = 0;
+   }
+
+   if(autoCommit)
+   {
+      return commit();
+   }
+   return true;
+}
+
+bool
+SegmentedMessageLogDequeue::commit()
+{
+   if(mReadSegment == mCommittedSegment && mReadOffset == mCommittedOffset)
+   {
+      return true;
+   }
+
+   Data position;
+   {
+      DataStream ds(position);
+      ds << mReadSegment << " " << mReadOffset << endl;
+   }
+   Data path = mHomeDir + "/" + positionFileName;
+   Data tempPath = path + ".tmp";
+   FILE* file = fopen(tempPath.c_str(), "wb");
+   if(!file)
+   {
+      WarningLog(<< "SegmentedMessageLogDequeue::commit - cannot write " << tempPath);
+      return false;
+   }
+   bool ok = fwrite(position.data(), 1, position.size(), file) == position.size() && fflush(file) == 0;
+   if(ok && mSync)
+   {
+#ifdef WIN32
+      ok = _commit(_fileno(file)) == 0;
+#else
+      ok = fsync(fileno(file)) == 0;
+#endif
+   }
+   fclose(file);
+#ifdef WIN32
+   ::remove(path.c_str());  // rename does not replace an existing file
+#endif
+   if(!ok || rename(tempPath.c_str(), path.c_str()) != 0)
+   {
+      WarningLog(<< "SegmentedMessageLogDequeue::commit - cannot write " << path);
+      return false;
+   }
+
+   // Segments before the one being read are done with
+   for(UInt64 segment = mCommittedSegment; segment < mReadSegment; segment++)
+   {
+      if(mMapSegment == segment)
+      {
+         unmap();
+      }
+      ::remove(segmentPath(mHomeDir, segment).c_str());
+   }
+   mCommittedSegment = mReadSegment;
+   mCommittedOffset = mReadOffset;
+   return true;
+}
+
+void
+SegmentedMessageLogDequeue::abort()
+{
+   mReadSegment = mCommittedSegment;
+   mReadOffset = mCommittedOffset;
+}
+
+bool
+SegmentedMessageLogDequeue::map(UInt64 segment)
+{
+   unmap();
+   Data path = segmentPath(mHomeDir, segment);
+#ifdef WIN32
+   HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                             0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+   if(file == INVALID_HANDLE_VALUE)
+   {
+      return false;
+   }
+   LARGE_INTEGER size;
+   if(!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+   {
+      CloseHandle(file);
+      return false;
+   }
+   HANDLE mapping = CreateFileMapping(file, 0, PAGE_READONLY, 0, 0, 0);
+   CloseHandle(file);
+   if(!mapping)
+   {
+      return false;
+   }
+   void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+   CloseHandle(mapping);  // the view keeps the mapping open
+   if(!view)
+   {
+      return false;
+   }
+   mMap = (const char*)view;
+   mMapSize = (UInt64)size.QuadPart;
+#else
+   int fd = open(path.c_str(), O_RDONLY);
+   if(fd < 0)
+   {
+      return false;
+   }
+   struct stat st;
+   if(fstat(fd, &st) != 0 || st.st_size == 0)
+   {
+      close(fd);
+      return false;
+   }
+   void* view = mmap(0, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);  // the mapping keeps the file open
+   if(view == MAP_FAILED)
+   {
+      WarningLog(<< "SegmentedMessageLogDequeue::map - cannot map " << path);
+      return false;
+   }
+   mMap = (const char*)view;
+   mMapSize = (UInt64)st.st_size;
+#endif
+   mMapSegment = segment;
+   return true;
+}
+
+void
+SegmentedMessageLogDequeue::unmap()
+{
+   if(mMap)
+   {
+#ifdef WIN32
+      UnmapViewOfFile(mMap);
+#else
+      munmap((void*)mMap, (size_t)mMapSize);
+#endif
+      mMap = 0;
+      mMapSize = 0;
+      mMapSegment = 0;
+   }
+}
+
+bool
+SegmentedMessageLogDequeue::segmentExists(UInt64 segment) const
+{
+   FILE* file = fopen(segmentPath(mHomeDir, segment).c_str(), "rb");
+   if(file)
+   {
+      fclose(file);
+      return true;
+   }
+   return false;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,146 @@
+#if !defined(RESIP_SEGMENTEDMESSAGELOG_HXX)
+#define RESIP_SEGMENTEDMESSAGELOG_HXX
+
+#include <stdio.h>
+#include <vector>
+
+#include "rutil/compat.hxx"
+#include "rutil/Data.hxx"
+#include "repro/MessageQueueIf.hxx"
+
+// A persistent message queue kept as a sequence of append-only files
+// (segments) in <baseDir>/<queueName>: msglog.0000000001, msglog.0000000002,
+// etc.  A segment is closed once it reaches the configured size and the next
+// one is started; a batch of records is never split between segments.
+//
+// Each record is an 8 byte header (length and checksum of the data, in host
+// byte order) followed by the data.  The producer appends a whole batch with
+// one write and, if synchronous, one disk sync.  The consumer maps the
+// segments into memory, so reading does not copy through the kernel, and
+// remembers how far it has read in msglog.pos.  Segments that have been read
+// and committed are deleted.
+//
+// There can only be one producer and one consumer per queue, which may be
+// separate processes.  The consumer sees records once they are completely
+// written.
+
+namespace repro
+{
+
+class SegmentedMessageLogEnqueue : public MessageEnqueueIf
+{
+public:
+   static const UInt64 DefaultSegmentSize = 64 * 1024 * 1024;
+
+   SegmentedMessageLogEnqueue(const resip::Data& baseDir, UInt64 segmentSize = DefaultSegmentSize);
+   virtual ~SegmentedMessageLogEnqueue();
+
+   virtual bool init(bool sync, const resip::Data& queueName);
+   virtual bool isRecoveryNeeded();
+
+   virtual bool push(const resip::Data& data);
+   virtual bool push(const std::vector<resip::Data>& records);
+
+private:
+   bool openSegment(UInt64 number);
+   void closeSegment();
+
+   resip::Data mBaseDir;
+   resip::Data mHomeDir;
+   UInt64 mSegmentSize;
+   bool mSync;
+   FILE* mFile;
+   UInt64 mSegmentNumber;
+   UInt64 mSegmentOffset;
+   bool mRecoveryNeeded;
+   resip::Data mBuffer;
+};
+
+class SegmentedMessageLogDequeue : public MessageDequeueIf
+{
+public:
+   SegmentedMessageLogDequeue(const resip::Data& baseDir);
+   virtual ~SegmentedMessageLogDequeue();
+
+   virtual bool init(bool sync, const resip::Data& queueName);
+   virtual bool isRecoveryNeeded();
+
+   // Note:  autoCommit is not needed for multiple consumers, since only one is allowed
+   virtual bool pop(size_t numRecords, std::vector<resip::Data>& records, bool autoCommit);
+   virtual bool commit();
+   virtual void abort();
+
+private:
+   bool map(UInt64 segment);
+   void unmap();
+   bool segmentExists(UInt64 segment) const;
+
+   resip::Data mBaseDir;
+   resip::Data mHomeDir;
+   bool mSync;
+   bool mRecoveryNeeded;
+
+   // position of the next record to read, and of the first uncommitted one
+   UInt64 mReadSegment;
+   UInt64 mReadOffset;
+   UInt64 mCommittedSegment;
+   UInt64 mCommittedOffset;
+
+   // mapping of mReadSegment
+   const char* mMap;
+   UInt64 mMapSize;
+   UInt64 mMapSegment;
+};
+
+}
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
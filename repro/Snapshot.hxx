@@ -0,0 +1,150 @@
+#if !defined(REPRO_SNAPSHOT_HXX)
+#define REPRO_SNAPSHOT_HXX
+
+#include "rutil/Atomic.hxx"
+#include "rutil/Time.hxx"
+
+namespace repro
+{
+
+/**
+   @class Snapshot
+
+   @brief Holds the current version of some read-mostly data (for instance
+   the compiled form of a store's records), so that it can be read without
+   taking a lock.
+
+   Readers pin the current version with a Snapshot::Reader, which costs two
+   atomic increments and a pointer load and never waits.  A writer builds a
+   complete new version and publish()es it; publish() waits until no reader
+   can still be using the version it replaced and then deletes it.  A
+   version is never changed once published.
+
+   Each reader counts itself in one of two counters, chosen by the low bit
+   of an epoch number.  To retire a version the writer swaps the pointer,
+   then twice moves the epoch on and waits for the counter that was in use
+   to drain to zero.  Any reader that could have loaded the old pointer
+   counted itself before one of those waits.
+
+   A version may point at things it does not own, such as the compiled
+   regexes of the records it was built from.  The writer must keep those
+   alive until publish() has returned for a version that no longer uses
+   them; only then can no Reader still reach them through the old version.
+
+   @note Calls to publish() must not overlap; stores call it with their own
+   write lock held.  publish() must not be called from a thread that holds a
+   Reader on the same Snapshot.
+*/
+template<class T>
+class Snapshot
+{
+   public:
+      Snapshot(T* initial = 0) : mCurrent(initial), mEpoch(0) {}
+      ~Snapshot() { delete mCurrent.load(); }
+
+      /**
+         Makes value (which is now owned by this Snapshot) the current 
+         version, and deletes the previous one once no Reader uses it.
+      */
+      void publish(T* value)
+      {
+         const T* old = mCurrent.exchange(value);
+         for(int i = 0; i < 2; i++)
+         {
+            unsigned int epoch = mEpoch.fetchAdd(1);
+            while(mReaders[epoch & 1].load() != 0)
+            {
+               resip::sleepMs(0);
+            }
+         }
+         delete old;
+      }
+
+      class Reader
+      {
+         public:
+            Reader(const Snapshot& snapshot) : 
+               mSnapshot(snapshot),
+               mSlot(snapshot.mEpoch.load() & 1)
+            {
+               mSnapshot.mReaders[mSlot].fetchAdd(1);
+               mValue = mSnapshot.mCurrent.load();
+            }
+            ~Reader() { mSnapshot.mReaders[mSlot].fetchSub(1); }
+
+            // 0 if nothing has been published yet
+            const T* get() const { return mValue; }
+            const T* operator->() const { return mValue; }
+            const T& operator*() const { return *mValue; }
+
+         private:
+            const Snapshot& mSnapshot;
+            unsigned int mSlot;
+            const T* mValue;
+
+            Reader(const Reader&);
+            Reader& operator=(const Reader&);
+      };
+
+   private:
+      resip::Atomic<const T*> mCurrent;
+      resip::Atomic<unsigned int> mEpoch;
+      mutable resip::Atomic<int> mReaders[2];
+
+      Snapshot(const Snapshot&);
+      Snapshot& operator=(const Snapshot&);
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
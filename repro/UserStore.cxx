@@ -7,6 +7,8 @@
 #include "rutil/DataStream.hxx"
 #include "resip/stack/Symbols.hxx"
 #include "rutil/Logger.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/Timer.hxx"
 #include "resip/stack/TransactionUser.hxx"
 #include "resip/dum/UserAuthInfo.hxx"
 
@@ -21,7 +23,11 @@ using namespace std;
 
 #define RESIPROCATE_SUBSYSTEM Subsystem::REPRO
 
-UserStore::UserStore(AbstractDb& db ) : mDb(db)
+UserStore::UserStore(AbstractDb& db ) : 
+   mDb(db),
+   mAuthCacheGeneration(0),
+   mAuthCacheMaxEntries(0),
+   mAuthCacheTtl(0)
 { 
 }
 
@@ -40,7 +46,54 @@ UserStore::getUserAuthInfo(  const resip::Data& user,
                              const resip::Data& realm ) const
 {
    Key key =  buildKey(user, realm);
-   return mDb.getUserAuthInfo( key );
+   unsigned long generation;
+   {
+      Lock lock(mAuthCacheMutex);
+      if(mAuthCacheMaxEntries == 0)
+      {
+         return mDb.getUserAuthInfo( key );
+      }
+      AuthCacheMap::iterator it = mAuthCacheMap.find(key);
+      if(it != mAuthCacheMap.end())
+      {
+         if(it->second->mExpires > Timer::getTimeSecs())
+         {
+            // Move to the front of the LRU list
+            mAuthCacheList.splice(mAuthCacheList.begin(), mAuthCacheList, it->second);
+            mAuthCacheHits.fetchAdd(1);
+            return it->second->mA1;
+         }
+         mAuthCacheList.erase(it->second);
+         mAuthCacheMap.erase(it);
+      }
+      generation = mAuthCacheGeneration;
+   }
+   mAuthCacheMisses.fetchAdd(1);
+
+   // Don't hold the lock across the database query
+   Data a1;
+   if(!mDb.lookupUserAuthInfo( key, a1 ))
+   {
+      // Not a definitive answer, so don't let it stand for the whole TTL
+      WarningLog(<< "User auth lookup failed for " << key << ", not caching the result");
+      return a1;
+   }
+
+   Lock lock(mAuthCacheMutex);
+   // Skip the insert if the user may have changed while we were querying
+   if(mAuthCacheMaxEntries > 0 && 
+      generation == mAuthCacheGeneration &&
+      mAuthCacheMap.find(key) == mAuthCacheMap.end())
+   {
+      mAuthCacheList.push_front(AuthCacheEntry(key, a1, Timer::getTimeSecs() + mAuthCacheTtl));
+      mAuthCacheMap[key] = mAuthCacheList.begin();
+      while(mAuthCacheMap.size() > mAuthCacheMaxEntries)
+      {
+         mAuthCacheMap.erase(mAuthCacheList.back().mKey);
+         mAuthCacheList.pop_back();
+      }
+   }
+   return a1;
 }
 
 bool 
@@ -89,13 +142,25 @@ UserStore::addUser( const Data& username,
    rec.email = emailAddress;
    rec.forwardAddress = Data::Empty;
 
-   return mDb.addUser( buildKey(username,domain), rec);
+   bool ret = mDb.addUser( buildKey(username,domain), rec);
+   invalidateAuthCache(buildKey(username, realm));
+   return ret;
 }
 
 void 
 UserStore::eraseUser( const Key& key )
 { 
+   AbstractDb::UserRecord rec;
+   if(isAuthCacheEnabled())
+   {
+      // The cache is keyed by realm, not domain
+      rec = mDb.getUser(key);
+   }
    mDb.eraseUser( key );
+   if(!rec.user.empty())
+   {
+      invalidateAuthCache(buildKey(rec.user, rec.realm));
+   }
 }
 
 bool
@@ -110,12 +175,23 @@ UserStore::updateUser( const Key& originalKey,
                        const resip::Data& passwordHashAlt)
 {
    Key newkey = buildKey(user, domain);
+
+   AbstractDb::UserRecord originalRec;
+   if(isAuthCacheEnabled())
+   {
+      // The realm may be changing
+      originalRec = mDb.getUser(originalKey);
+   }
    
    bool ret = addUser(user, domain, realm, password, applyA1HashToPassword, fullName, emailAddress, passwordHashAlt);
    if ( newkey != originalKey )
    {
       eraseUser(originalKey);
    }
+   if(!originalRec.user.empty())
+   {
+      invalidateAuthCache(buildKey(originalRec.user, originalRec.realm));
+   }
    return ret;
 }
 
@@ -138,6 +214,58 @@ UserStore::buildKey( const resip::Data& user, const resip::Data& realm)
    return ret;
 }
 
+void
+UserStore::setAuthCache(unsigned int maxEntries, unsigned int ttlSecs)
+{
+   Lock lock(mAuthCacheMutex);
+   mAuthCacheMaxEntries = ttlSecs > 0 ? maxEntries : 0;
+   mAuthCacheTtl = ttlSecs;
+   mAuthCacheList.clear();
+   mAuthCacheMap.clear();
+}
+
+void
+UserStore::clearAuthCache()
+{
+   Lock lock(mAuthCacheMutex);
+   ++mAuthCacheGeneration;
+   mAuthCacheList.clear();
+   mAuthCacheMap.clear();
+}
+
+void
+UserStore::clearAuthCache(const resip::Data& user, const resip::Data& realm)
+{
+   invalidateAuthCache(buildKey(user, realm));
+}
+
+bool
+UserStore::isAuthCacheEnabled() const
+{
+   Lock lock(mAuthCacheMutex);
+   return mAuthCacheMaxEntries > 0;
+}
+
+size_t
+UserStore::getAuthCacheSize() const
+{
+   Lock lock(mAuthCacheMutex);
+   return mAuthCacheMap.size();
+}
+
+void
+UserStore::invalidateAuthCache(const Key& key)
+{
+   Lock lock(mAuthCacheMutex);
+   ++mAuthCacheGeneration;
+   AuthCacheMap::iterator it = mAuthCacheMap.find(key);
+   if(it != mAuthCacheMap.end())
+   {
+      mAuthCacheList.erase(it->second);
+      mAuthCacheMap.erase(it);
+   }
+}
+
 
 /* ====================================================================
  * The Vovida Software License, Version 1.0 
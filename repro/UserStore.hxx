@@ -1,8 +1,14 @@
 #if !defined(REPRO_USERSTORE_HXX)
 #define REPRO_USERSTORE_HXX
 
+#include <list>
+
 #include "rutil/Data.hxx"
 #include "rutil/Fifo.hxx"
+#include "rutil/HashMap.hxx"
+#include "rutil/Mutex.hxx"
+#include "rutil/Atomic.hxx"
+#include "rutil/compat.hxx"
 #include "resip/stack/Message.hxx"
 
 #include "repro/AbstractDb.hxx"
@@ -57,9 +63,45 @@ class UserStore
       
       static Key buildKey(const resip::Data& user, const resip::Data& domain);
 
+      // Caches up to maxEntries results of getUserAuthInfo (including "no
+      // such user", but not lookups that failed) for ttlSecs each, least
+      // recently used entries are evicted first.  Changes made through this class invalidate the affected
+      // entries; changes made directly in the database are only seen once
+      // the entry expires or clearAuthCache is called.  0 disables the cache.
+      void setAuthCache(unsigned int maxEntries, unsigned int ttlSecs);
+      void clearAuthCache();
+      // Drops the cached entry for one user, if any
+      void clearAuthCache(const resip::Data& user, const resip::Data& realm);
+      unsigned long getAuthCacheHits() const { return mAuthCacheHits.load(); }
+      unsigned long getAuthCacheMisses() const { return mAuthCacheMisses.load(); }
+      size_t getAuthCacheSize() const;
+
    private:
+      bool isAuthCacheEnabled() const;
+      void invalidateAuthCache(const Key& key);
 
       AbstractDb& mDb;
+
+      class AuthCacheEntry
+      {
+         public:
+            AuthCacheEntry(const Key& key, const resip::Data& a1, UInt64 expires)
+               : mKey(key), mA1(a1), mExpires(expires) {}
+            Key mKey;
+            resip::Data mA1;
+            UInt64 mExpires;  // seconds
+      };
+      typedef std::list<AuthCacheEntry> AuthCacheList;  // most recently used first
+      typedef HashMap<Key, AuthCacheList::iterator> AuthCacheMap;
+
+      mutable resip::Mutex mAuthCacheMutex;
+      mutable AuthCacheList mAuthCacheList;
+      mutable AuthCacheMap mAuthCacheMap;
+      unsigned long mAuthCacheGeneration;  // bumped by every invalidation
+      unsigned int mAuthCacheMaxEntries;
+      unsigned int mAuthCacheTtl;
+      mutable resip::Atomic<unsigned long> mAuthCacheHits;
+      mutable resip::Atomic<unsigned long> mAuthCacheMisses;
 };
 
  }
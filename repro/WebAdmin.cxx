@@ -1213,6 +1213,7 @@ WebAdmin::buildShowFiltersSubPage(DataStream& s)
       "  <td>Action</td>" << endl << 
       "  <td>Action Data</td>" << endl << 
       "  <td>Order</td>" << endl << 
+      "  <td>Hits</td>" << endl << 
       "  <td><input type=\"submit\" value=\"Remove\"/></td>" << endl << 
       "</tr></thead>" << endl << 
       "<tbody>" << endl;
@@ -1242,6 +1243,7 @@ WebAdmin::buildShowFiltersSubPage(DataStream& s)
          "<td>" << action << "</td>" << endl << 
          "<td>" << rec.mActionData << "</td>" << endl << 
          "<td>" << rec.mOrder << "</td>" << endl << 
+         "<td>" << mStore.mFilterStore.getFilterHits(key) << "</td>" << endl << 
          "<td><input type=\"checkbox\" name=\"remove." <<  key << "\"/></td>" << endl << 
          "</tr>" << endl;
    }
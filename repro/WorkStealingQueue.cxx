@@ -0,0 +1,302 @@
+#include "repro/WorkStealingQueue.hxx"
+
+#include <time.h>
+
+#include "resip/stack/ApplicationMessage.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/Timer.hxx"
+#include "rutil/WinLeakCheck.hxx"
+
+using namespace resip;
+
+namespace repro
+{
+
+WorkStealingQueue::WorkStealingQueue(unsigned int numQueues) :
+   mNextQueue(0),
+   mSize(0),
+   mStealable(0),
+   mIdleWorkers(0),
+   mStolen(0),
+   mAverageServiceTimeMicroSec(0)
+{
+   if(numQueues == 0)
+   {
+      numQueues = 1;
+   }
+   for(unsigned int i = 0; i < numQueues; i++)
+   {
+      mQueues.push_back(new Queue);
+   }
+}
+
+WorkStealingQueue::~WorkStealingQueue()
+{
+   for(std::vector<Queue*>::iterator q = mQueues.begin(); q != mQueues.end(); ++q)
+   {
+      for(std::deque<Item>::iterator i = (*q)->mItems.begin(); i != (*q)->mItems.end(); ++i)
+      {
+         delete i->mWork;
+      }
+      delete *q;
+   }
+}
+
+void
+WorkStealingQueue::add(ApplicationMessage* work)
+{
+   add(work, mNextQueue.fetchAdd(1) % mQueues.size(), false);
+}
+
+void
+WorkStealingQueue::add(ApplicationMessage* work, const Data& affinityKey)
+{
+   add(work, (unsigned int)(affinityKey.hash() % mQueues.size()), true);
+}
+
+void
+WorkStealingQueue::add(ApplicationMessage* work, unsigned int queue, bool pinned)
+{
+   Item item;
+   item.mWork = work;
+   item.mAdded = time(0);
+   item.mPinned = pinned;
+   {
+      Lock lock(mQueues[queue]->mMutex);
+      mQueues[queue]->mItems.push_back(item);
+   }
+   mSize.fetchAdd(1);
+   if(!pinned)
+   {
+      mStealable.fetchAdd(1);
+   }
+
+   // An idle worker registers itself in mIdleWorkers before it looks for work
+   // for the last time, so either it sees this work or we see it here.
+   if(mIdleWorkers.load() > 0)
+   {
+      Lock lock(mIdleMutex);
+      if(pinned)
+      {
+         // only the worker of this queue can take it
+         mWorkAdded.broadcast();
+      }
+      else
+      {
+         mWorkAdded.signal();
+      }
+   }
+}
+
+ApplicationMessage*
+WorkStealingQueue::take(unsigned int queue)
+{
+   Item item;
+   {
+      Lock lock(mQueues[queue]->mMutex);
+      std::deque<Item>& items = mQueues[queue]->mItems;
+      if(items.empty())
+      {
+         return 0;
+      }
+      item = items.front();
+      items.pop_front();
+   }
+   mSize.fetchSub(1);
+   if(!item.mPinned)
+   {
+      mStealable.fetchSub(1);
+   }
+   return item.mWork;
+}
+
+ApplicationMessage*
+WorkStealingQueue::steal(unsigned int queue)
+{
+   ApplicationMessage* work = 0;
+   {
+      Lock lock(mQueues[queue]->mMutex);
+      std::deque<Item>& items = mQueues[queue]->mItems;
+      for(std::deque<Item>::iterator i = items.begin(); i != items.end(); ++i)
+      {
+         if(!i->mPinned)
+         {
+            work = i->mWork;
+            items.erase(i);
+            break;
+         }
+      }
+   }
+   if(work)
+   {
+      mSize.fetchSub(1);
+      mStealable.fetchSub(1);
+      mStolen.fetchAdd(1);
+   }
+   return work;
+}
+
+ApplicationMessage*
+WorkStealingQueue::takeOrSteal(unsigned int queue)
+{
+   ApplicationMessage* work = take(queue);
+   if(!work && mStealable.load() > 0)
+   {
+      for(unsigned int i = 1; i < mQueues.size() && !work; i++)
+      {
+         work = steal((queue + i) % mQueues.size());
+      }
+   }
+   return work;
+}
+
+bool
+WorkStealingQueue::hasWorkFor(unsigned int queue) const
+{
+   if(mStealable.load() > 0)
+   {
+      return true;
+   }
+   Lock lock(mQueues[queue]->mMutex);
+   return !mQueues[queue]->mItems.empty();
+}
+
+ApplicationMessage*
+WorkStealingQueue::getNext(unsigned int queue, int ms)
+{
+   resip_assert(queue < mQueues.size());
+   ApplicationMessage* work = takeOrSteal(queue);
+   if(work || ms == RESIP_FIFO_NOWAIT)
+   {
+      return work;
+   }
+
+   {
+      const UInt64 end = Timer::getTimeMs() + ms;
+      Lock lock(mIdleMutex);
+      mIdleWorkers.fetchAdd(1);
+      // woken up for work pinned to another queue too, so check again
+      while(!hasWorkFor(queue))
+      {
+         if(ms == RESIP_FIFO_FOREVER)
+         {
+            mWorkAdded.wait(mIdleMutex);
+         }
+         else
+         {
+            const UInt64 now = Timer::getTimeMs();
+            if(now >= end)
+            {
+               break;
+            }
+            mWorkAdded.wait(mIdleMutex, (unsigned int)(end - now));
+         }
+      }
+      mIdleWorkers.fetchSub(1);
+   }
+
+   return takeOrSteal(queue);
+}
+
+void
+WorkStealingQueue::workDone(UInt64 serviceTimeMicroSec)
+{
+   // Moving average over about the last 64 pieces of work.  Updates from
+   // different workers may overwrite each other, which does not matter here.
+   unsigned long average = mAverageServiceTimeMicroSec.load();
+   mAverageServiceTimeMicroSec.store(average - average / 64 + (unsigned long)(serviceTimeMicroSec / 64));
+}
+
+bool
+WorkStealingQueue::empty() const
+{
+   return mSize.load() <= 0;
+}
+
+time_t
+WorkStealingQueue::expectedWaitTimeMilliSec() const
+{
+   // the queues are worked on in parallel
+   return (time_t)(((UInt64)averageServiceTimeMicroSec() * getCountDepth() / mQueues.size() + 500) / 1000);
+}
+
+time_t
+WorkStealingQueue::getTimeDepth() const
+{
+   time_t oldest = 0;
+   for(std::vector<Queue*>::const_iterator q = mQueues.begin(); q != mQueues.end(); ++q)
+   {
+      Lock lock((*q)->mMutex);
+      if(!(*q)->mItems.empty() && (oldest == 0 || (*q)->mItems.front().mAdded < oldest))
+      {
+         oldest = (*q)->mItems.front().mAdded;
+      }
+   }
+   return oldest == 0 ? 0 : time(0) - oldest;
+}
+
+size_t
+WorkStealingQueue::getCountDepth() const
+{
+   long size = mSize.load();
+   return size > 0 ? (size_t)size : 0;
+}
+
+time_t
+WorkStealingQueue::averageServiceTimeMicroSec() const
+{
+   return (time_t)mAverageServiceTimeMicroSec.load();
+}
+
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,157 @@
+#ifndef WORK_STEALING_QUEUE_HXX
+#define WORK_STEALING_QUEUE_HXX 1
+
+#include <deque>
+#include <vector>
+
+#include "rutil/AbstractFifo.hxx"
+#include "rutil/Atomic.hxx"
+#include "rutil/Condition.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/Mutex.hxx"
+
+namespace resip
+{
+class ApplicationMessage;
+}
+
+namespace repro
+{
+
+/**
+   @class WorkStealingQueue
+
+   @brief The work queues of a Dispatcher running in work stealing mode.
+
+   There is one queue per worker thread.  Work is spread over the queues
+   round robin, and a worker whose own queue is empty takes the oldest work
+   from the other queues instead of waiting.  Work that is added with an
+   affinity key (for example a Call-ID or an AOR) always goes to the same
+   queue for the same key and is never stolen, so work with the same key is
+   done by one worker, in the order it was added.
+
+   The statistics cover all of the queues, so a WorkStealingQueue can be
+   registered with a CongestionManager just like a TimeLimitFifo.
+*/
+class WorkStealingQueue : public resip::FifoStatsInterface
+{
+   public:
+      WorkStealingQueue(unsigned int numQueues);
+      virtual ~WorkStealingQueue();   // deletes any work left in the queues
+
+      void add(resip::ApplicationMessage* work);
+      void add(resip::ApplicationMessage* work, const resip::Data& affinityKey);
+
+      /**
+         @returns The next work for the worker of queue, waiting up to ms 
+            milliseconds if there is none, or 0 if there is still none.
+      */
+      resip::ApplicationMessage* getNext(unsigned int queue, int ms);
+
+      /**
+         Called by the workers with the time it took to do a piece of work,
+         used for averageServiceTimeMicroSec() and expectedWaitTimeMilliSec().
+      */
+      void workDone(UInt64 serviceTimeMicroSec);
+
+      bool empty() const;
+      unsigned int numQueues() const { return (unsigned int)mQueues.size(); }
+      unsigned long getStolenCount() const { return mStolen.load(); }
+
+      // FifoStatsInterface
+      virtual time_t expectedWaitTimeMilliSec() const;
+      virtual time_t getTimeDepth() const;
+      virtual size_t getCountDepth() const;
+      virtual time_t averageServiceTimeMicroSec() const;
+
+   private:
+      class Item
+      {
+         public:
+            resip::ApplicationMessage* mWork;
+            time_t mAdded;
+            bool mPinned;
+      };
+
+      class Queue
+      {
+         public:
+            mutable resip::Mutex mMutex;
+            std::deque<Item> mItems;
+      };
+
+      void add(resip::ApplicationMessage* work, unsigned int queue, bool pinned);
+      resip::ApplicationMessage* take(unsigned int queue);
+      resip::ApplicationMessage* steal(unsigned int queue);
+      resip::ApplicationMessage* takeOrSteal(unsigned int queue);
+      bool hasWorkFor(unsigned int queue) const;
+
+      std::vector<Queue*> mQueues;
+      resip::Atomic<unsigned int> mNextQueue;
+      resip::Atomic<long> mSize;
+      resip::Atomic<long> mStealable;   // work that is not pinned to its queue
+      resip::Atomic<long> mIdleWorkers;
+      resip::Atomic<unsigned long> mStolen;
+      resip::Atomic<unsigned long> mAverageServiceTimeMicroSec;
+
+      resip::Mutex mIdleMutex;
+      resip::Condition mWorkAdded;
+
+      //No copying!
+      WorkStealingQueue(const WorkStealingQueue& toCopy);
+      WorkStealingQueue& operator=(const WorkStealingQueue& toCopy);
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
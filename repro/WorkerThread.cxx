@@ -1,8 +1,10 @@
 #include "repro/WorkerThread.hxx"
+#include "repro/WorkStealingQueue.hxx"
 
 #include "resip/stack/SipStack.hxx"
 #include "resip/stack/ApplicationMessage.hxx"
 #include "rutil/Logger.hxx"
+#include "rutil/Timer.hxx"
 
 #define RESIPROCATE_SUBSYSTEM resip::Subsystem::REPRO
 
@@ -13,7 +15,20 @@ WorkerThread::WorkerThread(Worker* worker,
                         resip::TimeLimitFifo<resip::ApplicationMessage>& fifo,
                         resip::SipStack* stack):
    mWorker(worker),
-   mFifo(fifo),
+   mFifo(&fifo),
+   mQueues(0),
+   mQueueIndex(0),
+   mStack(stack)
+{}
+
+WorkerThread::WorkerThread(Worker* worker,
+                        WorkStealingQueue& queues,
+                        unsigned int queueIndex,
+                        resip::SipStack* stack):
+   mWorker(worker),
+   mFifo(0),
+   mQueues(&queues),
+   mQueueIndex(queueIndex),
    mStack(stack)
 {}
 
@@ -34,9 +49,19 @@ WorkerThread::thread()
       mWorker->onStart();
       while(mWorker && !isShutdown())
       {
-         if( (msg=mFifo.getNext(100)) != 0 )
+         msg = mQueues ? mQueues->getNext(mQueueIndex, 100) : mFifo->getNext(100);
+         if( msg != 0 )
          {
-            queueToStack = mWorker->process(msg);
+            if(mQueues)
+            {
+               UInt64 start = resip::Timer::getTimeMicroSec();
+               queueToStack = mWorker->process(msg);
+               mQueues->workDone(resip::Timer::getTimeMicroSec() - start);
+            }
+            else
+            {
+               queueToStack = mWorker->process(msg);
+            }
 
             if(queueToStack && mStack)
             {
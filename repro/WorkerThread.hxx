@@ -14,17 +14,23 @@ class SipStack;
 namespace repro
 {
 
+class WorkStealingQueue;
+
 class WorkerThread : public resip::ThreadIf
 {
 
    public:
       WorkerThread(Worker* impl,resip::TimeLimitFifo<resip::ApplicationMessage>& fifo,resip::SipStack* stack);
+      // Works on queue number queueIndex of a WorkStealingQueue
+      WorkerThread(Worker* impl,WorkStealingQueue& queues,unsigned int queueIndex,resip::SipStack* stack);
       virtual ~WorkerThread();
       void thread();
       
    protected:
       Worker* mWorker;
-      resip::TimeLimitFifo<resip::ApplicationMessage>& mFifo;
+      resip::TimeLimitFifo<resip::ApplicationMessage>* mFifo;
+      WorkStealingQueue* mQueues;
+      unsigned int mQueueIndex;
       resip::SipStack* mStack;
 
 };
@@ -4,6 +4,7 @@
 #include "rutil/compat.hxx"
 
 #include "repro/PersistentMessageQueue.hxx"
+#include "repro/SegmentedMessageLog.hxx"
 #include <rutil/Time.hxx>
 #include <rutil/Logger.hxx>
 #include <rutil/WinLeakCheck.hxx>
@@ -48,18 +49,28 @@ main (int argc, char** argv)
    // Log any resip logs to cerr, since session events are logged to cout
    Log::initialize(Log::Cerr, Log::Info, "");
 
+   // Usage: queuetostream [--segmented] [<queue name>]
+   // --segmented reads a queue written with AccountingQueueType = SegmentedLog
    Data msgQueueName("sessioneventqueue");
-   if(argc >= 2)
+   bool segmented = false;
+   for(int i = 1; i < argc; i++)
    {
-      msgQueueName = argv[1];
+      if(Data(argv[i]) == "--segmented")
+      {
+         segmented = true;
+      }
+      else
+      {
+         msgQueueName = argv[i];
+      }
    }
-   PersistentMessageDequeue* queue = new PersistentMessageDequeue("");
+   MessageDequeueIf* queue = segmented ? (MessageDequeueIf*)new SegmentedMessageLogDequeue("") : new PersistentMessageDequeue("");
    if(queue->init(true, msgQueueName))
    {
       vector<resip::Data> recs;
       while(!finished)
       {
-         if(queue->pop(5, recs, true))
+         if(queue->pop(100, recs, true))
          {
             if(recs.size() > 0)
             {
@@ -78,7 +89,7 @@ main (int argc, char** argv)
             if(queue->isRecoveryNeeded())
             {
                delete queue;
-               queue = new PersistentMessageDequeue("");
+               queue = segmented ? (MessageDequeueIf*)new SegmentedMessageLogDequeue("") : new PersistentMessageDequeue("");
                if(!queue->init(true, msgQueueName))
                {
                   cerr << "Error initializing message queue after error!" << endl;
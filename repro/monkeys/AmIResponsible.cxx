@@ -49,7 +49,7 @@ AmIResponsible::process(RequestContext& context)
       if(!(dest==resip::Tuple()))
       {
          // .bwc. Valid flow token
-         std::auto_ptr<Target> target(new Target(request.header(h_RequestLine).uri()));
+         std::auto_ptr<Target> target(new Target(request.const_header(h_RequestLine).uri()));
          target->rec().mReceivedFrom = dest;
          target->rec().mUseFlowRouting = true;
          context.getResponseContext().addTarget(target);
@@ -64,7 +64,7 @@ AmIResponsible::process(RequestContext& context)
       // !RjS! - Jason - check the RURI to see if the domain is
       // something this request is responsible for. If yes, then
       // just return Continue. If no make this call below.
-      const Uri& uri = request.header(h_RequestLine).uri();
+      const Uri& uri = request.const_header(h_RequestLine).uri();
       if (!context.getProxy().isMyUri(uri))
       {
          // if this is not for a domain for which the proxy is responsible,
@@ -125,13 +125,13 @@ AmIResponsible::process(RequestContext& context)
 
             // .slg. Allow trusted nodes to relay
             if (!context.getKeyValueStore().getBoolValue(IsTrustedNode::mFromTrustedNodeKey) && 
-                !context.getProxy().isMyUri(request.header(h_From).uri()) &&
+                !context.getProxy().isMyUri(request.const_header(h_From).uri()) &&
                 !request.hasForceTarget())
             {
                // make 403, send, dispose of memory
                resip::SipMessage response;
                InfoLog (<< *this << ": will not relay to " << uri << " from " 
-                        << request.header(h_From).uri() << ", send 403");
+                        << request.const_header(h_From).uri() << ", send 403");
                Helper::makeResponse(response, context.getOriginalRequest(), 403, "Relaying Forbidden"); 
                context.sendResponse(response);
                return Processor::SkipThisChain;
@@ -107,7 +107,7 @@ CertificateAuthenticator::process(repro::RequestContext &rc)
          return Continue;
       }
 
-      if (proxy.isMyDomain(sipMessage->header(h_From).uri().host()))
+      if (proxy.isMyDomain(sipMessage->const_header(h_From).uri().host()))
       {
          if (!rc.getKeyValueStore().getBoolValue(IsTrustedNode::mFromTrustedNodeKey))
          {
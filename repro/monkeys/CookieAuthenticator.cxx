@@ -68,8 +68,8 @@ CookieAuthenticator::process(repro::RequestContext &rc)
          return Continue;
       }
 
-      if(!sipMessage->header(h_From).isWellFormed() ||
-         sipMessage->header(h_From).isAllContacts() )
+      if(!sipMessage->const_header(h_From).isWellFormed() ||
+         sipMessage->const_header(h_From).isAllContacts() )
       {
          InfoLog(<<"Malformed From header: cannot verify against cookie. Rejecting.");
          rc.sendResponse(*auto_ptr<SipMessage>
@@ -78,9 +78,9 @@ CookieAuthenticator::process(repro::RequestContext &rc)
       }
 
       const WsCookieContext &wsCookieContext = *(sipMessage->getWsCookieContext());
-      if (proxy.isMyDomain(sipMessage->header(h_From).uri().host()))
+      if (proxy.isMyDomain(sipMessage->const_header(h_From).uri().host()))
       {
-         if(authorizedForThisIdentity(sipMessage->header(h_RequestLine).method(), wsCookieContext, sipMessage->header(h_From).uri(), sipMessage->header(h_To).uri()))
+         if(authorizedForThisIdentity(sipMessage->const_header(h_RequestLine).method(), wsCookieContext, sipMessage->const_header(h_From).uri(), sipMessage->const_header(h_To).uri()))
          {
             if(mWsCookieExtraHeader.get() && sipMessage->exists(*mWsCookieExtraHeader))
             {
@@ -127,8 +127,8 @@ CookieAuthenticator::cookieUriMatch(const resip::Uri &first, const resip::Uri &s
 bool
 CookieAuthenticator::authorizedForThisIdentity(const MethodTypes method,
                                                 const WsCookieContext& wsCookieContext,
-                                                resip::Uri &fromUri,
-                                                resip::Uri &toUri)
+                                                const resip::Uri &fromUri,
+                                                const resip::Uri &toUri)
 {
    if(difftime(wsCookieContext.getExpiresTime(), time(NULL)) < 0)
    {
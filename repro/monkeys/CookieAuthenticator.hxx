@@ -26,7 +26,7 @@ namespace repro
       std::auto_ptr<resip::ExtensionHeader> mWsCookieExtraHeader;
 
       bool cookieUriMatch(const resip::Uri &first, const resip::Uri &second);
-      bool authorizedForThisIdentity(const MethodTypes method, const WsCookieContext& wsCookieContext, resip::Uri &fromUri, resip::Uri &toUri);
+      bool authorizedForThisIdentity(const MethodTypes method, const WsCookieContext& wsCookieContext, const resip::Uri &fromUri, const resip::Uri &toUri);
   };
 
 }
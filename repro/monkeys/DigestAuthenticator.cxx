@@ -86,8 +86,8 @@ DigestAuthenticator::process(repro::RequestContext &rc)
       //
       // Note that other monkeys can still challenge the request later if needed 
       // for other reasons (for example, the StaticRoute monkey)
-      if(!sipMessage->header(h_From).isWellFormed() ||
-         sipMessage->header(h_From).isAllContacts() )
+      if(!sipMessage->const_header(h_From).isWellFormed() ||
+         sipMessage->const_header(h_From).isAllContacts() )
       {
          InfoLog(<<"Malformed From header: cannot get realm to challenge with. Rejecting.");
          rc.sendResponse(*auto_ptr<SipMessage>
@@ -95,7 +95,7 @@ DigestAuthenticator::process(repro::RequestContext &rc)
          return SkipAllChains;         
       }
       
-      if (proxy.isMyDomain(sipMessage->header(h_From).uri().host()))
+      if (proxy.isMyDomain(sipMessage->const_header(h_From).uri().host()))
       {
          if (!rc.getKeyValueStore().getBoolValue(IsTrustedNode::mFromTrustedNodeKey))
          {
@@ -168,8 +168,8 @@ DigestAuthenticator::process(repro::RequestContext &rc)
          case Helper::Authenticated:
             InfoLog (<< "Authentication ok for " << user);
             
-            if(!sipMessage->header(h_From).isWellFormed() ||
-               sipMessage->header(h_From).isAllContacts())
+            if(!sipMessage->const_header(h_From).isWellFormed() ||
+               sipMessage->const_header(h_From).isAllContacts())
             {
                InfoLog(<<"From header is malformed in"
                               " digest response.");
@@ -178,7 +178,7 @@ DigestAuthenticator::process(repro::RequestContext &rc)
                return SkipAllChains;               
             }
             
-            if (authorizedForThisIdentity(user, realm, sipMessage->header(h_From).uri()))
+            if (authorizedForThisIdentity(user, realm, sipMessage->const_header(h_From).uri()))
             {
                rc.setDigestIdentity(user);
 
@@ -229,7 +229,7 @@ DigestAuthenticator::process(repro::RequestContext &rc)
 
                      // We currently don't do anything special with the P-Peferred-Identity hint - just
                      // add default identity
-                     sipMessage->header(h_PAssertedIdentities).push_back(getDefaultIdentity(user, realm, sipMessage->header(h_From)));
+                     sipMessage->header(h_PAssertedIdentities).push_back(getDefaultIdentity(user, realm, sipMessage->const_header(h_From)));
 
                      // Remove the P-Preferered-Identity header
                      sipMessage->remove(h_PPreferredIdentities);
@@ -238,7 +238,7 @@ DigestAuthenticator::process(repro::RequestContext &rc)
                   {
                      if (!sipMessage->exists(h_PAssertedIdentities))
                      {
-                        sipMessage->header(h_PAssertedIdentities).push_back(getDefaultIdentity(user, realm, sipMessage->header(h_From)));
+                        sipMessage->header(h_PAssertedIdentities).push_back(getDefaultIdentity(user, realm, sipMessage->const_header(h_From)));
                      }
                      // else  TODO
                      //  - should implement guidlines in RFC5876 4.5 - whereby the proxy should remove 
@@ -278,7 +278,7 @@ DigestAuthenticator::process(repro::RequestContext &rc)
             {
                // !rwm! The user is trying to forge a request.  Respond with a 403
                InfoLog (<< "User: " << user << " at realm: " << realm << 
-                           " trying to forge request from: " << sipMessage->header(h_From).uri());
+                           " trying to forge request from: " << sipMessage->const_header(h_From).uri());
                rc.sendResponse(*auto_ptr<SipMessage>
                                (Helper::makeResponse(*sipMessage, 403)));
                return SkipAllChains;               
@@ -311,7 +311,7 @@ DigestAuthenticator::process(repro::RequestContext &rc)
 
 bool
 DigestAuthenticator::authorizedForThisIdentity(const resip::Data &user, const resip::Data &realm, 
-                                                resip::Uri &fromUri)
+                                                const resip::Uri &fromUri)
 {
    // !rwm! good enough for now.  TODO eventually consult a database to see what
    // combinations of user/realm combos are authorized for an identity
@@ -337,7 +337,7 @@ DigestAuthenticator::authorizedForThisIdentity(const resip::Data &user, const re
 }
 
 NameAddr
-DigestAuthenticator::getDefaultIdentity(const resip::Data &user, const resip::Data &realm, resip::NameAddr &from)
+DigestAuthenticator::getDefaultIdentity(const resip::Data &user, const resip::Data &realm, const resip::NameAddr &from)
 {
    NameAddr defaultIdentity;
    defaultIdentity.displayName() = from.displayName();
@@ -390,9 +390,9 @@ DigestAuthenticator::requestUserAuthInfo(repro::RequestContext &rc, resip::Data
       UserInfoMessage* async = new UserInfoMessage(*this, rc.getTransactionId(), &(rc.getProxy()));
       async->user()=user;
       async->realm()=realm;
-      if(sipMessage->header(h_From).isWellFormed())
+      if(sipMessage->const_header(h_From).isWellFormed())
       {
-         async->domain()=sipMessage->header(h_From).uri().host();
+         async->domain()=sipMessage->const_header(h_From).uri().host();
       }
       else
       {
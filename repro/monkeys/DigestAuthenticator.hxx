@@ -24,8 +24,8 @@ namespace repro
       virtual processor_action_t process(RequestContext &);
 
     protected:
-      virtual bool authorizedForThisIdentity(const resip::Data &user, const resip::Data &realm, resip::Uri &fromUri);
-      virtual resip::NameAddr getDefaultIdentity(const resip::Data &user, const resip::Data &realm, resip::NameAddr &from);
+      virtual bool authorizedForThisIdentity(const resip::Data &user, const resip::Data &realm, const resip::Uri &fromUri);
+      virtual resip::NameAddr getDefaultIdentity(const resip::Data &user, const resip::Data &realm, const resip::NameAddr &from);
       virtual void challengeRequest(RequestContext &, bool stale = false);
       virtual processor_action_t requestUserAuthInfo(RequestContext &, resip::Data & realm);
       virtual processor_action_t requestUserAuthInfo(RequestContext &, const resip::Auth& auth, UserInfoMessage *userInfo);
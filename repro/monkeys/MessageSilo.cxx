@@ -192,8 +192,9 @@ MessageSilo::process(RequestContext& context)
          async->mSourceUri = Data::from(from);
          time(&async->mOriginalSendTime);  // Get now timestamp
 
-         // Dispatch async request to worker thread pool
-         mAsyncDispatcher->post(async_ptr);
+         // Dispatch async request to worker thread pool.  Keep the work for an AOR on one 
+         // worker, so that messages are silo'd and drained in order.
+         mAsyncDispatcher->post(async_ptr, async->mDestUri);
 
          SipMessage response;
          InfoLog(<<"Message was Silo'd responding with a " << mSuccessStatusCode);
@@ -332,7 +333,7 @@ MessageSilo::onAdd(resip::ServerRegistrationHandle h, const resip::SipMessage& r
    async->mAor = reg.header(h_To).uri().getAOR(false /* addPort? */);
    async->mRequestContacts = h->getRequestContacts();
    std::auto_ptr<ApplicationMessage> async_ptr(async);
-   mAsyncDispatcher->post(async_ptr);
+   mAsyncDispatcher->post(async_ptr, async->mAor);
    return true;
 }
 
@@ -188,7 +188,7 @@ RequestFilter::process(RequestContext &rc)
             {
                // Dispatch async
                std::auto_ptr<ApplicationMessage> async(new RequestFilterAsyncMessage(*this, rc.getTransactionId(), &rc.getProxy(), actionData));
-               mAsyncDispatcher->post(async);
+               mAsyncDispatcher->post(async, rc.getOriginalRequest().header(h_CallId).value());
                return WaitingForEvent;
             }
             else
@@ -45,6 +45,8 @@ main (int argc, char** argv)
       cerr << "  /LogDnsCache - causes the DNS cache contents to be written to the resip logs" << endl;
       cerr << "  /ClearDnsCache - empties the stacks DNS cache" << endl;
       cerr << "  /GetDnsCache - retrieves the DNS cache contents" << endl;
+      cerr << "  /ClearUserAuthCache [user=<user> realm=<realm>] - empties the user credential" << endl;
+      cerr << "                       cache, or removes a single user from it" << endl;
       cerr << "  /GetCongestionStats - retrieves the stacks congestion manager stats and state" << endl;
       cerr << "  /SetCongestionTolerance metric=<SIZE|WAIT_TIME|TIME_DEPTH> maxTolerance=<value>" << endl;
       cerr << "                          [fifoDescription=<desc>] - sets congestion tolerances" << endl;
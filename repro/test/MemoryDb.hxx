@@ -0,0 +1,116 @@
+#if !defined(REPRO_TEST_MEMORYDB_HXX)
+#define REPRO_TEST_MEMORYDB_HXX
+
+#include <map>
+
+#include "rutil/Data.hxx"
+#include "repro/AbstractDb.hxx"
+
+namespace repro
+{
+
+// Keeps the tables in memory, for tests and benchmarks that need an
+// AbstractDb without a database behind it
+class MemoryDb : public AbstractDb
+{
+   public:
+      virtual bool isSane() { return true; }
+
+   protected:
+      typedef std::map<resip::Data, resip::Data> Records;
+
+      virtual bool dbWriteRecord(const Table table, const resip::Data& key, const resip::Data& data)
+      {
+         mTables[table][key] = data;
+         return true;
+      }
+      virtual bool dbReadRecord(const Table table, const resip::Data& key, resip::Data& data) const
+      {
+         Records::const_iterator it = mTables[table].find(key);
+         if(it == mTables[table].end())
+         {
+            return false;
+         }
+         data = it->second;
+         return true;
+      }
+      virtual void dbEraseRecord(const Table table, const resip::Data& key, bool)
+      {
+         mTables[table].erase(key);
+      }
+      virtual resip::Data dbNextKey(const Table table, bool first)
+      {
+         Records::iterator& cursor = mCursors[table];
+         if(first)
+         {
+            cursor = mTables[table].begin();
+         }
+         else if(cursor != mTables[table].end())
+         {
+            cursor++;
+         }
+         return cursor == mTables[table].end() ? resip::Data::Empty : cursor->first;
+      }
+      virtual bool dbNextRecord(const Table, const resip::Data&, resip::Data&, bool, bool) { return false; }
+      virtual bool dbBeginTransaction(const Table) { return true; }
+      virtual bool dbCommitTransaction(const Table) { return true; }
+      virtual bool dbRollbackTransaction(const Table) { return true; }
+
+   private:
+      Records mTables[MaxTable];
+      Records::iterator mCursors[MaxTable];
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,195 @@
+// Measures how fast accounting events can be written to and read back from
+// the BerkeleyDb queue and the segmented log, one record per commit (as the
+// AccountingCollector used to write them) and in batches.
+//
+// Usage: benchAccountingQueue [<records> [<batch size> [<directory>]]]
+
+#include <iostream>
+#include <stdlib.h>
+#include <vector>
+
+#include "rutil/compat.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/FileSystem.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/Timer.hxx"
+
+#include "repro/PersistentMessageQueue.hxx"
+#include "repro/SegmentedMessageLog.hxx"
+
+using namespace repro;
+using namespace resip;
+using namespace std;
+
+static Data
+makeEvent(unsigned int i)
+{
+   // About the size of a "Session Routed" event
+   Data event("{\"EventId\":2,\"EventName\":\"Session Routed\",\"Datetime\":\"Mon, 01 Jan 2024 00:00:00 GMT\","
+              "\"CallId\":\"");
+   event += Data(i);
+   event += "-a84b4c76e66710@pc33.example.com\",\"From\":{\"DisplayName\":\"Alice\",\"Uri\":\"sip:alice@example.com\"},"
+            "\"To\":{\"DisplayName\":\"Bob\",\"Uri\":\"sip:bob@example.com\"},\"RequestUri\":\"sip:bob@192.0.2.4:5060\","
+            "\"Routes\":[\"<sip:proxy.example.com;lr>\"],\"Target\":\"sip:bob@192.0.2.4:5060;transport=tcp\"}";
+   return event;
+}
+
+static void
+report(const char* what, unsigned int records, UInt64 elapsedUs)
+{
+   cout << what << ": " << records << " records in " << elapsedUs / 1000 << " ms, "
+        << (elapsedUs ? (UInt64)records * 1000000 / elapsedUs : 0) << " records/s" << endl;
+}
+
+static bool
+write(MessageEnqueueIf& queue, const vector<Data>& events, unsigned int batchSize)
+{
+   vector<Data> batch;
+   for(size_t i = 0; i < events.size(); i++)
+   {
+      batch.push_back(events[i]);
+      if(batch.size() == batchSize || i + 1 == events.size())
+      {
+         if(!(batchSize == 1 ? queue.push(batch[0]) : queue.push(batch)))
+         {
+            return false;
+         }
+         batch.clear();
+      }
+   }
+   return true;
+}
+
+static unsigned int
+read(MessageDequeueIf& queue, unsigned int batchSize)
+{
+   unsigned int count = 0;
+   vector<Data> records;
+   while(queue.pop(batchSize, records, true) && !records.empty())
+   {
+      count += (unsigned int)records.size();
+   }
+   return count;
+}
+
+template<class Enqueue, class Dequeue>
+static void
+run(const char* name, const Data& dir, const vector<Data>& events, unsigned int batchSize)
+{
+   Data label(name);
+   FileSystem::Directory(dir).create();
+   {
+      Enqueue queue(dir);
+      if(!queue.init(true, "benchqueue"))
+      {
+         cerr << name << ": cannot create queue in " << dir << endl;
+         return;
+      }
+      UInt64 start = Timer::getTimeMicroSec();
+      bool ok = write(queue, events, 1);
+      report((label + " push, 1 per commit").c_str(), (unsigned int)events.size(), Timer::getTimeMicroSec() - start);
+
+      start = Timer::getTimeMicroSec();
+      ok = ok && write(queue, events, batchSize);
+      report((label + " push, " + Data(batchSize) + " per commit").c_str(), (unsigned int)events.size(), Timer::getTimeMicroSec() - start);
+      if(!ok)
+      {
+         cerr << name << ": push failed" << endl;
+         return;
+      }
+   }
+   {
+      Dequeue queue(dir);
+      if(!queue.init(true, "benchqueue"))
+      {
+         cerr << name << ": cannot open queue in " << dir << endl;
+         return;
+      }
+      UInt64 start = Timer::getTimeMicroSec();
+      unsigned int count = read(queue, batchSize);
+      report((label + " pop, " + Data(batchSize) + " per commit").c_str(), count, Timer::getTimeMicroSec() - start);
+      if(count != events.size() * 2)
+      {
+         cerr << name << ": read " << count << " records, expected " << events.size() * 2 << endl;
+      }
+   }
+}
+
+int
+main(int argc, char** argv)
+{
+   Log::initialize(Log::Cerr, Log::Warning, argv[0]);
+
+   unsigned int records = argc > 1 ? atoi(argv[1]) : 2000;
+   unsigned int batchSize = argc > 2 ? atoi(argv[2]) : 100;
+   Data dir = argc > 3 ? Data(argv[3]) : Data("./benchAccountingQueue");
+   if(records == 0 || batchSize == 0)
+   {
+      cerr << "usage: " << argv[0] << " [<records> [<batch size> [<directory>]]]" << endl;
+      return 1;
+   }
+
+   FileSystem::Directory(dir).create();
+   vector<Data> events;
+   for(unsigned int i = 0; i < records; i++)
+   {
+      events.push_back(makeEvent(i));
+   }
+
+#ifndef DISABLE_BERKELEYDB_USE
+   run<PersistentMessageEnqueue, PersistentMessageDequeue>("BerkeleyDb", dir + "/db", events, batchSize);
+#endif
+   run<SegmentedMessageLogEnqueue, SegmentedMessageLogDequeue>("SegmentedLog", dir + "/log", events, batchSize);
+
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
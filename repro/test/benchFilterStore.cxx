@@ -0,0 +1,312 @@
+// Measures FilterStore::process() with many filters against a plain scan
+// that runs every filter's regexes in order (how process() used to work),
+// and checks that both pick the same filter.
+//
+// Usage: benchFilterStore [<filters> [<requests>]]
+
+#include <iostream>
+#include <stdlib.h>
+#include <vector>
+
+#ifdef WIN32
+#include <pcreposix.h>
+#else
+#include <regex.h>
+#endif
+
+#include "rutil/compat.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/Timer.hxx"
+#include "resip/stack/ExtensionHeader.hxx"
+#include "resip/stack/SipMessage.hxx"
+
+#include "repro/FilterStore.hxx"
+#include "repro/test/MemoryDb.hxx"
+
+using namespace repro;
+using namespace resip;
+using namespace std;
+
+class Filter
+{
+   public:
+      Data header[2];
+      Data pattern[2];
+      Data method;
+      Data actionData;
+      regex_t re[2];
+};
+
+static void
+headerValues(const SipMessage& msg, const Data& name, vector<Data>& values)
+{
+   values.clear();
+   if(isEqualNoCase(name, "request-line"))
+   {
+      values.push_back(Data::from(msg.header(h_RequestLine)));
+      return;
+   }
+   Headers::Type type = Headers::getType(name.c_str(), name.size());
+   if(type != Headers::UNKNOWN)
+   {
+      const HeaderFieldValueList* hfv = msg.getRawHeader(type);
+      if(!hfv)
+      {
+         return;
+      }
+      for(HeaderFieldValueList::const_iterator it = hfv->begin(); it != hfv->end(); it++)
+      {
+         Data value;
+         it->toShareData(value);
+         values.push_back(value);
+      }
+   }
+   else if(msg.exists(ExtensionHeader(name)))
+   {
+      const StringCategories& headers = msg.header(ExtensionHeader(name));
+      for(StringCategories::const_iterator it = headers.begin(); it != headers.end(); it++)
+      {
+         values.push_back(it->value());
+      }
+   }
+}
+
+// Index of the first filter that applies to msg, -1 if none
+static int
+scan(vector<Filter>& filters, const SipMessage& msg)
+{
+   vector<Data> values;
+   for(size_t k = 0; k < filters.size(); k++)
+   {
+      Filter& filter = filters[k];
+      if(!filter.method.empty() && !isEqualNoCase(filter.method, msg.methodStr()))
+      {
+         continue;
+      }
+      bool match = true;
+      for(int c = 0; c < 2 && match; c++)
+      {
+         if(filter.header[c].empty())
+         {
+            continue;
+         }
+         headerValues(msg, filter.header[c], values);
+         match = false;
+         for(size_t v = 0; v < values.size() && !match; v++)
+         {
+            regmatch_t pmatch[10];
+            match = regexec(&filter.re[c], values[v].c_str(), 10, pmatch, 0) == 0;
+         }
+      }
+      if(match)
+      {
+         return (int)k;
+      }
+   }
+   return -1;
+}
+
+static Data
+makeRequest(int i, int target, int numFilters)
+{
+   // Every fourth request hits a filter, picked by target
+   Data method = i % 8 == 7 ? "MESSAGE" : "INVITE";
+   Data agent = "Softphone/" + Data(i % 5) + ".0";
+   Data from = "sip:user" + Data(i) + "@example.com";
+   Data to = "<sip:+1555" + Data(1000 + i % 9000) + "@example.com>";
+   Data carrier = "carrier-x" + Data(i % 7);
+   Data requestUri = "sip:+1555" + Data(1000 + i % 9000) + "@example.com";
+   if(i % 4 == 0 && target < numFilters)
+   {
+      switch(target % 4)
+      {
+         case 0: agent = "BadAgent" + Data(target) + "/2"; break;
+         case 1: from = "sip:spam" + Data(target) + "@example.net"; break;
+         case 2: to = "<sip:1900" + Data(target) + "123@example.com>"; break;
+         default: carrier = "carrier" + Data(target); requestUri = "sip:9" + Data(i) + "@example.com"; break;
+      }
+   }
+   return method + " " + requestUri + " SIP/2.0\r\n"
+      "Via: SIP/2.0/UDP 192.0.2.1:5060;branch=z9hG4bK" + Data(i) + "\r\n"
+      "Max-Forwards: 70\r\n"
+      "From: <" + from + ">;tag=" + Data(i) + "\r\n"
+      "To: " + to + "\r\n"
+      "Call-ID: " + Data(i) + "@192.0.2.1\r\n"
+      "CSeq: 1 " + method + "\r\n"
+      "Contact: <sip:user@192.0.2.1:5060>\r\n"
+      "User-Agent: " + agent + "\r\n"
+      "X-Carrier: " + carrier + "\r\n"
+      "Content-Length: 0\r\n\r\n";
+}
+
+int
+main(int argc, char** argv)
+{
+   Log::initialize(Log::Cerr, Log::Warning, argv[0]);
+
+   int numFilters = argc > 1 ? atoi(argv[1]) : 1000;
+   int numRequests = argc > 2 ? atoi(argv[2]) : 2000;
+   if(numFilters <= 0 || numFilters > 32000 || numRequests <= 0)
+   {
+      cerr << "usage: " << argv[0] << " [<filters, at most 32000> [<requests>]]" << endl;
+      return 1;
+   }
+
+   MemoryDb db;
+   FilterStore store(db);
+   vector<Filter> filters(numFilters);
+   for(int k = 0; k < numFilters; k++)
+   {
+      Filter& filter = filters[k];
+      switch(k % 4)
+      {
+         case 0:
+            filter.header[0] = "User-Agent";
+            filter.pattern[0] = "^BadAgent" + Data(k) + "/[0-9]+";
+            break;
+         case 1:
+            filter.header[0] = "From";
+            filter.pattern[0] = "sip:spam" + Data(k) + "@";
+            break;
+         case 2:
+            filter.header[0] = "To";
+            filter.pattern[0] = "<sip:\\+?1900" + Data(k) + "[0-9]*@";
+            break;
+         default:
+            filter.header[0] = "X-Carrier";
+            filter.pattern[0] = "^carrier" + Data(k) + "$";
+            filter.header[1] = "request-line";
+            filter.pattern[1] = "^INVITE sip:9";
+            break;
+      }
+      if(k % 10 == 5)
+      {
+         filter.method = "INVITE";
+      }
+      filter.actionData = "filter " + Data(k);
+      for(int c = 0; c < 2; c++)
+      {
+         if(!filter.header[c].empty())
+         {
+            regcomp(&filter.re[c], filter.pattern[c].c_str(), REG_EXTENDED | REG_NOSUB);
+         }
+      }
+      store.addFilter(filter.header[0], filter.pattern[0], filter.header[1], filter.pattern[1],
+                      filter.method, Data::Empty, FilterStore::Reject, filter.actionData, (short)k);
+   }
+
+   vector<SipMessage*> requests;
+   for(int i = 0; i < numRequests; i++)
+   {
+      int target = (int)(((unsigned int)i * 2654435761u) % (unsigned int)numFilters);
+      requests.push_back(SipMessage::make(makeRequest(i, target, numFilters)));
+   }
+
+   vector<int> expected(numRequests);
+   UInt64 start = Timer::getTimeMicroSec();
+   for(int i = 0; i < numRequests; i++)
+   {
+      expected[i] = scan(filters, *requests[i]);
+   }
+   UInt64 scanUs = Timer::getTimeMicroSec() - start;
+
+   vector<Data> results(numRequests);
+   start = Timer::getTimeMicroSec();
+   for(int i = 0; i < numRequests; i++)
+   {
+      short action;
+      if(!store.process(*requests[i], action, results[i]))
+      {
+         results[i] = Data::Empty;
+      }
+   }
+   UInt64 storeUs = Timer::getTimeMicroSec() - start;
+
+   int mismatches = 0;
+   int matched = 0;
+   for(int i = 0; i < numRequests; i++)
+   {
+      Data want = expected[i] == -1 ? Data::Empty : filters[expected[i]].actionData;
+      matched += expected[i] != -1;
+      if(results[i] != want && mismatches++ < 5)
+      {
+         cerr << "request " << i << ": FilterStore gave \"" << results[i] << "\", expected \"" << want << "\"" << endl;
+      }
+   }
+
+   cout << numFilters << " filters, " << numRequests << " requests, " << matched << " filtered" << endl;
+   cout << "regex scan:  " << (double)scanUs / numRequests << " us per request" << endl;
+   cout << "FilterStore: " << (double)storeUs / numRequests << " us per request" << endl;
+
+   for(int k = 0; k < numFilters; k++)
+   {
+      for(int c = 0; c < 2; c++)
+      {
+         if(!filters[k].header[c].empty())
+         {
+            regfree(&filters[k].re[c]);
+         }
+      }
+   }
+   for(int i = 0; i < numRequests; i++)
+   {
+      delete requests[i];
+   }
+   if(mismatches)
+   {
+      cerr << mismatches << " requests gave different results" << endl;
+      return 1;
+   }
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
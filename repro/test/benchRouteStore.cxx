@@ -0,0 +1,203 @@
+// Measures RouteStore::process() against a plain scan that runs every route's
+// regex on the request URI (how process() used to work), and checks that both
+// give the same targets in the same order.
+//
+// Usage: benchRouteStore [<routes> [<lookups>]]
+
+#include <iostream>
+#include <stdlib.h>
+#include <vector>
+
+#ifdef WIN32
+#include <pcreposix.h>
+#else
+#include <regex.h>
+#endif
+
+#include "rutil/compat.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/Timer.hxx"
+#include "resip/stack/Uri.hxx"
+
+#include "repro/RouteStore.hxx"
+#include "repro/test/MemoryDb.hxx"
+
+using namespace repro;
+using namespace resip;
+using namespace std;
+
+class Route
+{
+   public:
+      Data method;
+      Data pattern;
+      Data host;  // of the target the route produces
+      regex_t re;
+};
+
+int
+main(int argc, char** argv)
+{
+   Log::initialize(Log::Cerr, Log::Warning, argv[0]);
+
+   int numRoutes = argc > 1 ? atoi(argv[1]) : 10000;
+   int numLookups = argc > 2 ? atoi(argv[2]) : 1000;
+   if(numRoutes <= 0 || numRoutes > 32000 || numLookups <= 0)
+   {
+      cerr << "usage: " << argv[0] << " [<routes, at most 32000> [<lookups>]]" << endl;
+      return 1;
+   }
+
+   // Mostly number prefix routes, as in a least cost routing dial plan, and
+   // a few by domain or method that have to be tried for every request
+   MemoryDb db;
+   RouteStore store(db);
+   vector<Route> routes(numRoutes);
+   for(int k = 0; k < numRoutes; k++)
+   {
+      Route& route = routes[k];
+      Data rewrite;
+      if(k % 100 == 50)
+      {
+         route.pattern = "@site" + Data(k) + "\\.example\\.com$";
+         route.host = "site" + Data(k) + "-gw.example.com";
+         rewrite = "sip:" + route.host;
+      }
+      else if(k % 100 == 75)
+      {
+         route.method = "MESSAGE";
+         route.pattern = "^sip:" + Data(100000 + k - 1);
+         route.host = "im" + Data(k) + ".example.com";
+         rewrite = "sip:" + route.host;
+      }
+      else
+      {
+         route.pattern = "^sip:(" + Data(100000 + k) + "[0-9]*)@example\\.com";
+         route.host = "gw" + Data(k) + ".example.com";
+         rewrite = "sip:$1@" + route.host;
+      }
+      regcomp(&route.re, route.pattern.c_str(), REG_EXTENDED);
+      store.addRoute(route.method, Data::Empty, route.pattern, rewrite, (short)k);
+   }
+
+   vector<Uri> uris;
+   vector<Data> uriStrings;
+   vector<Data> methods;
+   for(int i = 0; i < numLookups; i++)
+   {
+      int k = (int)(((unsigned int)i * 2654435761u) % (unsigned int)numRoutes);
+      Data uri = "sip:" + Data(100000 + k) + "4567@" +
+                 (i % 10 == 0 ? "site" + Data(k / 100 * 100 + 50) + ".example.com" : Data("example.com"));
+      uriStrings.push_back(uri);
+      uris.push_back(Uri(uri));
+      methods.push_back(i % 20 == 0 ? "MESSAGE" : "INVITE");
+   }
+
+   // Every route, in order
+   vector<vector<Data> > expected(numLookups);
+   UInt64 start = Timer::getTimeMicroSec();
+   for(int i = 0; i < numLookups; i++)
+   {
+      for(int k = 0; k < numRoutes; k++)
+      {
+         if(!routes[k].method.empty() && routes[k].method != methods[i])
+         {
+            continue;
+         }
+         regmatch_t pmatch[10];
+         if(regexec(&routes[k].re, uriStrings[i].c_str(), 10, pmatch, 0) == 0)
+         {
+            expected[i].push_back(routes[k].host);
+         }
+      }
+   }
+   UInt64 scanUs = Timer::getTimeMicroSec() - start;
+
+   vector<RouteStore::UriList> results(numLookups);
+   start = Timer::getTimeMicroSec();
+   for(int i = 0; i < numLookups; i++)
+   {
+      results[i] = store.process(uris[i], methods[i], Data::Empty);
+   }
+   UInt64 storeUs = Timer::getTimeMicroSec() - start;
+
+   int mismatches = 0;
+   for(int i = 0; i < numLookups; i++)
+   {
+      bool same = results[i].size() == expected[i].size();
+      for(size_t j = 0; same && j < expected[i].size(); j++)
+      {
+         same = results[i][j].host() == expected[i][j];
+      }
+      if(!same && mismatches++ < 5)
+      {
+         cerr << "different targets for " << methods[i] << " " << uriStrings[i] << endl;
+      }
+   }
+
+   cout << numRoutes << " routes, " << numLookups << " lookups" << endl;
+   cout << "regex scan: " << (double)scanUs / numLookups << " us per lookup" << endl;
+   cout << "RouteStore: " << (double)storeUs / numLookups << " us per lookup" << endl;
+
+   for(int k = 0; k < numRoutes; k++)
+   {
+      regfree(&routes[k].re);
+   }
+   if(mismatches)
+   {
+      cerr << mismatches << " lookups gave different targets" << endl;
+      return 1;
+   }
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
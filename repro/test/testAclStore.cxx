@@ -0,0 +1,228 @@
+#include <iostream>
+#include <list>
+
+#include "rutil/Data.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/ResipAssert.h"
+#include "resip/stack/Tuple.hxx"
+
+#include "repro/AclStore.hxx"
+#include "repro/test/MemoryDb.hxx"
+
+using namespace repro;
+using namespace resip;
+using namespace std;
+
+// What isAddressTrusted() answered before the ACLs were kept in a trie: the
+// address matches an ACL's address under its mask, and its port unless the
+// ACL's port is 0
+static bool
+linearTrusted(AclStore& store, const Tuple& address)
+{
+   for(AclStore::Key key = store.getFirstAddressKey(); !key.empty(); key = store.getNextAddressKey(key))
+   {
+      Tuple acl = store.getAddressTuple(key);
+      if(acl.isEqualWithMask(address, store.getAddressMask(key), acl.getPort() == 0))
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
+static void
+check(AclStore& store, const char* address, int port, TransportType type, bool trusted)
+{
+   Tuple tuple(address, port, type);
+   const bool result = store.isAddressTrusted(tuple);
+   if(result != trusted || linearTrusted(store, tuple) != trusted)
+   {
+      cerr << address << ":" << port << " " << Tuple::toData(type) << ": trusted " << result
+           << ", linear " << linearTrusted(store, tuple) << ", expected " << trusted << endl;
+      resip_assert(0);
+   }
+}
+
+static void
+testIPv4Masks()
+{
+   MemoryDb db;
+   AclStore store(db);
+
+   resip_assert(store.addAcl(Data::Empty, "10.0.0.0", 8, 0, V4, UDP));
+   check(store, "10.0.0.0", 5060, UDP, true);
+   check(store, "10.255.255.255", 1234, UDP, true);
+   check(store, "11.0.0.1", 5060, UDP, false);
+   check(store, "9.255.255.255", 5060, UDP, false);
+   check(store, "10.1.2.3", 5060, TCP, false);  // transport must match
+
+   resip_assert(store.addAcl(Data::Empty, "192.0.2.7", 32, 5060, V4, TCP));
+   check(store, "192.0.2.7", 5060, TCP, true);
+   check(store, "192.0.2.7", 5061, TCP, false);  // port must match
+   check(store, "192.0.2.6", 5060, TCP, false);
+   check(store, "192.0.2.7", 5060, UDP, false);
+
+   // Same address twice, different ports and transports
+   resip_assert(store.addAcl(Data::Empty, "192.0.2.7", 32, 5061, V4, TLS));
+   check(store, "192.0.2.7", 5061, TLS, true);
+   check(store, "192.0.2.7", 5060, TCP, true);
+   check(store, "192.0.2.7", 5060, TLS, false);
+
+   // A host bit set past the mask is ignored
+   resip_assert(store.addAcl(Data::Empty, "172.16.9.9", 12, 0, V4, UDP));
+   check(store, "172.31.0.1", 5060, UDP, true);
+   check(store, "172.32.0.1", 5060, UDP, false);
+
+   resip_assert(!store.addAcl(Data::Empty, "10.0.0.0", 8, 0, V4, UDP));  // already there
+}
+
+#ifdef USE_IPV6
+static void
+testIPv6Masks()
+{
+   MemoryDb db;
+   AclStore store(db);
+
+   resip_assert(store.addAcl(Data::Empty, "2001:db8:1:2::", 64, 0, V6, UDP));
+   check(store, "2001:db8:1:2::1", 5060, UDP, true);
+   check(store, "2001:db8:1:2:ffff:ffff:ffff:ffff", 5060, UDP, true);
+   check(store, "2001:db8:1:3::1", 5060, UDP, false);
+   check(store, "2001:db8:1:1:ffff:ffff:ffff:ffff", 5060, UDP, false);
+   check(store, "2001:db8:1:2::1", 5060, TCP, false);
+
+   resip_assert(store.addAcl(Data::Empty, "2001:db8::5", 128, 5061, V6, TLS));
+   check(store, "2001:db8::5", 5061, TLS, true);
+   check(store, "2001:db8::4", 5061, TLS, false);
+   check(store, "2001:db8::5", 5060, TLS, false);
+
+   // The families are kept apart: 0a00::/8 has the bits of 10.0.0.0/8
+   resip_assert(store.addAcl(Data::Empty, "10.0.0.0", 8, 0, V4, UDP));
+   check(store, "a00::1", 5060, UDP, false);
+   check(store, "10.0.0.1", 5060, UDP, true);
+   resip_assert(store.addAcl(Data::Empty, "::", 8, 0, V6, TCP));
+   check(store, "0.0.0.1", 5060, TCP, false);
+   check(store, "ff::1", 5060, TCP, true);
+}
+#endif
+
+static void
+testRebuild()
+{
+   MemoryDb db;
+   {
+      AclStore store(db);
+      resip_assert(store.addAcl("192.168.1.0/24", 0, UDP));
+#ifdef USE_IPV6
+      resip_assert(store.addAcl("[2001:db8:a::]/64", 5060, TCP));
+#endif
+      resip_assert(store.addAcl("proxy.example.com", 0, 0));
+   }
+
+   // A new store builds the trie from the records in the database
+   AclStore store(db);
+   check(store, "192.168.1.77", 5060, UDP, true);
+#ifdef USE_IPV6
+   check(store, "2001:db8:a::1", 5060, TCP, true);
+   check(store, "2001:db8:a::1", 5080, TCP, false);
+#endif
+
+   list<Data> peerNames;
+   peerNames.push_back("other.example.com");
+   resip_assert(!store.isTlsPeerNameTrusted(peerNames));
+   peerNames.push_back("proxy.example.com");
+   resip_assert(store.isTlsPeerNameTrusted(peerNames));
+
+   // Each change is seen by the next check
+   store.eraseAcl(Data::Empty, "192.168.1.0", 24, 0, V4, UDP);
+   check(store, "192.168.1.77", 5060, UDP, false);
+
+   resip_assert(store.addAcl(Data::Empty, "192.168.0.0", 16, 0, V4, UDP));
+   check(store, "192.168.1.77", 5060, UDP, true);
+
+#ifdef USE_IPV6
+   check(store, "2001:db8:a::1", 5060, TCP, true);
+   store.eraseAcl(Data::Empty, "2001:db8:a::", 64, 5060, V6, TCP);
+   check(store, "2001:db8:a::1", 5060, TCP, false);
+#endif
+
+   store.eraseAcl("proxy.example.com", Data::Empty, 0, 0, 0, 0);
+   resip_assert(!store.isTlsPeerNameTrusted(peerNames));
+   resip_assert(store.addAcl("other.example.com", 0, 0));
+   resip_assert(store.isTlsPeerNameTrusted(peerNames));
+
+   // Several changes between checks cost one rebuild
+   for(int i = 0; i < 16; i++)
+   {
+      resip_assert(store.addAcl(Data::Empty, "198.51.100." + Data(i), 32, 0, V4, UDP));
+   }
+   store.eraseAcl(Data::Empty, "198.51.100.3", 32, 0, V4, UDP);
+   check(store, "198.51.100.2", 5060, UDP, true);
+   check(store, "198.51.100.3", 5060, UDP, false);
+   check(store, "198.51.100.15", 5060, UDP, true);
+   check(store, "198.51.100.16", 5060, UDP, false);
+}
+
+int
+main(int argc, char** argv)
+{
+   Log::initialize(Log::Cerr, Log::Warning, argv[0]);
+
+   testIPv4Masks();
+#ifdef USE_IPV6
+   testIPv6Masks();
+#endif
+   testRebuild();
+
+   cerr << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
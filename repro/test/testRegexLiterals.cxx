@@ -0,0 +1,169 @@
+#ifdef WIN32
+#include <pcreposix.h>
+#else
+#include <regex.h>
+#endif
+
+#include <iostream>
+
+#include "rutil/Data.hxx"
+#include "rutil/ResipAssert.h"
+
+#include "repro/RegexLiterals.hxx"
+
+using namespace repro;
+using namespace resip;
+using namespace std;
+
+// The stores skip a regex when the request does not contain its required
+// literal (or start with its required prefix), so a wrong answer here makes a
+// route or filter silently stop matching.  Each pattern comes with a string
+// it matches, which must contain the literal and start with the prefix.
+struct LiteralCase
+{
+   const char* pattern;
+   const char* prefix;
+   const char* literal;
+   const char* sample;
+};
+
+static const LiteralCase cases[] =
+{
+   // plain text and anchors
+   { "sip:1800",                   "",             "sip:1800",       "sip:1800@example.com" },
+   { "^sip:1800",                  "sip:1800",     "sip:1800",       "sip:18005551212@example.com" },
+   { "^sip:1800$",                 "sip:1800",     "sip:1800",       "sip:1800" },
+   { "example\\.com$",             "",             "example.com",    "sip:bob@example.com" },
+   { "^.*@example\\.com",          "",             "@example.com",   "sip:bob@example.com" },
+   { "^$",                         "",             "",               "" },
+
+   // alternation: no single literal is in every match
+   { "^sip:1800|^sip:1888",        "",             "",               "sip:1888" },
+   { "abc|abd",                    "",             "",               "abd" },
+   { "^sip:(1800|1888)@",          "sip:",         "sip:",           "sip:1888@" },
+   { "^(sip|sips):bob@",           "",             ":bob@",          "sips:bob@" },
+   { "^(a(b|c))d",                 "a",            "a",              "acd" },
+
+   // groups that match exactly once do not break the text
+   { "^sip:(1800)@example",        "sip:1800@example", "sip:1800@example", "sip:1800@example.com" },
+   { "^sip:(1800[0-9]*)@",         "sip:1800",     "sip:1800",       "sip:18001@" },
+   { "^(sip:)?bob@",               "",             "bob@",           "bob@example.com" },
+   { "^(sip:)*bob@",               "",             "bob@",           "sip:sip:bob@" },
+   { "^(sip:)+bob@",               "",             "bob@",           "sip:sip:bob@" },
+   { "^(sip:){0,1}bob@",           "",             "bob@",           "bob@" },
+
+   // quantifiers on single characters
+   { "^abc?d",                     "ab",           "ab",             "abd" },
+   { "^abc*d",                     "ab",           "ab",             "abd" },
+   { "^abc+d",                     "abc",          "abc",            "abcccd" },
+   { "^a?bcd",                     "",             "bcd",            "bcd" },
+   { "^a*bcd",                     "",             "bcd",            "aaabcd" },
+   { "^ab{0,2}cde",                "a",            "cde",            "acde" },
+   { "^ab{2}cde",                  "a",            "cde",            "abbcde" },
+   { "x.y",                        "",             "x",              "xzy" },
+   { "^x.*yz",                     "x",            "yz",             "x123yz" },
+
+   // character classes
+   { "^[a-z]+@example",            "",             "@example",       "bob@example" },
+   { "^[^@]*@host",                "",             "@host",          "bob@host" },
+   { "^sip:[[:digit:]]+@gateway",  "sip:",         "@gateway",       "sip:5551212@gateway" },
+   { "^[]a]bc",                    "",             "bc",             "]bc" },
+   { "^[^]a]bc",                   "",             "bc",             "xbc" },
+   { "^ab[|]cd",                   "ab",           "ab",             "ab|cd" },
+   { "^ab[(]cd",                   "ab",           "ab",             "ab(cd" },
+   { "^a[.]bcd",                   "a",            "bcd",            "a.bcd" },
+
+   // escapes
+   { "^\\+1800",                   "+1800",        "+1800",          "+18005551212" },
+   { "^a\\.b\\*c",                 "a.b*c",        "a.b*c",          "a.b*c" },
+   { "^a\\|b",                     "a|b",          "a|b",            "a|b" },
+   { "^\\(x\\)yz",                 "(x)yz",        "(x)yz",          "(x)yz" },
+   { "^ab\\.?cd",                  "ab",           "ab",             "abcd" },
+   { "^\\^x",                      "^x",           "^x",             "^x" },
+   { "^a\\$b",                     "a$b",          "a$b",            "a$b" },
+};
+
+
+static void
+checkCase(const LiteralCase& c)
+{
+   const Data prefix = RegexLiterals::requiredPrefix(c.pattern);
+   const Data literal = RegexLiterals::requiredLiteral(c.pattern);
+   if (prefix != c.prefix || literal != c.literal)
+   {
+      cerr << c.pattern << ": prefix \"" << prefix << "\" literal \"" << literal
+           << "\", expected \"" << c.prefix << "\" \"" << c.literal << "\"" << endl;
+      resip_assert(0);
+   }
+
+   regex_t re;
+   resip_assert(regcomp(&re, c.pattern, REG_EXTENDED | REG_NOSUB) == 0);
+   resip_assert(regexec(&re, c.sample, 0, 0, 0) == 0);
+   regfree(&re);
+
+   const Data sample(c.sample);
+   resip_assert(sample.prefix(prefix));
+   resip_assert(literal.empty() || sample.find(literal) != Data::npos);
+}
+
+int
+main(int argc, char** argv)
+{
+   for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+   {
+      checkCase(cases[i]);
+   }
+
+   cerr << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
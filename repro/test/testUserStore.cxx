@@ -0,0 +1,228 @@
+// Checks the UserStore digest credential cache: hits, expiry, not caching
+// failed lookups, and clearing it through the ClearUserAuthCache command.
+
+#include <iostream>
+
+#include "rutil/Data.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/Time.hxx"
+#include "resip/stack/SipStack.hxx"
+
+#include "repro/CommandServer.hxx"
+#include "repro/ProcessorChain.hxx"
+#include "repro/Proxy.hxx"
+#include "repro/ProxyConfig.hxx"
+#include "repro/ReproRunner.hxx"
+#include "repro/UserStore.hxx"
+#include "repro/test/MemoryDb.hxx"
+
+using namespace repro;
+using namespace resip;
+using namespace std;
+
+// Counts the credential lookups that reach the database, and can make them fail
+class CountingDb : public MemoryDb
+{
+   public:
+      CountingDb() : mLookups(0), mFail(false) {}
+
+      virtual bool lookupUserAuthInfo(const Key& key, Data& a1) const
+      {
+         mLookups++;
+         if(mFail)
+         {
+            a1 = Data::Empty;
+            return false;
+         }
+         return MemoryDb::lookupUserAuthInfo(key, a1);
+      }
+
+      // Changes the stored hash behind UserStore's back, as another process
+      // writing to the database would
+      void setPasswordHash(const Data& user, const Data& realm, const Data& hash)
+      {
+         UserRecord rec;
+         rec.user = user;
+         rec.domain = realm;
+         rec.realm = realm;
+         rec.passwordHash = hash;
+         addUser(UserStore::buildKey(user, realm), rec);
+      }
+
+      mutable int mLookups;
+      bool mFail;
+};
+
+class TestReproRunner : public ReproRunner
+{
+   public:
+      TestReproRunner(Proxy& proxy) : mTestProxy(proxy) {}
+      virtual Proxy* getProxy() { return &mTestProxy; }
+
+   private:
+      Proxy& mTestProxy;
+};
+
+// Runs commands directly instead of reading them from a connection
+class TestCommandServer : public CommandServer
+{
+   public:
+      TestCommandServer(ReproRunner& runner)
+         : CommandServer(runner, "127.0.0.1", 0, V4),
+           mResultCode(0)
+      {}
+
+      unsigned int command(const Data& request)
+      {
+         mResultCode = 0;
+         handleRequest(1, 1, request);
+         return mResultCode;
+      }
+
+      virtual void sendResponse(unsigned int, unsigned int, const Data&,
+                                unsigned int resultCode, const Data&)
+      {
+         mResultCode = resultCode;
+      }
+
+   private:
+      unsigned int mResultCode;
+};
+
+int
+main(int argc, char** argv)
+{
+   Log::initialize(Log::Cerr, Log::Warning, argv[0]);
+
+   CountingDb db;
+   ProxyConfig config;
+   config.createDataStore(&db);
+   UserStore& users = config.getDataStore()->mUserStore;
+   users.setAuthCache(10, 1);
+
+   SipStack stack;
+   ProcessorChain requestChain(Processor::REQUEST_CHAIN);
+   ProcessorChain responseChain(Processor::RESPONSE_CHAIN);
+   ProcessorChain targetChain(Processor::TARGET_CHAIN);
+   Proxy proxy(stack, config, requestChain, responseChain, targetChain);
+   TestReproRunner runner(proxy);
+   TestCommandServer commands(runner);
+   resip_assert(&proxy.getUserStore() == &users);
+
+   const Data realm("example.com");
+   db.setPasswordHash("alice", realm, "hash1");
+
+   // hit
+   {
+      resip_assert(users.getUserAuthInfo("alice", realm) == "hash1");
+      resip_assert(db.mLookups == 1);
+      resip_assert(users.getUserAuthInfo("alice", realm) == "hash1");
+      resip_assert(db.mLookups == 1);
+      resip_assert(users.getAuthCacheHits() == 1);
+      resip_assert(users.getAuthCacheMisses() == 1);
+
+      // unknown users are cached too
+      resip_assert(users.getUserAuthInfo("bob", realm).empty());
+      resip_assert(users.getUserAuthInfo("bob", realm).empty());
+      resip_assert(db.mLookups == 2);
+      resip_assert(users.getAuthCacheSize() == 2);
+   }
+
+   // a failed lookup is not mistaken for an unknown user
+   {
+      db.mFail = true;
+      resip_assert(users.getUserAuthInfo("carol", realm).empty());
+      resip_assert(users.getUserAuthInfo("carol", realm).empty());
+      resip_assert(db.mLookups == 4);
+      resip_assert(users.getAuthCacheSize() == 2);
+      db.mFail = false;
+      db.setPasswordHash("carol", realm, "hash3");
+      resip_assert(users.getUserAuthInfo("carol", realm) == "hash3");
+      resip_assert(db.mLookups == 5);
+   }
+
+   // invalidation through the command server
+   {
+      db.setPasswordHash("alice", realm, "hash2");
+      resip_assert(users.getUserAuthInfo("alice", realm) == "hash1");
+
+      resip_assert(commands.command("<ClearUserAuthCache><Request><User>alice</User></Request></ClearUserAuthCache>") == 400);
+      resip_assert(users.getUserAuthInfo("alice", realm) == "hash1");
+
+      resip_assert(commands.command("<ClearUserAuthCache><Request><User>alice</User><Realm>example.com</Realm></Request></ClearUserAuthCache>") == 200);
+      resip_assert(users.getAuthCacheSize() == 2);
+      resip_assert(users.getUserAuthInfo("alice", realm) == "hash2");
+
+      db.setPasswordHash("alice", realm, "hash4");
+      db.setPasswordHash("bob", realm, "hash5");
+      resip_assert(commands.command("<ClearUserAuthCache><Request></Request></ClearUserAuthCache>") == 200);
+      resip_assert(users.getAuthCacheSize() == 0);
+      resip_assert(users.getUserAuthInfo("alice", realm) == "hash4");
+      resip_assert(users.getUserAuthInfo("bob", realm) == "hash5");
+   }
+
+   // expiry
+   {
+      db.setPasswordHash("alice", realm, "hash6");
+      resip_assert(users.getUserAuthInfo("alice", realm) == "hash4");
+      int lookups = db.mLookups;
+      // the TTL is 1s, counted in whole seconds
+      sleepMs(1100);
+      resip_assert(users.getUserAuthInfo("alice", realm) == "hash6");
+      resip_assert(db.mLookups == lookups + 1);
+   }
+
+   cerr << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,377 @@
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "rutil/Data.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/Mutex.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/ThreadIf.hxx"
+#include "rutil/Time.hxx"
+#include "rutil/Timer.hxx"
+#include "resip/stack/ApplicationMessage.hxx"
+
+#include "repro/WorkStealingQueue.hxx"
+
+using namespace repro;
+using namespace resip;
+using namespace std;
+
+class Work : public ApplicationMessage
+{
+   public:
+      Work(int producer, int seq, const Data& key)
+         : mProducer(producer), mSeq(seq), mKey(key)
+      {}
+
+      virtual Message* clone() const { return new Work(*this); }
+      virtual EncodeStream& encode(EncodeStream& strm) const { return strm << "Work " << mProducer << "/" << mSeq; }
+      virtual EncodeStream& encodeBrief(EncodeStream& strm) const { return encode(strm); }
+
+      int mProducer;
+      int mSeq;
+      Data mKey;  // empty if the work is not pinned
+};
+
+static Work*
+getNext(WorkStealingQueue& queues, unsigned int queue, int ms)
+{
+   return dynamic_cast<Work*>(queues.getNext(queue, ms));
+}
+
+// Adds count pieces of work; every other one is pinned to the key of this
+// producer, the others can go to any worker
+class Producer : public ThreadIf
+{
+   public:
+      Producer(WorkStealingQueue& queues, int id, int count)
+         : mQueues(queues), mId(id), mCount(count)
+      {}
+
+      virtual void thread()
+      {
+         const Data key("call-" + Data(mId));
+         for(int seq = 0; seq < mCount; ++seq)
+         {
+            if(seq % 2)
+            {
+               mQueues.add(new Work(mId, seq, key), key);
+            }
+            else
+            {
+               mQueues.add(new Work(mId, seq, Data::Empty));
+            }
+         }
+      }
+
+   private:
+      WorkStealingQueue& mQueues;
+      int mId;
+      int mCount;
+};
+
+// Checks that the work pinned to a key is all done by one worker, in order
+class Results
+{
+   public:
+      Results() : mDone(0) {}
+
+      void done(unsigned int worker, Work* work)
+      {
+         Lock lock(mMutex);
+         if(!work->mKey.empty())
+         {
+            std::map<Data, unsigned int>::iterator w = mWorkerOf.find(work->mKey);
+            if(w == mWorkerOf.end())
+            {
+               mWorkerOf[work->mKey] = worker;
+            }
+            else
+            {
+               resip_assert(w->second == worker);
+            }
+            std::map<Data, int>::iterator last = mLastSeq.find(work->mKey);
+            resip_assert(last == mLastSeq.end() || last->second < work->mSeq);
+            mLastSeq[work->mKey] = work->mSeq;
+         }
+         ++mDone;
+      }
+
+      int doneCount()
+      {
+         Lock lock(mMutex);
+         return mDone;
+      }
+
+   private:
+      Mutex mMutex;
+      std::map<Data, unsigned int> mWorkerOf;
+      std::map<Data, int> mLastSeq;
+      int mDone;
+};
+
+class Worker : public ThreadIf
+{
+   public:
+      Worker(WorkStealingQueue& queues, unsigned int queue, Results& results, int total)
+         : mQueues(queues), mQueue(queue), mResults(results), mTotal(total)
+      {}
+
+      virtual void thread()
+      {
+         while(mResults.doneCount() < mTotal)
+         {
+            Work* work = getNext(mQueues, mQueue, 10);
+            if(work)
+            {
+               UInt64 start = Timer::getTimeMicroSec();
+               mResults.done(mQueue, work);
+               delete work;
+               mQueues.workDone(Timer::getTimeMicroSec() - start);
+            }
+         }
+      }
+
+   private:
+      WorkStealingQueue& mQueues;
+      unsigned int mQueue;
+      Results& mResults;
+      int mTotal;
+};
+
+// Waits for one piece of work on its queue and notes how long that took
+class Waiter : public ThreadIf
+{
+   public:
+      Waiter(WorkStealingQueue& queues, unsigned int queue)
+         : mQueues(queues), mQueue(queue), mWork(0), mWaitedMs(0)
+      {}
+
+      virtual void thread()
+      {
+         UInt64 start = Timer::getTimeMs();
+         mWork = getNext(mQueues, mQueue, 5000);
+         mWaitedMs = Timer::getTimeMs() - start;
+      }
+
+      WorkStealingQueue& mQueues;
+      unsigned int mQueue;
+      Work* mWork;
+      UInt64 mWaitedMs;
+};
+
+int
+main(int argc, char** argv)
+{
+   Log::initialize(Log::Cerr, Log::Warning, argv[0]);
+
+   // pinned work stays on its queue, in order, and is never stolen
+   {
+      WorkStealingQueue queues(3);
+      const Data key("call-a");
+      for(int seq = 0; seq < 5; ++seq)
+      {
+         queues.add(new Work(0, seq, key), key);
+      }
+      resip_assert(queues.getCountDepth() == 5);
+
+      unsigned int owner = queues.numQueues();
+      for(unsigned int q = 0; q < queues.numQueues(); ++q)
+      {
+         Work* work = getNext(queues, q, RESIP_FIFO_NOWAIT);
+         if(work)
+         {
+            resip_assert(owner == queues.numQueues());
+            resip_assert(work->mSeq == 0);
+            owner = q;
+            delete work;
+         }
+      }
+      resip_assert(owner < queues.numQueues());
+      for(int seq = 1; seq < 5; ++seq)
+      {
+         const unsigned int other = (owner + 1) % queues.numQueues();
+         resip_assert(getNext(queues, other, RESIP_FIFO_NOWAIT) == 0);
+         Work* work = getNext(queues, owner, RESIP_FIFO_NOWAIT);
+         resip_assert(work && work->mSeq == seq);
+         delete work;
+      }
+      resip_assert(queues.empty());
+      resip_assert(queues.getStolenCount() == 0);
+   }
+
+   // unpinned work is spread over the queues and stolen by idle workers
+   {
+      WorkStealingQueue queues(3);
+      for(int seq = 0; seq < 6; ++seq)
+      {
+         queues.add(new Work(0, seq, Data::Empty));
+      }
+      resip_assert(queues.getCountDepth() == 6);
+      for(int seq = 0; seq < 6; ++seq)
+      {
+         Work* work = getNext(queues, 0, RESIP_FIFO_NOWAIT);
+         resip_assert(work);
+         delete work;
+      }
+      resip_assert(queues.empty());
+      resip_assert(queues.getStolenCount() == 4);
+      resip_assert(getNext(queues, 0, RESIP_FIFO_NOWAIT) == 0);
+   }
+
+   // count and time depth, service time
+   {
+      WorkStealingQueue queues(2);
+      resip_assert(queues.getTimeDepth() == 0);
+      queues.add(new Work(0, 0, Data::Empty));
+      sleepMs(2100);
+      queues.add(new Work(0, 1, Data::Empty));
+      resip_assert(queues.getCountDepth() == 2);
+      resip_assert(queues.getTimeDepth() >= 2);
+
+      resip_assert(queues.averageServiceTimeMicroSec() == 0);
+      for(int i = 0; i < 1000; ++i)
+      {
+         queues.workDone(64000);
+      }
+      // converges on 64ms, both queues are worked on at once
+      resip_assert(queues.averageServiceTimeMicroSec() > 60000);
+      resip_assert(queues.averageServiceTimeMicroSec() <= 64000);
+      resip_assert(queues.expectedWaitTimeMilliSec() >= 60);
+      resip_assert(queues.expectedWaitTimeMilliSec() <= 64);
+   }
+
+   // idle workers wake up for their own work and for work they can steal
+   {
+      WorkStealingQueue queues(2);
+      const Data key("call-b");
+      Waiter* waiters[2];
+      for(unsigned int q = 0; q < 2; ++q)
+      {
+         waiters[q] = new Waiter(queues, q);
+         waiters[q]->run();
+      }
+      sleepMs(200);
+      // pinned to one of them, so the other one may not take it
+      queues.add(new Work(0, 0, key), key);
+      sleepMs(200);
+      queues.add(new Work(0, 1, Data::Empty));
+      for(unsigned int q = 0; q < 2; ++q)
+      {
+         waiters[q]->join();
+      }
+
+      int pinned = -1;
+      for(unsigned int q = 0; q < 2; ++q)
+      {
+         resip_assert(waiters[q]->mWork);
+         resip_assert(waiters[q]->mWaitedMs < 2000);
+         if(waiters[q]->mWork->mSeq == 0)
+         {
+            pinned = (int)q;
+         }
+      }
+      resip_assert(pinned >= 0);
+      // the other one kept waiting when it was woken up for the pinned work
+      resip_assert(waiters[pinned]->mWaitedMs < waiters[1 - pinned]->mWaitedMs);
+      resip_assert(waiters[1 - pinned]->mWaitedMs >= 350);
+      for(unsigned int q = 0; q < 2; ++q)
+      {
+         delete waiters[q]->mWork;
+         delete waiters[q];
+      }
+      resip_assert(queues.empty());
+   }
+
+   // several producers and workers
+   {
+      const int numProducers = 4;
+      const int numWorkers = 3;
+      const int count = 20000;
+      WorkStealingQueue queues(numWorkers);
+      Results results;
+
+      std::vector<Worker*> workers;
+      for(int i = 0; i < numWorkers; ++i)
+      {
+         workers.push_back(new Worker(queues, i, results, numProducers*count));
+         workers.back()->run();
+      }
+      std::vector<Producer*> producers;
+      for(int i = 0; i < numProducers; ++i)
+      {
+         producers.push_back(new Producer(queues, i, count));
+         producers.back()->run();
+      }
+
+      for(int i = 0; i < numProducers; ++i)
+      {
+         producers[i]->join();
+         delete producers[i];
+      }
+      for(int i = 0; i < numWorkers; ++i)
+      {
+         workers[i]->join();
+         delete workers[i];
+      }
+      resip_assert(results.doneCount() == numProducers*count);
+      resip_assert(queues.empty());
+      resip_assert(queues.getCountDepth() == 0);
+      cerr << queues.getStolenCount() << " of " << numProducers*count
+           << " pieces of work were stolen" << endl;
+   }
+
+   cerr << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -47,18 +47,21 @@ DialogId::DialogId(const SipMessage& msg) :
          }
       }
    }
+   mHash = mDialogSetId.hash() ^ mRemoteTag.hash();
    DebugLog ( << "DialogId::DialogId: " << *this);   
 }
 
 DialogId::DialogId(const Data& callId, const Data& localTag, const Data& remoteTag) : 
    mDialogSetId(callId, localTag),
-   mRemoteTag(remoteTag)
+   mRemoteTag(remoteTag),
+   mHash(mDialogSetId.hash() ^ mRemoteTag.hash())
 {
 }
 
 DialogId::DialogId(const DialogSetId& id, const Data& remoteTag) :
    mDialogSetId(id),
-   mRemoteTag(remoteTag)
+   mRemoteTag(remoteTag),
+   mHash(mDialogSetId.hash() ^ mRemoteTag.hash())
 {
    DebugLog ( << "DialogId::DialogId: " << *this);   
 }
@@ -66,13 +69,13 @@ DialogId::DialogId(const DialogSetId& id, const Data& remoteTag) :
 bool
 DialogId::operator==(const DialogId& rhs) const
 {
-   return mDialogSetId == rhs.mDialogSetId && mRemoteTag == rhs.mRemoteTag;
+   return mHash == rhs.mHash && mDialogSetId == rhs.mDialogSetId && mRemoteTag == rhs.mRemoteTag;
 }
 
 bool
 DialogId::operator!=(const DialogId& rhs) const
 {
-   return mDialogSetId != rhs.mDialogSetId || mRemoteTag != rhs.mRemoteTag;
+   return mHash != rhs.mHash || mDialogSetId != rhs.mDialogSetId || mRemoteTag != rhs.mRemoteTag;
 }
 
 bool
@@ -121,11 +124,6 @@ resip::operator<<(EncodeStream& os, const DialogId& id)
 }
 
 
-size_t DialogId::hash() const 
-{
-   return mDialogSetId.hash() ^ mRemoteTag.hash();
-}
-
 HashValueImp(resip::DialogId, data.hash());
 
 /* ====================================================================
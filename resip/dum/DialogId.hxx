@@ -24,12 +24,13 @@ class DialogId
       const Data& getLocalTag() const;
       const Data& getRemoteTag() const;
 
-      size_t hash() const;
+      size_t hash() const { return mHash; }
 
    private:
       friend EncodeStream& operator<<(EncodeStream&, const DialogId& id);
       DialogSetId mDialogSetId;
       Data mRemoteTag;
+      size_t mHash; // of the DialogSetId and mRemoteTag; compared first by operator==
 };
 }
 
@@ -106,7 +106,7 @@ class DialogSet
 
       MergedRequestKey mMergeKey;
       Data mCancelKey;
-      typedef std::map<DialogId,Dialog*> DialogMap;
+      typedef HashMap<DialogId,Dialog*> DialogMap;
       DialogMap mDialogs;
       BaseCreator* mCreator;
       DialogSetId mId;
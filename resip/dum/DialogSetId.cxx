@@ -49,30 +49,33 @@ DialogSetId::DialogSetId(const SipMessage& msg) :
          mTag = msg.header(h_To).param(p_tag);
       }
    }
+   mHash = mCallId.hash() ^ mTag.hash();
 }
 
 DialogSetId::DialogSetId(const Data& callId, const Data& tag)
    : mCallId(callId),
-     mTag(tag)
+     mTag(tag),
+     mHash(mCallId.hash() ^ mTag.hash())
 {
 }
 
 DialogSetId::DialogSetId() 
    : mCallId(),
-     mTag()
+     mTag(),
+     mHash(mCallId.hash() ^ mTag.hash())
 {
 }
 
 bool
 DialogSetId::operator==(const DialogSetId& rhs) const
 {
-   return mCallId == rhs.mCallId && mTag == rhs.mTag;
+   return mHash == rhs.mHash && mCallId == rhs.mCallId && mTag == rhs.mTag;
 }
 
 bool
 DialogSetId::operator!=(const DialogSetId& rhs) const
 {
-   return mCallId != rhs.mCallId || mTag != rhs.mTag;
+   return mHash != rhs.mHash || mCallId != rhs.mCallId || mTag != rhs.mTag;
 }
 
 bool
@@ -103,11 +106,6 @@ DialogSetId::operator>(const DialogSetId& rhs) const
    return mTag > rhs.mTag;
 }
 
-size_t DialogSetId::hash() const
-{
-    return mCallId.hash() ^ mTag.hash();
-}
-
 
 EncodeStream&
 resip::operator<<(EncodeStream& os, const DialogSetId& id)
@@ -21,7 +21,7 @@ class DialogSetId
       bool operator!=(const DialogSetId& rhs) const;
       bool operator<(const DialogSetId& rhs) const;
       bool operator>(const DialogSetId& rhs) const;
-      size_t hash() const;
+      size_t hash() const { return mHash; }
       friend EncodeStream& operator<<(EncodeStream&, const DialogSetId& id);
       
       const Data& getCallId() const { return mCallId; }
@@ -31,6 +31,7 @@ class DialogSetId
       
       Data mCallId;
       Data mTag;
+      size_t mHash; // of mCallId and mTag; compared first by operator==
 };
 
     EncodeStream& operator<<(EncodeStream&, const DialogSetId&);
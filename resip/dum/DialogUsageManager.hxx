@@ -495,7 +495,7 @@ class DialogUsageManager : public HandleManager, public TransactionUser
       typedef std::set<MergedRequestKey> MergedRequests;
       MergedRequests mMergedRequests;
             
-      typedef std::map<Data, DialogSet*> CancelMap;
+      typedef HashMap<Data, DialogSet*> CancelMap;
       CancelMap mCancelMap;
       
       typedef HashMap<DialogSetId, DialogSet*> DialogSetMap;
@@ -550,13 +550,13 @@ class DialogUsageManager : public HandleManager, public TransactionUser
       ShutdownState mShutdownState;
 
       // from ETag -> ServerPublication
-      typedef std::map<Data, ServerPublication*> ServerPublications;
+      typedef HashMap<Data, ServerPublication*> ServerPublications;
       ServerPublications mServerPublications;
       typedef std::map<Data, SipMessage*> RequiresCerts;
       RequiresCerts mRequiresCerts;      
       // from Event-Type+document-aor -> ServerSubscription
       // Managed by ServerSubscription
-      typedef std::multimap<Data, ServerSubscription*> ServerSubscriptions;
+      typedef HashMultiMap<Data, ServerSubscription*> ServerSubscriptions;
       ServerSubscriptions mServerSubscriptions;
 
       IncomingTarget* mIncomingTarget;
@@ -53,19 +53,37 @@ contactsRemoveIfRequired(ContactList& contacts, UInt64& now,
 #endif
 }
 
-InMemorySyncRegDb::InMemorySyncRegDb(unsigned int removeLingerSecs) : 
+InMemorySyncRegDb::InMemorySyncRegDb(unsigned int removeLingerSecs, unsigned int numShards) : 
    mRemoveLingerSecs(removeLingerSecs)
 {
+   resip_assert(numShards > 0);
+   mShards.reserve(numShards);
+   for(unsigned int i = 0; i < numShards; i++)
+   {
+      mShards.push_back(new Shard);
+   }
 }
 
 InMemorySyncRegDb::~InMemorySyncRegDb()
 {
-   for( database_map_t::const_iterator it = mDatabase.begin();
-        it != mDatabase.end(); it++)
+   for(std::vector<Shard*>::iterator shard = mShards.begin(); shard != mShards.end(); shard++)
    {
-      delete it->second;
+      for( database_map_t::const_iterator it = (*shard)->mDatabase.begin();
+           it != (*shard)->mDatabase.end(); it++)
+      {
+         delete it->second;
+      }
+      delete *shard;
    }
-   mDatabase.clear();
+   mShards.clear();
+}
+
+InMemorySyncRegDb::Shard&
+InMemorySyncRegDb::getShard(const Uri& aor)
+{
+   // Uri::operator< compares the user part exactly, so AORs the database
+   // treats as equal always land in the same shard
+   return *mShards[aor.user().hash() % mShards.size()];
 }
 
 void 
@@ -120,18 +138,21 @@ InMemorySyncRegDb::invokeOnInitialSyncAor(unsigned int connectionId, const resip
 void 
 InMemorySyncRegDb::initialSync(unsigned int connectionId)
 {
-   Lock g(mDatabaseMutex);
    UInt64 now = Timer::getTimeSecs();
-   for(database_map_t::iterator it = mDatabase.begin(); it != mDatabase.end(); it++)
+   for(std::vector<Shard*>::iterator shard = mShards.begin(); shard != mShards.end(); shard++)
    {
-      if(it->second)
+      WriteLock g((*shard)->mDatabaseMutex);
+      for(database_map_t::iterator it = (*shard)->mDatabase.begin(); it != (*shard)->mDatabase.end(); it++)
       {
-         ContactList& contacts = *(it->second);
-         if(mRemoveLingerSecs > 0) 
+         if(it->second)
          {
-            contactsRemoveIfRequired(contacts, now, mRemoveLingerSecs);
+            ContactList& contacts = *(it->second);
+            if(mRemoveLingerSecs > 0) 
+            {
+               contactsRemoveIfRequired(contacts, now, mRemoveLingerSecs);
+            }
+            invokeOnInitialSyncAor(connectionId, it->first, contacts);
          }
-         invokeOnInitialSyncAor(connectionId, it->first, contacts);
       }
    }
 }
@@ -140,9 +161,10 @@ void
 InMemorySyncRegDb::addAor(const Uri& aor,
                           const ContactList& contacts)
 {
-   Lock g(mDatabaseMutex);
-   database_map_t::iterator it = mDatabase.find(aor);
-   if(it != mDatabase.end())
+   Shard& shard = getShard(aor);
+   WriteLock g(shard.mDatabaseMutex);
+   database_map_t::iterator it = shard.mDatabase.find(aor);
+   if(it != shard.mDatabase.end())
    {
        if(it->second)
        {
@@ -155,7 +177,7 @@ InMemorySyncRegDb::addAor(const Uri& aor,
    }
    else
    {
-       mDatabase[aor] = new ContactList(contacts);
+       shard.mDatabase[aor] = new ContactList(contacts);
    }
    invokeOnAorModified(true /* sync? */, aor, contacts);
 }
@@ -163,35 +185,41 @@ InMemorySyncRegDb::addAor(const Uri& aor,
 void 
 InMemorySyncRegDb::removeAor(const Uri& aor)
 {
-  database_map_t::iterator i;
-
-  Lock g(mDatabaseMutex);
-  i = mDatabase.find(aor);
+  Shard& shard = getShard(aor);
+  WriteLock g(shard.mDatabaseMutex);
+  database_map_t::iterator i = shard.mDatabase.find(aor);
   //DebugLog (<< "Removing registration bindings " << aor);
-  if (i != mDatabase.end())
+  if (i != shard.mDatabase.end())
   {
-     if (i->second)
+     removeAorLocked(i);
+  }
+}
+
+void 
+InMemorySyncRegDb::removeAorLocked(database_map_t::iterator i)
+{
+  const Uri& aor = i->first;
+  if (i->second)
+  {
+     if(mRemoveLingerSecs > 0)
      {
-        if(mRemoveLingerSecs > 0)
-        {
-           ContactList& contacts = *(i->second);
-           UInt64 now = Timer::getTimeSecs();
-           for(ContactList::iterator it = contacts.begin(); it != contacts.end(); it++)
-           {
-              // Don't delete record - set expires to 0
-              it->mRegExpires = 0;
-              it->mLastUpdated = now;
-           }
-           invokeOnAorModified(true /* sync? */, aor, contacts);
-        }
-        else
+        ContactList& contacts = *(i->second);
+        UInt64 now = Timer::getTimeSecs();
+        for(ContactList::iterator it = contacts.begin(); it != contacts.end(); it++)
         {
-           delete i->second;
-           // Setting this to 0 causes it to be removed when we unlock the AOR.
-           i->second = 0;
-           ContactList emptyList;
-           invokeOnAorModified(true /* sync? */, aor, emptyList);
+           // Don't delete record - set expires to 0
+           it->mRegExpires = 0;
+           it->mLastUpdated = now;
         }
+        invokeOnAorModified(true /* sync? */, aor, contacts);
+     }
+     else
+     {
+        delete i->second;
+        // Setting this to 0 causes it to be removed when we unlock the AOR.
+        i->second = 0;
+        ContactList emptyList;
+        invokeOnAorModified(true /* sync? */, aor, emptyList);
      }
   }
 }
@@ -200,11 +228,14 @@ void
 InMemorySyncRegDb::getAors(InMemorySyncRegDb::UriList& container)
 {
    container.clear();
-   Lock g(mDatabaseMutex);
-   for( database_map_t::const_iterator it = mDatabase.begin();
-        it != mDatabase.end(); it++)
+   for(std::vector<Shard*>::iterator shard = mShards.begin(); shard != mShards.end(); shard++)
    {
-      container.push_back(it->first);
+      ReadLock g((*shard)->mDatabaseMutex);
+      for( database_map_t::const_iterator it = (*shard)->mDatabase.begin();
+           it != (*shard)->mDatabase.end(); it++)
+      {
+         container.push_back(it->first);
+      }
    }
 }
 
@@ -217,10 +248,11 @@ InMemorySyncRegDb::aorIsRegistered(const Uri& aor)
 bool 
 InMemorySyncRegDb::aorIsRegistered(const Uri& aor, UInt64* maxExpires)
 {
-   Lock g(mDatabaseMutex);
+   Shard& shard = getShard(aor);
+   ReadLock g(shard.mDatabaseMutex);
    bool registered = false;
-   database_map_t::iterator i = mDatabase.find(aor);
-   if (i != mDatabase.end() && i->second != 0)
+   database_map_t::iterator i = shard.mDatabase.find(aor);
+   if (i != shard.mDatabase.end() && i->second != 0)
    {
       if (mRemoveLingerSecs > 0 || maxExpires)
       {
@@ -253,73 +285,79 @@ InMemorySyncRegDb::aorIsRegistered(const Uri& aor, UInt64* maxExpires)
 void
 InMemorySyncRegDb::lockRecord(const Uri& aor)
 {
-   Lock g2(mLockedRecordsMutex);
+   Shard& shard = getShard(aor);
+   Lock g2(shard.mLockedRecordsMutex);
 
    DebugLog(<< "InMemorySyncRegDb::lockRecord:  aor=" << aor << " threadid=" << ThreadIf::selfId());
 
    {
-      Lock g1(mDatabaseMutex);
+      WriteLock g1(shard.mDatabaseMutex);
       // This forces insertion if the record does not yet exist.
-      mDatabase[aor];
+      shard.mDatabase[aor];
    }
 
-   while (mLockedRecords.count(aor))
+   while (shard.mLockedRecords.count(aor))
    {
-      mRecordUnlocked.wait(mLockedRecordsMutex);
+      shard.mRecordUnlocked.wait(shard.mLockedRecordsMutex);
    }
 
-   mLockedRecords.insert(aor);
+   shard.mLockedRecords.insert(aor);
 }
 
 void
 InMemorySyncRegDb::unlockRecord(const Uri& aor)
 {
-   Lock g2(mLockedRecordsMutex);
+   Shard& shard = getShard(aor);
+   Lock g2(shard.mLockedRecordsMutex);
 
    DebugLog(<< "InMemorySyncRegDb::unlockRecord:  aor=" << aor << " threadid=" << ThreadIf::selfId());
 
    {
-      Lock g1(mDatabaseMutex);
+      WriteLock g1(shard.mDatabaseMutex);
       // If the pointer is null, we remove the record from the map.
-      database_map_t::iterator i = mDatabase.find(aor);
+      database_map_t::iterator i = shard.mDatabase.find(aor);
 
       // The record must have been inserted when we locked it in the first place
-      resip_assert (i != mDatabase.end());
+      resip_assert (i != shard.mDatabase.end());
 
       if (i->second == 0)
       {
-         mDatabase.erase(i);
+         shard.mDatabase.erase(i);
       }
    }
 
-   mLockedRecords.erase(aor);
-   mRecordUnlocked.broadcast();
+   shard.mLockedRecords.erase(aor);
+   shard.mRecordUnlocked.broadcast();
 }
 
 RegistrationPersistenceManager::update_status_t 
 InMemorySyncRegDb::updateContact(const resip::Uri& aor, 
                                  const ContactInstanceRecord& rec) 
 {
-   ContactList *contactList = 0;
+   Shard& shard = getShard(aor);
+   WriteLock g(shard.mDatabaseMutex);
 
+   ContactList *contactList = 0;
+   database_map_t::iterator i;
+   i = shard.mDatabase.find(aor);
+   if (i == shard.mDatabase.end() || i->second == 0)
    {
-      Lock g(mDatabaseMutex);
-
-      database_map_t::iterator i;
-      i = mDatabase.find(aor);
-      if (i == mDatabase.end() || i->second == 0)
-      {
-         contactList = new ContactList();
-         mDatabase[aor] = contactList;
-      }
-      else
-      {
-         contactList = i->second;
-      }
+      contactList = new ContactList();
+      shard.mDatabase[aor] = contactList;
+   }
+   else
+   {
+      contactList = i->second;
    }
    
    resip_assert(contactList);
 
+   if(mRemoveLingerSecs > 0)
+   {
+      UInt64 now = Timer::getTimeSecs();
+      contactsRemoveIfRequired(*contactList, now, mRemoveLingerSecs);
+   }
+
    ContactList::iterator j;
 
    // See if the contact is already present. We use URI matching rules here.
@@ -354,19 +392,16 @@ void
 InMemorySyncRegDb::removeContact(const Uri& aor, 
                                  const ContactInstanceRecord& rec)
 {
-   ContactList *contactList = 0;
+   Shard& shard = getShard(aor);
+   WriteLock g(shard.mDatabaseMutex);
 
+   database_map_t::iterator i;
+   i = shard.mDatabase.find(aor);
+   if (i == shard.mDatabase.end() || i->second == 0)
    {
-      Lock g(mDatabaseMutex);
-
-      database_map_t::iterator i;
-      i = mDatabase.find(aor);
-      if (i == mDatabase.end() || i->second == 0)
-      {
-         return;
-      }
-      contactList = i->second;
+      return;
    }
+   ContactList *contactList = i->second;
 
    ContactList::iterator j;
 
@@ -387,7 +422,7 @@ InMemorySyncRegDb::removeContact(const Uri& aor,
             contactList->erase(j);
             if (contactList->empty())
             {
-               removeAor(aor);
+               removeAorLocked(i);
             }
             else
             {
@@ -403,18 +438,20 @@ InMemorySyncRegDb::removeContact(const Uri& aor,
 void
 InMemorySyncRegDb::getContacts(const Uri& aor, ContactList& container)
 {
-   Lock g(mDatabaseMutex);
-   database_map_t::iterator i = mDatabase.find(aor);
-   if (i == mDatabase.end() || i->second == 0)
+   Shard& shard = getShard(aor);
+   ReadLock g(shard.mDatabaseMutex);
+   database_map_t::iterator i = shard.mDatabase.find(aor);
+   if (i == shard.mDatabase.end() || i->second == 0)
    {
       container.clear();
       return;
    }
    if(mRemoveLingerSecs > 0)
    {
+      // Lingering contacts are left for updateContact() and initialSync()
+      // to remove; only readers hold the lock here.
       ContactList& contacts = *(i->second);
       UInt64 now = Timer::getTimeSecs();
-      contactsRemoveIfRequired(contacts, now, mRemoveLingerSecs);
       container.clear();
       for(ContactList::iterator it = contacts.begin(); it != contacts.end(); it++)
       {
@@ -433,20 +470,20 @@ InMemorySyncRegDb::getContacts(const Uri& aor, ContactList& container)
 void
 InMemorySyncRegDb::getContactsFull(const Uri& aor, ContactList& container)
 {
-   Lock g(mDatabaseMutex);
-   database_map_t::iterator i = mDatabase.find(aor);
-   if (i == mDatabase.end() || i->second == 0)
+   Shard& shard = getShard(aor);
+   ReadLock g(shard.mDatabaseMutex);
+   database_map_t::iterator i = shard.mDatabase.find(aor);
+   if (i == shard.mDatabase.end() || i->second == 0)
    {
       container.clear();
       return;
    }
-   ContactList& contacts = *(i->second);
+   container = *(i->second);
    if(mRemoveLingerSecs > 0)
    {
       UInt64 now = Timer::getTimeSecs();
-      contactsRemoveIfRequired(contacts, now, mRemoveLingerSecs);
+      contactsRemoveIfRequired(container, now, mRemoveLingerSecs);
    }
-   container = contacts;
 }
 
 
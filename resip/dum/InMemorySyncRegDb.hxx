@@ -4,9 +4,11 @@
 #include <map>
 #include <set>
 #include <list>
+#include <vector>
 
 #include "resip/dum/RegistrationPersistenceManager.hxx"
 #include "rutil/Mutex.hxx"
+#include "rutil/RWMutex.hxx"
 #include "rutil/Condition.hxx"
 #include "rutil/Lock.hxx"
 
@@ -48,12 +50,17 @@ protected:
   transport registration bindings to a remote peer for replication.
   See the RegSyncClient and RegSyncServer implementations in the repro
   project.
+
+  AORs are spread over a number of shards by a hash of their user part.
+  Each shard has its own readers/writer lock and its own set of locked
+  records, so lookups only wait for changes to AORs in the same shard, and
+  only while such a change is being made.
 */
 class InMemorySyncRegDb : public RegistrationPersistenceManager
 {
    public:
 
-      InMemorySyncRegDb(unsigned int removeLingerSecs = 0);
+      InMemorySyncRegDb(unsigned int removeLingerSecs = 0, unsigned int numShards = 64);
       virtual ~InMemorySyncRegDb();
       
       virtual void addHandler(InMemorySyncRegDbHandler* handler);
@@ -82,12 +89,24 @@ class InMemorySyncRegDb : public RegistrationPersistenceManager
       
    protected:
       typedef std::map<Uri,ContactList *> database_map_t;
-      database_map_t mDatabase;
-      Mutex mDatabaseMutex;
 
-      std::set<Uri> mLockedRecords;
-      Mutex mLockedRecordsMutex;
-      Condition mRecordUnlocked;
+      class Shard
+      {
+         public:
+            /// held for reading to look at mDatabase or the ContactLists in
+            /// it, and for writing to change them
+            RWMutex mDatabaseMutex;
+            database_map_t mDatabase;
+
+            std::set<Uri> mLockedRecords;
+            Mutex mLockedRecordsMutex;
+            Condition mRecordUnlocked;
+      };
+      std::vector<Shard*> mShards;
+      Shard& getShard(const Uri& aor);
+
+      /// mDatabaseMutex of the shard {i} is in must be held for writing
+      void removeAorLocked(database_map_t::iterator i);
 
       void invokeOnAorModified(bool sync, const resip::Uri& aor, const ContactList& contacts);
       void invokeOnInitialSyncAor(unsigned int connectionId, const resip::Uri& aor, const ContactList& contacts);
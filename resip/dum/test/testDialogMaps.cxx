@@ -0,0 +1,177 @@
+// Compares the cost of finding dialogs, CANCEL targets and subscriptions in
+// the ordered maps DUM used to keep them in with the hash tables it uses now.
+// The dialogs are those of a B2BUA: every call has two legs that differ only
+// in their Call-ID, and many share the same long host part.
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "resip/dum/DialogId.hxx"
+#include "resip/stack/Helper.hxx"
+#include "rutil/HashMap.hxx"
+#include "rutil/Timer.hxx"
+
+using namespace resip;
+using namespace std;
+
+struct Leg
+{
+   Data callId;
+   Data localTag;
+   Data remoteTag;
+   Data transactionId;
+   Data eventKey;
+};
+
+template<class Map>
+static UInt64
+timeDialogLookups(const vector<Leg>& legs, Map& dialogs, int rounds)
+{
+   for (size_t i = 0; i < legs.size(); ++i)
+   {
+      dialogs[DialogId(legs[i].callId, legs[i].localTag, legs[i].remoteTag)] = (int)i;
+   }
+   UInt64 start = Timer::getTimeMicroSec();
+   size_t found = 0;
+   for (int r = 0; r < rounds; ++r)
+   {
+      for (size_t i = 0; i < legs.size(); ++i)
+      {
+         // DUM builds the id from each message it receives
+         if (dialogs.find(DialogId(legs[i].callId, legs[i].localTag, legs[i].remoteTag)) != dialogs.end())
+         {
+            ++found;
+         }
+      }
+   }
+   UInt64 elapsed = Timer::getTimeMicroSec() - start;
+   resip_assert(found == legs.size() * rounds);
+   return elapsed;
+}
+
+template<class Map>
+static UInt64
+timeDataLookups(const vector<Leg>& legs, const Data Leg::* key, Map& index, int rounds)
+{
+   for (size_t i = 0; i < legs.size(); ++i)
+   {
+      index.insert(typename Map::value_type(legs[i].*key, (int)i));
+   }
+   UInt64 start = Timer::getTimeMicroSec();
+   size_t found = 0;
+   for (int r = 0; r < rounds; ++r)
+   {
+      for (size_t i = 0; i < legs.size(); ++i)
+      {
+         found += index.count(legs[i].*key) ? 1 : 0;
+      }
+   }
+   UInt64 elapsed = Timer::getTimeMicroSec() - start;
+   resip_assert(found == legs.size() * rounds);
+   return elapsed;
+}
+
+static void
+report(const char* what, UInt64 before, UInt64 after, size_t lookups)
+{
+   cout << what << ": ordered " << (double)before * 1000 / lookups << " ns, hashed "
+        << (double)after * 1000 / lookups << " ns per lookup" << endl;
+}
+
+int
+main(int argc, char* argv[])
+{
+   const int numDialogs = argc > 1 ? atoi(argv[1]) : 100000;
+   const int rounds = argc > 2 ? atoi(argv[2]) : 5;
+
+   const Data host("@b2bua-0123456789.example.com");
+   vector<Leg> legs;
+   legs.reserve(numDialogs);
+   for (int i = 0; i < numDialogs / 2; ++i)
+   {
+      Leg a;
+      a.callId = Helper::computeCallId() + host;
+      a.localTag = Helper::computeTag(Helper::tagSize);
+      a.remoteTag = Helper::computeTag(Helper::tagSize);
+      a.transactionId = Helper::computeUniqueBranch();
+      a.eventKey = Data("presence") + "sip:user" + Data(i) + host;
+      Leg b(a);
+      b.callId = Helper::computeCallId() + host;
+      b.transactionId = Helper::computeUniqueBranch();
+      legs.push_back(a);
+      legs.push_back(b);
+   }
+   const size_t lookups = legs.size() * rounds;
+   cout << legs.size() << " dialogs, " << lookups << " lookups each" << endl;
+
+   {
+      map<DialogId, int> before;
+      HashMap<DialogId, int> after;
+      report("Dialog", timeDialogLookups(legs, before, rounds),
+             timeDialogLookups(legs, after, rounds), lookups);
+   }
+   {
+      map<Data, int> before;
+      HashMap<Data, int> after;
+      report("CANCEL", timeDataLookups(legs, &Leg::transactionId, before, rounds),
+             timeDataLookups(legs, &Leg::transactionId, after, rounds), lookups);
+   }
+   {
+      multimap<Data, int> before;
+      HashMultiMap<Data, int> after;
+      report("Subscription", timeDataLookups(legs, &Leg::eventKey, before, rounds),
+             timeDataLookups(legs, &Leg::eventKey, after, rounds), lookups);
+   }
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
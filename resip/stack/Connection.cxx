@@ -37,6 +37,7 @@ Connection::Connection(Transport* transport,const Tuple& who, Socket socket,
    : ConnectionBase(transport,who,compression),
      mFirstWriteAfterConnectedPending(false),
      mInWritable(false),
+     mWriteRetryPending(false),
      mFlowTimerEnabled(false),
      mPollItemHandle(0),
      mIsServer(isServer)
@@ -58,6 +59,17 @@ Connection::Connection(Transport* transport,const Tuple& who, Socket socket,
 
 Connection::~Connection()
 {
+   // ConnectionBase fails the transaction of each outstanding send; fail
+   // the ones merged into the front send here
+   if(mTransport && !mOutstandingSends.empty())
+   {
+      for (std::vector<Data>::const_iterator it = mFrontSendMergedTids.begin(); it != mFrontSendMergedTids.end(); ++it)
+      {
+         mTransport->fail(*it,
+            mFailureReason ? mFailureReason : TransportFailure::ConnectionUnknown,
+            mFailureSubCode);
+      }
+   }
    if(mWho.mFlowKey && ConnectionBase::transport())
    {
       getConnectionManager().removeConnection(this);
@@ -81,6 +93,8 @@ Connection::removeFrontOutstandingSend()
 {
    delete mOutstandingSends.front();
    mOutstandingSends.pop_front();
+   mFrontSendMergedTids.clear();
+   mWriteRetryPending = false;
 
    if (mOutstandingSends.empty())
    {
@@ -259,6 +273,17 @@ Connection::performWrite()
       }
    }
 
+   if (mSendingTransmissionFormat == Uncompressed &&
+       ConnectionManager::MaxWriteCoalesceBytes > 0 &&
+       mOutstandingSends.size() > 1)
+   {
+      if (canGatherWrite())
+      {
+         return performGatherWrite();
+      }
+      coalesceOutstandingSends();
+   }
+
    const Data& data = mOutstandingSends.front()->data;
    int nBytes = write(data.data() + mSendPos,int(data.size() - mSendPos));
 
@@ -274,6 +299,7 @@ Connection::performWrite()
    {
       // Nothing was written - likely socket buffers are backed up and EWOULDBLOCK was returned
       // no need to do calculations in else statement
+      mWriteRetryPending = true;
       return 0;
    }
    else
@@ -281,15 +307,123 @@ Connection::performWrite()
       // Safe because of the conditional above ( < 0 ).
       Data::size_type bytesWritten = static_cast<Data::size_type>(nBytes);
       mSendPos += bytesWritten;
+      mWriteRetryPending = false;
       if (mSendPos == data.size())
       {
+         ConnectionManager::countWrite((unsigned int)mFrontSendMergedTids.size() + 1);
          mSendPos = 0;
          removeFrontOutstandingSend();
       }
+      else
+      {
+         ConnectionManager::countWrite(0);
+      }
       return bytesWritten;
    }
 }
 
+int
+Connection::performGatherWrite()
+{
+   WriteBuffer buffers[MaxGatherBuffers];
+   int count = 0;
+   size_t total = 0;
+   Data::size_type offset = mSendPos;
+   for (std::list<SendData*>::const_iterator it = mOutstandingSends.begin();
+        it != mOutstandingSends.end() && count < MaxGatherBuffers; ++it)
+   {
+      if ((*it)->command != SendData::NoCommand)
+      {
+         break;
+      }
+      const Data& data = (*it)->data;
+      if (count > 0 && total + data.size() > ConnectionManager::MaxWriteCoalesceBytes)
+      {
+         break;
+      }
+      buffers[count].data = data.data() + offset;
+      buffers[count].count = int(data.size() - offset);
+      total += buffers[count].count;
+      offset = 0;
+      ++count;
+   }
+
+   int nBytes = gatherWrite(buffers, count);
+   if (nBytes < 0)
+   {
+      InfoLog(<< "Write failed on socket: " << this->getSocket() << ", closing connection");
+      return -1;
+   }
+
+   // Release the messages that were completely written
+   unsigned int messages = 0;
+   Data::size_type bytesLeft = static_cast<Data::size_type>(nBytes);
+   while (bytesLeft > 0)
+   {
+      Data::size_type remaining = mOutstandingSends.front()->data.size() - mSendPos;
+      if (bytesLeft < remaining)
+      {
+         mSendPos += bytesLeft;
+         break;
+      }
+      bytesLeft -= remaining;
+      mSendPos = 0;
+      ++messages;
+      removeFrontOutstandingSend();
+   }
+   if (nBytes > 0)
+   {
+      ConnectionManager::countWrite(messages);
+   }
+   return nBytes;
+}
+
+void
+Connection::coalesceOutstandingSends()
+{
+   // A write that wrote nothing must be retried with the same buffer (TLS)
+   if (mSendPos != 0 || mWriteRetryPending)
+   {
+      return;
+   }
+
+   std::list<SendData*>::iterator first = mOutstandingSends.begin();
+   std::list<SendData*>::iterator last = first;
+   size_t total = (*first)->data.size();
+   unsigned int merged = 0;
+   for (++last; last != mOutstandingSends.end(); ++last)
+   {
+      if ((*last)->command != SendData::NoCommand ||
+          total + (*last)->data.size() > ConnectionManager::MaxWriteCoalesceBytes)
+      {
+         break;
+      }
+      total += (*last)->data.size();
+      ++merged;
+   }
+   if (merged == 0)
+   {
+      return;
+   }
+
+   char* buffer = new char[total];
+   SendData* newSd = new SendData((*first)->destination, buffer, (int)total);
+   newSd->transactionId = (*first)->transactionId;
+   newSd->sigcompId = (*first)->sigcompId;
+   for (std::list<SendData*>::iterator it = first; it != last; ++it)
+   {
+      if (it != first)
+      {
+         mFrontSendMergedTids.push_back((*it)->transactionId);
+      }
+      memcpy(buffer, (*it)->data.data(), (*it)->data.size());
+      buffer += (*it)->data.size();
+      delete *it;
+   }
+   first = mOutstandingSends.erase(first, last);
+   mOutstandingSends.insert(first, newSd);
+}
+
 
 bool 
 Connection::performWrites(unsigned int max)
@@ -2,6 +2,7 @@
 #define RESIP_Connection_hxx
 
 #include <list>
+#include <vector>
 
 #include "resip/stack/ConnectionBase.hxx"
 //#include "rutil/Fifo.hxx"
@@ -109,6 +110,20 @@ class Connection : public ConnectionBase,
       virtual int read(char* /* buffer */, const int /* count */) { return 0; }
       /// pure virtual, but need concrete Connection for book-ends of lists
       virtual int write(const char* /* buffer */, const int /* count */) { return 0; }
+
+      enum { MaxGatherBuffers = 64 };
+      struct WriteBuffer
+      {
+         const char* data;
+         int count;
+      };
+      /** Connections that can write several buffers with one call (writev)
+          return true; the others (TLS, where a retried SSL_write must be
+          given the same buffer) get queued messages merged into one buffer
+          and written with write() instead. */
+      virtual bool canGatherWrite() const { return false; }
+      /// like write(), for {count} (at most MaxGatherBuffers) buffers written in order
+      virtual int gatherWrite(const WriteBuffer* /* buffers */, int /* count */) { return 0; }
       virtual void onDoubleCRLF();
       virtual void onSingleCRLF();
 
@@ -118,8 +133,15 @@ class Connection : public ConnectionBase,
    private:
       ConnectionManager& getConnectionManager() const;
       void removeFrontOutstandingSend();
+      int performGatherWrite();
+      void coalesceOutstandingSends();
       bool mInWritable;
+      /// the last write() of mOutstandingSends.front() wrote nothing
+      bool mWriteRetryPending;
       bool mFlowTimerEnabled;
+      /// transactions of the messages merged into mOutstandingSends.front()
+      /// after its own; they fail with it if the connection goes away
+      std::vector<Data> mFrontSendMergedTids;
       FdPollItemHandle mPollItemHandle;
       
       /// no default c'tor
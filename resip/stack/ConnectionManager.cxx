@@ -23,6 +23,10 @@ using namespace std;
 UInt64 ConnectionManager::MinimumGcAge = 1;  // in milliseconds
 UInt64 ConnectionManager::MinimumGcHeadroom = 0;
 bool ConnectionManager::EnableAgressiveGc = false;
+unsigned int ConnectionManager::AgressiveGcMaxToRemove = 100;
+unsigned int ConnectionManager::MaxWriteCoalesceBytes = 16384;
+Atomic<unsigned long> ConnectionManager::mWriteCount;
+Atomic<unsigned long> ConnectionManager::mWriteMessageCount;
 
 ConnectionManager::ConnectionManager() : 
    mHead(0,Tuple(),0,Compression::Disabled, false),
@@ -30,7 +34,9 @@ ConnectionManager::ConnectionManager() :
    mReadHead(ConnectionReadList::makeList(&mHead)),
    mLRUHead(ConnectionLruList::makeList(&mHead)),
    mFlowTimerLRUHead(FlowTimerLruList::makeList(&mHead)),
-   mPollGrp(0)
+   mPollGrp(0),
+   mFdLimit(0),
+   mFdLimitCheckedMs(0)
 {
    DebugLog(<<"ConnectionManager::ConnectionManager() called ");
 }
@@ -204,7 +210,7 @@ ConnectionManager::addConnection(Connection* connection)
    // Garbage collect old connections if agressive is enabled
    if(EnableAgressiveGc)
    {
-      gc(MinimumGcAge, 0);  // cleanup all connections that haven't seen data in last x ms
+      gc(MinimumGcAge, AgressiveGcMaxToRemove);  // cleanup connections that haven't seen data in last x ms
    }
 
    //DebugLog (<< "count=" << mAddrMap.count(connection->who()) << "who=" << connection->who() << " mAddrMap=" << Inserter(mAddrMap));
@@ -294,37 +300,64 @@ ConnectionManager::gc(UInt64 relThreshold, unsigned int maxToRemove)
       }
    }
 
-   if(MinimumGcHeadroom > 0)
+   AddrMap::size_type headroom;
+   if(MinimumGcHeadroom > 0 && getFdHeadroom(headroom) && headroom < MinimumGcHeadroom)
    {
+      WarningLog(<< "actual headroom = " << headroom << ", MinimumGcHeadroom = " << MinimumGcHeadroom << ", garbage collector making extra effort to reclaim file descriptors");
+      AddrMap::size_type mustRemove = MinimumGcHeadroom - headroom;
+      unsigned int remainder = gcWithTarget(mustRemove);
+      numRemoved += (mustRemove - remainder);
+      if(remainder > 0)
+      {
+         ErrLog(<< "No more stream connections to close, something else must be eating file descriptors, limit too low or MinimumGcHeadroom too high");
+      }
+   }
+   return numRemoved;
+}
+
+void
+ConnectionManager::getWriteStatistics(unsigned long& writes, unsigned long& messages)
+{
+   writes = mWriteCount.load();
+   messages = mWriteMessageCount.load();
+}
+
+void
+ConnectionManager::countWrite(unsigned int messages)
+{
+   mWriteCount.fetchAdd(1);
+   if(messages > 0)
+   {
+      mWriteMessageCount.fetchAdd(messages);
+   }
+}
+
+bool
+ConnectionManager::getFdHeadroom(AddrMap::size_type& headroom)
+{
 #ifdef WIN32
-      DebugLog(<<"MinimumGcHeadroom not yet implemented on Windows (requires getrlimit())");
+   DebugLog(<<"MinimumGcHeadroom not yet implemented on Windows (requires getrlimit())");
+   return false;
 #else
+   // gc() runs for every new connection when agressive gc is enabled, so
+   // don't make a system call each time; the limit rarely changes.
+   UInt64 now = Timer::getTimeMs();
+   if(mFdLimitCheckedMs == 0 || now - mFdLimitCheckedMs >= 1000)
+   {
       struct rlimit rlim;
       if(getrlimit(RLIMIT_NOFILE, &rlim) != 0)
       {
          ErrLog(<<"Call to getrlimit() for RLIMIT_NOFILE failed: " << errortostringOS(errno));
+         return false;
       }
-      else
-      {
-         rlim_t& soft_limit = rlim.rlim_cur;
-         AddrMap::size_type conn_count = mAddrMap.size();
-         AddrMap::size_type headroom = soft_limit - conn_count;
-         DebugLog(<< "GC headroom check: soft_limit = " << soft_limit << ", managed connection count = " << conn_count << ", headroom = " << headroom << ", minimum headroom = " << MinimumGcHeadroom);
-         if(headroom < MinimumGcHeadroom)
-         {
-            WarningLog(<< "actual headroom = " << headroom << ", MinimumGcHeadroom = " << MinimumGcHeadroom << ", garbage collector making extra effort to reclaim file descriptors");
-            AddrMap::size_type mustRemove = MinimumGcHeadroom - headroom;
-            unsigned int remainder = gcWithTarget(mustRemove);
-            numRemoved += (mustRemove - remainder);
-            if(remainder > 0)
-            {
-               ErrLog(<< "No more stream connections to close, something else must be eating file descriptors, limit too low or MinimumGcHeadroom too high");
-            }
-         }
-      }
-#endif
+      mFdLimit = rlim.rlim_cur;
+      mFdLimitCheckedMs = now;
    }
-   return numRemoved;
+   AddrMap::size_type conn_count = mAddrMap.size();
+   headroom = conn_count < mFdLimit ? AddrMap::size_type(mFdLimit - conn_count) : 0;
+   DebugLog(<< "GC headroom check: soft_limit = " << mFdLimit << ", managed connection count = " << conn_count << ", headroom = " << headroom << ", minimum headroom = " << MinimumGcHeadroom);
+   return true;
+#endif
 }
 
 unsigned int
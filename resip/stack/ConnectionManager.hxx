@@ -3,6 +3,7 @@
 
 #include <map>
 #include "rutil/HashMap.hxx"
+#include "rutil/Atomic.hxx"
 #include "resip/stack/Connection.hxx"
 
 namespace resip
@@ -34,6 +35,21 @@ class ConnectionManager
           perform garbage collection on every new connection.  If disabled
           then garbage collection is only performed if we run out of Fd's */
       static bool EnableAgressiveGc;
+      /** Maximum number of idle connections the agressive garbage collector
+          closes each time a connection is added; 0 for no limit.  Keeps the
+          cost of a single pass bounded when many connections go idle at once;
+          the rest are closed by later passes. */
+      static unsigned int AgressiveGcMaxToRemove;
+      /** Maximum number of bytes of queued messages that are written to a
+          stream connection with a single call (writev for TCP, one
+          SSL_write for TLS), so that a burst of messages to one peer does
+          not cost a system call and a TLS record each; 0 writes every
+          message separately */
+      static unsigned int MaxWriteCoalesceBytes;
+
+      /** Totals for all stream connections: the number of writes that sent
+          data, and the number of messages those writes completed */
+      static void getWriteStatistics(unsigned long& writes, unsigned long& messages);
 
       ConnectionManager();
       ~ConnectionManager();
@@ -51,8 +67,8 @@ class ConnectionManager
       void addToWritable(Connection* conn); // add the specified conn to end
       void removeFromWritable(Connection* conn); // remove the current mWriteMark
 
-      typedef std::map<Tuple, Connection*> AddrMap;
-      typedef std::map<Socket, Connection*> IdMap;
+      typedef HashMap<Tuple, Connection*> AddrMap;
+      typedef HashMap<Socket, Connection*> IdMap;
 
       void addConnection(Connection* connection);
       void removeConnection(Connection* connection);
@@ -66,6 +82,15 @@ class ConnectionManager
       /// move to youngest 
       void touch(Connection* connection);
       void moveToFlowTimerLru(Connection *connection);
+
+      /// number of connections that may be opened before reaching
+      /// MinimumGcHeadroom; getrlimit() is called at most once a second
+      bool getFdHeadroom(AddrMap::size_type& headroom);
+
+      /// called by Connection for each write that sent data
+      static void countWrite(unsigned int messages);
+      static Atomic<unsigned long> mWriteCount;
+      static Atomic<unsigned long> mWriteMessageCount;
       
       AddrMap mAddrMap;
       IdMap mIdMap;
@@ -84,6 +109,10 @@ class ConnectionManager
 
       /// collection for epoll
       FdPollGrp* mPollGrp;
+
+      /// cached RLIMIT_NOFILE soft limit, see getFdHeadroom()
+      UInt64 mFdLimit;
+      UInt64 mFdLimitCheckedMs;
       //<<---------------------------------
 
       friend class TcpBaseTransport;
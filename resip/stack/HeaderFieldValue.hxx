@@ -63,6 +63,9 @@ class HeaderFieldValue
       
       inline const char* getBuffer() const {return mField;}
       inline unsigned int getLength() const {return mFieldLength;}
+      /// false if the text belongs to someone else, such as a SipMessage's
+      /// receive buffer
+      inline bool ownsBuffer() const {return mMine;}
       inline void clear()
       {
          if (mMine)
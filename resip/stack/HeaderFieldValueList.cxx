@@ -72,6 +72,26 @@ HeaderFieldValueList::operator=(const HeaderFieldValueList& rhs)
    return *this;
 }
 
+void
+HeaderFieldValueList::reserve(size_t size)
+{
+   if(size <= mHeaders.capacity())
+   {
+      return;
+   }
+
+   // vector would copy-construct the values into the new storage, and a
+   // copied HeaderFieldValue duplicates its text; swap them across instead
+   ListImpl bigger(mHeaders.get_allocator());
+   bigger.reserve(size);
+   for(iterator i = mHeaders.begin(); i != mHeaders.end(); ++i)
+   {
+      bigger.push_back(HeaderFieldValue::Empty);
+      bigger.back().swap(*i);
+   }
+   mHeaders.swap(bigger);
+}
+
 EncodeStream&
 HeaderFieldValueList::encode(int headerEnum, EncodeStream& str) const
 {
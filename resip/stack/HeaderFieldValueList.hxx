@@ -65,6 +65,10 @@ class HeaderFieldValueList
       */
       void push_back(const char* buffer, size_t length, bool own) 
       {
+         if(mHeaders.size() == mHeaders.capacity())
+         {
+            reserve(mHeaders.empty() ? 1 : 2*mHeaders.size());
+         }
          mHeaders.push_back(HeaderFieldValue::Empty); 
          mHeaders.back().init(buffer,length,own);
       }
@@ -76,10 +80,9 @@ class HeaderFieldValueList
       const HeaderFieldValue* front() const {return &mHeaders.front();}
       const HeaderFieldValue* back() const {return &mHeaders.back();}
 
-      inline void reserve(size_t size)
-      {
-         mHeaders.reserve(size);
-      }
+      /// Grows the list without copying the text of the values already
+      /// in it.
+      void reserve(size_t size);
 
       bool parsedEmpty() const;
    private:
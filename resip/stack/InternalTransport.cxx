@@ -134,6 +134,25 @@ InternalTransport::bind()
    DebugLog (<< "Binding to " << Tuple::inet_ntop(mTuple)); 
 #endif
 
+#if defined(SO_REUSEPORT)
+   if ( (mTransportFlags & RESIP_TRANSPORT_FLAG_REUSEPORT) != 0 )
+   {
+      int on = 1;
+      if ( ::setsockopt(mFd, SOL_SOCKET, SO_REUSEPORT, (const char*)&on, sizeof(on)) == SOCKET_ERROR )
+      {
+         int e = getErrno();
+         error(e);
+         ErrLog (<< "Could not set SO_REUSEPORT on " << mTuple);
+         throw Transport::Exception("Failed setting SO_REUSEPORT", __FILE__,__LINE__);
+      }
+   }
+#else
+   if ( (mTransportFlags & RESIP_TRANSPORT_FLAG_REUSEPORT) != 0 )
+   {
+      WarningLog (<< "SO_REUSEPORT not supported on this platform, ignoring for " << mTuple);
+   }
+#endif
+
    if ( ::bind( mFd, &mTuple.getMutableSockaddr(), mTuple.length()) == SOCKET_ERROR )
    {
       int e = getErrno();
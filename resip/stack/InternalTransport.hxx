@@ -7,6 +7,7 @@
 #include "rutil/ConsumerFifoBuffer.hxx"
 #include "rutil/Data.hxx"
 #include "rutil/Fifo.hxx"
+#include "rutil/LockFreeFifo.hxx"
 #include "rutil/Socket.hxx"
 #include "rutil/FdPoll.hxx"
 #include "resip/stack/Message.hxx"
@@ -92,8 +93,10 @@ class InternalTransport : public Transport
       SelectInterruptor mSelectInterruptor;
       FdPollItemHandle mInterruptorHandle;
 
-      Fifo<SendData> mTxFifo; // owned by the transport
-      ConsumerFifoBuffer<SendData> mTxFifoOutBuffer;
+      // owned by the transport; filled by every TransactionController shard
+      // but only ever drained by the thread that runs this transport
+      LockFreeFifo<SendData> mTxFifo;
+      ConsumerFifoBuffer<SendData, LockFreeFifo<SendData> > mTxFifoOutBuffer;
       FdPollGrp *mPollGrp;      // not owned by transport, just used
       // FdPollItemIf *mPollItem;	// owned by the transport
       FdPollItemHandle mPollItemHandle; // owned by the transport
@@ -10,6 +10,32 @@
 #include "resip/stack/MsgHeaderScanner.hxx"
 #include "rutil/WinLeakCheck.hxx"
 
+#if !defined(RESIP_MSG_HEADER_SCANNER_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RESIP_MSG_HEADER_SCANNER_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+// AVX2 is enabled per function and selected at runtime, so the library
+// itself still runs on CPUs without it.
+#if defined(RESIP_MSG_HEADER_SCANNER_SSE2) && defined(__GNUC__)
+#if defined(__clang__)
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_cpu_supports)
+#define RESIP_MSG_HEADER_SCANNER_AVX2
+#endif
+#endif
+#elif __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define RESIP_MSG_HEADER_SCANNER_AVX2
+#endif
+#endif
+#if defined(RESIP_MSG_HEADER_SCANNER_AVX2)
+#include <immintrin.h>
+#endif
+#endif
+
 namespace resip 
 {
 
@@ -873,6 +899,292 @@ processMsgHeaderFieldNameAndValue(SipMessage * msg,
 
 #endif //!defined(RESIP_MSG_HEADER_SCANNER_DEBUG) }
 
+///////////////////////////////////////////////////////////////////////////////
+//   Runs.  In some states (the status line and the inside of values) all but
+//   a handful of characters leave the state unchanged and have no action; only
+//   the text property bits accumulate.  Such a state is a "run state" and the
+//   characters that do something in it are its stop characters.  Runs are
+//   skipped 16 (SSE2) or 32 (AVX2) characters at a time and the state machine
+//   resumes at the stop character.  The tables below are derived from
+//   "stateMachine" and "charInfoArray", so the callbacks are exactly those of
+//   the character at a time scan.
+
+enum { MaxRunStopChars = 6 };
+enum { MaxPropChars = 16 };
+
+struct RunInfo
+{
+      bool isRun;
+      unsigned char stopChars[MaxRunStopChars]; // unused entries repeat [0]
+};
+
+static RunInfo runInfoArray[numStates];
+static RunInfo noRunInfoArray[numStates];  // used by smScalar
+static RunInfo* activeRunInfoArray = noRunInfoArray;
+
+static unsigned char propCharArray[MaxPropChars];
+static MsgHeaderScanner::TextPropBitMask propBitMaskArray[MaxPropChars];
+static int numPropChars = 0;
+
+// Returns the first stop character at or after "charPtr", or an earlier
+// character once less than a full vector remains before "endCharPtr".
+typedef char* (*SkipRunFunction)(char* charPtr,
+                                 const char* endCharPtr,
+                                 const RunInfo& runInfo,
+                                 MsgHeaderScanner::TextPropBitMask& textPropBitMask);
+
+static char*
+skipRunScalar(char* charPtr,
+              const char*,
+              const RunInfo&,
+              MsgHeaderScanner::TextPropBitMask&)
+{
+   return charPtr;
+}
+
+static SkipRunFunction skipRun = skipRunScalar;
+static MsgHeaderScanner::ScanMode scanMode = MsgHeaderScanner::smScalar;
+
+static void initRunInfoArray()
+{
+   numPropChars = 0;
+   for (unsigned int charIndex = 0; charIndex <= UCHAR_MAX; ++charIndex)
+   {
+      if (charInfoArray[charIndex].textPropBitMask != 0 &&
+          numPropChars < MaxPropChars)
+      {
+         propCharArray[numPropChars] = (unsigned char)charIndex;
+         propBitMaskArray[numPropChars] = charInfoArray[charIndex].textPropBitMask;
+         ++numPropChars;
+      }
+   }
+
+   for (int state = 0; state < numStates; ++state)
+   {
+      RunInfo& runInfo = runInfoArray[state];
+      runInfo.isRun = true;
+      int numStopChars = 0;
+      for (unsigned int charIndex = 0; charIndex <= UCHAR_MAX; ++charIndex)
+      {
+         const TransitionInfo& transitionInfo =
+            stateMachine[state][c2i(charInfoArray[charIndex].category)];
+         if (transitionInfo.action == taNone && transitionInfo.nextState == state)
+         {
+            continue;
+         }
+         if (numStopChars == MaxRunStopChars)
+         {
+            runInfo.isRun = false;
+            break;
+         }
+         runInfo.stopChars[numStopChars++] = (unsigned char)charIndex;
+      }
+      for (int i = numStopChars; i < MaxRunStopChars; ++i)
+      {
+         runInfo.stopChars[i] = runInfo.stopChars[0];
+      }
+      noRunInfoArray[state].isRun = false;
+   }
+}
+
+#if defined(RESIP_MSG_HEADER_SCANNER_SSE2)
+
+static inline unsigned int firstSetBit(unsigned int mask)
+{
+#if defined(_MSC_VER)
+   unsigned long index;
+   _BitScanForward(&index, mask);
+   return (unsigned int)index;
+#else
+   return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+
+static __m128i stopVectorArray[numStates][MaxRunStopChars];
+static __m128i propVectorArray[MaxPropChars];
+
+static void initVectorArrays()
+{
+   for (int state = 0; state < numStates; ++state)
+   {
+      for (int i = 0; i < MaxRunStopChars; ++i)
+      {
+         stopVectorArray[state][i] =
+            _mm_set1_epi8((char)runInfoArray[state].stopChars[i]);
+      }
+   }
+   for (int i = 0; i < numPropChars; ++i)
+   {
+      propVectorArray[i] = _mm_set1_epi8((char)propCharArray[i]);
+   }
+}
+
+static char*
+skipRunSse2(char* charPtr,
+            const char* endCharPtr,
+            const RunInfo& runInfo,
+            MsgHeaderScanner::TextPropBitMask& textPropBitMask)
+{
+   const __m128i* stopVectors = stopVectorArray[&runInfo - runInfoArray];
+   while (endCharPtr - charPtr >= 16)
+   {
+      __m128i chars = _mm_loadu_si128((const __m128i*)charPtr);
+      __m128i stops = _mm_cmpeq_epi8(chars, stopVectors[0]);
+      for (int i = 1; i < MaxRunStopChars; ++i)
+      {
+         stops = _mm_or_si128(stops, _mm_cmpeq_epi8(chars, stopVectors[i]));
+      }
+      unsigned int stopMask = (unsigned int)_mm_movemask_epi8(stops);
+      // Only the characters before the first stop belong to the run.
+      unsigned int runMask = stopMask ? (stopMask & (0 - stopMask)) - 1 : 0xFFFFu;
+      for (int i = 0; i < numPropChars; ++i)
+      {
+         if ((unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(chars, propVectorArray[i])) & runMask)
+         {
+            textPropBitMask |= propBitMaskArray[i];
+         }
+      }
+      if (stopMask)
+      {
+         return charPtr + firstSetBit(stopMask);
+      }
+      charPtr += 16;
+   }
+   return charPtr;
+}
+
+#endif
+
+#if defined(RESIP_MSG_HEADER_SCANNER_AVX2)
+
+static __m256i wideStopVectorArray[numStates][MaxRunStopChars];
+static __m256i widePropVectorArray[MaxPropChars];
+
+__attribute__((target("avx2")))
+static void initWideVectorArrays()
+{
+   for (int state = 0; state < numStates; ++state)
+   {
+      for (int i = 0; i < MaxRunStopChars; ++i)
+      {
+         wideStopVectorArray[state][i] =
+            _mm256_broadcastsi128_si256(stopVectorArray[state][i]);
+      }
+   }
+   for (int i = 0; i < numPropChars; ++i)
+   {
+      widePropVectorArray[i] = _mm256_broadcastsi128_si256(propVectorArray[i]);
+   }
+}
+
+__attribute__((target("avx2")))
+static char*
+skipRunAvx2(char* charPtr,
+            const char* endCharPtr,
+            const RunInfo& runInfo,
+            MsgHeaderScanner::TextPropBitMask& textPropBitMask)
+{
+   const __m256i* wideStopVectors = wideStopVectorArray[&runInfo - runInfoArray];
+   while (endCharPtr - charPtr >= 32)
+   {
+      __m256i chars = _mm256_loadu_si256((const __m256i*)charPtr);
+      __m256i stops = _mm256_cmpeq_epi8(chars, wideStopVectors[0]);
+      for (int i = 1; i < MaxRunStopChars; ++i)
+      {
+         stops = _mm256_or_si256(stops, _mm256_cmpeq_epi8(chars, wideStopVectors[i]));
+      }
+      unsigned int stopMask = (unsigned int)_mm256_movemask_epi8(stops);
+      unsigned int runMask = stopMask ? (stopMask & (0 - stopMask)) - 1 : 0xFFFFFFFFu;
+      for (int i = 0; i < numPropChars; ++i)
+      {
+         if ((unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chars, widePropVectorArray[i])) & runMask)
+         {
+            textPropBitMask |= propBitMaskArray[i];
+         }
+      }
+      if (stopMask)
+      {
+         return charPtr + firstSetBit(stopMask);
+      }
+      charPtr += 32;
+   }
+   return skipRunSse2(charPtr, endCharPtr, runInfo, textPropBitMask);
+}
+
+static bool cpuSupportsAvx2()
+{
+   static bool checked = false;
+   static bool supported = false;
+   if (!checked)
+   {
+      __builtin_cpu_init();
+      supported = __builtin_cpu_supports("avx2") != 0;
+      if (supported)
+      {
+         initWideVectorArrays();
+      }
+      checked = true;
+   }
+   return supported;
+}
+
+#endif
+
+MsgHeaderScanner::ScanMode
+MsgHeaderScanner::setScanMode(ScanMode mode)
+{
+   if (!mInitialized)
+   {
+      // Builds the tables; "mode" is applied below.
+      MsgHeaderScanner scanner;
+   }
+
+   if (mode == smBest)
+   {
+      mode = smAvx2;
+   }
+#if defined(RESIP_MSG_HEADER_SCANNER_AVX2)
+   if (mode == smAvx2 && !cpuSupportsAvx2())
+   {
+      mode = smSse2;
+   }
+#else
+   if (mode == smAvx2)
+   {
+      mode = smSse2;
+   }
+#endif
+
+   switch (mode)
+   {
+#if defined(RESIP_MSG_HEADER_SCANNER_AVX2)
+      case smAvx2:
+         skipRun = skipRunAvx2;
+         activeRunInfoArray = runInfoArray;
+         break;
+#endif
+#if defined(RESIP_MSG_HEADER_SCANNER_SSE2)
+      case smSse2:
+         skipRun = skipRunSse2;
+         activeRunInfoArray = runInfoArray;
+         break;
+#endif
+      default:
+         mode = smScalar;
+         skipRun = skipRunScalar;
+         activeRunInfoArray = noRunInfoArray;
+         break;
+   }
+   scanMode = mode;
+   return mode;
+}
+
+MsgHeaderScanner::ScanMode
+MsgHeaderScanner::getScanMode()
+{
+   return scanMode;
+}
+
 bool MsgHeaderScanner::mInitialized = false;
 
 MsgHeaderScanner::MsgHeaderScanner()
@@ -917,6 +1229,8 @@ MsgHeaderScanner::scanChunk(char * chunk,
    MsgHeaderScanner::ScanChunkResult result;
    CharInfo* localCharInfoArray = charInfoArray;
    TransitionInfo (*localStateMachine)[numCharCategories] = stateMachine;
+   RunInfo* localRunInfoArray = activeRunInfoArray;
+   SkipRunFunction localSkipRun = skipRun;
    State localState = mState;
    char *charPtr = chunk + mPrevScanChunkNumSavedTextChars;
    char *termCharPtr = chunk + chunkLength;
@@ -950,7 +1264,19 @@ MsgHeaderScanner::scanChunk(char * chunk,
       printStateTransition(localState, *charPtr, transitionAction);
 #endif
       localState = transitionInfo->nextState;
-      if (transitionAction == taNone) continue;
+      if (transitionAction == taNone)
+      {
+#if !defined(RESIP_MSG_HEADER_SCANNER_DEBUG)
+         if (localRunInfoArray[(unsigned)localState].isRun)
+         {
+            charPtr = localSkipRun(charPtr + 1,
+                                   termCharPtr + 1,  // the sentinel is a stop
+                                   localRunInfoArray[(unsigned)localState],
+                                   localTextPropBitMask) - 1;
+         }
+#endif
+         continue;
+      }
       // END message header character scan block END
       // The loop remainder is executed about 4-5 times per message header line.
       switch (transitionAction)
@@ -1067,6 +1393,16 @@ MsgHeaderScanner::initialize()
 {
    initCharInfoArray();
    initStateMachine();
+   initRunInfoArray();
+#if defined(RESIP_MSG_HEADER_SCANNER_SSE2)
+   initVectorArrays();
+#endif
+#if defined(RESIP_MSG_HEADER_SCANNER_DEBUG)
+   // Keep the per character trace complete.
+   setScanMode(smScalar);
+#else
+   setScanMode(smBest);
+#endif
    return true;
 }
 
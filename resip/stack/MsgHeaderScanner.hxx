@@ -117,6 +117,21 @@ class MsgHeaderScanner
                                                   unsigned int chunkLength,
                                                   char **unprocessedCharPtr); 
     
+      // How runs of characters that cannot end a status line or value are
+      // scanned.  Every mode produces the same result.
+      enum ScanMode {
+         smScalar,     // One character at a time.
+         smSse2,       // 16 characters at a time.
+         smAvx2,       // 32 characters at a time.
+         smBest        // The fastest mode this build and CPU support (default).
+      };
+
+      //       Selects the scan mode of all scanners.  A mode this build or CPU
+      //       does not support falls back to the next slower one.  Returns the
+      //       mode selected.  Not thread safe; call before scanning starts.
+      static ScanMode setScanMode(ScanMode mode);
+      static ScanMode getScanMode();
+
       // !ah! DEBUG only, write to fd.
       // !ah! for documentation generation
       static int dumpStateMachine(int fd); 
@@ -137,7 +137,7 @@ class ParserContainerBase
             // Poor man's move c'tor, watch out!
             HeaderKit(const HeaderKit& orig) 
             : pc(orig.pc),
-               hfv(orig.hfv)
+               hfv()
             {
                HeaderKit& nc_orig = const_cast<HeaderKit&>(orig);
                std::swap(nc_orig.pc, pc);
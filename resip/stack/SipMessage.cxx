@@ -26,11 +26,22 @@ using namespace std;
 #define RESIPROCATE_SUBSYSTEM Subsystem::SIP
 
 bool SipMessage::checkContentLength=true;
+bool SipMessage::shareReceiveBuffers=false;
+size_t SipMessage::poolArenaBlockSize=4096;
+size_t SipMessage::poolArenaMaxBytes=65536;
+
+static Atomic<unsigned long> poolStatMessages;
+static Atomic<unsigned long> poolStatOverflowedMessages;
+static Atomic<unsigned long> poolStatArenaBlocks;
+static Atomic<unsigned long> poolStatArenaReuses;
+static Atomic<unsigned long> poolStatHeapAllocations;
+static Atomic<unsigned long> poolStatHeapBytes;
 
 SipMessage::SipMessage(const Tuple *receivedTransportTuple)
    : mIsDecorated(false),
      mIsBadAck200(false),     
      mIsExternal(receivedTransportTuple != 0),  // may be modified later by setFromTU or setFromExternal
+     mPool(poolArenaBlockSize, poolArenaMaxBytes),
      mHeaders(StlPoolAllocator<HeaderFieldValueList*, PoolBase >(&mPool)),
 #ifndef __SUNPRO_CC
      mUnknownHeaders(StlPoolAllocator<std::pair<Data, HeaderFieldValueList*>, PoolBase >(&mPool)),
@@ -53,7 +64,8 @@ SipMessage::SipMessage(const Tuple *receivedTransportTuple)
 }
 
 SipMessage::SipMessage(const SipMessage& from)
-   : mHeaders(StlPoolAllocator<HeaderFieldValueList*, PoolBase >(&mPool)),
+   : mPool(poolArenaBlockSize, poolArenaMaxBytes),
+     mHeaders(StlPoolAllocator<HeaderFieldValueList*, PoolBase >(&mPool)),
 #ifndef __SUNPRO_CC
      mUnknownHeaders(StlPoolAllocator<std::pair<Data, HeaderFieldValueList*>, PoolBase >(&mPool)),
 #else
@@ -97,6 +109,41 @@ SipMessage::~SipMessage()
    }
 #endif
    freeMem();
+
+   poolStatMessages.fetchAdd(1);
+   if (mPool.getArenaBlocks() > 0 || mPool.getHeapAllocations() > 0)
+   {
+      poolStatOverflowedMessages.fetchAdd(1);
+      poolStatArenaBlocks.fetchAdd((unsigned long)mPool.getArenaBlocks());
+      poolStatArenaReuses.fetchAdd((unsigned long)mPool.getArenaReuses());
+      poolStatHeapAllocations.fetchAdd((unsigned long)mPool.getHeapAllocations());
+      poolStatHeapBytes.fetchAdd((unsigned long)mPool.getHeapBytes());
+   }
+}
+
+SipMessage::PoolStatistics
+SipMessage::getPoolStatistics()
+{
+   PoolStatistics stats;
+   stats.messages = poolStatMessages.load();
+   stats.overflowedMessages = poolStatOverflowedMessages.load();
+   stats.arenaBlocks = poolStatArenaBlocks.load();
+   stats.arenaReuses = poolStatArenaReuses.load();
+   stats.heapAllocations = poolStatHeapAllocations.load();
+   stats.heapBytes = poolStatHeapBytes.load();
+   return stats;
+}
+
+void
+SipMessage::dumpPoolStatistics()
+{
+   PoolStatistics stats = getPoolStatistics();
+   InfoLog(<< "SipMessage pool: " << stats.messages << " messages, "
+           << stats.overflowedMessages << " outgrew the embedded pool"
+           << " (" << (stats.messages ? 100.0*stats.overflowedMessages/stats.messages : 0.0) << "%), "
+           << stats.arenaBlocks << " arena blocks of " << poolArenaBlockSize << " bytes, "
+           << stats.arenaReuses << " arena allocations reused, "
+           << stats.heapAllocations << " heap allocations totalling " << stats.heapBytes << " bytes");
 }
 
 void
@@ -110,6 +157,7 @@ SipMessage::clear(bool leaveResponseStuff)
       // !bwc! The "invalid" 0 index.
       mHeaders.push_back(getEmptyHfvl());
       mBufferList.clear();
+      mSharedBuffers = 0;
    }
 
    mUnknownHeaders.clear();
@@ -148,13 +196,23 @@ SipMessage::init(const SipMessage& rhs)
 
    memcpy(&mHeaderIndices,&rhs.mHeaderIndices,sizeof(mHeaderIndices));
 
+   // Text that rhs does not own is in its receive buffers (if they are
+   // shared; otherwise it may belong to something else entirely, eg. a
+   // SipFrag). Taking a reference leaves rhs untouched, so several threads
+   // may copy the same message.
+   const bool share = rhs.mSharedBuffers != 0;
+   if (share)
+   {
+      mSharedBuffers = rhs.mSharedBuffers->addRef();
+   }
+
    // .bwc. Clear out the pesky invalid 0 index.
    clearHeaders();
    mHeaders.reserve(rhs.mHeaders.size());
    for (TypedHeaders::const_iterator i = rhs.mHeaders.begin();
         i != rhs.mHeaders.end(); i++)
    {
-      mHeaders.push_back(getCopyHfvl(**i));
+      mHeaders.push_back(share ? getSharedHfvl(**i) : getCopyHfvl(**i));
    }
 
    for (UnknownHeaders::const_iterator i = rhs.mUnknownHeaders.begin();
@@ -162,7 +220,7 @@ SipMessage::init(const SipMessage& rhs)
    {
       mUnknownHeaders.push_back(pair<Data, HeaderFieldValueList*>(
                                    i->first,
-                                   getCopyHfvl(*i->second)));
+                                   share ? getSharedHfvl(*i->second) : getCopyHfvl(*i->second)));
    }
    if (rhs.mStartLine != 0)
    {
@@ -172,6 +230,12 @@ SipMessage::init(const SipMessage& rhs)
    {
       mContents = rhs.mContents->clone();
    }
+   else if (share && !rhs.mContentsHfv.ownsBuffer())
+   {
+      // an unparsed body straight out of the receive buffers, which are
+      // already padded for the parser
+      mContentsHfv.init(rhs.mContentsHfv.getBuffer(), rhs.mContentsHfv.getLength(), false);
+   }
    else if (rhs.mContentsHfv.getBuffer() != 0)
    {
       mContentsHfv.copyWithPadding(rhs.mContentsHfv);
@@ -237,6 +301,7 @@ SipMessage::freeMem(bool leaveResponseStuff)
       {
          delete [] *i;
       }
+      SharedBuffers::release(mSharedBuffers);
    }
 
    if(mStartLine)
@@ -256,6 +321,67 @@ SipMessage::freeMem(bool leaveResponseStuff)
    }
 }
 
+HeaderFieldValueList*
+SipMessage::getSharedHfvl(const HeaderFieldValueList& hfvl)
+{
+   if (hfvl.getParserContainer())
+   {
+      return getCopyHfvl(hfvl);
+   }
+
+   HeaderFieldValueList* copy = getEmptyHfvl();
+   // reserve up front; growing the vector would copy the text after all
+   copy->reserve(hfvl.size());
+   for (HeaderFieldValueList::const_iterator i = hfvl.begin(); i != hfvl.end(); ++i)
+   {
+      if (i->ownsBuffer())
+      {
+         copy->push_back(0, 0, false);
+         *copy->back() = *i;
+      }
+      else
+      {
+         copy->push_back(i->getBuffer(), i->getLength(), false);
+      }
+   }
+   return copy;
+}
+
+SipMessage::SharedBuffers::SharedBuffers()
+   : mRefCount(1)
+{
+}
+
+SipMessage::SharedBuffers::~SharedBuffers()
+{
+   for (vector<char*>::iterator i = mBuffers.begin(); i != mBuffers.end(); ++i)
+   {
+      delete [] *i;
+   }
+}
+
+void
+SipMessage::SharedBuffers::add(char* buf)
+{
+   mBuffers.push_back(buf);
+}
+
+SipMessage::SharedBuffers*
+SipMessage::SharedBuffers::addRef()
+{
+   mRefCount.fetchAdd(1);
+   return this;
+}
+
+void
+SipMessage::SharedBuffers::release(SharedBuffers* buffers)
+{
+   if (buffers && buffers->mRefCount.fetchSub(1) == 1)
+   {
+      delete buffers;
+   }
+}
+
 void
 SipMessage::clearHeaders()
 {
@@ -862,7 +988,19 @@ SipMessage::encodeEmbedded(EncodeStream& str) const
 void
 SipMessage::addBuffer(char* buf)
 {
-   mBufferList.push_back(buf);
+   if (shareReceiveBuffers)
+   {
+      // only while parsing; a copy never adds buffers
+      if (!mSharedBuffers)
+      {
+         mSharedBuffers = new SharedBuffers;
+      }
+      mSharedBuffers->add(buf);
+   }
+   else
+   {
+      mBufferList.push_back(buf);
+   }
 }
 
 void 
@@ -19,6 +19,7 @@
 #include "resip/stack/MessageDecorator.hxx"
 #include "resip/stack/Cookie.hxx"
 #include "resip/stack/WsCookieContext.hxx"
+#include "rutil/Atomic.hxx"
 #include "rutil/BaseException.hxx"
 #include "rutil/Data.hxx"
 #include "rutil/DinkyPool.hxx"
@@ -196,6 +197,42 @@ class SipMessage : public TransactionMessage
       
       static bool checkContentLength;
 
+      /**
+         When set, the receive buffers of messages parsed from then on are
+         reference counted, and copying such a message does not copy the
+         text of headers that have not been accessed, nor an unparsed body;
+         the copy refers to the original buffers, which are freed along with
+         the last message using them. Headers that have been parsed are
+         still copied. Off by default.
+      */
+      static bool shareReceiveBuffers;
+
+      /**
+         Once the pool embedded in a SipMessage is used up, further
+         allocations made for the message (headers, parser categories,
+         parameters) are carved out of blocks of poolArenaBlockSize bytes,
+         up to poolArenaMaxBytes per message, and freed in one go with the
+         message. Setting either to 0 sends every overflowing allocation to
+         the heap. Read when a message is constructed.
+      */
+      static size_t poolArenaBlockSize;
+      static size_t poolArenaMaxBytes;
+
+      /// @brief Totals over all SipMessages destroyed so far, for sizing the
+      /// pool and arena.
+      struct PoolStatistics
+      {
+         unsigned long messages;
+         unsigned long overflowedMessages; ///< outgrew the embedded pool
+         unsigned long arenaBlocks;
+         unsigned long arenaReuses;       ///< served from a freed allocation
+         unsigned long heapAllocations;    ///< outgrew the arena too
+         unsigned long heapBytes;
+      };
+      static PoolStatistics getPoolStatistics();
+      /// @brief Logs getPoolStatistics() at Info level.
+      static void dumpPoolStatistics();
+
       /**
       @brief Base exception for SipMessage related exceptions
       */
@@ -258,6 +295,8 @@ class SipMessage : public TransactionMessage
       /// @return true if the message is external and is a response or
       /// an internally-generated request.
       virtual bool isClientTransaction() const;
+
+      virtual bool isForTransaction() const { return true; }
       
       /** @brief Generate a string from the SipMessage object
       
@@ -634,6 +673,10 @@ class SipMessage : public TransactionMessage
          return new (ptr) HeaderFieldValueList(hfvl, mPool);
       }
 
+      // like getCopyHfvl(), but header text that lives in the receive
+      // buffers is referred to rather than copied
+      HeaderFieldValueList* getSharedHfvl(const HeaderFieldValueList& hfvl);
+
       inline void freeHfvl(HeaderFieldValueList* hfvl)
       {
          if(hfvl)
@@ -666,7 +709,8 @@ class SipMessage : public TransactionMessage
       // Sizing so that average SipMessages don't need to allocate heap memory
       // To profile current sizing, enable DINKYPOOL_PROFILING in SipMessage.cxx 
       // and look for DebugLog message in SipMessage destructor to know when heap
-      // allocations are occuring and how much of the pool is used.
+      // allocations are occuring and how much of the pool is used.  For totals
+      // across messages see dumpPoolStatistics().
       DinkyPool<3732> mPool;
 
       typedef std::vector<HeaderFieldValueList*, 
@@ -692,8 +736,35 @@ class SipMessage : public TransactionMessage
       // Used by the TU to specify where a message is to go
       Tuple mDestination;
       
-      // Raw buffers coming from the Transport. message manages the memory
+      /**
+         Receive buffers shared by a SipMessage and its copies (see
+         shareReceiveBuffers). Created while the message is parsed, before
+         anything can copy it; copies only take a reference, which may be
+         released in other threads.
+      */
+      class SharedBuffers
+      {
+         public:
+            SharedBuffers();
+            void add(char* buf);
+            SharedBuffers* addRef();
+            static void release(SharedBuffers* buffers);
+
+         private:
+            ~SharedBuffers();
+
+            std::vector<char*> mBuffers;
+            Atomic<unsigned int> mRefCount;
+
+            // disabled
+            SharedBuffers(const SharedBuffers&);
+            SharedBuffers& operator=(const SharedBuffers&);
+      };
+
+      // Raw buffers coming from the Transport. message manages the memory.
+      // With shareReceiveBuffers set they go in mSharedBuffers instead.
       std::vector<char*> mBufferList;
+      SharedBuffers* mSharedBuffers;
 
       // special case for the first line of message
       StartLine* mStartLine;
@@ -56,7 +56,7 @@ SipStack::SipStack(const SipStackOptions& options) :
         mTUFifo(TransactionController::MaxTUFifoTimeDepthSecs,
                 TransactionController::MaxTUFifoSize),
         mTuSelector(mTUFifo),
-        mAppTimers(mTuSelector),
+        mAppTimers(mTuSelector, options.mUseTimerWheel),
         mStatsManager(*this),
         mNextTransportKey(1)
 {
@@ -107,6 +107,7 @@ SipStack::SipStack(Security* pSecurity,
    mShuttingDown(false),
    mStatisticsManagerEnabled(true),
    mSocketFunc(socketFunc),
+   mUseTimerWheel(false),
    mNextTransportKey(1)
 {
    Timer::getTimeMs(); // initalize time offsets
@@ -201,7 +202,9 @@ SipStack::init(const SipStackOptions& options)
 
    // WATCHOUT: the transaction controller constructor will
    // grab the security, DnsStub, compression and statsManager
-   mTransactionController = new TransactionController(*this, mAsyncProcessHandler);
+   mUseTimerWheel = options.mUseTimerWheel;
+   mTransactionController = new TransactionController(*this, mAsyncProcessHandler, mUseTimerWheel,
+                                                      resipMax(options.mTransactionShards, 1U));
    mTransactionController->transportSelector().setPollGrp(mPollGrp);
    mTransactionControllerThread = 0;
    mTransportSelectorThread = 0;
@@ -227,6 +230,12 @@ SipStack::~SipStack()
    mDnsThread=0;
    delete mTransactionControllerThread;
    mTransactionControllerThread=0;
+   for(std::vector<TransactionControllerThread*>::iterator i = mTransactionShardThreads.begin();
+       i != mTransactionShardThreads.end(); ++i)
+   {
+      delete *i;
+   }
+   mTransactionShardThreads.clear();
    delete mTransportSelectorThread;
    mTransportSelectorThread=0;
 
@@ -268,6 +277,18 @@ SipStack::run()
    mTransactionControllerThread=new TransactionControllerThread(*mTransactionController);
    mTransactionControllerThread->run();
 
+   for(std::vector<TransactionControllerThread*>::iterator i = mTransactionShardThreads.begin();
+       i != mTransactionShardThreads.end(); ++i)
+   {
+      delete *i;
+   }
+   mTransactionShardThreads.clear();
+   for(unsigned int i = 1; i < mTransactionController->getNumShards(); ++i)
+   {
+      mTransactionShardThreads.push_back(new TransactionControllerThread(mTransactionController->getShard(i)));
+      mTransactionShardThreads.back()->run();
+   }
+
    delete mTransportSelectorThread;
    mTransportSelectorThread=new TransportSelectorThread(mTransactionController->transportSelector());
    mTransportSelectorThread->run();
@@ -302,6 +323,17 @@ SipStack::shutdownAndJoinThreads()
       mTransactionControllerThread->join();
    }
 
+   for(std::vector<TransactionControllerThread*>::iterator i = mTransactionShardThreads.begin();
+       i != mTransactionShardThreads.end(); ++i)
+   {
+      (*i)->shutdown();
+   }
+   for(std::vector<TransactionControllerThread*>::iterator i = mTransactionShardThreads.begin();
+       i != mTransactionShardThreads.end(); ++i)
+   {
+      (*i)->join();
+   }
+
    if(mTransportSelectorThread)
    {
       mTransportSelectorThread->shutdown();
@@ -409,7 +441,8 @@ SipStack::addTransport( TransportType protocol,
                                           *mCompression,
                                           certificateFilename, 
                                           privateKeyFilename,
-                                          privateKeyPassPhrase);
+                                          privateKeyPassPhrase,
+                                          mUseTimerWheel);
 #else
             CritLog (<< "Can't add DTLS transport: DTLS not supported in this stack.");
             throw Transport::Exception("Can't add DTLS transport: DTLS not supported in this stack.", __FILE__,__LINE__);
@@ -483,12 +516,14 @@ SipStack::addTransport(std::auto_ptr<Transport> transport)
                transport->netNs());
    if(!isSecure(transport->transport()))
    {
-      if(mNonSecureTransports.count(tuple) == 0)
+      NonSecureTransportMap::iterator existing = mNonSecureTransports.find(tuple);
+      if(existing == mNonSecureTransports.end() ||
+         transport->isReusePortShardOf(*existing->second))
       {
          // All is good - assign key to transport then add to mNonSecureTransports list
          transport->setKey(mNextTransportKey++);
          tuple.mTransportKey = transport->getKey();
-         mNonSecureTransports[tuple] = transport.get();
+         mNonSecureTransports.insert(NonSecureTransportMap::value_type(tuple, transport.get()));
       }
       else
       {
@@ -1050,7 +1085,10 @@ SipStack::processTimers()
 {
    if(!mTransactionControllerThread)
    {
-      mTransactionController->process();
+      for(unsigned int i = 0; i < mTransactionController->getNumShards(); ++i)
+      {
+         mTransactionController->getShard(i).process();
+      }
    }
 
    if(!mDnsThread)
@@ -1234,13 +1272,13 @@ SipStack::dump(EncodeStream& strm)  const
       strm << "domains: " << Inserter(this->mDomains) << std::endl;
    }
    strm << " TUFifo size=" << this->mTUFifo.size() << std::endl
-        << " Timers size=" << this->mTransactionController->mTimers.size() << std::endl;
+        << " Timers size=" << this->mTransactionController->getTimerQueueSize() << std::endl;
    {
       Lock lock(mAppTimerMutex);
       strm << " AppTimers size=" << this->mAppTimers.size() << std::endl;
    }
-   strm << " ServerTransactionMap size=" << this->mTransactionController->mServerTransactionMap.size() << std::endl
-        << " ClientTransactionMap size=" << this->mTransactionController->mClientTransactionMap.size() << std::endl
+   strm << " ServerTransactionMap size=" << this->mTransactionController->getNumServerTransactions() << std::endl
+        << " ClientTransactionMap size=" << this->mTransactionController->getNumClientTransactions() << std::endl
         // !slg! TODO - There is technically a threading concern with the following three lines and the runtime addTransport call
         << " Exact Transports=" << Inserter(this->mTransactionController->mTransportSelector.mExactTransports) << std::endl
         << " Any Transports=" << Inserter(this->mTransactionController->mTransportSelector.mAnyInterfaceTransports) << std::endl
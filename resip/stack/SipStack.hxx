@@ -96,6 +96,21 @@ class FdPollGrp;
           See EventStackThread. The SipStack does NOT take ownership;
           the application (or a helper such as EventStackSimpleMgr) must
           release this object after the SipStack is destructed.
+
+       mUseTimerWheel
+          If true, transaction, application and DTLS timers are kept in
+          a hierarchical timing wheel (see TimerWheel) instead of a
+          binary heap. This makes adding and expiring timers O(1) and
+          lets terminated transactions cancel their outstanding timers,
+          which helps stacks carrying very many concurrent transactions.
+          Defaults to false.
+
+       mTransactionShards
+          Number of shards the transaction layer is split into. Each shard
+          has its own transaction maps, timers and fifo, and messages are
+          assigned to a shard by their transaction id. When the stack is
+          run() each shard gets its own thread, so transaction processing
+          can use several cores. Defaults to 1.
 **/
 class SipStackOptions
 {
@@ -103,7 +118,8 @@ class SipStackOptions
       SipStackOptions()
          : mSecurity(0), mExtraNameserverList(0),
            mAsyncProcessHandler(0), mStateless(false),
-           mSocketFunc(0), mCompression(0), mPollGrp(0)
+           mSocketFunc(0), mCompression(0), mPollGrp(0),
+           mUseTimerWheel(false), mTransactionShards(1)
       {
       }
 
@@ -114,6 +130,8 @@ class SipStackOptions
       AfterSocketCreationFuncPtr mSocketFunc;
       Compression *mCompression;
       FdPollGrp* mPollGrp;
+      bool mUseTimerWheel;
+      unsigned int mTransactionShards;
 };
 
 
@@ -1111,6 +1129,8 @@ class SipStack : public FdSetIOObserver
       std::auto_ptr<ProducerFifoBuffer<TransactionMessage> > mStateMacFifoBuffer;
 
       TransactionControllerThread* mTransactionControllerThread;
+      // threads for the TransactionController shards other than the first
+      std::vector<TransactionControllerThread*> mTransactionShardThreads;
       TransportSelectorThread* mTransportSelectorThread;
       bool mInternalThreadsRunning;
       bool mProcessingHasStarted; 
@@ -1132,7 +1152,8 @@ class SipStack : public FdSetIOObserver
       // TransportSelector if add will be valid and introduce locking
       // Note:  We could add a Mutex here and add thread safe accesor methods to transport pointers 
       //        as a convience to API users
-      typedef std::map<Tuple, Transport*> NonSecureTransportMap;
+      // multimap since UDP REUSEPORT shards share one Tuple
+      typedef std::multimap<Tuple, Transport*> NonSecureTransportMap;
       NonSecureTransportMap mNonSecureTransports;
       typedef std::map<TransportSelector::TlsTransportKey, Transport*> SecureTransportMap;
       SecureTransportMap mSecureTransports;
@@ -1143,6 +1164,8 @@ class SipStack : public FdSetIOObserver
 
       AfterSocketCreationFuncPtr mSocketFunc;
 
+      bool mUseTimerWheel;
+
       unsigned int mNextTransportKey;
 
       SharedPtr<Transport::SipMessageLoggingHandler> mTransportSipMessageLoggingHandler;
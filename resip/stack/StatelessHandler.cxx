@@ -74,14 +74,14 @@ StatelessHandler::process()
             if (sip->getDestination().mFlowKey)
             {
                DebugLog (<< "Processing request from TU : " << msg->brief());
-               mController.mTransportSelector.transmit(sip, sip->getDestination()); // results not used
+               mController.mTransportSelector.transmit(sip, sip->getDestination(), 0, mController.mShardIndex); // results not used
             }
             else
             {
                DebugLog (<< "Processing request from TU : " << msg->brief());
-               StatelessMessage* stateless = new StatelessMessage(mController.mTransportSelector, sip);
+               StatelessMessage* stateless = new StatelessMessage(mController.mTransportSelector, sip, mController.mShardIndex);
                DnsResult* dnsRes = mController.mTransportSelector.createDnsResult(stateless);      
-               mController.mTransportSelector.dnsResolve(dnsRes, sip);
+               mController.mTransportSelector.dnsResolve(dnsRes, sip, mController.mShardIndex);
             }
          }
          else // no dns for sip responses
@@ -101,7 +101,7 @@ StatelessHandler::process()
                     port = via.param(p_rport).port();
                 }
                 Tuple destination(via.param(p_received), port, Tuple::toTransport(via.transport()));
-                mController.mTransportSelector.transmit(sip, destination); // results not used
+                mController.mTransportSelector.transmit(sip, destination, 0, mController.mShardIndex); // results not used
             }
          }
       }
@@ -118,7 +118,10 @@ StatelessHandler::process()
 }
 
 
-StatelessMessage::StatelessMessage(TransportSelector& selector, SipMessage* msg) : mSelector(selector), mMsg(msg)
+StatelessMessage::StatelessMessage(TransportSelector& selector, SipMessage* msg, unsigned int shard) :
+   mSelector(selector),
+   mMsg(msg),
+   mShard(shard)
 {
 }
 
@@ -140,7 +143,7 @@ StatelessMessage::handle(DnsResult* result)
    if (result->available() == DnsResult::Available)
    {
       Tuple next = result->next();
-      mSelector.transmit(mMsg, next);
+      mSelector.transmit(mMsg, next, 0, mShard);
    }
 
    delete this;
@@ -23,7 +23,7 @@ class StatelessHandler
 class StatelessMessage : public DnsHandler
 {
    public:
-      StatelessMessage(TransportSelector& selector, SipMessage* msg);
+      StatelessMessage(TransportSelector& selector, SipMessage* msg, unsigned int shard=0);
       ~StatelessMessage() {};
          
       void handle(DnsResult* result);
@@ -32,6 +32,7 @@ class StatelessMessage : public DnsHandler
    private:
       TransportSelector& mSelector;
       SipMessage* mMsg;
+      unsigned int mShard;
 };
 
 }
@@ -54,6 +54,24 @@ StatisticsManager::poll()
        mPublicPayload = new StatisticsMessage::AtomicPayload;
        // re-used each time, free'd in destructor
    }
+   copy(&requestsSent, &mRequestsSent, 1);
+   copy(&responsesSent, &mResponsesSent, 1);
+   copy(&requestsRetransmitted, &mRequestsRetransmitted, 1);
+   copy(&responsesRetransmitted, &mResponsesRetransmitted, 1);
+   copy(&requestsReceived, &mRequestsReceived, 1);
+   copy(&responsesReceived, &mResponsesReceived, 1);
+
+   copy(requestsSentByMethod, mRequestsSentByMethod, MAX_METHODS);
+   copy(requestsRetransmittedByMethod, mRequestsRetransmittedByMethod, MAX_METHODS);
+   copy(requestsReceivedByMethod, mRequestsReceivedByMethod, MAX_METHODS);
+   copy(responsesSentByMethod, mResponsesSentByMethod, MAX_METHODS);
+   copy(responsesRetransmittedByMethod, mResponsesRetransmittedByMethod, MAX_METHODS);
+   copy(responsesReceivedByMethod, mResponsesReceivedByMethod, MAX_METHODS);
+
+   copy(&responsesSentByMethodByCode[0][0], &mResponsesSentByMethodByCode[0][0], MAX_METHODS*MaxCode);
+   copy(&responsesRetransmittedByMethodByCode[0][0], &mResponsesRetransmittedByMethodByCode[0][0], MAX_METHODS*MaxCode);
+   copy(&responsesReceivedByMethodByCode[0][0], &mResponsesReceivedByMethodByCode[0][0], MAX_METHODS*MaxCode);
+
    mPublicPayload->loadIn(*this);
 
    bool postToStack = true;
@@ -80,6 +98,48 @@ StatisticsManager::poll()
    }
 }
 
+void
+StatisticsManager::zeroOut()
+{
+   clear(&mRequestsSent, 1);
+   clear(&mResponsesSent, 1);
+   clear(&mRequestsRetransmitted, 1);
+   clear(&mResponsesRetransmitted, 1);
+   clear(&mRequestsReceived, 1);
+   clear(&mResponsesReceived, 1);
+
+   clear(mRequestsSentByMethod, MAX_METHODS);
+   clear(mRequestsRetransmittedByMethod, MAX_METHODS);
+   clear(mRequestsReceivedByMethod, MAX_METHODS);
+   clear(mResponsesSentByMethod, MAX_METHODS);
+   clear(mResponsesRetransmittedByMethod, MAX_METHODS);
+   clear(mResponsesReceivedByMethod, MAX_METHODS);
+
+   clear(&mResponsesSentByMethodByCode[0][0], MAX_METHODS*MaxCode);
+   clear(&mResponsesRetransmittedByMethodByCode[0][0], MAX_METHODS*MaxCode);
+   clear(&mResponsesReceivedByMethodByCode[0][0], MAX_METHODS*MaxCode);
+
+   StatisticsMessage::Payload::zeroOut();
+}
+
+void
+StatisticsManager::copy(unsigned int* to, const Counter* from, size_t count)
+{
+   for(size_t i = 0; i < count; ++i)
+   {
+      to[i] = from[i].load();
+   }
+}
+
+void
+StatisticsManager::clear(Counter* counters, size_t count)
+{
+   for(size_t i = 0; i < count; ++i)
+   {
+      counters[i].store(0);
+   }
+}
+
 void 
 StatisticsManager::process()
 {
@@ -97,8 +157,8 @@ StatisticsManager::sent(SipMessage* msg)
 
    if (msg->isRequest())
    {
-      ++requestsSent;
-      ++requestsSentByMethod[met];
+      mRequestsSent.fetchAdd(1);
+      mRequestsSentByMethod[met].fetchAdd(1);
    }
    else if (msg->isResponse())
    {
@@ -108,9 +168,9 @@ StatisticsManager::sent(SipMessage* msg)
          code = 0;
       }
 
-      ++responsesSent;
-      ++responsesSentByMethod[met];
-      ++responsesSentByMethodByCode[met][code];
+      mResponsesSent.fetchAdd(1);
+      mResponsesSentByMethod[met].fetchAdd(1);
+      mResponsesSentByMethodByCode[met][code].fetchAdd(1);
    }
    
    return false;
@@ -123,14 +183,14 @@ StatisticsManager::retransmitted(MethodTypes met,
 {
    if(request)
    {
-      ++requestsRetransmitted;
-      ++requestsRetransmittedByMethod[met];
+      mRequestsRetransmitted.fetchAdd(1);
+      mRequestsRetransmittedByMethod[met].fetchAdd(1);
    }
    else
    {
-      ++responsesRetransmitted;
-      ++responsesRetransmittedByMethod[met];
-      ++responsesRetransmittedByMethodByCode[met][code];
+      mResponsesRetransmitted.fetchAdd(1);
+      mResponsesRetransmittedByMethod[met].fetchAdd(1);
+      mResponsesRetransmittedByMethodByCode[met][code].fetchAdd(1);
    }
    return false;
 }
@@ -142,19 +202,19 @@ StatisticsManager::received(SipMessage* msg)
 
    if (msg->isRequest())
    {
-      ++requestsReceived;
-      ++requestsReceivedByMethod[met];
+      mRequestsReceived.fetchAdd(1);
+      mRequestsReceivedByMethod[met].fetchAdd(1);
    }
    else if (msg->isResponse())
    {
-      ++responsesReceived;
-      ++responsesReceivedByMethod[met];
       int code = msg->const_header(h_StatusLine).statusCode();
       if (code < 0 || code >= MaxCode)
       {
          code = 0;
       }
-      ++responsesReceivedByMethodByCode[met][code];
+      mResponsesReceived.fetchAdd(1);
+      mResponsesReceivedByMethod[met].fetchAdd(1);
+      mResponsesReceivedByMethodByCode[met][code].fetchAdd(1);
    }
 
    return false;
@@ -3,6 +3,7 @@
 
 #include "rutil/Timer.hxx"
 #include "rutil/Data.hxx"
+#include "rutil/Atomic.hxx"
 #include "resip/stack/StatisticsMessage.hxx"
 #include "resip/stack/StatisticsHandler.hxx"
 
@@ -57,6 +58,31 @@ class StatisticsManager : public StatisticsMessage::Payload
       bool received(SipMessage* msg);
 
       void poll(); // force an update
+      void zeroOut();
+
+      // The counters are bumped by every TransactionController shard, so
+      // they are kept here and copied into the Payload fields by poll().
+      typedef Atomic<unsigned int> Counter;
+      static void copy(unsigned int* to, const Counter* from, size_t count);
+      static void clear(Counter* counters, size_t count);
+
+      Counter mRequestsSent;
+      Counter mResponsesSent;
+      Counter mRequestsRetransmitted;
+      Counter mResponsesRetransmitted;
+      Counter mRequestsReceived;
+      Counter mResponsesReceived;
+
+      Counter mRequestsSentByMethod[MAX_METHODS];
+      Counter mRequestsRetransmittedByMethod[MAX_METHODS];
+      Counter mRequestsReceivedByMethod[MAX_METHODS];
+      Counter mResponsesSentByMethod[MAX_METHODS];
+      Counter mResponsesRetransmittedByMethod[MAX_METHODS];
+      Counter mResponsesReceivedByMethod[MAX_METHODS];
+
+      Counter mResponsesSentByMethodByCode[MAX_METHODS][MaxCode];
+      Counter mResponsesRetransmittedByMethodByCode[MAX_METHODS][MaxCode];
+      Counter mResponsesReceivedByMethodByCode[MAX_METHODS][MaxCode];
 
       SipStack& mStack;
       UInt64 mInterval;
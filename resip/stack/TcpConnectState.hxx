@@ -26,6 +26,7 @@ public:
 
     virtual const Data& getTransactionId() const;
     virtual bool isClientTransaction() const;
+    virtual bool isForTransaction() const { return true; }
 
     State getState() const { return mState; }
 
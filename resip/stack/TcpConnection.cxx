@@ -8,6 +8,10 @@
 #include "resip/stack/Tuple.hxx"
 #include "rutil/Errdes.hxx"
 
+#if !defined(WIN32)
+#include <sys/uio.h>
+#endif
+
 using namespace resip;
 
 #define RESIPROCATE_SUBSYSTEM Subsystem::TRANSPORT
@@ -109,6 +113,54 @@ TcpConnection::write( const char* buf, const int count )
    return bytesWritten;
 }
 
+bool
+TcpConnection::canGatherWrite() const
+{
+   return true;
+}
+
+int
+TcpConnection::gatherWrite(const WriteBuffer* buffers, int count)
+{
+   resip_assert(buffers);
+   resip_assert(count > 0);
+
+#if defined(WIN32)
+   WSABUF wsaBuffers[MaxGatherBuffers];
+   resip_assert(count <= MaxGatherBuffers);
+   for (int i = 0; i < count; ++i)
+   {
+      wsaBuffers[i].buf = const_cast<char*>(buffers[i].data);
+      wsaBuffers[i].len = buffers[i].count;
+   }
+   DWORD sent = 0;
+   int bytesWritten = (::WSASend(getSocket(), wsaBuffers, count, &sent, 0, 0, 0) == 0) ? (int)sent : INVALID_SOCKET;
+#else
+   struct iovec iov[MaxGatherBuffers];
+   resip_assert(count <= MaxGatherBuffers);
+   for (int i = 0; i < count; ++i)
+   {
+      iov[i].iov_base = const_cast<char*>(buffers[i].data);
+      iov[i].iov_len = buffers[i].count;
+   }
+   int bytesWritten = (int)::writev(getSocket(), iov, count);
+#endif
+
+   if (bytesWritten == INVALID_SOCKET)
+   {
+      int e = getErrno();
+      if (e == EAGAIN || e == EWOULDBLOCK)
+      {
+          return 0;
+      }
+      InfoLog (<< "Failed write on " << getSocket() << " " << errortostringOS(e));
+      Transport::error(e);
+      return -1;
+   }
+
+   return bytesWritten;
+}
+
 bool 
 TcpConnection::hasDataToRead()
 {
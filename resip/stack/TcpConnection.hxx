@@ -15,6 +15,8 @@ class TcpConnection : public Connection
       
       int read( char* buf, const int count );
       int write( const char* buf, const int count );
+      virtual bool canGatherWrite() const;
+      virtual int gatherWrite(const WriteBuffer* buffers, int count);
       virtual bool hasDataToRead(); // has data that can be read 
       virtual bool isGood(); // has valid connection
       virtual bool isWritable();
@@ -36,7 +36,13 @@ TimerMessage::~TimerMessage()
 bool 
 TimerMessage::isClientTransaction() const
 {
-   switch (mType)
+   return isClientTransaction(mType);
+}
+
+bool
+TimerMessage::isClientTransaction(Timer::Type type)
+{
+   switch (type)
    {
       case Timer::TimerA:
       case Timer::TimerB:
@@ -21,6 +21,8 @@ class TimerMessage : public TransactionMessage
       Timer::Type getType() const;
       unsigned long getDuration() const;
       bool isClientTransaction() const;
+      /// whether timers of this type belong to client transactions
+      static bool isClientTransaction(Timer::Type type);
       
       virtual EncodeStream& encode(EncodeStream& strm) const;
       virtual EncodeStream& encodeBrief(EncodeStream& str) const;
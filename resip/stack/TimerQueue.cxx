@@ -19,25 +19,35 @@ using namespace std;
 
 #define RESIPROCATE_SUBSYSTEM Subsystem::TRANSACTION
 
-TransactionTimerQueue::TransactionTimerQueue(Fifo<TimerMessage>& fifo)
-   : mFifo(fifo)
+TransactionTimerQueue::TransactionTimerQueue(Fifo<TimerMessage>& fifo, bool useTimerWheel)
+   : TimerQueue<TransactionTimer>(useTimerWheel),
+     mFifo(fifo)
 {
 }
 
+static void
+deletePayloads(std::vector<TimerWithPayload>& timers)
+{
+   for (std::vector<TimerWithPayload>::iterator i = timers.begin(); i != timers.end(); ++i)
+   {
+      delete i->getMessage();
+   }
+   timers.clear();
+}
+
 #ifdef USE_DTLS
 
-DtlsTimerQueue::DtlsTimerQueue( Fifo<DtlsMessage>& fifo )
-    : mFifo( fifo )
+DtlsTimerQueue::DtlsTimerQueue( Fifo<DtlsMessage>& fifo, bool useTimerWheel )
+    : TimerQueue<TimerWithPayload>( useTimerWheel ),
+      mFifo( fifo )
 {
 }
 
 DtlsTimerQueue::~DtlsTimerQueue()
 {
-   while(!mTimers.empty())
-   {
-      delete mTimers.top().getMessage();
-      mTimers.pop();
-   }
+   std::vector<TimerWithPayload> timers;
+   drainTimers(timers);
+   deletePayloads(timers);
 }
 
 #endif
@@ -46,9 +56,36 @@ UInt64
 TransactionTimerQueue::add(Timer::Type type, const Data& transactionId, unsigned long msOffset)
 {
    TransactionTimer t(msOffset, type, transactionId);
-   mTimers.push(t);
    DebugLog (<< "Adding timer: " << Timer::toData(type) << " tid=" << transactionId << " ms=" << msOffset);
-   return mTimers.top().getWhen();
+   if (usesTimerWheel())
+   {
+      WheelHandle handle = 0;
+      UInt64 when = addTimer(t, &handle);
+      handles(TimerMessage::isClientTransaction(type))[transactionId].push_back(handle);
+      return when;
+   }
+   return addTimer(t);
+}
+
+void
+TransactionTimerQueue::cancel(const Data& transactionId, bool clientTransaction)
+{
+   if (!usesTimerWheel())
+   {
+      return;
+   }
+
+   HandleMap& map = handles(clientTransaction);
+   HandleMap::iterator i = map.find(transactionId);
+   if (i != map.end())
+   {
+      for (std::vector<WheelHandle>::iterator h = i->second.begin(); h != i->second.end(); ++h)
+      {
+         mWheel->cancel(*h);
+      }
+      StackLog (<< "Canceled " << i->second.size() << " timers for tid=" << transactionId);
+      map.erase(i);
+   }
 }
 
 #ifdef USE_DTLS
@@ -57,19 +94,21 @@ UInt64
 DtlsTimerQueue::add( SSL *ssl, unsigned long msOffset )
 {
    TimerWithPayload t( msOffset, new DtlsMessage( ssl ) ) ;
-   mTimers.push( t ) ;
-   return mTimers.top().getWhen();
+   return addTimer( t ) ;
 }
 
 #endif
 
+BaseTimeLimitTimerQueue::BaseTimeLimitTimerQueue(bool useTimerWheel)
+   : TimerQueue<TimerWithPayload>(useTimerWheel)
+{
+}
+
 BaseTimeLimitTimerQueue::~BaseTimeLimitTimerQueue()
 {
-   while(!mTimers.empty())
-   {
-      delete mTimers.top().getMessage();
-      mTimers.pop();
-   }
+   std::vector<TimerWithPayload> timers;
+   drainTimers(timers);
+   deletePayloads(timers);
 }
 
 UInt64
@@ -77,8 +116,7 @@ BaseTimeLimitTimerQueue::add(unsigned int timeMs,Message* payload)
 {
    resip_assert(payload);
    DebugLog(<< "Adding application timer: " << payload->brief() << " ms=" << timeMs);
-   mTimers.push(TimerWithPayload(timeMs,payload));
-   return mTimers.top().getWhen();
+   return addTimer(TimerWithPayload(timeMs,payload));
 }
 
 void
@@ -91,12 +129,36 @@ BaseTimeLimitTimerQueue::processTimer(const TimerWithPayload& timer)
 void
 TransactionTimerQueue::processTimer(const TransactionTimer& timer)
 {
+   if (usesTimerWheel())
+   {
+      // forget the handle of the timer that is firing
+      HandleMap& map = handles(TimerMessage::isClientTransaction(timer.getType()));
+      HandleMap::iterator i = map.find(timer.getTransactionId());
+      resip_assert(i != map.end());
+      std::vector<WheelHandle>& v = i->second;
+      for (std::vector<WheelHandle>::iterator h = v.begin(); h != v.end(); ++h)
+      {
+         if (&(*h)->timer() == &timer)
+         {
+            *h = v.back();
+            v.pop_back();
+            break;
+         }
+      }
+      if (v.empty())
+      {
+         map.erase(i);
+      }
+   }
+
    mFifo.add(new TimerMessage(timer.getTransactionId(), 
                               timer.getType(), 
                               timer.getDuration()));
 }
 
-TimeLimitTimerQueue::TimeLimitTimerQueue(TimeLimitFifo<Message>& fifo) : mFifo(fifo)
+TimeLimitTimerQueue::TimeLimitTimerQueue(TimeLimitFifo<Message>& fifo, bool useTimerWheel)
+   : BaseTimeLimitTimerQueue(useTimerWheel),
+     mFifo(fifo)
 {}
 
 void
@@ -105,16 +167,16 @@ TimeLimitTimerQueue::addToFifo(Message*msg, TimeLimitFifo<Message>::DepthUsage d
    mFifo.add(msg, d);
 }
 
-TuSelectorTimerQueue::TuSelectorTimerQueue(TuSelector& sel) : mFifoSelector(sel)
+TuSelectorTimerQueue::TuSelectorTimerQueue(TuSelector& sel, bool useTimerWheel)
+   : TimerQueue<TimerWithPayload>(useTimerWheel),
+     mFifoSelector(sel)
 {}
 
 TuSelectorTimerQueue::~TuSelectorTimerQueue()
 {
-   while(!mTimers.empty())
-   {
-      delete mTimers.top().getMessage();
-      mTimers.pop();
-   }
+   std::vector<TimerWithPayload> timers;
+   drainTimers(timers);
+   deletePayloads(timers);
 }
 
 UInt64
@@ -122,8 +184,7 @@ TuSelectorTimerQueue::add(unsigned int timeMs,Message* payload)
 {
    resip_assert(payload);
    DebugLog(<< "Adding application timer: " << payload->brief() << " ms=" << timeMs);
-   mTimers.push(TimerWithPayload(timeMs,payload));
-   return mTimers.top().getWhen();
+   return addTimer(TimerWithPayload(timeMs,payload));
 }
 
 void
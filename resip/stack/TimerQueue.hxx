@@ -11,14 +11,12 @@
 #include <iosfwd>
 #include "resip/stack/TimerMessage.hxx"
 #include "resip/stack/DtlsMessage.hxx"
+#include "resip/stack/TimerWheel.hxx"
 #include "rutil/Fifo.hxx"
+#include "rutil/HashMap.hxx"
 #include "rutil/TimeLimitFifo.hxx"
 #include "rutil/Timer.hxx"
 
-// .dlb. 
-// to do: timer wheel for transaction-bound timers and a heap for
-// everything longer.
-
 namespace resip
 {
 
@@ -31,14 +29,21 @@ class TuSelector;
   * @brief This class takes a fifo as a place to where you can write your stuff.
   * When using this in the main loop, call process() on this.
   * During Transaction processing, TimerMessages and SIP messages are generated.
-  * 
-    @todo .dlb. timer wheel for transaction-bound timers and a heap for 
-      everything longer.
+  *
+  * Timers are kept in a binary heap by default. Passing useTimerWheel keeps
+  * them in a TimerWheel instead, which makes add and expiry O(1) and allows
+  * queued timers to be canceled; this pays off once there are many
+  * thousands of timers live at once.
   */
 template <class T>
 class TimerQueue
 {
    public:
+      explicit TimerQueue(bool useTimerWheel=false)
+         : mWheel(useTimerWheel ? new TimerWheel<T> : 0)
+      {
+      }
+
       // This is the logic that runs when a timer goes off. This is the only
       // thing subclasses must implement.
       virtual void processTimer(const T& timer)=0;
@@ -52,6 +57,12 @@ class TimerQueue
          {
             mTimers.pop();
          }
+         delete mWheel;
+      }
+
+      bool usesTimerWheel() const
+      {
+         return mWheel != 0;
       }
 
       /// @brief provides the time in milliseconds before the next timer will fire
@@ -61,9 +72,9 @@ class TimerQueue
       ///
       unsigned int msTillNextTimer()
       {
-         if (!mTimers.empty())
+         if (!empty())
          {
-            UInt64 next = mTimers.top().getWhen();
+            UInt64 next = mWheel ? mWheel->nextWhen() : mTimers.top().getWhen();
             UInt64 now = Timer::getTimeMs();
             if (now > next) 
             {
@@ -93,6 +104,19 @@ class TimerQueue
       /// machine fifo and application messages into the TU fifo
       virtual UInt64 process()
       {
+         if (mWheel)
+         {
+            if (!mWheel->empty())
+            {
+               mWheel->process(Timer::getTimeMs(), *this);
+               if (!mWheel->empty())
+               {
+                  return mWheel->nextWhen();
+               }
+            }
+            return 0;
+         }
+
          if (!mTimers.empty())
          {
             UInt64 now=Timer::getTimeMs();
@@ -112,17 +136,21 @@ class TimerQueue
 
       int size() const
       {
-         return (int)mTimers.size();
+         return mWheel ? (int)mWheel->size() : (int)mTimers.size();
       }
 
       bool empty() const
       {
-         return mTimers.empty();
+         return mWheel ? mWheel->empty() : mTimers.empty();
       }
 
       std::ostream& encode(std::ostream& str) const
       {
-         if(mTimers.size() > 0)
+         if(mWheel)
+         {
+            return str << "TimerQueue[ wheel size =" << mWheel->size() << "]";
+         }
+         else if(mTimers.size() > 0)
          {
             return str << "TimerQueue[ size =" << mTimers.size() 
                        << " top=" << mTimers.top() << "]" ;
@@ -136,7 +164,11 @@ class TimerQueue
 #ifndef RESIP_USE_STL_STREAMS
       EncodeStream& encode(EncodeStream& str) const
       {
-         if(mTimers.size() > 0)
+         if(mWheel)
+         {
+            return str << "TimerQueue[ wheel size =" << mWheel->size() << "]";
+         }
+         else if(mTimers.size() > 0)
          {
             return str << "TimerQueue[ size =" << mTimers.size() 
                        << " top=" << mTimers.top() << "]" ;
@@ -149,8 +181,48 @@ class TimerQueue
 #endif
 
    protected:
+      typedef typename TimerWheel<T>::Handle WheelHandle;
+
+      /// @brief queues {timer}; returns the time of the earliest timer when
+      /// using the heap, and of {timer} itself when using the wheel
+      UInt64 addTimer(const T& timer, WheelHandle* handle=0)
+      {
+         if (mWheel)
+         {
+            WheelHandle h = mWheel->add(timer);
+            if (handle)
+            {
+               *handle = h;
+            }
+            return timer.getWhen();
+         }
+         mTimers.push(timer);
+         return mTimers.top().getWhen();
+      }
+
+      /// @brief empties the queue without firing anything, so subclasses
+      /// can free timer payloads in their destructors
+      void drainTimers(std::vector<T>& timers)
+      {
+         while (!mTimers.empty())
+         {
+            timers.push_back(mTimers.top());
+            mTimers.pop();
+         }
+         if (mWheel)
+         {
+            mWheel->drain(timers);
+         }
+      }
+
       typedef std::vector<T, std::allocator<T> > TimerVector;
       std::priority_queue<T, TimerVector, std::greater<T> > mTimers;
+      TimerWheel<T>* mWheel;
+
+   private:
+      // disabled
+      TimerQueue(const TimerQueue&);
+      TimerQueue& operator=(const TimerQueue&);
 };
 
 /**
@@ -159,6 +231,7 @@ class TimerQueue
 class BaseTimeLimitTimerQueue : public TimerQueue<TimerWithPayload>
 {
    public:
+      explicit BaseTimeLimitTimerQueue(bool useTimerWheel=false);
       ~BaseTimeLimitTimerQueue();
       UInt64 add(unsigned int timeMs,Message* payload);
       virtual void processTimer(const TimerWithPayload& timer);
@@ -173,7 +246,7 @@ class BaseTimeLimitTimerQueue : public TimerQueue<TimerWithPayload>
 class TimeLimitTimerQueue : public BaseTimeLimitTimerQueue
 {
    public:
-      TimeLimitTimerQueue(TimeLimitFifo<Message>& fifo);
+      TimeLimitTimerQueue(TimeLimitFifo<Message>& fifo, bool useTimerWheel=false);
    protected:
       virtual void addToFifo(Message*, TimeLimitFifo<Message>::DepthUsage);
    private:
@@ -187,7 +260,7 @@ class TimeLimitTimerQueue : public BaseTimeLimitTimerQueue
 class TuSelectorTimerQueue : public TimerQueue<TimerWithPayload>
 {
    public:
-      TuSelectorTimerQueue(TuSelector& sel);
+      TuSelectorTimerQueue(TuSelector& sel, bool useTimerWheel=false);
       ~TuSelectorTimerQueue();
       UInt64 add(unsigned int timeMs,Message* payload);
       virtual void processTimer(const TimerWithPayload& timer);
@@ -202,11 +275,27 @@ class TuSelectorTimerQueue : public TimerQueue<TimerWithPayload>
 class TransactionTimerQueue : public TimerQueue<TransactionTimer>
 {
    public:
-      TransactionTimerQueue(Fifo<TimerMessage>& fifo);
+      TransactionTimerQueue(Fifo<TimerMessage>& fifo, bool useTimerWheel=false);
       UInt64 add(Timer::Type type, const Data& transactionId, unsigned long msOffset);
       virtual void processTimer(const TransactionTimer& timer);
+
+      /// @brief drops every timer still queued for the transaction, so
+      /// that terminated transactions do not leave dead timers behind.
+      /// Only the timer wheel supports this; with the heap the timers
+      /// fire as usual and are ignored by the TransactionController.
+      void cancel(const Data& transactionId, bool clientTransaction);
+
    private:
+      typedef HashMap<Data, std::vector<WheelHandle> > HandleMap;
+      HandleMap& handles(bool clientTransaction)
+      {
+         return clientTransaction ? mClientHandles : mServerHandles;
+      }
+
       Fifo<TimerMessage>& mFifo;
+      // wheel mode only; client and server transactions may share an id
+      HandleMap mClientHandles;
+      HandleMap mServerHandles;
 };
 
 #ifdef USE_DTLS
@@ -219,7 +308,7 @@ class TransactionTimerQueue : public TimerQueue<TransactionTimer>
 class DtlsTimerQueue : public TimerQueue<TimerWithPayload>
 {
    public:
-      DtlsTimerQueue(Fifo<DtlsMessage>& fifo);
+      DtlsTimerQueue(Fifo<DtlsMessage>& fifo, bool useTimerWheel=false);
       ~DtlsTimerQueue();
       UInt64 add(SSL *, unsigned long msOffset);
       virtual void processTimer(const TimerWithPayload& timer) ;
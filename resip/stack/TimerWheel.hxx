@@ -0,0 +1,372 @@
+#if !defined(RESIP_TIMERWHEEL_HXX)
+#define RESIP_TIMERWHEEL_HXX
+
+#include <vector>
+#include "rutil/compat.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/Timer.hxx"
+
+namespace resip
+{
+
+/**
+  * @internal
+  * @brief Hierarchical timing wheel for timers of type T (anything with a
+  * getWhen() in milliseconds, such as TransactionTimer or TimerWithPayload).
+  *
+  * Insertion, cancelation and expiry are O(1). The first wheel has one slot
+  * per millisecond for the next 256ms; three coarser wheels of 64 slots
+  * each cover up to 2^26ms (about 18 hours), and their slots are cascaded
+  * down as time advances. Anything further out waits in an overflow list
+  * that is rescanned every 2^26ms.
+  *
+  * Timers in the same millisecond fire in no particular order, as with
+  * the heap in TimerQueue.
+  */
+template <class T>
+class TimerWheel
+{
+   private:
+      class Link
+      {
+         public:
+            Link() : mPrev(this), mNext(this) {}
+
+            bool empty() const { return mNext == this; }
+
+            void unlink()
+            {
+               mPrev->mNext = mNext;
+               mNext->mPrev = mPrev;
+               mPrev = mNext = this;
+            }
+
+            void pushBack(Link* link)
+            {
+               link->mPrev = mPrev;
+               link->mNext = this;
+               mPrev->mNext = link;
+               mPrev = link;
+            }
+
+            // moves every element of this list to the end of rhs
+            void spliceInto(Link& rhs)
+            {
+               if (!empty())
+               {
+                  Link* first = mNext;
+                  Link* last = mPrev;
+                  first->mPrev = rhs.mPrev;
+                  rhs.mPrev->mNext = first;
+                  last->mNext = &rhs;
+                  rhs.mPrev = last;
+                  mPrev = mNext = this;
+               }
+            }
+
+            Link* mPrev;
+            Link* mNext;
+
+         private:
+            // disabled
+            Link(const Link&);
+            Link& operator=(const Link&);
+      };
+
+   public:
+      class Node : private Link
+      {
+         public:
+            const T& timer() const { return mTimer; }
+
+         private:
+            friend class TimerWheel<T>;
+            explicit Node(const T& timer) : mTimer(timer) {}
+            T mTimer;
+      };
+
+      /// identifies a queued timer for cancel(); invalid once it has fired
+      typedef Node* Handle;
+
+      TimerWheel() : mCurrentTick(Timer::getTimeMs()), mSize(0) {}
+
+      ~TimerWheel()
+      {
+         std::vector<T> timers;
+         drain(timers);
+      }
+
+      Handle add(const T& timer)
+      {
+         Node* node = new Node(timer);
+         insert(node);
+         ++mSize;
+         return node;
+      }
+
+      void cancel(Handle handle)
+      {
+         resip_assert(handle);
+         handle->unlink();
+         --mSize;
+         delete handle;
+      }
+
+      /// @brief fires every timer due at or before {now}, calling
+      /// handler.processTimer(timer) for each in expiry order
+      template <class Handler>
+      void process(UInt64 now, Handler& handler)
+      {
+         while (mSize > 0 && mCurrentTick <= now)
+         {
+            Link due;
+            mWheel0[mCurrentTick & Wheel0Mask].spliceInto(due);
+            if ((++mCurrentTick & Wheel0Mask) == 0)
+            {
+               cascade();
+            }
+
+            // handler may add or cancel timers, so take one node at a time
+            while (!due.empty())
+            {
+               Node* node = static_cast<Node*>(due.mNext);
+               node->unlink();
+               --mSize;
+               handler.processTimer(node->mTimer);
+               delete node;
+            }
+         }
+
+         if (mSize == 0 && mCurrentTick <= now)
+         {
+            // nothing queued; no need to walk the wheels up to now
+            mCurrentTick = now + 1;
+         }
+      }
+
+      /// @brief earliest time any timer can fire. Exact for timers due
+      /// within 256ms; otherwise the time of the next cascade that can
+      /// bring a timer closer, which is never later than the timer itself.
+      UInt64 nextWhen() const
+      {
+         resip_assert(mSize > 0);
+         UInt64 next = 0;
+
+         // first wheel holds everything due in [mCurrentTick, mCurrentTick+256)
+         for (UInt64 tick = mCurrentTick; tick < mCurrentTick + Wheel0Size; ++tick)
+         {
+            if (!mWheel0[tick & Wheel0Mask].empty())
+            {
+               next = tick;
+               break;
+            }
+         }
+
+         // first non-empty slot on each coarser wheel
+         for (unsigned int level = 0; level < NumWheels; ++level)
+         {
+            const unsigned int shift = Wheel0Bits + level*WheelBits;
+            UInt64 block = mCurrentTick >> shift;
+            for (unsigned int k = 1; k <= WheelSize; ++k)
+            {
+               if (!mWheels[level][(block + k) & WheelMask].empty())
+               {
+                  UInt64 when = (block + k) << shift;
+                  if (next == 0 || when < next)
+                  {
+                     next = when;
+                  }
+                  break;
+               }
+            }
+         }
+
+         if (!mOverflow.empty())
+         {
+            UInt64 when = ((mCurrentTick >> MaxBits) + 1) << MaxBits;
+            if (next == 0 || when < next)
+            {
+               next = when;
+            }
+         }
+         resip_assert(next);
+         return next;
+      }
+
+      size_t size() const
+      {
+         return mSize;
+      }
+
+      bool empty() const
+      {
+         return mSize == 0;
+      }
+
+      /// removes every queued timer, appending them to {timers}
+      void drain(std::vector<T>& timers)
+      {
+         drain(mOverflow, timers);
+         for (unsigned int level = 0; level < NumWheels; ++level)
+         {
+            for (unsigned int i = 0; i < WheelSize; ++i)
+            {
+               drain(mWheels[level][i], timers);
+            }
+         }
+         for (unsigned int i = 0; i < Wheel0Size; ++i)
+         {
+            drain(mWheel0[i], timers);
+         }
+         resip_assert(mSize == 0);
+      }
+
+   private:
+      static const unsigned int Wheel0Bits = 8;
+      static const unsigned int Wheel0Size = 1 << Wheel0Bits;
+      static const UInt64 Wheel0Mask = Wheel0Size - 1;
+      static const unsigned int WheelBits = 6;
+      static const unsigned int WheelSize = 1 << WheelBits;
+      static const UInt64 WheelMask = WheelSize - 1;
+      static const unsigned int NumWheels = 3;
+      static const unsigned int MaxBits = Wheel0Bits + NumWheels*WheelBits;
+
+      void insert(Node* node)
+      {
+         UInt64 when = node->mTimer.getWhen();
+         if (when < mCurrentTick)
+         {
+            // already due; fire on the next tick processed
+            when = mCurrentTick;
+         }
+
+         UInt64 delta = when - mCurrentTick;
+         if (delta < Wheel0Size)
+         {
+            mWheel0[when & Wheel0Mask].pushBack(node);
+            return;
+         }
+         for (unsigned int level = 0; level < NumWheels; ++level)
+         {
+            const unsigned int shift = Wheel0Bits + level*WheelBits;
+            if (delta < (UInt64(1) << (shift + WheelBits)))
+            {
+               mWheels[level][(when >> shift) & WheelMask].pushBack(node);
+               return;
+            }
+         }
+         mOverflow.pushBack(node);
+      }
+
+      // Called as soon as the first wheel wraps, so the slots of the block
+      // mCurrentTick is in are always empty on the coarser wheels (apart
+      // from timers a full revolution away); moves the timers of the slots
+      // that are now due down towards the first wheel, coarsest first.
+      void cascade()
+      {
+         unsigned int level = 0;
+         while (level < NumWheels &&
+                ((mCurrentTick >> (Wheel0Bits + level*WheelBits)) & WheelMask) == 0)
+         {
+            ++level;
+         }
+
+         if (level == NumWheels)
+         {
+            reinsert(mOverflow);
+         }
+         for (int i = (int)resipMin(level, NumWheels - 1); i >= 0; --i)
+         {
+            const unsigned int shift = Wheel0Bits + i*WheelBits;
+            reinsert(mWheels[i][(mCurrentTick >> shift) & WheelMask]);
+         }
+      }
+
+      void reinsert(Link& slot)
+      {
+         Link pending;
+         slot.spliceInto(pending);
+         while (!pending.empty())
+         {
+            Node* node = static_cast<Node*>(pending.mNext);
+            node->unlink();
+            insert(node);
+         }
+      }
+
+      void drain(Link& slot, std::vector<T>& timers)
+      {
+         while (!slot.empty())
+         {
+            Node* node = static_cast<Node*>(slot.mNext);
+            node->unlink();
+            --mSize;
+            timers.push_back(node->mTimer);
+            delete node;
+         }
+      }
+
+      UInt64 mCurrentTick; // next millisecond to be processed
+      size_t mSize;
+      Link mWheel0[Wheel0Size];
+      Link mWheels[NumWheels][WheelSize];
+      Link mOverflow;
+
+      // disabled
+      TimerWheel(const TimerWheel&);
+      TimerWheel& operator=(const TimerWheel&);
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2004 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -37,7 +37,9 @@ unsigned int TransactionController::MaxTUFifoSize = 0;
 unsigned int TransactionController::MaxTUFifoTimeDepthSecs = 0;
 
 TransactionController::TransactionController(SipStack& stack, 
-                                                AsyncProcessHandler* handler) :
+                                                AsyncProcessHandler* handler,
+                                                bool useTimerWheel,
+                                                unsigned int numShards) :
    mStack(stack),
    mDiscardStrayResponses(true),
    mFixBadDialogIdentifiers(true),
@@ -46,16 +48,53 @@ TransactionController::TransactionController(SipStack& stack,
    mStateMacFifoOutBuffer(mStateMacFifo),
    mCongestionManager(0),
    mTuSelector(stack.mTuSelector),
-   mTransportSelector(mStateMacFifo,
-                      stack.getSecurity(),
-                      stack.getDnsStub(),
-                      stack.getCompression()),
-   mTimers(mTimerFifo),
+   mOwnTransportSelector(new TransportSelector(mStateMacFifo,
+                                               stack.getSecurity(),
+                                               stack.getDnsStub(),
+                                               stack.getCompression())),
+   mTransportSelector(*mOwnTransportSelector),
+   mTimers(mTimerFifo, useTimerWheel),
    mShuttingDown(false),
    mStatsManager(stack.mStatsManager),
-   mHostname(DnsUtil::getLocalHostName())
+   mHostname(DnsUtil::getLocalHostName()),
+   mPrimary(0),
+   mShardIndex(0)
 {
    mStateMacFifo.setDescription("TransactionController::mStateMacFifo");
+
+   mTransportSelector.setNumShards(numShards);
+
+   for(unsigned int i = 1; i < numShards; ++i)
+   {
+      mShards.push_back(new TransactionController(*this, handler, useTimerWheel, i));
+   }
+   if(!mShards.empty())
+   {
+      InfoLog(<< "Transaction processing split over " << numShards << " shards");
+   }
+}
+
+TransactionController::TransactionController(TransactionController& primary,
+                                             AsyncProcessHandler* handler,
+                                             bool useTimerWheel,
+                                             unsigned int index) :
+   mStack(primary.mStack),
+   mDiscardStrayResponses(primary.mDiscardStrayResponses),
+   mFixBadDialogIdentifiers(primary.mFixBadDialogIdentifiers),
+   mFixBadCSeqNumbers(primary.mFixBadCSeqNumbers),
+   mStateMacFifo(handler),
+   mStateMacFifoOutBuffer(mStateMacFifo),
+   mCongestionManager(0),
+   mTuSelector(primary.mTuSelector),
+   mTransportSelector(primary.mTransportSelector),
+   mTimers(mTimerFifo, useTimerWheel),
+   mShuttingDown(false),
+   mStatsManager(primary.mStatsManager),
+   mHostname(primary.mHostname),
+   mPrimary(&primary),
+   mShardIndex(index)
+{
+   mStateMacFifo.setDescription("TransactionController::mStateMacFifo[" + Data(index) + "]");
 }
 
 #if defined(WIN32) && !defined(__GNUC__)
@@ -64,6 +103,13 @@ TransactionController::TransactionController(SipStack& stack,
 
 TransactionController::~TransactionController()
 {
+   // shards go first; their transactions still refer to our TransportSelector
+   for(std::vector<TransactionController*>::iterator i = mShards.begin(); i != mShards.end(); ++i)
+   {
+      delete *i;
+   }
+   mShards.clear();
+
    if(mClientTransactionMap.size())
    {
       WarningLog(<< "On shutdown, there are Client TransactionStates remaining!");
@@ -76,6 +122,59 @@ TransactionController::~TransactionController()
 }
 
 
+TransactionController&
+TransactionController::getShard(unsigned int index)
+{
+   resip_assert(index < getNumShards());
+   return index == 0 ? *this : *mShards[index-1];
+}
+
+TransactionController&
+TransactionController::shardFor(const Data& tid)
+{
+   if(mShards.empty())
+   {
+      return *this;
+   }
+
+   // A CANCEL transaction's id is that of its INVITE plus "cancel"; strip
+   // it so both land on the same shard.
+   static const char cancel[] = "cancel";
+   static const size_t cancelLen = sizeof(cancel) - 1;
+   size_t len = tid.size();
+   while(len >= cancelLen && memcmp(tid.data() + len - cancelLen, cancel, cancelLen) == 0)
+   {
+      len -= cancelLen;
+   }
+
+   size_t index = Data::rawHash((const unsigned char*)tid.data(), len) % getNumShards();
+   return index == 0 ? *this : *mShards[index-1];
+}
+
+TransactionController&
+TransactionController::shardFor(TransactionMessage* message)
+{
+   if(mShards.empty())
+   {
+      return *this;
+   }
+
+   // Only messages that belong to a transaction move; transport, flow and
+   // statistics requests are handled here, next to the TransportSelector.
+   if(message->isForTransaction())
+   {
+      try
+      {
+         return shardFor(message->getTransactionId());
+      }
+      catch(resip::BaseException&)
+      {
+         // no usable tid; TransactionState::process() will drop it
+      }
+   }
+   return *this;
+}
+
 bool 
 TransactionController::isTUOverloaded() const
 {
@@ -96,6 +195,7 @@ TransactionController::process(int timeout)
        //mTimers.empty() && 
        !mStateMacFifoOutBuffer.messageAvailable() && // !dcm! -- see below 
        !mStack.mTUFifo.messageAvailable() &&
+       !shardsHaveMessages() &&
        mTransportSelector.isFinished())
 // !dcm! -- why would one wait for the Tu's fifo to be empty before delivering a
 // shutdown message?
@@ -115,7 +215,7 @@ TransactionController::process(int timeout)
 
       // Check if Statistics Manager needs to be polled - note:  all statistic manager polls should happen from the 
       // TransactionController thread / process loop
-      if(mStack.mStatisticsManagerEnabled)
+      if(!mPrimary && mStack.mStatisticsManagerEnabled)
       {
          mStatsManager.process();
       }
@@ -147,7 +247,15 @@ TransactionController::process(int timeout)
          int runs=16;
          while(message)
          {
-            TransactionState::process(*this, message);
+            TransactionController& shard = shardFor(message);
+            if(&shard == this)
+            {
+               TransactionState::process(*this, message);
+            }
+            else
+            {
+               shard.mStateMacFifo.add(message);
+            }
             if(--runs==0)
             {
                break;
@@ -155,7 +263,7 @@ TransactionController::process(int timeout)
             message = mStateMacFifoOutBuffer.getNext(-1);
          }
 
-         mTransportSelector.poke();
+         mTransportSelector.poke(mShardIndex);
       }
    }
 }
@@ -167,25 +275,44 @@ TransactionController::getTimeTillNextProcessMS()
    {
       return 0;
    }
-   return mTimers.msTillNextTimer();
+   unsigned int next = mTimers.msTillNextTimer();
+   for(std::vector<TransactionController*>::iterator i = mShards.begin(); i != mShards.end(); ++i)
+   {
+      next = resipMin(next, (*i)->getTimeTillNextProcessMS());
+   }
+   return next;
 } 
 
+bool
+TransactionController::shardsHaveMessages() const
+{
+   for(std::vector<TransactionController*>::const_iterator i = mShards.begin(); i != mShards.end(); ++i)
+   {
+      if((*i)->mStateMacFifo.messageAvailable())
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
 void
 TransactionController::send(SipMessage* msg)
 {
+   TransactionController& shard = shardFor(msg);
    if(msg->isRequest() && 
       msg->method() != ACK && 
-      getRejectionBehavior()!=CongestionManager::NORMAL)
+      shard.getRejectionBehavior()!=CongestionManager::NORMAL)
    {
       // Need to 503 this.
       SipMessage* resp(Helper::makeResponse(*msg, 503));
-      resp->header(h_RetryAfter).value()=(UInt32)mStateMacFifo.expectedWaitTimeMilliSec()/1000;
+      resp->header(h_RetryAfter).value()=(UInt32)shard.mStateMacFifo.expectedWaitTimeMilliSec()/1000;
       resp->setTransactionUser(msg->getTransactionUser());
       mTuSelector.add(resp, TimeLimitFifo<Message>::InternalElement);
       delete msg;
       return;
    }
-   mStateMacFifo.add(msg);
+   shard.mStateMacFifo.add(msg);
 }
 
 
@@ -206,25 +333,45 @@ TransactionController::getTransactionFifoSize() const
 {
    // Should we include the stuff in mStateMacFifoOutBuffer here too? This is
    // likely to be called from other threads...
-   return mStateMacFifo.size();
+   unsigned int size = mStateMacFifo.size();
+   for(std::vector<TransactionController*>::const_iterator i = mShards.begin(); i != mShards.end(); ++i)
+   {
+      size += (*i)->getTransactionFifoSize();
+   }
+   return size;
 }
 
 unsigned int 
 TransactionController::getNumClientTransactions() const
 {
-   return mClientTransactionMap.size();
+   unsigned int size = mClientTransactionMap.size();
+   for(std::vector<TransactionController*>::const_iterator i = mShards.begin(); i != mShards.end(); ++i)
+   {
+      size += (*i)->getNumClientTransactions();
+   }
+   return size;
 }
 
 unsigned int 
 TransactionController::getNumServerTransactions() const
 {
-   return mServerTransactionMap.size();
+   unsigned int size = mServerTransactionMap.size();
+   for(std::vector<TransactionController*>::const_iterator i = mShards.begin(); i != mShards.end(); ++i)
+   {
+      size += (*i)->getNumServerTransactions();
+   }
+   return size;
 }
 
 unsigned int 
 TransactionController::getTimerQueueSize() const
 {
-   return mTimers.size();
+   unsigned int size = mTimers.size();
+   for(std::vector<TransactionController*>::const_iterator i = mShards.begin(); i != mShards.end(); ++i)
+   {
+      size += (*i)->getTimerQueueSize();
+   }
+   return size;
 }
 
 void 
@@ -253,13 +400,13 @@ void TransactionController::unregisterMarkListener(MarkListener* listener)
 void 
 TransactionController::abandonServerTransaction(const Data& tid)
 {
-   mStateMacFifo.add(new AbandonServerTransaction(tid));
+   shardFor(tid).mStateMacFifo.add(new AbandonServerTransaction(tid));
 }
 
 void 
 TransactionController::cancelClientInviteTransaction(const Data& tid)
 {
-   mStateMacFifo.add(new CancelClientInviteTransaction(tid));
+   shardFor(tid).mStateMacFifo.add(new CancelClientInviteTransaction(tid));
 }
 
 void 
@@ -9,6 +9,9 @@
 
 #include "rutil/ConsumerFifoBuffer.hxx"
 
+#include <memory>
+#include <vector>
+
 namespace resip
 {
 
@@ -20,6 +23,20 @@ class SipStack;
 class Compression;
 class FdPollGrp;
 
+/**
+   @internal
+   @brief Runs the transaction state machines.
+
+   A controller can be split into several shards, each with its own
+   transaction maps, timer queue and fifo, so that they can be serviced
+   by one TransactionControllerThread each. The controller created by
+   the SipStack is shard 0: it owns the TransportSelector (which all the
+   shards share), receives everything the transports produce, and hands
+   each message to the shard selected by a hash of its transaction id.
+   Since a CANCEL and a non-2xx ACK carry the transaction id of their
+   INVITE, all the messages of a transaction are handled by one shard,
+   in order.
+*/
 class TransactionController
 {
    public:
@@ -28,9 +45,21 @@ class TransactionController
       static unsigned int MaxTUFifoTimeDepthSecs;
 
       TransactionController(SipStack& stack, 
-                              AsyncProcessHandler* handler);
+                              AsyncProcessHandler* handler,
+                              bool useTimerWheel=false,
+                              unsigned int numShards=1);
       ~TransactionController();
 
+      /// @brief number of shards, including this one
+      unsigned int getNumShards() const
+      {
+         return (unsigned int)mShards.size() + 1;
+      }
+
+      /// @brief shard {index}, where shard 0 is this controller. Each of
+      /// the others needs to be given cycles (ie: process()) too.
+      TransactionController& getShard(unsigned int index);
+
       void process(int timeout=0);
       unsigned int getTimeTillNextProcessMS();
 
@@ -55,7 +84,10 @@ class TransactionController
       
       void setCongestionManager( CongestionManager *manager ) 
       { 
-         mTransportSelector.setCongestionManager(manager);
+         if(!mPrimary)
+         {
+            mTransportSelector.setCongestionManager(manager);
+         }
          if(mCongestionManager)
          {
             mCongestionManager->unregisterFifo(&mStateMacFifo);
@@ -65,6 +97,10 @@ class TransactionController
          {
             mCongestionManager->registerFifo(&mStateMacFifo);
          }
+         for(std::vector<TransactionController*>::iterator i = mShards.begin(); i != mShards.end(); ++i)
+         {
+            (*i)->setCongestionManager(manager);
+         }
       }
 
       CongestionManager::RejectionBehavior getRejectionBehavior() const
@@ -87,12 +123,20 @@ class TransactionController
       inline void setFixBadDialogIdentifiers(bool pFixBadDialogIdentifiers) 
       {
          mFixBadDialogIdentifiers = pFixBadDialogIdentifiers;
+         for(std::vector<TransactionController*>::iterator i = mShards.begin(); i != mShards.end(); ++i)
+         {
+            (*i)->setFixBadDialogIdentifiers(pFixBadDialogIdentifiers);
+         }
       }
 
       inline bool getFixBadCSeqNumbers() const { return mFixBadCSeqNumbers;} 
       inline void setFixBadCSeqNumbers(bool pFixBadCSeqNumbers)
       {
          mFixBadCSeqNumbers = pFixBadCSeqNumbers;
+         for(std::vector<TransactionController*>::iterator i = mShards.begin(); i != mShards.end(); ++i)
+         {
+            (*i)->setFixBadCSeqNumbers(pFixBadCSeqNumbers);
+         }
       }
 
       void abandonServerTransaction(const Data& tid);
@@ -106,6 +150,17 @@ class TransactionController
    private:
       TransactionController(const TransactionController& rhs);
       TransactionController& operator=(const TransactionController& rhs);
+
+      // creates shard {index} of {primary}
+      TransactionController(TransactionController& primary,
+                            AsyncProcessHandler* handler,
+                            bool useTimerWheel,
+                            unsigned int index);
+
+      TransactionController& shardFor(const Data& tid);
+      TransactionController& shardFor(TransactionMessage* message);
+      bool shardsHaveMessages() const;
+
       SipStack& mStack;
       
       // If true, indicate to the Transaction to ignore responses for which
@@ -137,22 +192,32 @@ class TransactionController
       // from the sipstack (for convenience)
       TuSelector& mTuSelector;
 
-      // Used to decide which transport to send a sip message on. 
-      TransportSelector mTransportSelector;
+      // Used to decide which transport to send a sip message on. Owned by
+      // shard 0 and shared by the other shards.
+      std::auto_ptr<TransportSelector> mOwnTransportSelector;
+      TransportSelector& mTransportSelector;
+
+      // timers associated with the transactions. When a timer fires, it is
+      // placed in the mStateMacFifo. Declared before the transaction maps,
+      // since TransactionStates cancel their timers when they are deleted.
+      TransactionTimerQueue  mTimers;
 
       // stores all of the transactions that are currently active in this stack 
       TransactionMap mClientTransactionMap;
       TransactionMap mServerTransactionMap;
 
-      // timers associated with the transactions. When a timer fires, it is
-      // placed in the mStateMacFifo
-      TransactionTimerQueue  mTimers;
-
       bool mShuttingDown;
       
       StatisticsManager& mStatsManager;
       
       Data mHostname;
+
+      // shard 0 if this is one of the other shards, else 0
+      TransactionController* mPrimary;
+      // our index, which is also the TransportSelector state we send with
+      unsigned int mShardIndex;
+      // shards 1..N-1, owned by shard 0
+      std::vector<TransactionController*> mShards;
       
       friend class SipStack; // for debug only
       friend class StatelessHandler;
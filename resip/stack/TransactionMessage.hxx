@@ -19,6 +19,11 @@ class TransactionMessage : public Message
       // purpose of determining which TransactionMap to use
       virtual bool isClientTransaction() const = 0; 
 
+      // indicates this message is processed by the transaction named by
+      // getTransactionId(), so a sharded TransactionController hands it to
+      // that transaction's shard
+      virtual bool isForTransaction() const { return false; }
+
       virtual Message* clone() const {resip_assert(false); return NULL;}
 };
 
@@ -46,7 +46,7 @@ using namespace resip;
 
 #define RESIPROCATE_SUBSYSTEM Subsystem::TRANSACTION
 
-UInt32 TransactionState::StatelessIdCounter = 0;
+Atomic<UInt32> TransactionState::StatelessIdCounter(0);
 
 TransactionState::TransactionState(TransactionController& controller, Machine m, 
                                    State s, const Data& id, MethodTypes method, const Data& methodText, TransactionUser* tu) : 
@@ -124,7 +124,7 @@ TransactionState::handleBadRequest(const resip::SipMessage& badReq, TransactionC
 
       if(badReq.isExternal())
       {
-         controller.mTransportSelector.transmit(error,target);
+         controller.mTransportSelector.transmit(error, target, 0, controller.mShardIndex);
          delete error;
          return true;
       }
@@ -156,6 +156,7 @@ TransactionState::~TransactionState()
 
    //StackLog (<< "Deleting TransactionState " << mId << " : " << this);
    erase(mId);
+   mController.mTimers.cancel(mId, isClient());
    
    delete mNextTransmission;
    delete mMethodText;
@@ -187,7 +188,7 @@ TransactionState::processSipMessageAsNew(SipMessage* sip, TransactionController&
             SipMessage* noMatch = Helper::makeResponse(*sip, 500);
             Tuple target(sip->getSource());
 
-            controller.mTransportSelector.transmit(noMatch, target);
+            controller.mTransportSelector.transmit(noMatch, target, 0, controller.mShardIndex);
             delete noMatch;
             return false;
          }
@@ -257,7 +258,7 @@ TransactionState::processSipMessageAsNew(SipMessage* sip, TransactionController&
                //was TransactionState::sendToTU(tu, controller, Helper::makeResponse(*sip, 481));
                SipMessage* response = Helper::makeResponse(*sip, 481);
                Tuple target(sip->getSource());
-               controller.mTransportSelector.transmit(response, target);
+               controller.mTransportSelector.transmit(response, target, 0, controller.mShardIndex);
                
                delete response;
                return false;
@@ -379,7 +380,7 @@ TransactionState::processSipMessageAsNew(SipMessage* sip, TransactionController&
             new TransactionState(controller, 
                                  Stateless, 
                                  Calling, 
-                                 Data(StatelessIdCounter++), 
+                                 Data(StatelessIdCounter.fetchAdd(1)), 
                                  method,
                                  sip->methodStr(),
                                  tu);
@@ -407,7 +408,7 @@ TransactionState::process(TransactionController& controller,
    if (keepAlive)
    {
       StackLog ( << "Sending keep alive to: " << keepAlive->getDestination());      
-      controller.mTransportSelector.transmit(keepAlive, keepAlive->getDestination());
+      controller.mTransportSelector.transmit(keepAlive, keepAlive->getDestination(), 0, controller.mShardIndex);
       delete keepAlive;
       return;
    }
@@ -434,7 +435,7 @@ TransactionState::process(TransactionController& controller,
       TerminateFlow* termFlow = dynamic_cast<TerminateFlow*>(message);
       if(termFlow)
       {
-         controller.mTransportSelector.terminateFlow(termFlow->getFlow());
+         controller.mTransportSelector.terminateFlow(termFlow->getFlow(), controller.mShardIndex);
          delete termFlow;
          return;
       }
@@ -442,7 +443,7 @@ TransactionState::process(TransactionController& controller,
       EnableFlowTimer* enableFlowTimer = dynamic_cast<EnableFlowTimer*>(message);
       if(enableFlowTimer)
       {
-         controller.mTransportSelector.enableFlowTimer(enableFlowTimer->getFlow());
+         controller.mTransportSelector.enableFlowTimer(enableFlowTimer->getFlow(), controller.mShardIndex);
          delete enableFlowTimer;
          return;
       }
@@ -526,7 +527,7 @@ TransactionState::process(TransactionController& controller,
             //tryLater->header(h_RetryAfter).comment() = "Server busy TRANS";
             Tuple target(sip->getSource());
             delete sip;
-            controller.mTransportSelector.transmit(tryLater, target);
+            controller.mTransportSelector.transmit(tryLater, target, 0, controller.mShardIndex);
             delete tryLater;
             return;
          }
@@ -2543,7 +2544,7 @@ TransactionState::sendCurrentToWire()
                                                    mCurrentResponseCode);
       }
 
-      mController.mTransportSelector.retransmit(mMsgToRetransmit);
+      mController.mTransportSelector.retransmit(mMsgToRetransmit, mController.mShardIndex);
    }
    else if(mNextTransmission) // initial transmission; need to determine target
    {
@@ -2557,7 +2558,8 @@ TransactionState::sendCurrentToWire()
             transmitState=mController.mTransportSelector.transmit(
                         sip, 
                         mTarget,
-                        mIsReliable ? 0 : &mMsgToRetransmit);
+                        mIsReliable ? 0 : &mMsgToRetransmit,
+                        mController.mShardIndex);
          }
          else // mTarget isn't set...
          {
@@ -2574,7 +2576,8 @@ TransactionState::sendCurrentToWire()
                transmitState=mController.mTransportSelector.transmit(
                            sip, 
                            mTarget,
-                           mIsReliable ? 0 : &mMsgToRetransmit);
+                           mIsReliable ? 0 : &mMsgToRetransmit,
+                           mController.mShardIndex);
             }
             else // ...so DNS is required...
             {
@@ -2585,7 +2588,7 @@ TransactionState::sendCurrentToWire()
                   resip_assert(mMethod!=CANCEL); // .bwc. mTarget should be set in this case.
                   mDnsResult = mController.mTransportSelector.createDnsResult(this);
                   mPendingOperation=Dns;
-                  mController.mTransportSelector.dnsResolve(mDnsResult, sip);
+                  mController.mTransportSelector.dnsResolve(mDnsResult, sip, mController.mShardIndex);
                }
                else // ... but our DNS query isn't done yet.
                {
@@ -2622,7 +2625,8 @@ TransactionState::sendCurrentToWire()
             transmitState=mController.mTransportSelector.transmit(
                         sip, 
                         target,
-                        mIsReliable ? 0 : &mMsgToRetransmit);
+                        mIsReliable ? 0 : &mMsgToRetransmit,
+                        mController.mShardIndex);
          }
          else
          {
@@ -2640,7 +2644,8 @@ TransactionState::sendCurrentToWire()
             transmitState=mController.mTransportSelector.transmit(
                         sip, 
                         mResponseTarget,
-                        mIsReliable ? 0 : &mMsgToRetransmit);
+                        mIsReliable ? 0 : &mMsgToRetransmit,
+                        mController.mShardIndex);
          }
       }
 
@@ -7,6 +7,7 @@
 #include "resip/stack/MethodTypes.hxx"
 #include "resip/stack/SipMessage.hxx"
 #include "resip/stack/Transport.hxx"
+#include "rutil/Atomic.hxx"
 #include "rutil/HeapInstanceCounter.hxx"
 
 namespace resip
@@ -189,7 +190,7 @@ class TransactionState : public DnsHandler
       int mFailureSubCode;
       bool mTcpConnectTimerStarted;
 
-      static UInt32 StatelessIdCounter;
+      static Atomic<UInt32> StatelessIdCounter;  // shared by all shards
       
       friend EncodeStream& operator<<(EncodeStream& strm, const TransactionState& state);
       friend class TransactionController;
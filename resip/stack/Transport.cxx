@@ -459,6 +459,15 @@ Transport::operator==(const Transport& rhs) const
             ( memcmp(&boundInterface(),&rhs.boundInterface(),mTuple.length()) == 0) );
 }
 
+bool
+Transport::isReusePortShardOf(const Transport& rhs) const
+{
+   return ( transport() == UDP && rhs.transport() == UDP &&
+            ( mTransportFlags & RESIP_TRANSPORT_FLAG_REUSEPORT ) != 0 &&
+            ( rhs.mTransportFlags & RESIP_TRANSPORT_FLAG_REUSEPORT ) != 0 &&
+            *this == rhs );
+}
+
 EncodeStream&
 resip::operator<<(EncodeStream& strm, const resip::Transport& rhs)
 {
@@ -52,6 +52,24 @@ class FdPollGrp;
  *    Specifies whether this Transport object has its own thread (ie; if
  *    set, the TransportSelector should not run the select/poll loop for
  *    this transport, since that is another thread's job)
+ * RXBATCH:
+ *    On datagram transports that support it (UDP), receive several
+ *    datagrams per system call (recvmmsg) into a ring of receive buffers
+ *    that is kept allocated. Combine with RXALL to keep reading batches
+ *    until the socket is drained. Ignored where recvmmsg is unavailable.
+ * TXBATCH:
+ *    On datagram transports that support it (UDP), send several queued
+ *    messages per system call (sendmmsg). Combine with TXALL to keep
+ *    sending batches until the transmit queue is empty. Ignored where
+ *    sendmmsg is unavailable.
+ * REUSEPORT:
+ *    Set SO_REUSEPORT on the socket before binding, so several UDP
+ *    transports can share one ip:port. Each one is a shard with its own
+ *    socket; the kernel hashes each peer's flow onto one shard, so
+ *    responses leave through the shard that received the request.
+ *    Usually combined with OWNTHREAD so every shard is served by its own
+ *    TransportThread. Only the first shard added is used to send requests
+ *    that are not tied to a receiving transport.
  */
 #define RESIP_TRANSPORT_FLAG_NOBIND      (1<<0)
 #define RESIP_TRANSPORT_FLAG_RXALL       (1<<1)
@@ -59,6 +77,9 @@ class FdPollGrp;
 #define RESIP_TRANSPORT_FLAG_KEEP_BUFFER (1<<3)
 #define RESIP_TRANSPORT_FLAG_TXNOW       (1<<4)
 #define RESIP_TRANSPORT_FLAG_OWNTHREAD   (1<<5)
+#define RESIP_TRANSPORT_FLAG_RXBATCH     (1<<6)
+#define RESIP_TRANSPORT_FLAG_TXBATCH     (1<<7)
+#define RESIP_TRANSPORT_FLAG_REUSEPORT   (1<<8)
 
 /**
    @brief The base class for Transport classes.
@@ -373,6 +394,11 @@ class Transport : public FdSetIOObserver
       inline unsigned int getKey() const {return mTuple.mTransportKey;} 
       inline void setKey(unsigned int pKey) { mTuple.mTransportKey = pKey;} // should only be called once after creation
 
+      unsigned getTransportFlags() const { return mTransportFlags; }
+
+      /// true if this transport and rhs are UDP shards of one ip:port (see RESIP_TRANSPORT_FLAG_REUSEPORT)
+      bool isReusePortShardOf(const Transport& rhs) const;
+
    protected:
 
       Data mInterface;
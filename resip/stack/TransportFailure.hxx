@@ -36,6 +36,7 @@ class TransportFailure : public TransactionMessage
 
       virtual const Data& getTransactionId() const;
       virtual bool isClientTransaction() const;
+      virtual bool isForTransaction() const { return true; }
 
       FailureReason getFailureReason() const { return mFailureReason; }
       int getFailureSubCode() const { return mFailureSubCode; }
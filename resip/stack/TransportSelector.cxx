@@ -32,6 +32,7 @@
 #include "rutil/DataStream.hxx"
 #include "rutil/DnsUtil.hxx"
 #include "rutil/Inserter.hxx"
+#include "rutil/Lock.hxx"
 #include "rutil/Logger.hxx"
 #include "rutil/Socket.hxx"
 #include "rutil/FdPoll.hxx"
@@ -74,9 +75,10 @@ TransportSelector::TransportSelector(Fifo<TransactionMessage>& fifo, Security* s
    mCompression(compression),
    mSigcompStack (0),
    mPollGrp(0),
-   mAvgBufferSize(1024),
    mInterruptorHandle(0)
 {
+   mShards.push_back(new Shard);
+
    memset(&mUnspecified.v4Address, 0, sizeof(sockaddr_in));
    mUnspecified.v4Address.sin_family = AF_UNSPEC;
 
@@ -119,25 +121,30 @@ TransportSelector::~TransportSelector()
    delete mSigcompStack;
 #endif
 
-   for(HashMap<Data, Socket>::iterator socketIterator = mSockets.begin();
-       socketIterator != mSockets.end(); socketIterator++)
+   for(std::vector<Shard*>::iterator shard = mShards.begin(); shard != mShards.end(); ++shard)
    {
-      if (socketIterator->second != INVALID_SOCKET)
+      for(HashMap<Data, Socket>::iterator socketIterator = (*shard)->mSockets.begin();
+          socketIterator != (*shard)->mSockets.end(); socketIterator++)
       {
-         closeSocket(socketIterator->second);
-         DebugLog(<< "Closing TransportSelector::mSocket[" << socketIterator->first << "]");
+         if (socketIterator->second != INVALID_SOCKET)
+         {
+            closeSocket(socketIterator->second);
+            DebugLog(<< "Closing TransportSelector::mSocket[" << socketIterator->first << "]");
+         }
       }
-   }
 
-   for(HashMap<Data, Socket>::iterator socketIterator = mSocket6s.begin();
-       socketIterator != mSocket6s.end(); socketIterator++)
-   {
-      if (socketIterator->second != INVALID_SOCKET)
+      for(HashMap<Data, Socket>::iterator socketIterator = (*shard)->mSocket6s.begin();
+          socketIterator != (*shard)->mSocket6s.end(); socketIterator++)
       {
-         closeSocket(socketIterator->second);
-         DebugLog(<< "Closing TransportSelector::mSocket6[" << socketIterator->first << "]");
+         if (socketIterator->second != INVALID_SOCKET)
+         {
+            closeSocket(socketIterator->second);
+            DebugLog(<< "Closing TransportSelector::mSocket6[" << socketIterator->first << "]");
+         }
       }
+      delete *shard;
    }
+   mShards.clear();
 
    setPollGrp(0);
 }
@@ -145,6 +152,7 @@ TransportSelector::~TransportSelector()
 void
 TransportSelector::shutdown()
 {
+   Lock lock(mShards[0]->mMutex);
    for(TransportKeyMap::iterator it = mTransports.begin(); it != mTransports.end(); it++)
    {
        it->second->shutdown();
@@ -154,6 +162,7 @@ TransportSelector::shutdown()
 bool
 TransportSelector::isFinished() const
 {
+   Lock lock(mShards[0]->mMutex);
    for(TransportKeyMap::const_iterator it = mTransports.begin(); it != mTransports.end(); it++)
    {
       if (!it->second->isFinished())
@@ -164,9 +173,37 @@ TransportSelector::isFinished() const
    return true;
 }
 
+void
+TransportSelector::setNumShards(unsigned int count)
+{
+   resip_assert(count > 0);
+   while(mShards.size() < count)
+   {
+      mShards.push_back(new Shard);
+   }
+}
+
+TransportSelector::AllShardsLock::AllShardsLock(const std::vector<Shard*>& shards) :
+   mShards(shards)
+{
+   for(std::vector<Shard*>::const_iterator i = mShards.begin(); i != mShards.end(); ++i)
+   {
+      (*i)->mMutex.lock();
+   }
+}
+
+TransportSelector::AllShardsLock::~AllShardsLock()
+{
+   for(std::vector<Shard*>::const_reverse_iterator i = mShards.rbegin(); i != mShards.rend(); ++i)
+   {
+      (*i)->mMutex.unlock();
+   }
+}
+
 void
 TransportSelector::addTransport(std::auto_ptr<Transport> autoTransport, bool isStackRunning)
 {
+   AllShardsLock lock(mShards);
    Transport* transport = autoTransport.release();
 
    // !bwc! This is a multimap from TransportType/IpVersion to Transport*.
@@ -216,26 +253,20 @@ TransportSelector::addTransport(std::auto_ptr<Transport> autoTransport, bool isS
 
    if(!isSecure(transport->transport()))
    {
-      if(mExactTransports.find(tuple) == mExactTransports.end() &&
-         mAnyInterfaceTransports.find(tuple) == mAnyInterfaceTransports.end())
+      ExactTupleMap::const_iterator exact = mExactTransports.find(tuple);
+      AnyInterfaceTupleMap::const_iterator anyIf = mAnyInterfaceTransports.find(tuple);
+      if(exact == mExactTransports.end() && anyIf == mAnyInterfaceTransports.end())
       {
          DebugLog (<< "Adding transport: " << tuple);
-
-         // Store the transport in the ANY interface maps if the tuple specifies ANY
-         // interface. Store the transport in the specific interface maps if the tuple
-         // specifies an interface. See TransportSelector::findTransport.
-         if (transport->interfaceName().empty() ||
-             transport->getTuple().isAnyInterface() ||
-             transport->hasSpecificContact() )
-         {
-            mAnyInterfaceTransports[tuple] = transport;
-            mAnyPortAnyInterfaceTransports[tuple] = transport;
-         }
-         else
-         {
-            mExactTransports[tuple] = transport;
-            mAnyPortTransports[tuple] = transport;
-         }
+         addNonSecureTransportLookup(tuple, transport);
+      }
+      else if((exact != mExactTransports.end() && transport->isReusePortShardOf(*exact->second)) ||
+              (anyIf != mAnyInterfaceTransports.end() && transport->isReusePortShardOf(*anyIf->second)))
+      {
+         // Additional REUSEPORT shard - it receives on its own socket and responses
+         // go out through it by transport key, but requests are still sent from the
+         // shard already in the lookup maps.
+         DebugLog (<< "Adding transport shard: " << tuple);
       }
       else
       {
@@ -297,6 +328,7 @@ TransportSelector::addTransport(std::auto_ptr<Transport> autoTransport, bool isS
 void
 TransportSelector::removeTransport(unsigned int transportKey)
 {
+   AllShardsLock lock(mShards);
    Transport* transportToRemove = 0;
 
    // Find transport in global map and remove it
@@ -315,11 +347,7 @@ TransportSelector::removeTransport(unsigned int transportKey)
 
       if(!isSecure(transportToRemove->transport()))
       {
-         // Ensure transport is removed from all containers
-         mAnyInterfaceTransports.erase(transportToRemove->getTuple());
-         mAnyPortAnyInterfaceTransports.erase(transportToRemove->getTuple());
-         mExactTransports.erase(transportToRemove->getTuple());
-         mAnyPortTransports.erase(transportToRemove->getTuple());
+         removeNonSecureTransportLookup(transportToRemove);
       }
       else
       {
@@ -329,7 +357,17 @@ TransportSelector::removeTransport(unsigned int transportKey)
          mTlsTransports.erase(tlsKey);
       }
 
-      mTypeToTransportMap.erase(transportToRemove->getTuple());
+      // Only erase this transport's entry - the map holds every transport of the same type
+      std::pair<TypeToTransportMap::iterator, TypeToTransportMap::iterator> range =
+         mTypeToTransportMap.equal_range(transportToRemove->getTuple());
+      for(TypeToTransportMap::iterator it = range.first; it != range.second; ++it)
+      {
+         if(it->second == transportToRemove)
+         {
+            mTypeToTransportMap.erase(it);
+            break;
+         }
+      }
 
       // Remove transport types from Dns list of supported protocols
       mDns.removeTransportType(transportToRemove->transport(), transportToRemove->ipVersion());
@@ -358,6 +396,69 @@ TransportSelector::removeTransport(unsigned int transportKey)
    }
 }
 
+void
+TransportSelector::addNonSecureTransportLookup(const Tuple& tuple, Transport* transport)
+{
+   // Store the transport in the ANY interface maps if the tuple specifies ANY
+   // interface. Store the transport in the specific interface maps if the tuple
+   // specifies an interface. See TransportSelector::findTransport.
+   if (transport->interfaceName().empty() ||
+       transport->getTuple().isAnyInterface() ||
+       transport->hasSpecificContact() )
+   {
+      mAnyInterfaceTransports[tuple] = transport;
+      mAnyPortAnyInterfaceTransports[tuple] = transport;
+   }
+   else
+   {
+      mExactTransports[tuple] = transport;
+      mAnyPortTransports[tuple] = transport;
+   }
+}
+
+template<class TupleMap>
+static bool
+eraseTransportEntry(TupleMap& tupleMap, const Tuple& tuple, Transport* transport)
+{
+   typename TupleMap::iterator it = tupleMap.find(tuple);
+   if(it != tupleMap.end() && it->second == transport)
+   {
+      tupleMap.erase(it);
+      return true;
+   }
+   return false;
+}
+
+void
+TransportSelector::removeNonSecureTransportLookup(Transport* transport)
+{
+   // Ensure transport is removed from all containers, leaving entries that
+   // belong to other transports alone
+   const Tuple& tuple = transport->getTuple();
+   bool wasLookedUp = eraseTransportEntry(mAnyInterfaceTransports, tuple, transport);
+   wasLookedUp |= eraseTransportEntry(mAnyPortAnyInterfaceTransports, tuple, transport);
+   wasLookedUp |= eraseTransportEntry(mExactTransports, tuple, transport);
+   wasLookedUp |= eraseTransportEntry(mAnyPortTransports, tuple, transport);
+
+   if(!wasLookedUp)
+   {
+      return;
+   }
+
+   // If this was the sending shard of a REUSEPORT group, promote a remaining shard
+   std::pair<TypeToTransportMap::iterator, TypeToTransportMap::iterator> range =
+      mTypeToTransportMap.equal_range(tuple);
+   for(TypeToTransportMap::iterator it = range.first; it != range.second; ++it)
+   {
+      if(it->second != transport && it->second->isReusePortShardOf(*transport))
+      {
+         DebugLog (<< "Promoting transport shard: " << it->first);
+         addNonSecureTransportLookup(it->first, it->second);
+         return;
+      }
+   }
+}
+
 void
 TransportSelector::setPollGrp(FdPollGrp *grp)
 {
@@ -484,8 +585,9 @@ TransportSelector::checkTransportAddRemoveQueue()
 }
 
 void 
-TransportSelector::poke()
+TransportSelector::poke(unsigned int shard)
 {
+   Lock lock(mShards[shard]->mMutex);
    for(TransportList::iterator it = mHasOwnProcessTransports.begin(); it != mHasOwnProcessTransports.end(); it++)
    {
       try
@@ -529,8 +631,10 @@ TransportSelector::createDnsResult(DnsHandler* handler)
 
 void
 TransportSelector::dnsResolve(DnsResult* result,
-                              SipMessage* msg)
+                              SipMessage* msg,
+                              unsigned int shard)
 {
+   Lock lock(mShards[shard]->mMutex);
    // Picking the target destination:
    //   - for request, use forced target if set
    //     otherwise use loose routing behaviour (route or, if none, request-uri)
@@ -709,7 +813,7 @@ TransportSelector::findTransportByVia(SipMessage* msg, const Tuple& target, Tupl
 }
 
 Tuple
-TransportSelector::determineSourceInterface(SipMessage* msg, const Tuple& target) const
+TransportSelector::determineSourceInterface(SipMessage* msg, const Tuple& target, unsigned int shard) const
 {
    resip_assert(msg->exists(h_Vias));
    resip_assert(!msg->header(h_Vias).empty());
@@ -743,31 +847,33 @@ TransportSelector::determineSourceInterface(SipMessage* msg, const Tuple& target
       // send a packet to the target by making a connect call on a udp socket.
       Socket tmp = INVALID_SOCKET;
       Data netNs = target.getNetNs();
+      HashMap<Data, Socket>& sockets = mShards[shard]->mSockets;
+      HashMap<Data, Socket>& socket6s = mShards[shard]->mSocket6s;
       // One IPV4 and IPV6 socket per namespace.  Even if we do not support netns,
       // we still have the default namespace of "" (empty string).
       if (target.isV4())
       {
          // If socket does not exist for namespace, create one
-         if (mSockets.find(netNs) == mSockets.end() || mSockets[netNs] == INVALID_SOCKET)
+         if (sockets.find(netNs) == sockets.end() || sockets[netNs] == INVALID_SOCKET)
          {
 #ifdef USE_NETNS
             NetNs::setNs(netNs);
 #endif
-            mSockets[netNs] = InternalTransport::socket(UDP, V4); // may throw
+            sockets[netNs] = InternalTransport::socket(UDP, V4); // may throw
          }
-         tmp = mSockets[netNs];
+         tmp = sockets[netNs];
       }
       else
       {
          // If socket does not exist for namespace, create one
-         if (mSocket6s.find(netNs) == mSocket6s.end() || mSocket6s[netNs] == INVALID_SOCKET)
+         if (socket6s.find(netNs) == socket6s.end() || socket6s[netNs] == INVALID_SOCKET)
          {
 #ifdef USE_NETNS
             NetNs::setNs(netNs);
 #endif
-            mSocket6s[netNs] = InternalTransport::socket(UDP, V6); // may throw
+            socket6s[netNs] = InternalTransport::socket(UDP, V6); // may throw
          }
-         tmp = mSocket6s[netNs];
+         tmp = socket6s[netNs];
       }
 
 #ifdef USE_NETNS
@@ -820,14 +926,14 @@ TransportSelector::determineSourceInterface(SipMessage* msg, const Tuple& target
       // fails. I'm not sure the stack can recover from this error condition.
       if (target.isV4())
       {
-         ret = connect(mSockets[netNs],
+         ret = connect(sockets[netNs],
                        (struct sockaddr*)&mUnspecified.v4Address,
                        sizeof(mUnspecified.v4Address));
       }
 #ifdef USE_IPV6
       else
       {
-         ret = connect(mSocket6s[netNs],
+         ret = connect(socket6s[netNs],
                        (struct sockaddr*)&mUnspecified6.v6Address,
                        sizeof(mUnspecified6.v6Address));
       }
@@ -878,8 +984,10 @@ TransportSelector::determineSourceInterface(SipMessage* msg, const Tuple& target
 // !jf! there may be an extra copy of a tuple here. can probably get rid of it
 // but there are some const issues.
 TransportSelector::TransmitState
-TransportSelector::transmit(SipMessage* msg, Tuple& target, SendData* sendData)
+TransportSelector::transmit(SipMessage* msg, Tuple& target, SendData* sendData, unsigned int shard)
 {
+   Shard& state = *mShards[shard];
+   Lock lock(state.mMutex);
    resip_assert(msg);
 
    if(msg->mIsDecorated)
@@ -955,7 +1063,7 @@ TransportSelector::transmit(SipMessage* msg, Tuple& target, SendData* sendData)
             //look a little closer.
             if(source.isAnyInterface())
             {
-               Tuple temp = determineSourceInterface(msg,target);
+               Tuple temp = determineSourceInterface(msg, target, shard);
 
                // .bwc. determineSourceInterface() can give us a port, if the TU
                // put one in the topmost Via.
@@ -975,7 +1083,7 @@ TransportSelector::transmit(SipMessage* msg, Tuple& target, SendData* sendData)
          // .bwc. Here we use source to find transport.
          else
          {
-            source = determineSourceInterface(msg, target);
+            source = determineSourceInterface(msg, target, shard);
             transport = findTransportBySource(source, msg);
             DebugLog(<< "Found transport: " << source);
 
@@ -1077,7 +1185,7 @@ TransportSelector::transmit(SipMessage* msg, Tuple& target, SendData* sendData)
             if(source.isAnyInterface())
             {
                Tuple temp = source;
-               source = determineSourceInterface(msg,target);
+               source = determineSourceInterface(msg, target, shard);
                resip_assert(source.ipVersion()==temp.ipVersion() &&
                         source.getType()==temp.getType());
 
@@ -1270,7 +1378,7 @@ TransportSelector::transmit(SipMessage* msg, Tuple& target, SendData* sendData)
                                                    msg->getTransactionId(),
                                                    remoteSigcompId));
 
-         send->data.reserve(mAvgBufferSize + mAvgBufferSize/4);
+         send->data.reserve(state.mAvgBufferSize + state.mAvgBufferSize/4);
 
          DataStream str(send->data);
          msg->encode(str);
@@ -1279,7 +1387,7 @@ TransportSelector::transmit(SipMessage* msg, Tuple& target, SendData* sendData)
          // !bwc! Moving average of message size. (Used to intelligently
          // predict how much space to reserve in the buffer, to minimize
          // dynamic resizing.)
-         mAvgBufferSize = (255*mAvgBufferSize + send->data.size()+128)/256;
+         state.mAvgBufferSize = (255*state.mAvgBufferSize + send->data.size()+128)/256;
 
          resip_assert(!send->data.empty());
          DebugLog (<< "Transmitting to " << target
@@ -1312,8 +1420,9 @@ TransportSelector::transmit(SipMessage* msg, Tuple& target, SendData* sendData)
 }
 
 void
-TransportSelector::retransmit(const SendData& data)
+TransportSelector::retransmit(const SendData& data, unsigned int shard)
 {
+   Lock lock(mShards[shard]->mMutex);
    resip_assert(data.destination.mTransportKey);
    Transport* transport = findTransportByDest(data.destination);
 
@@ -1354,8 +1463,9 @@ TransportSelector::retransmit(const SendData& data)
 }
 
 void 
-TransportSelector::closeConnection(const Tuple& peer)
+TransportSelector::closeConnection(const Tuple& peer, unsigned int shard)
 {
+   Lock lock(mShards[shard]->mMutex);
    Transport* t = findTransportByDest(peer);
    if(t)
    {
@@ -1371,6 +1481,7 @@ TransportSelector::closeConnection(const Tuple& peer)
 unsigned int
 TransportSelector::sumTransportFifoSizes() const
 {
+   Lock lock(mShards[0]->mMutex);
    unsigned int sum = 0;
    for(TransportKeyMap::const_iterator it = mTransports.begin(); it != mTransports.end(); it++)
    {
@@ -1380,14 +1491,15 @@ TransportSelector::sumTransportFifoSizes() const
 }
 
 void 
-TransportSelector::terminateFlow(const resip::Tuple& flow)
+TransportSelector::terminateFlow(const resip::Tuple& flow, unsigned int shard)
 {
-   closeConnection(flow);
+   closeConnection(flow, shard);
 }
 
 void 
-TransportSelector::enableFlowTimer(const resip::Tuple& flow)
+TransportSelector::enableFlowTimer(const resip::Tuple& flow, unsigned int shard)
 {
+   Lock lock(mShards[shard]->mMutex);
    Transport* t = findTransportByDest(flow);
    if(t)
    {
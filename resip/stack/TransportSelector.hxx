@@ -11,6 +11,7 @@
 
 #include "rutil/Data.hxx"
 #include "rutil/Fifo.hxx"
+#include "rutil/Mutex.hxx"
 #include "rutil/GenericIPAddress.hxx"
 #include "resip/stack/Transport.hxx"
 #include "resip/stack/DnsInterface.hxx"
@@ -94,7 +95,14 @@ class TransportSelector
 
       /// Causes transport process loops to be interrupted if there is stuff in
       /// their transmit fifos.
-      void poke();
+      void poke(unsigned int shard=0);
+
+      /// Sets the number of TransactionController shards that send through
+      /// this TransportSelector. Each gets its own copy of the state used on
+      /// the send path, so that shards only contend with each other while a
+      /// transport is added or removed. The {shard} arguments below say
+      /// which copy the caller uses. Call before the stack runs.
+      void setNumShards(unsigned int count);
 
       /// Add/Remove a transport
       void addTransport(std::auto_ptr<Transport> transport, bool isStackRunning);
@@ -102,7 +110,7 @@ class TransportSelector
 
       /// DNS Resolution
       DnsResult* createDnsResult(DnsHandler* handler);
-      void dnsResolve(DnsResult* result, SipMessage* msg);
+      void dnsResolve(DnsResult* result, SipMessage* msg, unsigned int shard=0);
 
       /**
        transmit results in msg->resolve() being called to either
@@ -114,12 +122,12 @@ class TransportSelector
          Unsent,
          Sent
       } TransmitState;
-      TransmitState transmit( SipMessage* msg, Tuple& target, SendData* sendData=0 );
+      TransmitState transmit( SipMessage* msg, Tuple& target, SendData* sendData=0, unsigned int shard=0 );
 
       /// Resend to the same transport as last time
-      void retransmit(const SendData& msg);
+      void retransmit(const SendData& msg, unsigned int shard=0);
 
-      void closeConnection(const Tuple& peer);
+      void closeConnection(const Tuple& peer, unsigned int shard=0);
 
       unsigned int sumTransportFifoSizes() const;
 
@@ -131,8 +139,8 @@ class TransportSelector
       void setEnumSuffixes(const std::vector<Data>& suffixes);
 
       static Tuple getFirstInterface(bool is_v4, TransportType type);
-      void terminateFlow(const resip::Tuple& flow);
-      void enableFlowTimer(const resip::Tuple& flow);
+      void terminateFlow(const resip::Tuple& flow, unsigned int shard=0);
+      void enableFlowTimer(const resip::Tuple& flow, unsigned int shard=0);
 
       bool setUdpOnlyOnNumeric(bool value)
       {
@@ -193,13 +201,15 @@ class TransportSelector
 
    private:
       void checkTransportAddRemoveQueue();
+      void addNonSecureTransportLookup(const Tuple& tuple, Transport* transport);
+      void removeNonSecureTransportLookup(Transport* transport);
       Connection* findConnection(const Tuple& dest) const;
       Transport* findTransportBySource(Tuple& src, const SipMessage* msg) const;
       Transport* findLoopbackTransportBySource(bool ignorePort, Tuple& src) const;
       Transport* findTransportByDest(const Tuple& dest);
       Transport* findTransportByVia(SipMessage* msg, const Tuple& dest, Tuple& src) const;
       Transport* findTlsTransport(const Data& domain,TransportType type,IpVersion ipv) const;
-      Tuple determineSourceInterface(SipMessage* msg, const Tuple& dest) const;
+      Tuple determineSourceInterface(SipMessage* msg, const Tuple& dest, unsigned int shard) const;
 
       DnsInterface mDns;
       Fifo<TransactionMessage>& mStateMacFifo;
@@ -234,10 +244,6 @@ class TransportSelector
       typedef std::multimap<Tuple, Transport*, Tuple::AnyPortAnyInterfaceCompare> TypeToTransportMap;
       TypeToTransportMap mTypeToTransportMap;
 
-      // fake socket(s) one for each netns, for connect() and route table lookups
-      mutable HashMap<Data, Socket> mSockets;
-      mutable HashMap<Data, Socket> mSocket6s;
-
       // An AF_UNSPEC addr_in for rapid unconnect
       GenericIPAddress mUnspecified;
       GenericIPAddress mUnspecified6;
@@ -249,11 +255,36 @@ class TransportSelector
       // epoll support, for sharedprocess transports
       FdPollGrp* mPollGrp;
 
-      int mAvgBufferSize;
       Fifo<Transport> mTransportsToAddRemove;
       std::auto_ptr<SelectInterruptor> mSelectInterruptor;
       FdPollItemHandle mInterruptorHandle;
 
+      // What each TransactionController shard uses on the send path. A
+      // shard's calls lock only its own mMutex; add/removeTransport() lock
+      // all of them (in order), since they change the transport maps that
+      // every shard reads.
+      class Shard
+      {
+         public:
+            Shard() : mAvgBufferSize(1024) {}
+
+            Mutex mMutex;
+            // fake socket(s) one for each netns, for connect() and route table lookups
+            HashMap<Data, Socket> mSockets;
+            HashMap<Data, Socket> mSocket6s;
+            int mAvgBufferSize;
+      };
+      std::vector<Shard*> mShards;
+
+      class AllShardsLock
+      {
+         public:
+            AllShardsLock(const std::vector<Shard*>& shards);
+            ~AllShardsLock();
+         private:
+            const std::vector<Shard*>& mShards;
+      };
+
       friend class TestTransportSelector;
       friend class SipStack; // for debug only
 };
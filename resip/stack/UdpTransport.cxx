@@ -44,6 +44,11 @@ UdpTransport::UdpTransport(Fifo<TransactionMessage>& fifo,
    mPollEventCnt = 0;
    mTxTryCnt = mTxMsgCnt = mTxFailCnt = 0;
    mRxTryCnt = mRxMsgCnt = mRxKeepaliveCnt = mRxTransactionCnt = 0;
+   mRxBatchCnt = mRxBatchMsgCnt = mTxBatchCnt = mTxBatchMsgCnt = 0;
+   for (int i = 0; i < MaxBatchSize; ++i)
+   {
+      mRxBatchBuffers[i] = 0;
+   }
    mTuple.setType(UDP);
    mFd = InternalTransport::socket(transport(), version);
    mTuple.mFlowKey=(FlowKey)mFd;
@@ -83,6 +88,8 @@ UdpTransport::~UdpTransport()
            <<" rxmsg="<<mRxMsgCnt
            <<" rxka="<<mRxKeepaliveCnt
            <<" rxtr="<<mRxTransactionCnt
+           <<" rxbatch="<<mRxBatchCnt<<"/"<<mRxBatchMsgCnt
+           <<" txbatch="<<mTxBatchCnt<<"/"<<mTxBatchMsgCnt
            );
 #ifdef USE_SIGCOMP
    delete mSigcompStack;
@@ -91,6 +98,10 @@ UdpTransport::~UdpTransport()
    {
       delete[] mRxBuffer;
    }
+   for (int i = 0; i < MaxBatchSize; ++i)
+   {
+      delete[] mRxBatchBuffers[i];
+   }
    setPollGrp(0);
 }
 
@@ -225,6 +236,16 @@ UdpTransport::processTxAll()
 {
    SendData *msg;
    ++mTxTryCnt;
+#if defined(HAVE_SENDMMSG)
+   if ( (mTransportFlags & RESIP_TRANSPORT_FLAG_TXBATCH)!=0 )
+   {
+      while ( processTxBatch() == MaxBatchSize
+              && (mTransportFlags & RESIP_TRANSPORT_FLAG_TXALL)!=0 )
+      {
+      }
+      return;
+   }
+#endif
    while ( (msg=mTxFifoOutBuffer.getNext(RESIP_FIFO_NOWAIT)) != NULL )
    {
       processTxOne(msg);
@@ -307,6 +328,97 @@ UdpTransport::processTxOne(SendData *data)
    }
 }
 
+/**
+ * Pull up to MaxBatchSize messages from the transmit queue and hand all
+ * of them to the kernel with a single sendmmsg() call. SendData commands
+ * and messages that need SigComp compression are sent through
+ * processTxOne() instead.
+ * Returns the number of messages taken from the transmit queue.
+ */
+int
+UdpTransport::processTxBatch()
+{
+#if defined(HAVE_SENDMMSG)
+   struct mmsghdr msgs[MaxBatchSize];
+   struct iovec iovs[MaxBatchSize];
+   SendData* batch[MaxBatchSize];
+   int dequeued = 0;
+   int count = 0;
+   SendData* data;
+
+   while ( dequeued < MaxBatchSize
+           && (data=mTxFifoOutBuffer.getNext(RESIP_FIFO_NOWAIT)) != NULL )
+   {
+      ++dequeued;
+      if ( data->command != SendData::NoCommand
+#ifdef USE_SIGCOMP
+           || (mSigcompStack &&
+               data->sigcompId.size() > 0 &&
+               !data->isAlreadyCompressed)
+#endif
+         )
+      {
+         processTxOne(data);
+         continue;
+      }
+      resip_assert( data->destination.getPort() != 0 );
+
+      iovs[count].iov_base = const_cast<char*>(data->data.data());
+      iovs[count].iov_len = data->data.size();
+      memset(&msgs[count], 0, sizeof(msgs[count]));
+      msgs[count].msg_hdr.msg_name = const_cast<sockaddr*>(&data->destination.getSockaddr());
+      msgs[count].msg_hdr.msg_namelen = data->destination.length();
+      msgs[count].msg_hdr.msg_iov = &iovs[count];
+      msgs[count].msg_hdr.msg_iovlen = 1;
+      batch[count++] = data;
+   }
+
+   if ( count == 0 )
+   {
+      return dequeued;
+   }
+
+   ++mTxBatchCnt;
+   mTxBatchMsgCnt += count;
+   mTxMsgCnt += count;
+
+   int sent = 0;
+   while ( sent < count )
+   {
+      int n = sendmmsg(mFd, &msgs[sent], count - sent, 0);
+      if ( n <= 0 )
+      {
+         // The first remaining message could not be sent; fail it and
+         // carry on with the rest of the batch.
+         int e = getErrno();
+         error(e);
+         InfoLog (<< "Failed (" << e << ") sending to " << batch[sent]->destination);
+         fail(batch[sent]->transactionId);
+         ++mTxFailCnt;
+         ++sent;
+         continue;
+      }
+      for (int i = sent; i < sent + n; ++i)
+      {
+         if ( msgs[i].msg_len != iovs[i].iov_len )
+         {
+            ErrLog (<< "UDPTransport - send buffer full" );
+            fail(batch[i]->transactionId);
+         }
+      }
+      sent += n;
+   }
+
+   for (int i = 0; i < count; ++i)
+   {
+      delete batch[i];
+   }
+   return dequeued;
+#else
+   return 0;
+#endif
+}
+
 /**
  * Add options RXALL (to try receive all readable data) and KEEP_BUFFER.
  * While each can be specified independently, generally should do both
@@ -318,9 +430,19 @@ UdpTransport::processTxOne(SendData *data)
 void
 UdpTransport::processRxAll()
 {
+   ++mRxTryCnt;
+#if defined(HAVE_RECVMMSG)
+   if ( (mTransportFlags & RESIP_TRANSPORT_FLAG_RXBATCH) != 0 )
+   {
+      while ( processRxBatch() == MaxBatchSize
+              && (mTransportFlags & RESIP_TRANSPORT_FLAG_RXALL) != 0 )
+      {
+      }
+      return;
+   }
+#endif
    char *buffer = mRxBuffer;
    mRxBuffer = NULL;
-   ++mRxTryCnt;
    for (;;)
    {
       // TBD: check StateMac capacity
@@ -406,6 +528,82 @@ UdpTransport::processRxRecv(char*& buffer, Tuple& sender)
 }
 
 
+/**
+ * Receive up to MaxBatchSize datagrams with a single recvmmsg() call
+ * into mRxBatchBuffers, and parse each of them. Buffers absorbed into a
+ * SipMessage are replaced on the next call; the rest are reused.
+ * Return number of datagrams read:
+ *  0 if no data read (EAGAIN or error)
+ *  MaxBatchSize if the batch was filled and there may be more to read
+**/
+int
+UdpTransport::processRxBatch()
+{
+#if defined(HAVE_RECVMMSG)
+   struct mmsghdr msgs[MaxBatchSize];
+   struct iovec iovs[MaxBatchSize];
+   struct sockaddr_storage addrs[MaxBatchSize];
+
+   for (int i = 0; i < MaxBatchSize; ++i)
+   {
+      if ( mRxBatchBuffers[i] == NULL )
+      {
+         mRxBatchBuffers[i] = MsgHeaderScanner::allocateBuffer(MaxBufferSize);
+      }
+      iovs[i].iov_base = mRxBatchBuffers[i];
+      iovs[i].iov_len = MaxBufferSize;
+      memset(&msgs[i], 0, sizeof(msgs[i]));
+      msgs[i].msg_hdr.msg_name = &addrs[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+   }
+
+   int count = recvmmsg(mFd, msgs, MaxBatchSize, 0, 0);
+   if ( count == SOCKET_ERROR )
+   {
+      int err = getErrno();
+      if ( err != EAGAIN && err != EWOULDBLOCK )
+      {
+         error( err );
+      }
+      return 0;
+   }
+   ++mRxBatchCnt;
+   mRxBatchMsgCnt += count;
+
+   for (int i = 0; i < count; ++i)
+   {
+      int len = (int)msgs[i].msg_len;
+      if ( len <= 0 )
+      {
+         continue;
+      }
+      // same len-1 trick as processRxRecv() to detect truncation
+      if ( len+1 >= MaxBufferSize )
+      {
+         InfoLog(<<"Datagram exceeded max length "<<MaxBufferSize);
+         continue;
+      }
+      ++mRxMsgCnt;
+      Tuple sender(mTuple);
+      socklen_t slen = sender.length();
+      if ( msgs[i].msg_hdr.msg_namelen < slen )
+      {
+         slen = msgs[i].msg_hdr.msg_namelen;
+      }
+      memcpy(&sender.getMutableSockaddr(), &addrs[i], slen);
+      if ( processRxParse(mRxBatchBuffers[i], len, sender) )
+      {
+         mRxBatchBuffers[i] = NULL;
+      }
+   }
+   return count;
+#else
+   return 0;
+#endif
+}
+
 /**
  * Parse the contents of {buffer} and do something with it.
  * Return true iff {buffer} was consumed (absorbed into SipMessage
@@ -81,6 +81,9 @@ public:
    virtual void processPollEvent(FdPollEventMask mask);
 
    static const int MaxBufferSize = 8192;
+   /// Maximum number of datagrams moved per system call when the
+   /// RXBATCH or TXBATCH transport flags are set.
+   static const int MaxBatchSize = 16;
 
    // STUN client functionality
    bool stunSendTest(const Tuple& dest);
@@ -93,9 +96,11 @@ protected:
 
    void processRxAll();
    int processRxRecv(char*& buffer, Tuple& sender);
+   int processRxBatch();
    bool processRxParse(char *buffer, int len, Tuple& sender);
    void processTxAll();
    void processTxOne(SendData *data);
+   int processTxBatch();
    void updateEvents();
 
    osc::Stack *mSigcompStack;
@@ -109,8 +114,13 @@ protected:
    unsigned mRxMsgCnt;
    unsigned mRxKeepaliveCnt;
    unsigned mRxTransactionCnt;
+   unsigned mRxBatchCnt;      // recvmmsg calls that returned data
+   unsigned mRxBatchMsgCnt;   // datagrams received by those calls
+   unsigned mTxBatchCnt;      // sendmmsg calls
+   unsigned mTxBatchMsgCnt;   // datagrams handed to those calls
 private:
    char* mRxBuffer;
+   char* mRxBatchBuffers[MaxBatchSize];
    MsgHeaderScanner mMsgHeaderScanner;
    mutable resip::Mutex  myMutex;
    Tuple mStunMappedAddress;
@@ -84,9 +84,10 @@ DtlsTransport::DtlsTransport(Fifo<TransactionMessage>& fifo,
                              Compression& compression,
                              const Data& certificateFilename, 
                              const Data& privateKeyFilename,
-                             const Data& privateKeyPassPhrase)
+                             const Data& privateKeyPassPhrase,
+                             bool useTimerWheel)
  : UdpTransport( fifo, portNum, version, StunDisabled, interfaceObj, socketFunc, compression ),
-   mTimer( mHandshakePending ),
+   mTimer( mHandshakePending, useTimerWheel ),
    mSecurity( &security ),
    mDomain(sipDomain)
 {
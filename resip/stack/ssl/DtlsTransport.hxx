@@ -127,7 +127,8 @@ class DtlsTransport : public UdpTransport
                     Compression &compression = Compression::Disabled,
                     const Data& certificateFilename = "", 
                     const Data& privateKeyFilename = "",
-                    const Data& privateKeyPassPhrase = "");
+                    const Data& privateKeyPassPhrase = "",
+                    bool useTimerWheel = false);
       virtual  ~DtlsTransport();
 
       void process(FdSet& fdset);
@@ -20,7 +20,9 @@
 #include "rutil/ResipAssert.h"
 #include "rutil/BaseException.hxx"
 #include "rutil/DataStream.hxx"
+#include "rutil/Lock.hxx"
 #include "rutil/Logger.hxx"
+#include "rutil/Mutex.hxx"
 #include "rutil/Random.hxx"
 #include "rutil/Socket.hxx"
 #include "rutil/Timer.hxx"
@@ -54,6 +56,12 @@
 #include <openssl/x509.h>
 #include <openssl/x509v3.h>
 #include <openssl/ssl.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+#endif
 
 using namespace resip;
 using namespace std;
@@ -145,6 +153,10 @@ BaseSecurity::CipherList BaseSecurity::StrongestSuite("HIGH:-COMPLEMENTOFDEFAULT
 long BaseSecurity::OpenSSLCTXSetOptions = SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3;
 long BaseSecurity::OpenSSLCTXClearOptions = 0;
 
+unsigned long BaseSecurity::TlsSessionCacheSize = SSL_SESSION_CACHE_MAX_SIZE_DEFAULT;
+long BaseSecurity::TlsSessionTimeoutSeconds = 3600;
+long BaseSecurity::TlsTicketKeyLifetimeSeconds = 3600;
+
 Security::Security(const CipherList& cipherSuite, const Data& defaultPrivateKeyPassPhrase, const Data& dHParamsFilename) :
    BaseSecurity(cipherSuite, defaultPrivateKeyPassPhrase, dHParamsFilename)
 {
@@ -435,6 +447,7 @@ Security::createDomainCtx(const SSL_METHOD* method, const Data& domain, const Da
    setDHParams(ctx);
    SSL_CTX_set_options(ctx, BaseSecurity::OpenSSLCTXSetOptions);
    SSL_CTX_clear_options(ctx, BaseSecurity::OpenSSLCTXClearOptions);
+   setSessionCaching(ctx, domain);
 
    return ctx;
 }
@@ -1159,6 +1172,7 @@ BaseSecurity::BaseSecurity (const CipherList& cipherSuite, const Data& defaultPr
    setDHParams(mTlsCtx);
    SSL_CTX_set_options(mTlsCtx, BaseSecurity::OpenSSLCTXSetOptions);
    SSL_CTX_clear_options(mTlsCtx, BaseSecurity::OpenSSLCTXClearOptions);
+   setSessionCaching(mTlsCtx, "TLSv1");
    
    mSslCtx = SSL_CTX_new( SSLv23_method() );
    resip_assert(mSslCtx);
@@ -1170,6 +1184,7 @@ BaseSecurity::BaseSecurity (const CipherList& cipherSuite, const Data& defaultPr
    setDHParams(mSslCtx);
    SSL_CTX_set_options(mSslCtx, BaseSecurity::OpenSSLCTXSetOptions);
    SSL_CTX_clear_options(mSslCtx, BaseSecurity::OpenSSLCTXClearOptions);
+   setSessionCaching(mSslCtx, "SSLv23");
 }
 
 
@@ -3095,6 +3110,168 @@ BaseSecurity::setDHParams(SSL_CTX* ctx)
    }
 }
 
+
+#if defined(SSL_CTRL_SET_TLSEXT_TICKET_KEY_CB)
+
+// Session ticket keys shared by all contexts: [0] issues new tickets,
+// [1] (the previous key) is only accepted.  A context only resumes its own
+// sessions (see SSL_CTX_set_session_id_context), so sharing is safe.
+struct TicketKey
+{
+   unsigned char name[16];
+   unsigned char aesKey[16];
+   unsigned char hmacKey[32];
+   UInt64 createdMs;
+};
+
+static Mutex ticketKeyMutex;
+static TicketKey ticketKeys[2];
+static int numTicketKeys = 0;
+
+static bool
+rotateTicketKeys()
+{
+   UInt64 now = Timer::getTimeMs();
+   if(numTicketKeys > 0 &&
+      now - ticketKeys[0].createdMs < (UInt64)BaseSecurity::TlsTicketKeyLifetimeSeconds * 1000)
+   {
+      return true;
+   }
+   TicketKey key;
+   if(RAND_bytes(key.name, sizeof(key.name)) != 1 ||
+      RAND_bytes(key.aesKey, sizeof(key.aesKey)) != 1 ||
+      RAND_bytes(key.hmacKey, sizeof(key.hmacKey)) != 1)
+   {
+      ErrLog(<< "RAND_bytes failed, unable to create a session ticket key");
+      return numTicketKeys > 0;
+   }
+   key.createdMs = now;
+   ticketKeys[1] = ticketKeys[0];
+   ticketKeys[0] = key;
+   numTicketKeys = numTicketKeys == 0 ? 1 : 2;
+   DebugLog(<< "new session ticket key");
+   return true;
+}
+
+// Sets up {cipherCtx} for the ticket and points {hmacKey} at the key to
+// authenticate it with; returns what the ticket key callback should.
+// ticketKeyMutex must be held.
+static int
+selectTicketKey(unsigned char* keyName, unsigned char* iv,
+                EVP_CIPHER_CTX* cipherCtx, int encrypt, const unsigned char*& hmacKey)
+{
+   if(!rotateTicketKeys())
+   {
+      return encrypt ? -1 : 0;
+   }
+
+   if(encrypt)
+   {
+      const TicketKey& key = ticketKeys[0];
+      if(RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_128_cbc())) != 1)
+      {
+         return -1;
+      }
+      memcpy(keyName, key.name, sizeof(key.name));
+      EVP_EncryptInit_ex(cipherCtx, EVP_aes_128_cbc(), NULL, key.aesKey, iv);
+      hmacKey = key.hmacKey;
+      return 1;
+   }
+
+   for(int i = 0; i < numTicketKeys; ++i)
+   {
+      const TicketKey& key = ticketKeys[i];
+      if(memcmp(keyName, key.name, sizeof(key.name)) == 0)
+      {
+         EVP_DecryptInit_ex(cipherCtx, EVP_aes_128_cbc(), NULL, key.aesKey, iv);
+         hmacKey = key.hmacKey;
+         // 2 asks OpenSSL to issue a fresh ticket with the current key
+         return i == 0 ? 1 : 2;
+      }
+   }
+   // unknown or expired key: fall back to a full handshake
+   return 0;
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+// HMAC_CTX is deprecated in OpenSSL 3; the ticket HMAC is an EVP_MAC there.
+static int
+ticketKeyCallback(SSL* ssl, unsigned char* keyName, unsigned char* iv,
+                  EVP_CIPHER_CTX* cipherCtx, EVP_MAC_CTX* macCtx, int encrypt)
+{
+   Lock lock(ticketKeyMutex);
+   const unsigned char* hmacKey = 0;
+   int ret = selectTicketKey(keyName, iv, cipherCtx, encrypt, hmacKey);
+   if(ret > 0)
+   {
+      OSSL_PARAM params[3];
+      params[0] = OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY,
+                                                    (void*)hmacKey, sizeof(ticketKeys[0].hmacKey));
+      params[1] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, (char*)"SHA256", 0);
+      params[2] = OSSL_PARAM_construct_end();
+      if(EVP_MAC_CTX_set_params(macCtx, params) != 1)
+      {
+         return encrypt ? -1 : 0;
+      }
+   }
+   return ret;
+}
+#else
+static int
+ticketKeyCallback(SSL* ssl, unsigned char* keyName, unsigned char* iv,
+                  EVP_CIPHER_CTX* cipherCtx, HMAC_CTX* hmacCtx, int encrypt)
+{
+   Lock lock(ticketKeyMutex);
+   const unsigned char* hmacKey = 0;
+   int ret = selectTicketKey(keyName, iv, cipherCtx, encrypt, hmacKey);
+   if(ret > 0)
+   {
+      HMAC_Init_ex(hmacCtx, hmacKey, sizeof(ticketKeys[0].hmacKey), EVP_sha256(), NULL);
+   }
+   return ret;
+}
+#endif
+
+#endif
+
+void
+BaseSecurity::setSessionCaching(SSL_CTX* ctx, const Data& sessionIdContext)
+{
+   if(TlsSessionCacheSize == 0)
+   {
+      SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+      SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+      return;
+   }
+
+   // Client sessions are also handed to the new session callback so that
+   // TlsBaseTransport can offer them on the next connection to the peer.
+   SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_BOTH);
+   SSL_CTX_sess_set_cache_size(ctx, TlsSessionCacheSize);
+   SSL_CTX_set_timeout(ctx, TlsSessionTimeoutSeconds);
+
+   // Required to resume sessions when client certificates are requested;
+   // the md5 hex digest is exactly SSL_MAX_SID_CTX_LENGTH bytes.
+   Data context = sessionIdContext.md5();
+   SSL_CTX_set_session_id_context(ctx, (const unsigned char*)context.data(), (unsigned int)context.size());
+
+#if defined(SSL_CTRL_SET_TLSEXT_TICKET_KEY_CB)
+   if(TlsTicketKeyLifetimeSeconds > 0)
+   {
+      SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+      SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, ticketKeyCallback);
+#else
+      SSL_CTX_set_tlsext_ticket_key_cb(ctx, ticketKeyCallback);
+#endif
+   }
+   else
+#endif
+   {
+      SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+   }
+}
+
 #endif
 
 
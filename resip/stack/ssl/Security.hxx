@@ -90,6 +90,23 @@ class BaseSecurity
       static long OpenSSLCTXSetOptions;
       static long OpenSSLCTXClearOptions;
 
+      /**
+       * TLS session resumption, applied to each SSL_CTX as it is created.
+       *
+       * TlsSessionCacheSize is the number of sessions a server context
+       * keeps for resumption by session id (and bounds the sessions a
+       * TlsBaseTransport remembers as a client); 0 turns resumption off.
+       * Sessions expire after TlsSessionTimeoutSeconds.
+       *
+       * Servers also issue stateless session tickets.  The ticket keys are
+       * replaced every TlsTicketKeyLifetimeSeconds; tickets made with the
+       * previous key are still accepted (and renewed) for one more
+       * lifetime.  0 disables tickets.
+       */
+      static unsigned long TlsSessionCacheSize;
+      static long TlsSessionTimeoutSeconds;
+      static long TlsTicketKeyLifetimeSeconds;
+
       BaseSecurity(const CipherList& cipherSuite = StrongestSuite, const Data& defaultPrivateKeyPassPhrase = Data::Empty, const Data& dHParamsFilename = Data::Empty);
       virtual ~BaseSecurity();
 
@@ -261,6 +278,9 @@ class BaseSecurity
       static bool mAllowWildcardCertificates;
 
       void setDHParams(SSL_CTX* ctx);
+      /// @param sessionIdContext sessions are only resumed by a context
+      ///        configured with the same value
+      void setSessionCaching(SSL_CTX* ctx, const Data& sessionIdContext);
 };
 
 class Security : public BaseSecurity
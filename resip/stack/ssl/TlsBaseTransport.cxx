@@ -10,9 +10,11 @@
 #include "rutil/compat.hxx"
 #include "rutil/Data.hxx"
 #include "rutil/Socket.hxx"
+#include "rutil/Lock.hxx"
 #include "rutil/Logger.hxx"
 #include "resip/stack/ssl/TlsBaseTransport.hxx"
 #include "resip/stack/ssl/TlsConnection.hxx"
+#include "resip/stack/ssl/TlsHandshakePool.hxx"
 #include "resip/stack/ssl/Security.hxx"
 #include "rutil/WinLeakCheck.hxx"
 
@@ -21,6 +23,9 @@
 using namespace std;
 using namespace resip;
 
+unsigned int TlsBaseTransport::HandshakeWorkerThreads = 0;
+unsigned int TlsBaseTransport::MaxPendingHandshakes = 256;
+
 TlsBaseTransport::TlsBaseTransport(Fifo<TransactionMessage>& fifo, 
                            int portNum, 
                            IpVersion version,
@@ -42,7 +47,9 @@ TlsBaseTransport::TlsBaseTransport(Fifo<TransactionMessage>& fifo,
    mSslType(sslType),
    mDomainCtx(0),
    mClientVerificationMode(cvm),
-   mUseEmailAsSIP(useEmailAsSIP)
+   mUseEmailAsSIP(useEmailAsSIP),
+   mHandshakePool(0),
+   mHandshakePollHandle(0)
 {
    setTlsDomain(sipDomain);   
    mTuple.setType(transportType);
@@ -67,15 +74,107 @@ TlsBaseTransport::TlsBaseTransport(Fifo<TransactionMessage>& fifo,
          throw invalid_argument("Unrecognised SecurityTypes::SSLType value");
       }
    }
+
+   if(BaseSecurity::TlsSessionCacheSize > 0)
+   {
+      SSL_CTX_sess_set_new_cb(getCtx(), TlsConnection::newSessionCallback);
+   }
+
+   if(HandshakeWorkerThreads > 0)
+   {
+      mHandshakePool = new TlsHandshakePool(HandshakeWorkerThreads, MaxPendingHandshakes);
+   }
 }
 
 
 TlsBaseTransport::~TlsBaseTransport()
 {
+   if (mHandshakePool)
+   {
+      TlsHandshakePool::Statistics stats = mHandshakePool->getStatistics();
+      InfoLog(<< "TLS handshake workers for " << mTuple << ": submitted=" << stats.submitted
+              << " rejected=" << stats.rejected << " max queued=" << stats.maxQueued);
+      // Joins the workers; connections destroyed later by the
+      // ConnectionManager find no pool and have nothing to cancel.
+      if (mHandshakePollHandle)
+      {
+         mPollGrp->delPollItem(mHandshakePollHandle);
+      }
+      delete mHandshakePool;
+      mHandshakePool = 0;
+   }
    if (mDomainCtx)
    {
       SSL_CTX_free(mDomainCtx);mDomainCtx=0;
    }
+   for(ClientSessionMap::iterator it = mClientSessions.begin(); it != mClientSessions.end(); ++it)
+   {
+      SSL_SESSION_free(it->second);
+   }
+}
+
+void
+TlsBaseTransport::process(FdSet& fdset)
+{
+   TcpBaseTransport::process(fdset);
+   if (mHandshakePool)
+   {
+      mHandshakePool->getInterruptor().process(fdset);
+      processHandshakeCompletions();
+   }
+}
+
+void
+TlsBaseTransport::buildFdSet(FdSet& fdset)
+{
+   TcpBaseTransport::buildFdSet(fdset);
+   if (mHandshakePool)
+   {
+      mHandshakePool->getInterruptor().buildFdSet(fdset);
+   }
+}
+
+void
+TlsBaseTransport::process()
+{
+   TcpBaseTransport::process();
+   if (mHandshakePool)
+   {
+      processHandshakeCompletions();
+   }
+}
+
+void
+TlsBaseTransport::setPollGrp(FdPollGrp *grp)
+{
+   if (mHandshakePool)
+   {
+      if (mPollGrp && mHandshakePollHandle)
+      {
+         mPollGrp->delPollItem(mHandshakePollHandle);
+         mHandshakePollHandle = 0;
+      }
+      if (grp)
+      {
+         // only wakes the loop; process() picks up the connections
+         SelectInterruptor& interruptor = mHandshakePool->getInterruptor();
+         mHandshakePollHandle = grp->addPollItem(interruptor.getReadSocket(), FPEM_Read, &interruptor);
+      }
+   }
+   TcpBaseTransport::setPollGrp(grp);
+}
+
+void
+TlsBaseTransport::processHandshakeCompletions()
+{
+   TlsConnection* conn;
+   while ((conn = mHandshakePool->popCompleted()) != 0)
+   {
+      // Picks up the result of the step and, once the handshake is done,
+      // any data that arrived meanwhile (the read event for it has been
+      // consumed already).  Deletes the connection if the handshake failed.
+      conn->performReads();
+   }
 }
 
 SSL_CTX* 
@@ -114,6 +213,72 @@ TlsBaseTransport::setPeerCertificateVerificationCallback(
    return true;
 }
 
+bool
+TlsBaseTransport::setClientSession(SSL* ssl, const Tuple& who)
+{
+   Lock lock(mClientSessionMutex);
+   ClientSessionMap::iterator it = mClientSessions.find(std::make_pair(who, who.getTargetDomain()));
+   if(it == mClientSessions.end())
+   {
+      return false;
+   }
+   SSL_SESSION* session = it->second;
+   if((long)(time(0) - SSL_SESSION_get_time(session)) >= SSL_SESSION_get_timeout(session))
+   {
+      SSL_SESSION_free(session);
+      mClientSessions.erase(it);
+      return false;
+   }
+   // SSL_set_session takes its own reference
+   return SSL_set_session(ssl, session) == 1;
+}
+
+void
+TlsBaseTransport::storeClientSession(const Tuple& who, SSL_SESSION* session)
+{
+   Lock lock(mClientSessionMutex);
+   std::pair<ClientSessionMap::iterator, bool> inserted =
+      mClientSessions.insert(std::make_pair(std::make_pair(who, who.getTargetDomain()), session));
+   if(!inserted.second)
+   {
+      SSL_SESSION_free(inserted.first->second);
+      inserted.first->second = session;
+      return;
+   }
+   if(mClientSessions.size() > BaseSecurity::TlsSessionCacheSize)
+   {
+      // Rare (one entry per peer); drop whichever other entry expires first.
+      ClientSessionMap::iterator oldest = mClientSessions.end();
+      for(ClientSessionMap::iterator it = mClientSessions.begin(); it != mClientSessions.end(); ++it)
+      {
+         if(it != inserted.first &&
+            (oldest == mClientSessions.end() ||
+             SSL_SESSION_get_time(it->second) + SSL_SESSION_get_timeout(it->second) <
+             SSL_SESSION_get_time(oldest->second) + SSL_SESSION_get_timeout(oldest->second)))
+         {
+            oldest = it;
+         }
+      }
+      if(oldest != mClientSessions.end())
+      {
+         SSL_SESSION_free(oldest->second);
+         mClientSessions.erase(oldest);
+      }
+   }
+}
+
+void
+TlsBaseTransport::removeClientSession(const Tuple& who)
+{
+   Lock lock(mClientSessionMutex);
+   ClientSessionMap::iterator it = mClientSessions.find(std::make_pair(who, who.getTargetDomain()));
+   if(it != mClientSessions.end())
+   {
+      SSL_SESSION_free(it->second);
+      mClientSessions.erase(it);
+   }
+}
+
 Connection* 
 TlsBaseTransport::createConnection(const Tuple& who, Socket fd, bool server)
 {
@@ -9,8 +9,10 @@
 #include "resip/stack/TcpBaseTransport.hxx"
 #include "resip/stack/SecurityTypes.hxx"
 #include "rutil/HeapInstanceCounter.hxx"
+#include "rutil/Mutex.hxx"
 #include "resip/stack/Compression.hxx"
 
+#include <map>
 #include <openssl/ssl.h>
 
 namespace resip
@@ -19,6 +21,7 @@ namespace resip
 class Connection;
 class Message;
 class Security;
+class TlsHandshakePool;
 
 class TlsBaseTransport : public TcpBaseTransport
 {
@@ -42,8 +45,24 @@ class TlsBaseTransport : public TcpBaseTransport
                    const Data& privateKeyPassPhrase = "");
       virtual  ~TlsBaseTransport();
 
+      virtual void process(FdSet& fdset);
+      virtual void buildFdSet(FdSet& fdset);
+      virtual void process();
+      virtual void setPollGrp(FdPollGrp *grp);
+
       SSL_CTX* getCtx() const;
 
+      /** Number of threads each TLS transport created afterwards uses for
+          TLS handshakes (see TlsHandshakePool).  0, the default, does the
+          handshakes on the transport thread. */
+      static unsigned int HandshakeWorkerThreads;
+      /** Handshakes a transport's workers may have queued or running; the
+          transport thread does any beyond that itself. */
+      static unsigned int MaxPendingHandshakes;
+
+      /// @return 0 if handshakes are done on the transport thread
+      TlsHandshakePool* getHandshakePool() const { return mHandshakePool; }
+
       SecurityTypes::TlsClientVerificationMode getClientVerificationMode() 
          { return mClientVerificationMode; };
       bool isUseEmailAsSIP()
@@ -74,8 +93,21 @@ class TlsBaseTransport : public TcpBaseTransport
          void *func,
          void *arg);
 
+      /** @brief Client side session resumption.  The last session
+          negotiated with each peer (address and target domain) is offered
+          again on the next connection to it.
+      */
+      /// @return true if a session to resume was set on {ssl}
+      bool setClientSession(SSL* ssl, const Tuple& who);
+      /// takes ownership of the reference to {session}
+      void storeClientSession(const Tuple& who, SSL_SESSION* session);
+      /// forgets the session for {who}, e.g. after a failed handshake
+      void removeClientSession(const Tuple& who);
+
    protected:
       Connection* createConnection(const Tuple& who, Socket fd, bool server=false);
+      /// continues the connections whose handshake step a worker finished
+      void processHandshakeCompletions();
 
       Security* mSecurity;
       SecurityTypes::SSLType mSslType;
@@ -85,6 +117,13 @@ class TlsBaseTransport : public TcpBaseTransport
          as if it were a SIP URI.  This is convenient because many commercial
          CAs offer email certificates but not sip: certificates */
       bool mUseEmailAsSIP;
+
+      typedef std::map<std::pair<Tuple, Data>, SSL_SESSION*> ClientSessionMap;
+      ClientSessionMap mClientSessions;
+      Mutex mClientSessionMutex;
+
+      TlsHandshakePool* mHandshakePool;
+      FdPollItemHandle mHandshakePollHandle;
 };
 
 }
@@ -6,6 +6,7 @@
 
 #include "resip/stack/ssl/TlsConnection.hxx"
 #include "resip/stack/ssl/TlsTransport.hxx"
+#include "resip/stack/ssl/TlsHandshakePool.hxx"
 #include "resip/stack/ssl/Security.hxx"
 #include "rutil/Logger.hxx"
 #include "resip/stack/Uri.hxx"
@@ -26,6 +27,12 @@ using namespace resip;
 
 #define RESIPROCATE_SUBSYSTEM Subsystem::TRANSPORT
 
+Atomic<unsigned long> TlsConnection::mServerFullHandshakes;
+Atomic<unsigned long> TlsConnection::mServerResumedHandshakes;
+Atomic<unsigned long> TlsConnection::mClientFullHandshakes;
+Atomic<unsigned long> TlsConnection::mClientResumedHandshakes;
+Atomic<unsigned long> TlsConnection::mFailedHandshakes;
+
 inline bool handleOpenSSLErrorQueue(int ret, unsigned long err, const char* op)
 {
    bool hadReason = false;
@@ -62,7 +69,11 @@ TlsConnection::TlsConnection( Transport* transport, const Tuple& tuple,
    mServer(server),
    mSecurity(security),
    mSslType( sslType ),
-   mDomain(domain)
+   mDomain(domain),
+   mHandshakeOffloaded(false),
+   mHandshakeResult(0),
+   mHandshakeError(SSL_ERROR_NONE),
+   mHandshakeErrno(0)
 {
 #if defined(USE_SSL)
    InfoLog (<< "Creating TLS connection for domain " 
@@ -97,6 +108,7 @@ TlsConnection::TlsConnection( Transport* transport, const Tuple& tuple,
    
    mSsl = SSL_new(ctx);
    resip_assert(mSsl);
+   SSL_set_app_data(mSsl, this);
 
    resip_assert( mSecurity );
 
@@ -123,6 +135,10 @@ TlsConnection::TlsConnection( Transport* transport, const Tuple& tuple,
       }
       SSL_set_verify(mSsl, verify_mode, 0);
    }
+   else if(t->setClientSession(mSsl, who()))
+   {
+      DebugLog(<< "Offering previous TLS session to " << who());
+   }
 
    mBio = BIO_new_socket((int)fd,0/*close flag*/);
    if( !mBio )
@@ -142,6 +158,15 @@ TlsConnection::TlsConnection( Transport* transport, const Tuple& tuple,
 TlsConnection::~TlsConnection()
 {
 #if defined(USE_SSL)
+   if (mHandshakeOffloaded)
+   {
+      // t is 0 once the transport itself is being destroyed
+      TlsBaseTransport *t = dynamic_cast<TlsBaseTransport*>(transport());
+      if (t && t->getHandshakePool())
+      {
+         t->getHandshakePool()->cancel(this);
+      }
+   }
    ERR_clear_error();
    int ret = SSL_shutdown(mSsl);
    if(ret < 0)
@@ -181,6 +206,92 @@ TlsConnection::fromState(TlsConnection::TlsState s)
    return "????";
 }
 
+TlsConnection::HandshakeStatistics
+TlsConnection::getHandshakeStatistics()
+{
+   HandshakeStatistics stats;
+   stats.serverFull = mServerFullHandshakes.load();
+   stats.serverResumed = mServerResumedHandshakes.load();
+   stats.clientFull = mClientFullHandshakes.load();
+   stats.clientResumed = mClientResumedHandshakes.load();
+   stats.failed = mFailedHandshakes.load();
+   return stats;
+}
+
+void
+TlsConnection::dumpHandshakeStatistics()
+{
+   HandshakeStatistics stats = getHandshakeStatistics();
+   InfoLog(<< "TLS handshakes: server full=" << stats.serverFull
+           << " resumed=" << stats.serverResumed
+           << ", client full=" << stats.clientFull
+           << " resumed=" << stats.clientResumed
+           << ", failed=" << stats.failed);
+}
+
+int
+TlsConnection::newSessionCallback(SSL* ssl, SSL_SESSION* session)
+{
+#if defined(USE_SSL)
+   TlsConnection* conn = static_cast<TlsConnection*>(SSL_get_app_data(ssl));
+   if (!conn || conn->mServer)
+   {
+      // servers keep their sessions in the SSL_CTX cache
+      return 0;
+   }
+   TlsBaseTransport *t = dynamic_cast<TlsBaseTransport*>(conn->transport());
+   resip_assert(t);
+   t->storeClientSession(conn->who(), session);
+   return 1;
+#else
+   return 0;
+#endif // USE_SSL
+}
+
+void
+TlsConnection::doHandshakeStep()
+{
+#if defined(USE_SSL)
+   // Runs on a TlsHandshakePool worker; the transport thread does not touch
+   // mSsl until this returns.
+   ERR_clear_error();
+   mHandshakeResult = SSL_do_handshake(mSsl);
+   mHandshakeError = SSL_ERROR_NONE;
+   mHandshakeErrno = 0;
+   if (mHandshakeResult <= 0)
+   {
+      mHandshakeError = SSL_get_error(mSsl, mHandshakeResult);
+      mHandshakeErrno = getErrno();
+      // the OpenSSL error queue is per thread
+      unsigned long code;
+      while ((code = ERR_get_error()) != 0)
+      {
+         char buf[256];
+         ERR_error_string_n(code, buf, sizeof(buf));
+         if (!mHandshakeErrorReasons.empty())
+         {
+            mHandshakeErrorReasons += "; ";
+         }
+         mHandshakeErrorReasons += buf;
+      }
+   }
+#endif // USE_SSL
+}
+
+void
+TlsConnection::handshakeFailed()
+{
+   mFailedHandshakes.fetchAdd(1);
+   if (!mServer)
+   {
+      // don't offer a session the peer just rejected (or one bound to a
+      // certificate that no longer matches) again
+      TlsBaseTransport *t = dynamic_cast<TlsBaseTransport*>(transport());
+      resip_assert(t);
+      t->removeClientSession(who());
+   }
+}
+
 TlsConnection::TlsState
 TlsConnection::checkState()
 {
@@ -216,11 +327,46 @@ TlsConnection::checkState()
    }
 
    mHandShakeWantsRead = false;
-   ok = SSL_do_handshake(mSsl);
+   int err = SSL_ERROR_NONE;
+   int sysErr = 0;
+   bool offloaded = false;
+
+   TlsBaseTransport *t = dynamic_cast<TlsBaseTransport*>(transport());
+   resip_assert(t);
+   TlsHandshakePool* pool = t->getHandshakePool();
+   if (mHandshakeOffloaded)
+   {
+      if (!pool->collect(this))
+      {
+         // the SSL object belongs to a worker until the step is done;
+         // stay out of the write set in the meantime
+         mHandShakeWantsRead = true;
+         return mTlsState;
+      }
+      mHandshakeOffloaded = false;
+      offloaded = true;
+      ok = mHandshakeResult;
+      err = mHandshakeError;
+      sysErr = mHandshakeErrno;
+   }
+   else if (pool && pool->submit(this))
+   {
+      mHandshakeOffloaded = true;
+      mHandShakeWantsRead = true;
+      return mTlsState;
+   }
+   else
+   {
+      ok = SSL_do_handshake(mSsl);
+      if (ok <= 0)
+      {
+         err = SSL_get_error(mSsl,ok);
+         sysErr = getErrno();
+      }
+   }
       
    if ( ok <= 0 )
    {
-      int err = SSL_get_error(mSsl,ok);
          
       switch (err)
       {
@@ -255,7 +401,7 @@ TlsConnection::checkState()
          default:
             if(err == SSL_ERROR_SYSCALL)
             {
-               int e = getErrno();
+               int e = sysErr;
                switch(e)
                {
                   case EINTR:
@@ -270,8 +416,6 @@ TlsConnection::checkState()
                Transport::error(e);
                if(e == 0)
                {
-                  TlsBaseTransport *t = dynamic_cast<TlsBaseTransport*>(transport());
-                  resip_assert(t);
                   if(mServer && t->getClientVerificationMode() != SecurityTypes::None)
                   {
                      DebugLog(<<"client may have disconnected to prompt for user certificate, because it can't supply a certificate (verification mode == " << (t->getClientVerificationMode() == SecurityTypes::Mandatory?"Mandatory":"Optional") << " for this transport) or because it does not support using client certificates over WebSockets");
@@ -302,8 +446,6 @@ TlsConnection::checkState()
                   DebugLog(<<"protocol did not reach certificate exchange phase, peer does not have a certificate or the certificate was not accepted");
                   if(mServer)
                   {
-                     TlsBaseTransport *t = dynamic_cast<TlsBaseTransport*>(transport());
-                     resip_assert(t);
                      if(t->getClientVerificationMode() == SecurityTypes::Mandatory)
                      {
                         ErrLog(<<"Mandatory client certificate verification required, protocol failed, client did not send a certificate or it was not valid");
@@ -320,7 +462,21 @@ TlsConnection::checkState()
                DebugLog(<<"unrecognised/unhandled SSL_get_error result: " << errortostringSSL(err) );
             }
             ErrLog( << "TLS handshake failed ");
-            handleOpenSSLErrorQueue(ok, err, "SSL_do_handshake");
+            if (offloaded)
+            {
+               // the reasons were queued on the worker thread
+               if (!mHandshakeErrorReasons.empty())
+               {
+                  ErrLog( << mHandshakeErrorReasons );
+               }
+               ErrLog( << "Got TLS SSL_do_handshake error=" << err << " ret=" << ok );
+               mHandshakeErrorReasons.clear();
+            }
+            else
+            {
+               handleOpenSSLErrorQueue(ok, err, "SSL_do_handshake");
+            }
+            handshakeFailed();
             mBio = NULL;
             mTlsState = Broken;
             return mTlsState;
@@ -355,10 +511,20 @@ TlsConnection::checkState()
                  << "> remote cert domain(s) are <" 
                  << getPeerNamesData() << ">" );
          mFailureReason = TransportFailure::CertNameMismatch;         
+         handshakeFailed();
          return mTlsState;
       }
    }
 
+   if (SSL_session_reused(mSsl))
+   {
+      (mServer ? mServerResumedHandshakes : mClientResumedHandshakes).fetchAdd(1);
+      DebugLog( << "TLS session resumed");
+   }
+   else
+   {
+      (mServer ? mServerFullHandshakes : mClientFullHandshakes).fetchAdd(1);
+   }
    InfoLog( << "TLS handshake done for peer " << getPeerNamesData()); 
    mTlsState = Up;
    if (!mOutstandingSends.empty())
@@ -578,6 +744,19 @@ TlsConnection::hasDataToRead() // has data that can be read
    if(mTlsState == Initial)
       return false;
 
+   if (mTlsState != Up)
+   {
+      // This is asked on every pass of the transport loop.  With a
+      // handshake pool, checkState() hands a step to a worker, so leave the
+      // handshake to socket events and finished steps; otherwise each pass
+      // would queue a step that has nothing to do.
+      TlsBaseTransport *t = dynamic_cast<TlsBaseTransport*>(transport());
+      if (t && t->getHandshakePool())
+      {
+         return false;
+      }
+   }
+
    if (checkState() != Up)
    {
       return false;
@@ -7,6 +7,7 @@
 
 
 #include "resip/stack/Connection.hxx"
+#include "rutil/Atomic.hxx"
 #include "rutil/HeapInstanceCounter.hxx"
 #include "resip/stack/SecurityTypes.hxx"
 #include "resip/stack/ssl/Security.hxx"
@@ -53,6 +54,23 @@ class TlsConnection : public Connection
       
       typedef enum TlsState { Initial, Broken, Handshaking, Up } TlsState;
       static const char * fromState(TlsState);
+
+      /// Handshakes completed since startup, by side and by whether a
+      /// previous session was resumed (see BaseSecurity::TlsSessionCacheSize)
+      struct HandshakeStatistics
+      {
+         unsigned long serverFull;
+         unsigned long serverResumed;
+         unsigned long clientFull;
+         unsigned long clientResumed;
+         unsigned long failed;
+      };
+      static HandshakeStatistics getHandshakeStatistics();
+      static void dumpHandshakeStatistics();
+
+      /// SSL_CTX new session callback; hands client sessions to the
+      /// TlsBaseTransport for resumption
+      static int newSessionCallback(SSL* ssl, SSL_SESSION* session);
    
    private:
       /// No default c'tor
@@ -60,6 +78,11 @@ class TlsConnection : public Connection
       void computePeerName();
       Data getPeerNamesData() const;
       TlsState checkState();
+      void handshakeFailed();
+
+      friend class TlsHandshakePool;
+      /// one SSL_do_handshake on a TlsHandshakePool worker
+      void doHandshakeStep();
 
       bool mServer;
       Security* mSecurity;
@@ -69,9 +92,23 @@ class TlsConnection : public Connection
       TlsState mTlsState;
       bool mHandShakeWantsRead;
 
+      // set while a TlsHandshakePool worker owns mSsl; the results below
+      // are written by the worker and read once it has finished
+      bool mHandshakeOffloaded;
+      int mHandshakeResult;
+      int mHandshakeError;
+      int mHandshakeErrno;
+      Data mHandshakeErrorReasons;
+
       SSL* mSsl;
       BIO* mBio;
       std::list<BaseSecurity::PeerName> mPeerNames;
+
+      static Atomic<unsigned long> mServerFullHandshakes;
+      static Atomic<unsigned long> mServerResumedHandshakes;
+      static Atomic<unsigned long> mClientFullHandshakes;
+      static Atomic<unsigned long> mClientResumedHandshakes;
+      static Atomic<unsigned long> mFailedHandshakes;
 };
  
 }
@@ -0,0 +1,249 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#if defined(USE_SSL)
+
+#include <algorithm>
+
+#include "resip/stack/ssl/TlsHandshakePool.hxx"
+#include "resip/stack/ssl/TlsConnection.hxx"
+#include "rutil/compat.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/WinLeakCheck.hxx"
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::TRANSPORT
+
+using namespace resip;
+
+Mutex TlsHandshakePool::mPoolsMutex;
+std::set<TlsHandshakePool*> TlsHandshakePool::mPools;
+
+TlsHandshakePool::TlsHandshakePool(unsigned int numThreads, unsigned int maxPending) :
+   mMaxPending(maxPending ? maxPending : 1),
+   mShutdown(false),
+   mMaxQueued(0),
+   mSubmitted(0),
+   mRejected(0)
+{
+   for(unsigned int i = 0; i < numThreads; ++i)
+   {
+      Worker* worker = new Worker(*this);
+      mWorkers.push_back(worker);
+      worker->run();
+   }
+   InfoLog(<< "TLS handshakes run on " << numThreads << " worker threads, at most "
+           << mMaxPending << " at a time");
+
+   Lock lock(mPoolsMutex);
+   mPools.insert(this);
+}
+
+TlsHandshakePool::~TlsHandshakePool()
+{
+   {
+      Lock lock(mPoolsMutex);
+      mPools.erase(this);
+   }
+   {
+      Lock lock(mMutex);
+      mShutdown = true;
+      mWorkAvailable.broadcast();
+   }
+   for(std::vector<Worker*>::iterator it = mWorkers.begin(); it != mWorkers.end(); ++it)
+   {
+      (*it)->shutdown();
+      (*it)->join();
+      delete *it;
+   }
+}
+
+bool
+TlsHandshakePool::submit(TlsConnection* conn)
+{
+   Lock lock(mMutex);
+   if(mShutdown || mQueue.size() + mRunning.size() >= mMaxPending)
+   {
+      ++mRejected;
+      return false;
+   }
+   mQueue.push_back(conn);
+   ++mSubmitted;
+   mMaxQueued = resipMax(mMaxQueued, (unsigned int)mQueue.size());
+   mWorkAvailable.signal();
+   return true;
+}
+
+bool
+TlsHandshakePool::collect(TlsConnection* conn)
+{
+   Lock lock(mMutex);
+   if(mRunning.count(conn) ||
+      std::find(mQueue.begin(), mQueue.end(), conn) != mQueue.end())
+   {
+      return false;
+   }
+   mCompleted.erase(std::remove(mCompleted.begin(), mCompleted.end(), conn), mCompleted.end());
+   return true;
+}
+
+void
+TlsHandshakePool::cancel(TlsConnection* conn)
+{
+   Lock lock(mMutex);
+   mQueue.erase(std::remove(mQueue.begin(), mQueue.end(), conn), mQueue.end());
+   while(mRunning.count(conn))
+   {
+      // a handshake step never blocks on the network, so this is short
+      mWorkFinished.wait(mMutex);
+   }
+   mCompleted.erase(std::remove(mCompleted.begin(), mCompleted.end(), conn), mCompleted.end());
+}
+
+TlsConnection*
+TlsHandshakePool::popCompleted()
+{
+   Lock lock(mMutex);
+   if(mCompleted.empty())
+   {
+      return 0;
+   }
+   TlsConnection* conn = mCompleted.front();
+   mCompleted.pop_front();
+   return conn;
+}
+
+TlsHandshakePool::Statistics
+TlsHandshakePool::getStatistics() const
+{
+   Lock lock(mMutex);
+   Statistics stats;
+   stats.threads = (unsigned int)mWorkers.size();
+   stats.queued = (unsigned int)mQueue.size();
+   stats.running = (unsigned int)mRunning.size();
+   stats.maxQueued = mMaxQueued;
+   stats.submitted = mSubmitted;
+   stats.rejected = mRejected;
+   return stats;
+}
+
+TlsHandshakePool::Statistics
+TlsHandshakePool::getTotalStatistics()
+{
+   Statistics total;
+   total.threads = 0;
+   total.queued = 0;
+   total.running = 0;
+   total.maxQueued = 0;
+   total.submitted = 0;
+   total.rejected = 0;
+
+   Lock lock(mPoolsMutex);
+   for(std::set<TlsHandshakePool*>::const_iterator it = mPools.begin(); it != mPools.end(); ++it)
+   {
+      Statistics stats = (*it)->getStatistics();
+      total.threads += stats.threads;
+      total.queued += stats.queued;
+      total.running += stats.running;
+      total.maxQueued = resipMax(total.maxQueued, stats.maxQueued);
+      total.submitted += stats.submitted;
+      total.rejected += stats.rejected;
+   }
+   return total;
+}
+
+TlsConnection*
+TlsHandshakePool::take()
+{
+   Lock lock(mMutex);
+   while(mQueue.empty() && !mShutdown)
+   {
+      mWorkAvailable.wait(mMutex);
+   }
+   if(mShutdown)
+   {
+      return 0;
+   }
+   TlsConnection* conn = mQueue.front();
+   mQueue.pop_front();
+   mRunning.insert(conn);
+   return conn;
+}
+
+void
+TlsHandshakePool::finished(TlsConnection* conn)
+{
+   {
+      Lock lock(mMutex);
+      mRunning.erase(conn);
+      mCompleted.push_back(conn);
+      mWorkFinished.broadcast();
+   }
+   mInterruptor.interrupt();
+}
+
+void
+TlsHandshakePool::Worker::thread()
+{
+   while(!isShutdown())
+   {
+      TlsConnection* conn = mPool.take();
+      if(!conn)
+      {
+         break;
+      }
+      conn->doHandshakeStep();
+      mPool.finished(conn);
+   }
+}
+
+#endif // USE_SSL
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
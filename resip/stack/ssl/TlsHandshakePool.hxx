@@ -0,0 +1,155 @@
+#if !defined(RESIP_TLSHANDSHAKEPOOL_HXX)
+#define RESIP_TLSHANDSHAKEPOOL_HXX
+
+#include <deque>
+#include <set>
+#include <vector>
+
+#include "rutil/Condition.hxx"
+#include "rutil/Mutex.hxx"
+#include "rutil/SelectInterruptor.hxx"
+#include "rutil/ThreadIf.hxx"
+
+namespace resip
+{
+
+class TlsConnection;
+
+/**
+   @brief Runs TLS handshake steps (SSL_do_handshake) for the connections
+   of one TlsBaseTransport on worker threads.
+
+   The asymmetric crypto of a full handshake is by far the most expensive
+   thing a TLS transport does; doing it on the transport thread stalls
+   every established connection whenever a burst of new connections
+   arrives.  A TlsConnection submits itself when its handshake has
+   something to do and leaves its SSL object alone until the step is done.
+   Finished connections are queued and the transport's select/poll loop is
+   woken through getInterruptor(), so the transport thread picks up where
+   the worker left off (see TlsBaseTransport::processHandshakeCompletions).
+
+   At most maxPending connections are queued or running; beyond that
+   submit() fails and the caller does the handshake step itself.
+*/
+class TlsHandshakePool
+{
+   public:
+      TlsHandshakePool(unsigned int numThreads, unsigned int maxPending);
+      ~TlsHandshakePool();
+
+      /// @return false if the pool is full; the caller must do the step itself
+      bool submit(TlsConnection* conn);
+      /// @return false while {conn} is queued or on a worker; otherwise
+      ///         true, and popCompleted() will no longer return it
+      bool collect(TlsConnection* conn);
+      /// Forgets {conn}, waiting for its step to finish if a worker is
+      /// running it.  Called when a connection is destroyed.
+      void cancel(TlsConnection* conn);
+      /// @return a connection whose step has finished, 0 if there is none
+      TlsConnection* popCompleted();
+
+      SelectInterruptor& getInterruptor() { return mInterruptor; }
+
+      struct Statistics
+      {
+         unsigned int threads;
+         unsigned int queued;       // waiting for a worker now
+         unsigned int running;      // on a worker now
+         unsigned int maxQueued;    // largest queue seen
+         unsigned long submitted;
+         unsigned long rejected;    // done on the transport thread because the pool was full
+      };
+      Statistics getStatistics() const;
+      /// Sum of getStatistics() over every pool that exists right now
+      /// (maxQueued is the largest of them), so the stack's statistics
+      /// can report handshake load while the transports run.
+      static Statistics getTotalStatistics();
+
+   private:
+      class Worker : public ThreadIf
+      {
+         public:
+            Worker(TlsHandshakePool& pool) : mPool(pool) {}
+            virtual void thread();
+         private:
+            TlsHandshakePool& mPool;
+      };
+      friend class Worker;
+
+      TlsConnection* take();
+      void finished(TlsConnection* conn);
+
+      const unsigned int mMaxPending;
+      std::vector<Worker*> mWorkers;
+      SelectInterruptor mInterruptor;
+
+      mutable Mutex mMutex;
+      Condition mWorkAvailable;
+      Condition mWorkFinished;
+      bool mShutdown;
+      std::deque<TlsConnection*> mQueue;
+      std::set<TlsConnection*> mRunning;
+      std::deque<TlsConnection*> mCompleted;
+      unsigned int mMaxQueued;
+      unsigned long mSubmitted;
+      unsigned long mRejected;
+
+      static Mutex mPoolsMutex;
+      static std::set<TlsHandshakePool*> mPools;
+
+      // disabled
+      TlsHandshakePool(const TlsHandshakePool&);
+      TlsHandshakePool& operator=(const TlsHandshakePool&);
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
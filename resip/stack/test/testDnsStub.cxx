@@ -19,11 +19,15 @@
 #include "rutil/Logger.hxx"
 #include "rutil/ThreadIf.hxx"
 #include "rutil/DnsUtil.hxx"
+#include "rutil/ParseBuffer.hxx"
 #include "resip/stack/DnsResult.hxx"
 #include "resip/stack/SipStack.hxx"
 #include "rutil/dns/RRVip.hxx"
 #include "rutil/dns/QueryTypes.hxx"
 #include "rutil/dns/DnsStub.hxx"
+#include "rutil/dns/ExternalDns.hxx"
+#include "rutil/dns/ExternalDnsFactory.hxx"
+#include "assert.h"
 
 using namespace std;
 
@@ -144,6 +148,167 @@ void MyDnsSink::onDnsResult(const DNSResult<DnsAAAARecord>& result)
 }
 #endif
 
+// Stands in for the resolver library: records what goes on the wire and
+// lets the test answer it.
+class FakeDns : public ExternalDns
+{
+   public:
+      struct Lookup
+      {
+         Data target;
+         unsigned short type;
+         ExternalDnsHandler* handler;
+         void* userData;
+      };
+      std::vector<Lookup> mLookups;
+
+      virtual int init(const std::vector<GenericIPAddress>&, AfterSocketCreationFuncPtr,
+                       int, int, unsigned int) { return Success; }
+      virtual bool checkDnsChange() { return false; }
+      virtual unsigned int getTimeTillNextProcessMS() { return 1000; }
+      virtual void buildFdSet(fd_set&, fd_set&, int&) {}
+      virtual void process(fd_set&, fd_set&) {}
+      virtual void setPollGrp(FdPollGrp*) {}
+      virtual void processTimers() {}
+      virtual void freeResult(ExternalDnsRawResult) {}
+      virtual void freeResult(ExternalDnsHostResult) {}
+      virtual char* errorMessage(long errorCode)
+      {
+         char* msg = new char[16];
+         strcpy(msg, "fake error");
+         return msg;
+      }
+      virtual void lookup(const char* target, unsigned short type, ExternalDnsHandler* handler, void* userData)
+      {
+         Lookup lookup;
+         lookup.target = target;
+         lookup.type = type;
+         lookup.handler = handler;
+         lookup.userData = userData;
+         mLookups.push_back(lookup);
+      }
+      virtual bool hostFileLookup(const char*, in_addr&) { return false; }
+      virtual bool hostFileLookupLookupOnlyMode() { return false; }
+};
+
+class FakeDnsCreator : public ExternalDnsCreator
+{
+   public:
+      FakeDnsCreator() : mDns(0) {}
+      virtual ExternalDns* createExternalDns()
+      {
+         mDns = new FakeDns;
+         return mDns;
+      }
+      FakeDns* mDns;
+};
+
+class CountingSink : public DnsResultSink
+{
+   public:
+      CountingSink() : mResults(0), mStatus(-1) {}
+      void onDnsResult(const DNSResult<DnsHostRecord>& result)
+      {
+         ++mResults;
+         mStatus = result.status;
+         for (vector<DnsHostRecord>::const_iterator it = result.records.begin(); it != result.records.end(); ++it)
+         {
+            mHosts.push_back(it->host());
+         }
+      }
+      void onDnsResult(const DNSResult<DnsAAAARecord>&) { assert(0); }
+      void onDnsResult(const DNSResult<DnsSrvRecord>&) { assert(0); }
+      void onDnsResult(const DNSResult<DnsNaptrRecord>&) { assert(0); }
+      void onDnsResult(const DNSResult<DnsCnameRecord>&) { assert(0); }
+
+      int mResults;
+      int mStatus;
+      vector<Data> mHosts;
+};
+
+// one A record for {name}, as a server would send it
+static std::vector<unsigned char>
+makeAResponse(const Data& name, const unsigned char address[4])
+{
+   const unsigned char header[] = { 0x12, 0x34, 0x81, 0x80, 0, 1, 0, 1, 0, 0, 0, 0 };
+   std::vector<unsigned char> response(header, header + sizeof(header));
+   ParseBuffer pb(name);
+   while (!pb.eof())
+   {
+      const char* start = pb.position();
+      pb.skipToChar('.');
+      Data label(pb.data(start));
+      response.push_back((unsigned char)label.size());
+      response.insert(response.end(), label.data(), label.data() + label.size());
+      if (!pb.eof())
+      {
+         pb.skipChar();
+      }
+   }
+   const unsigned char rest[] =
+   {
+      0,                       // end of the question name
+      0, 1, 0, 1,              // A, IN
+      0xc0, 12,                // answer name: the question name
+      0, 1, 0, 1,              // A, IN
+      0, 0, 0, 60,             // TTL
+      0, 4                     // RDLENGTH
+   };
+   response.insert(response.end(), rest, rest + sizeof(rest));
+   response.insert(response.end(), address, address + 4);
+   return response;
+}
+
+// Identical lookups made while the first is still out share one query on
+// the wire, and every sink gets the answer.
+static void
+testMergedLookups()
+{
+   FakeDnsCreator creator;
+   ExternalDnsFactory::setExternalCreator(&creator);
+   {
+      DnsStub stub;
+      FakeDns* fake = creator.mDns;
+      assert(fake);
+
+      CountingSink first;
+      CountingSink second;
+      CountingSink otherCase;
+      stub.lookup<RR_A>("merge.example.com", Protocol::Sip, &first);
+      stub.lookup<RR_A>("merge.example.com", Protocol::Sip, &second);
+      stub.lookup<RR_A>("Merge.Example.COM", Protocol::Sip, &otherCase);
+      stub.processTimers();
+
+      assert(fake->mLookups.size() == 1);
+      assert(fake->mLookups[0].type == RR_A::getRRType());
+      assert(isEqualNoCase(fake->mLookups[0].target, "merge.example.com"));
+      assert(stub.getMergedQueryCount() == 2);
+      assert(first.mResults == 0 && second.mResults == 0 && otherCase.mResults == 0);
+
+      const unsigned char address[] = { 192, 0, 2, 10 };
+      std::vector<unsigned char> response = makeAResponse("merge.example.com", address);
+      fake->mLookups[0].handler->handleDnsRaw(
+         ExternalDnsRawResult(&response[0], (int)response.size(), fake->mLookups[0].userData));
+
+      CountingSink* sinks[] = { &first, &second, &otherCase };
+      for (int i = 0; i < 3; ++i)
+      {
+         assert(sinks[i]->mResults == 1);
+         assert(sinks[i]->mStatus == 0);
+         assert(sinks[i]->mHosts.size() == 1);
+         assert(sinks[i]->mHosts[0] == "192.0.2.10");
+      }
+
+      // a lookup of another name is a query of its own
+      CountingSink host;
+      stub.lookup<RR_A>("other.example.com", Protocol::Sip, &host);
+      stub.processTimers();
+      assert(fake->mLookups.size() == 2);
+      assert(stub.getMergedQueryCount() == 2);
+   }
+   ExternalDnsFactory::setExternalCreator(0);
+}
+
 class TestDns : public ThreadIf, public DnsStub
 {
    public:
@@ -170,9 +335,18 @@ using namespace resip;
 int 
 main(int argc, const char** argv)
 {
+   if (argc == 1)
+   {
+      initNetwork();
+      testMergedLookups();
+      cerr << "All OK" << endl;
+      return 0;
+   }
+
    if (argc < 3) 
    {
       cout << "usage: " << argv[0] << " target" << " type" << endl;
+      cout << "(without arguments, tests lookups against a fake resolver)" << endl;
       cout << "Valid type values: " << endl;
       cout << "A Record - 1" << endl;
       cout << "CNAME - 5" << endl;
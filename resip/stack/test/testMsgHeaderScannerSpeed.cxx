@@ -0,0 +1,329 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include "resip/stack/MsgHeaderScanner.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/DataStream.hxx"
+#include "rutil/Timer.hxx"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace resip;
+using namespace std;
+
+// Compares the scan modes of MsgHeaderScanner: first that every mode produces
+// the same messages, then how fast each one scans.
+//
+// Usage: testMsgHeaderScannerSpeed [-r <runs>] [-d <dir with the RFC 4475 .dat files>]
+
+static const char* rfc4475Files[] =
+{
+   "wsinv.dat", "intmeth.dat", "esc01.dat", "escnull.dat", "esc02.dat",
+   "lwsdisp.dat", "longreq.dat", "dblreq.dat", "semiuri.dat",
+   "transports.dat", "mpart01.dat", "unreason.dat", "noreason.dat",
+   "badinv01.dat", "clerr.dat", "scalar02.dat", "scalarlg.dat",
+   "quotbal.dat", "ltgtruri.dat", "lwsruri.dat", "lwsstart.dat",
+   "trws.dat", "escruri.dat", "baddate.dat", "regbadct.dat",
+   "badaspec.dat", "baddn.dat", "badvers.dat", "mismatch01.dat",
+   "mismatch02.dat", "bigcode.dat", "badbranch.dat", "insuf.dat",
+   "unkscm.dat", "novelsc.dat", "unksm2.dat", "bext01.dat",
+   "regaut01.dat", "multi01.dat", "mcl01.dat", "bcast.dat", "zeromf.dat",
+   "cparam01.dat", "cparam02.dat", "regescrt.dat", "sdp01.dat",
+   "inv2543.dat", "invut.dat", "ncl.dat", 0
+};
+
+static const char* invite =
+   "INVITE sip:bob@biloxi.example.com SIP/2.0\r\n"
+   "Via: SIP/2.0/TLS client.atlanta.example.com:5061;branch=z9hG4bK74bf9;received=192.0.2.101;rport=5061\r\n"
+   "Via: SIP/2.0/UDP 192.168.2.15:5100;branch=z9hG4bK-c87542-579667358-1--c87542-;rport=5100;received=192.168.2.15\r\n"
+   "Max-Forwards: 70\r\n"
+   "From: \"Alice Liddell\" <sip:alice@atlanta.example.com>;tag=9fxced76sl\r\n"
+   "To: \"Bob\" <sip:bob@biloxi.example.com>\r\n"
+   "Call-ID: 3848276298220188511@atlanta.example.com\r\n"
+   "CSeq: 1 INVITE\r\n"
+   "Record-Route: <sip:proxy1.example.com;lr;ftag=9fxced76sl>, <sip:proxy2.example.com;lr>\r\n"
+   "Contact: <sip:alice@client.atlanta.example.com;transport=tls>;+sip.instance=\"<urn:uuid:00000000-0000-1000-8000-000A95A0E128>\"\r\n"
+   "Allow: INVITE, ACK, CANCEL, OPTIONS, BYE, REFER, NOTIFY, MESSAGE, SUBSCRIBE, INFO, UPDATE\r\n"
+   "Supported: replaces, timer, gruu, outbound, path\r\n"
+   "Session-Expires: 1800;refresher=uac\r\n"
+   "User-Agent: Example UA/1.2.3 (linux)\r\n"
+   "P-Asserted-Identity: \"Alice Liddell\" <sip:alice@atlanta.example.com>, <tel:+15551234567>\r\n"
+   "Content-Type: application/sdp\r\n"
+   "Content-Length: 151\r\n"
+   "\r\n"
+   "v=0\r\n"
+   "o=alice 2890844526 2890844526 IN IP4 client.atlanta.example.com\r\n"
+   "s=-\r\n"
+   "c=IN IP4 192.0.2.101\r\n"
+   "t=0 0\r\n"
+   "m=audio 49172 RTP/AVP 0\r\n"
+   "a=rtpmap:0 PCMU/8000\r\n";
+
+static const char* registration =
+   "REGISTER sip:registrar.biloxi.example.com SIP/2.0\r\n"
+   "Via: SIP/2.0/UDP bobspc.biloxi.example.com:5060;branch=z9hG4bKnashds7;rport\r\n"
+   "Max-Forwards: 70\r\n"
+   "To: Bob <sip:bob@biloxi.example.com>\r\n"
+   "From: Bob <sip:bob@biloxi.example.com>;tag=456248\r\n"
+   "Call-ID: 843817637684230@998sdasdh09\r\n"
+   "CSeq: 1826 REGISTER\r\n"
+   "Contact: <sip:bob@192.0.2.4;transport=udp;ob>;reg-id=1;+sip.instance=\"<urn:uuid:f81d4fae-7dec-11d0-a765-00a0c91e6bf6>\";expires=3600\r\n"
+   "Authorization: Digest username=\"bob\", realm=\"biloxi.example.com\", nonce=\"dcd98b7102dd2f0e8b11d0f600bfb0c093\", uri=\"sip:registrar.biloxi.example.com\", response=\"245f23415f11432b3434341c022\", algorithm=MD5, qop=auth, nc=00000001, cnonce=\"0a4f113b\"\r\n"
+   "Supported: path, outbound, gruu\r\n"
+   "User-Agent: Example UA/1.2.3 (linux)\r\n"
+   "Content-Length: 0\r\n"
+   "\r\n";
+
+struct TestMessage
+{
+      Data name;
+      Data text;
+};
+
+// Scans "message" in chunks of at most "chunkSize" characters.  If "outcome"
+// is given, describes the result there so that two modes can be compared.
+static void
+scan(const TestMessage& message, unsigned int chunkSize, Data* outcome)
+{
+   unsigned int length = message.text.size();
+   std::vector<char> buffer(length + MsgHeaderScanner::MaxNumCharsChunkOverflow + 1);
+   memcpy(&buffer[0], message.text.data(), length);
+
+   SipMessage msg;
+   MsgHeaderScanner scanner;
+   scanner.prepareForMessage(&msg);
+
+   char* chunk = &buffer[0];
+   char* end = &buffer[0] + length;
+   char* fed = chunk;
+   char* unprocessedCharPtr = 0;
+   MsgHeaderScanner::ScanChunkResult result;
+   do
+   {
+      fed = (unsigned int)(end - fed) > chunkSize ? fed + chunkSize : end;
+      result = scanner.scanChunk(chunk, (unsigned int)(fed - chunk), &unprocessedCharPtr);
+      chunk = unprocessedCharPtr;
+   } while (result == MsgHeaderScanner::scrNextChunk && fed != end);
+
+   if (outcome)
+   {
+      DataStream stream(*outcome);
+      stream << result << ' ' << (unprocessedCharPtr - &buffer[0]) << ' '
+             << scanner.getHeaderCount() << '\n';
+      if (result == MsgHeaderScanner::scrEnd)
+      {
+         try
+         {
+            msg.encode(stream);
+         }
+         catch (BaseException& e)
+         {
+            stream << "exception: " << e;
+         }
+      }
+   }
+}
+
+static const char*
+modeName(MsgHeaderScanner::ScanMode mode)
+{
+   switch (mode)
+   {
+      case MsgHeaderScanner::smScalar:
+         return "scalar";
+      case MsgHeaderScanner::smSse2:
+         return "sse2";
+      case MsgHeaderScanner::smAvx2:
+         return "avx2";
+      default:
+         return "best";
+   }
+}
+
+static double
+timeScans(const std::vector<TestMessage>& messages, int runs)
+{
+   UInt64 bytes = 0;
+   UInt64 startTime = Timer::getTimeMicroSec();
+   for (int run = 0; run < runs; ++run)
+   {
+      for (std::vector<TestMessage>::const_iterator i = messages.begin(); i != messages.end(); ++i)
+      {
+         scan(*i, i->text.size(), 0);
+         bytes += i->text.size();
+      }
+   }
+   UInt64 elapsed = Timer::getTimeMicroSec() - startTime;
+   if (elapsed == 0)
+   {
+      elapsed = 1;
+   }
+   return (double)bytes / (double)elapsed;  // bytes per microsecond == MB/s
+}
+
+int
+main(int argc, char* argv[])
+{
+   int runs = 20000;
+   Data dir(".");
+   for (int i = 1; i < argc; ++i)
+   {
+      if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+      {
+         runs = atoi(argv[++i]);
+      }
+      else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+      {
+         dir = argv[++i];
+      }
+      else
+      {
+         cerr << "Usage: " << argv[0] << " [-r <runs>] [-d <dir>]" << endl;
+         return 1;
+      }
+   }
+
+   std::vector<TestMessage> torture;
+   for (const char** file = rfc4475Files; *file; ++file)
+   {
+      ifstream is((dir + "/" + *file).c_str(), ios::in | ios::binary);
+      if (!is)
+      {
+         continue;
+      }
+      ostringstream contents;
+      contents << is.rdbuf();
+      TestMessage message;
+      message.name = *file;
+      message.text = Data(contents.str());
+      torture.push_back(message);
+   }
+   if (torture.empty())
+   {
+      cerr << "No RFC 4475 messages found in " << dir << "; only timing INVITE/REGISTER" << endl;
+   }
+
+   std::vector<TestMessage> traffic;
+   TestMessage message;
+   message.name = "INVITE";
+   message.text = invite;
+   traffic.push_back(message);
+   message.name = "REGISTER";
+   message.text = registration;
+   traffic.push_back(message);
+
+   std::vector<TestMessage> all(torture);
+   all.insert(all.end(), traffic.begin(), traffic.end());
+
+   const MsgHeaderScanner::ScanMode best = MsgHeaderScanner::setScanMode(MsgHeaderScanner::smBest);
+   std::vector<MsgHeaderScanner::ScanMode> modes;
+   modes.push_back(MsgHeaderScanner::smScalar);
+   if (MsgHeaderScanner::setScanMode(MsgHeaderScanner::smSse2) == MsgHeaderScanner::smSse2)
+   {
+      modes.push_back(MsgHeaderScanner::smSse2);
+   }
+   if (MsgHeaderScanner::setScanMode(MsgHeaderScanner::smAvx2) == MsgHeaderScanner::smAvx2)
+   {
+      modes.push_back(MsgHeaderScanner::smAvx2);
+   }
+   cout << "Best scan mode: " << modeName(best) << endl;
+
+   // Every mode must see the same messages, however the input is chunked.
+   const unsigned int chunkSizes[] = { 1, 7, 64, 0xFFFFFFFF };
+   int mismatches = 0;
+   for (std::vector<TestMessage>::const_iterator i = all.begin(); i != all.end(); ++i)
+   {
+      for (unsigned int c = 0; c < sizeof(chunkSizes) / sizeof(chunkSizes[0]); ++c)
+      {
+         MsgHeaderScanner::setScanMode(MsgHeaderScanner::smScalar);
+         Data expected;
+         scan(*i, chunkSizes[c], &expected);
+         for (size_t m = 1; m < modes.size(); ++m)
+         {
+            MsgHeaderScanner::setScanMode(modes[m]);
+            Data outcome;
+            scan(*i, chunkSizes[c], &outcome);
+            if (outcome != expected)
+            {
+               cerr << i->name << ": " << modeName(modes[m]) << " differs from scalar"
+                    << " with chunks of " << chunkSizes[c] << endl;
+               ++mismatches;
+            }
+         }
+      }
+   }
+   if (mismatches)
+   {
+      return 1;
+   }
+   cout << all.size() << " messages scan identically in every mode" << endl;
+
+   for (size_t m = 0; m < modes.size(); ++m)
+   {
+      MsgHeaderScanner::setScanMode(modes[m]);
+      cout << modeName(modes[m]) << ":";
+      if (!torture.empty())
+      {
+         cout << " RFC 4475 " << timeScans(torture, runs / 10 + 1) << " MB/s,";
+      }
+      cout << " INVITE/REGISTER " << timeScans(traffic, runs) << " MB/s" << endl;
+   }
+
+   MsgHeaderScanner::setScanMode(MsgHeaderScanner::smBest);
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -14,6 +14,7 @@
 #include "rutil/Logger.hxx"
 #include "rutil/ParseBuffer.hxx"
 #include "rutil/Inserter.hxx"
+#include "rutil/ThreadIf.hxx"
 
 using namespace resip;
 using namespace std;
@@ -24,6 +25,31 @@ using namespace std;
 
 //vis -o to make binary bodies text
 
+// Copies one message over and over; copying must leave the original
+// untouched, so several of these can run at once.
+class CopyThread : public ThreadIf
+{
+   public:
+      CopyThread(const SipMessage& msg) : mMsg(msg), mLast(0), mOk(true) {}
+      ~CopyThread() { delete mLast; }
+
+      virtual void thread()
+      {
+         for (int i = 0; i < 2000; ++i)
+         {
+            SipMessage* copy = new SipMessage(mMsg);
+            mOk = mOk && copy->getRawBody().getBuffer() == mMsg.getRawBody().getBuffer();
+            delete mLast;
+            mLast = copy;
+         }
+      }
+
+      const SipMessage& mMsg;
+      // kept past the original
+      SipMessage* mLast;
+      bool mOk;
+};
+
 int
 main(int argc, char** argv)
 {
@@ -2296,6 +2322,174 @@ main(int argc, char** argv)
       assert( msg->header(h_ContentLength).value() == 0 );
    }
 
+   {
+      // Copies made with shareReceiveBuffers set refer to the original
+      // message's text, and keep it alive after the original is gone.
+      Data txt("INVITE sip:bob@biloxi.example.com SIP/2.0\r\n"
+         "Via: SIP/2.0/UDP pc33.atlanta.example.com;branch=z9hG4bKnashds8\r\n"
+         "Max-Forwards: 70\r\n"
+         "To: Bob <sip:bob@biloxi.example.com>\r\n"
+         "From: Alice <sip:alice@atlanta.example.com>;tag=1928301774\r\n"
+         "Call-ID: a84b4c76e66710\r\n"
+         "CSeq: 314159 INVITE\r\n"
+         "Contact: <sip:alice@pc33.atlanta.example.com>\r\n"
+         "X-Custom: kept as is\r\n"
+         "Content-Type: application/sdp\r\n"
+         "Content-Length: 4\r\n"
+         "\r\n"
+         "v=0\n");
+
+      SipMessage::shareReceiveBuffers = true;
+      SipMessage* orig = SipMessage::make(txt, true /* isExternal */);
+      orig->header(h_Vias).front();
+      SipMessage* first = new SipMessage(*orig);
+      SipMessage* second = new SipMessage(*orig);
+      SipMessage::shareReceiveBuffers = false;
+
+      assert(first->getRawBody().getBuffer() == orig->getRawBody().getBuffer());
+      assert(!first->getRawBody().ownsBuffer());
+      assert(second->getRawBody().getBuffer() == orig->getRawBody().getBuffer());
+      delete orig;
+
+      first->header(h_Vias).push_front(Via());
+      first->header(h_Vias).front().transport() = "UDP";
+      first->header(h_Vias).front().sentHost() = "proxy.example.com";
+      first->header(h_MaxForwards).value() = 69;
+      Data encoded(Data::from(*first));
+      assert(encoded.find("Via: SIP/2.0/UDP proxy.example.com;branch=") != Data::npos);
+      assert(encoded.find("Via: SIP/2.0/UDP pc33.atlanta.example.com;branch=z9hG4bKnashds8") != Data::npos);
+      assert(encoded.find("Max-Forwards: 69") != Data::npos);
+      assert(encoded.find("X-Custom: kept as is") != Data::npos);
+      assert(encoded.find("\r\n\r\nv=0\n") != Data::npos);
+      delete first;
+
+      assert(second->header(h_To).uri().user() == "bob");
+      assert(second->header(h_CSeq).sequence() == 314159);
+      assert(Data::from(*second).find("Call-ID: a84b4c76e66710") != Data::npos);
+
+      // a copy of a copy shares as well
+      SipMessage::shareReceiveBuffers = true;
+      SipMessage* third = new SipMessage(*second);
+      SipMessage::shareReceiveBuffers = false;
+      delete second;
+      assert(third->header(h_From).param(p_tag) == "1928301774");
+      assert(third->getContents());
+      delete third;
+   }
+
+   {
+      // several threads copying one message share its buffers safely
+      Data txt("INVITE sip:bob@biloxi.example.com SIP/2.0\r\n"
+         "Via: SIP/2.0/UDP pc33.atlanta.example.com;branch=z9hG4bKnashds8\r\n"
+         "Max-Forwards: 70\r\n"
+         "To: Bob <sip:bob@biloxi.example.com>\r\n"
+         "From: Alice <sip:alice@atlanta.example.com>;tag=1928301774\r\n"
+         "Call-ID: a84b4c76e66710\r\n"
+         "CSeq: 314159 INVITE\r\n"
+         "Content-Type: application/sdp\r\n"
+         "Content-Length: 4\r\n"
+         "\r\n"
+         "v=0\n");
+
+      SipMessage::shareReceiveBuffers = true;
+      SipMessage* orig = SipMessage::make(txt, true /* isExternal */);
+      SipMessage::shareReceiveBuffers = false;
+      orig->header(h_Vias).front();
+
+      const int numThreads = 4;
+      CopyThread* threads[numThreads];
+      for (int i = 0; i < numThreads; ++i)
+      {
+         threads[i] = new CopyThread(*orig);
+         threads[i]->run();
+      }
+      for (int i = 0; i < numThreads; ++i)
+      {
+         threads[i]->join();
+      }
+      delete orig;
+
+      for (int i = 0; i < numThreads; ++i)
+      {
+         assert(threads[i]->mOk);
+         Data encoded(Data::from(*threads[i]->mLast));
+         assert(encoded.find("Call-ID: a84b4c76e66710") != Data::npos);
+         assert(encoded.find("\r\n\r\nv=0\n") != Data::npos);
+         delete threads[i];
+      }
+   }
+
+   {
+      // Only headers that were changed (or accessed through a non-const
+      // accessor) are re-serialized on encode; everything else, including
+      // headers that were only read, goes out as received.
+      Data txt("INVITE sip:bob@biloxi.example.com SIP/2.0\r\n"
+         "Via: SIP/2.0/UDP pc33.atlanta.example.com;branch=z9hG4bKnashds8\r\n"
+         "Max-Forwards: 70\r\n"
+         "To:Bob<sip:bob@biloxi.example.com>\r\n"
+         "From:Alice<sip:alice@atlanta.example.com>;tag=1928301774\r\n"
+         "Call-ID: a84b4c76e66710\r\n"
+         "CSeq: 314159 INVITE\r\n"
+         "Contact:<sip:alice@pc33.atlanta.example.com>\r\n"
+         "Content-Length: 0\r\n"
+         "\r\n");
+
+      auto_ptr<SipMessage> msg(SipMessage::make(txt, true /* isExternal */));
+      assert(msg->const_header(h_From).uri().host() == "atlanta.example.com");
+      assert(msg->const_header(h_To).uri().user() == "bob");
+      assert(msg->const_header(h_Contacts).front().uri().user() == "alice");
+
+      SipMessage copy(*msg);
+      copy.header(h_MaxForwards).value()--;
+      copy.header(h_Contacts).front().uri().user() = "carol";
+      Data encoded(Data::from(copy));
+      assert(encoded.find("To: Bob<sip:bob@biloxi.example.com>\r\n") != Data::npos);
+      assert(encoded.find("From: Alice<sip:alice@atlanta.example.com>;tag=1928301774\r\n") != Data::npos);
+      assert(encoded.find("Contact: <sip:carol@pc33.atlanta.example.com>\r\n") != Data::npos);
+      assert(encoded.find("Max-Forwards: 69\r\n") != Data::npos);
+   }
+
+   {
+      // A message that outgrows the embedded pool continues in arena blocks,
+      // or on the heap once the arena is disabled.
+      Data txt("INVITE sip:bob@biloxi.example.com SIP/2.0\r\n");
+      for (int i = 0; i < 80; ++i)
+      {
+         txt += "X-Extension-" + Data(i) + ": value" + Data(i) + "\r\n";
+      }
+      txt += "Via: SIP/2.0/UDP pc33.atlanta.example.com;branch=z9hG4bKnashds8\r\n"
+             "Max-Forwards: 70\r\n"
+             "To: Bob <sip:bob@biloxi.example.com>\r\n"
+             "From: Alice <sip:alice@atlanta.example.com>;tag=1928301774\r\n"
+             "Call-ID: a84b4c76e66710\r\n"
+             "CSeq: 314159 INVITE\r\n"
+             "Content-Length: 0\r\n"
+             "\r\n";
+
+      SipMessage::PoolStatistics before = SipMessage::getPoolStatistics();
+      {
+         auto_ptr<SipMessage> msg(SipMessage::make(txt));
+         assert(msg->header(ExtensionHeader("X-Extension-79")).front().value() == "value79");
+      }
+      SipMessage::PoolStatistics after = SipMessage::getPoolStatistics();
+      assert(after.messages > before.messages);
+      assert(after.overflowedMessages == before.overflowedMessages + 1);
+      assert(after.arenaBlocks > before.arenaBlocks);
+
+      size_t blockSize = SipMessage::poolArenaBlockSize;
+      SipMessage::poolArenaBlockSize = 0;
+      before = after;
+      {
+         auto_ptr<SipMessage> msg(SipMessage::make(txt));
+         assert(msg->header(ExtensionHeader("X-Extension-79")).front().value() == "value79");
+      }
+      SipMessage::poolArenaBlockSize = blockSize;
+      after = SipMessage::getPoolStatistics();
+      assert(after.arenaBlocks == before.arenaBlocks);
+      assert(after.heapAllocations > before.heapAllocations);
+      SipMessage::dumpPoolStatistics();
+   }
+
    resipCerr << "\nTEST OK" << endl;
    return 0;
 }
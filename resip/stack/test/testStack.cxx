@@ -155,7 +155,8 @@ class SipStackAndThread
    public:
       SipStackAndThread(const char *tType,
         AsyncProcessHandler *notifyDn=0,
-        AsyncProcessHandler *notifyUp=0);
+        AsyncProcessHandler *notifyUp=0,
+        unsigned int shards=1);
          ~SipStackAndThread() {
          destroy();
       }
@@ -203,7 +204,8 @@ class SipStackAndThread
 
 
 SipStackAndThread::SipStackAndThread(const char *tType,
- AsyncProcessHandler *notifyDn, AsyncProcessHandler *notifyUp)
+ AsyncProcessHandler *notifyDn, AsyncProcessHandler *notifyUp,
+ unsigned int shards)
   : mStack(0), 
       mThread(0), 
       mSelIntr(0), 
@@ -249,6 +251,7 @@ SipStackAndThread::SipStackAndThread(const char *tType,
    options.mAsyncProcessHandler = mEventIntr?mEventIntr
       :(mSelIntr?mSelIntr:notifyDn);
    options.mPollGrp = mPollGrp;
+   options.mTransactionShards = shards;
    mStack = new SipStack(options);
    
    mStack->setFallbackPostNotify(notifyUp);
@@ -594,6 +597,7 @@ main(int argc, char* argv[])
    int sendSleepMs = 0;
    int cManager=0;
    int statisticsInterval=60;
+   int shards=1;
 
 #if defined(HAVE_POPT_H)
 
@@ -620,6 +624,7 @@ main(int argc, char* argv[])
       {"sleep",       0,   POPT_ARG_INT,    &sendSleepMs,0, "time (ms) to sleep after each sent request", 0},
       {"use-congestion-manager",0, POPT_ARG_NONE, &cManager ,   0, "use a CongestionManager", 0},
       {"statistics-interval",       0,   POPT_ARG_INT,    &statisticsInterval,0, "time in seconds between statistics logging", 0},
+      {"shards",      0,   POPT_ARG_INT,    &shards,    0, "number of transaction shards (threads with multithreadedstack)", 0},
       POPT_AUTOHELP
       { NULL, 0, 0, NULL, 0 }
    };
@@ -646,6 +651,7 @@ main(int argc, char* argv[])
      <<" bindIf="<<bindIfAddr
      <<" listen="<<doListen
      <<" tf="<<tpFlags
+     <<" shards="<<shards
      <<"." << endl;
 
    const char *eachThreadType = threadType;
@@ -678,8 +684,8 @@ main(int argc, char* argv[])
    {
       notifyUp = &sharedUp;
    }
-   SipStackAndThread receiver(eachThreadType, commonIntr, notifyUp);
-   SipStackAndThread sender(eachThreadType, commonIntr, notifyUp);
+   SipStackAndThread receiver(eachThreadType, commonIntr, notifyUp, shards);
+   SipStackAndThread sender(eachThreadType, commonIntr, notifyUp, shards);
    receiver.getStack().setStatisticsInterval(statisticsInterval);
    sender.getStack().setStatisticsInterval(statisticsInterval);
 
@@ -1,6 +1,7 @@
 #include <iostream>
 #include "resip/stack/TransactionMessage.hxx"
 #include "resip/stack/TimerQueue.hxx"
+#include "resip/stack/TimerWheel.hxx"
 #include "resip/stack/TuSelector.hxx"
 #include "rutil/Fifo.hxx"
 #include "rutil/TimeLimitFifo.hxx"
@@ -25,10 +26,120 @@ isNear(int value, int reference, int epsilon=250)
    return (diff < epsilon);
 }
 
+// checks that every timer fires in the process() call that first passes
+// its expiry
+class WheelChecker
+{
+   public:
+      WheelChecker() : mLast(0), mNow(0), mFired(0) {}
+
+      void processTimer(const TransactionTimer& timer)
+      {
+         assert(timer.getWhen() <= mNow);
+         assert(timer.getWhen() > mLast);
+         ++mFired;
+      }
+
+      void advance(TimerWheel<TransactionTimer>& wheel, UInt64 now)
+      {
+         mLast = mNow;
+         mNow = now;
+         wheel.process(mNow, *this);
+      }
+
+      UInt64 mLast;
+      UInt64 mNow;
+      int mFired;
+};
+
+static void
+testTimerWheel()
+{
+   cerr << "testTimerWheel" << endl;
+
+   TimerWheel<TransactionTimer> wheel;
+   WheelChecker checker;
+   checker.mNow = Timer::getTimeMs();
+   const UInt64 start = checker.mNow;
+
+   // offsets straddling each wheel boundary, and the overflow list
+   const unsigned long offsets[] = { 1, 2, 255, 256, 257, 300, 1000, 16383,
+                                     16384, 16385, 32000, 1048575, 1048576,
+                                     5000000, 67108863, 67108864, 70000000 };
+   const int count = sizeof(offsets)/sizeof(offsets[0]);
+   for (int i = 0; i < count; ++i)
+   {
+      wheel.add(TransactionTimer(offsets[i], Timer::TimerA, "wheel"));
+   }
+   assert(wheel.size() == (size_t)count);
+
+   TimerWheel<TransactionTimer>::Handle canceled =
+      wheel.add(TransactionTimer(500, Timer::TimerB, "canceled"));
+   wheel.cancel(canceled);
+   assert(wheel.size() == (size_t)count);
+
+   // step through the first second a millisecond at a time, then jump
+   // straight to each expiry; nextWhen() must never overshoot a timer
+   UInt64 now = start;
+   while (!wheel.empty())
+   {
+      UInt64 next = wheel.nextWhen();
+      assert(next >= checker.mNow);
+      for (int i = 0; i < count; ++i)
+      {
+         UInt64 when = offsets[i] + start;
+         assert(when <= checker.mNow || next <= when + 2);
+      }
+      now = (now < start + 1000) ? now + 1 : resipMax(next, checker.mNow + 1);
+      checker.advance(wheel, now);
+   }
+   assert(checker.mFired == count);
+
+   // drain hands back whatever is left
+   for (int i = 0; i < 10; ++i)
+   {
+      wheel.add(TransactionTimer(i*100000, Timer::TimerA, "drain"));
+   }
+   std::vector<TransactionTimer> drained;
+   wheel.drain(drained);
+   assert(drained.size() == 10);
+   assert(wheel.empty());
+
+   // TransactionTimerQueue cancels by transaction id, keeping client and
+   // server transactions with the same id apart
+   Fifo<TimerMessage> r;
+   TransactionTimerQueue queue(r, true);
+   queue.add(Timer::TimerA, "tid", 10);
+   queue.add(Timer::TimerB, "tid", 20);
+   queue.add(Timer::TimerG, "tid", 20);
+   queue.add(Timer::TimerA, "other", 10);
+   assert(queue.size() == 4);
+   assert(isNear(queue.msTillNextTimer(), 10, 5));
+   queue.cancel("tid", true);
+   assert(queue.size() == 2);
+   queue.cancel("tid", true);
+   assert(queue.size() == 2);
+   usleep(50*1000);
+   queue.process();
+   assert(queue.size() == 0);
+   assert(r.size() == 2);
+   queue.cancel("tid", false);
+   assert(queue.msTillNextTimer() == INT_MAX);
+   delete r.getNext();
+   delete r.getNext();
+
+   // payloads still queued are freed with the queue
+   TimeLimitFifo<Message> f(0, 0);
+   TimeLimitTimerQueue appQueue(f, true);
+   appQueue.add(100000, new TimerMessage("app", Timer::TimerA, 100000));
+   assert(appQueue.size() == 1);
+}
+
 
 int
 main()
 {
+   testTimerWheel();
 
    TimeLimitFifo<Message> f(0, 0);
    Fifo<TimerMessage> r;
@@ -0,0 +1,377 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <iostream>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "resip/stack/Connection.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "resip/stack/ssl/Security.hxx"
+#include "resip/stack/ssl/TlsHandshakePool.hxx"
+#include "resip/stack/ssl/TlsTransport.hxx"
+#include "rutil/Atomic.hxx"
+#include "rutil/Condition.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/Log.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/Mutex.hxx"
+#include "rutil/ThreadIf.hxx"
+#include "rutil/Timer.hxx"
+
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+using namespace std;
+using namespace resip;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::TEST
+
+// Runs TLS handshakes against a TlsTransport whose handshakes are done by a
+// TlsHandshakePool, and destroys a connection while a worker is in the
+// middle of its handshake.  The test drives the transport itself, so the
+// main thread plays the transport thread.
+
+static SSL_CTX* clientCtx = 0;
+
+static void
+writeSelfSignedCert(const Data& certFile, const Data& keyFile)
+{
+   EC_KEY* ecKey = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+   assert(ecKey && EC_KEY_generate_key(ecKey) == 1);
+   EVP_PKEY* key = EVP_PKEY_new();
+   EVP_PKEY_assign_EC_KEY(key, ecKey);
+
+   X509* cert = X509_new();
+   X509_set_version(cert, 2);
+   ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+   X509_gmtime_adj(X509_get_notBefore(cert), 0);
+   X509_gmtime_adj(X509_get_notAfter(cert), 3600);
+   X509_set_pubkey(cert, key);
+   X509_NAME* name = X509_get_subject_name(cert);
+   X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0);
+   X509_set_issuer_name(cert, name);
+   assert(X509_sign(cert, key, EVP_sha256()) > 0);
+
+   FILE* fp = fopen(certFile.c_str(), "w");
+   assert(fp && PEM_write_X509(fp, cert) == 1);
+   fclose(fp);
+   fp = fopen(keyFile.c_str(), "w");
+   assert(fp && PEM_write_PrivateKey(fp, key, 0, 0, 0, 0, 0) == 1);
+   fclose(fp);
+
+   X509_free(cert);
+   EVP_PKEY_free(key);
+}
+
+// While the gate is closed, server handshakes stop in the SNI callback,
+// i.e. inside the SSL_do_handshake() of a pool worker.
+static Mutex gateMutex;
+static Condition gateCondition;
+static bool gateClosed = false;
+static bool inHandshake = false;
+static bool gateOpened = false;
+
+static int
+serverNameCallback(SSL* ssl, int* alert, void* arg)
+{
+   Lock lock(gateMutex);
+   inHandshake = true;
+   gateCondition.broadcast();
+   while(gateClosed)
+   {
+      gateCondition.wait(gateMutex);
+   }
+   return SSL_TLSEXT_ERR_OK;
+}
+
+class GateOpener : public ThreadIf
+{
+   public:
+      GateOpener(int delayMs) : mDelayMs(delayMs) {}
+      virtual void thread()
+      {
+         sleepMs(mDelayMs);
+         Lock lock(gateMutex);
+         gateClosed = false;
+         gateOpened = true;
+         gateCondition.broadcast();
+      }
+   private:
+      int mDelayMs;
+};
+
+class Client : public ThreadIf
+{
+   public:
+      Client(int port, int id) : mPort(port), mId(id), mLocalPort(0), mDone(false) {}
+
+      int localPort() const { return mLocalPort.load(); }
+      bool done() const { return mDone.load(); }
+
+      virtual void thread()
+      {
+         int fd = (int)::socket(AF_INET, SOCK_STREAM, 0);
+         assert(fd >= 0);
+         // don't hang the test if the server never answers
+         struct timeval tv;
+         tv.tv_sec = 10;
+         tv.tv_usec = 0;
+         setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
+
+         sockaddr_in addr;
+         memset(&addr, 0, sizeof(addr));
+         addr.sin_family = AF_INET;
+         addr.sin_port = htons(mPort);
+         addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+         int ret = ::connect(fd, (sockaddr*)&addr, sizeof(addr));
+         assert(ret == 0);
+         socklen_t len = sizeof(addr);
+         ret = getsockname(fd, (sockaddr*)&addr, &len);
+         assert(ret == 0);
+         mLocalPort.store(ntohs(addr.sin_port));
+
+         SSL* ssl = SSL_new(clientCtx);
+         SSL_set_fd(ssl, fd);
+         SSL_set_tlsext_host_name(ssl, "localhost");
+         if(SSL_connect(ssl) == 1)
+         {
+            Data msg("OPTIONS sip:localhost SIP/2.0\r\n"
+                     "Via: SIP/2.0/TLS 127.0.0.1:5061;branch=z9hG4bK-" + Data(mId) + "\r\n"
+                     "Max-Forwards: 70\r\n"
+                     "To: <sip:localhost>\r\n"
+                     "From: <sip:client@localhost>;tag=" + Data(mId) + "\r\n"
+                     "Call-ID: " + Data(mId) + "@localhost\r\n"
+                     "CSeq: 1 OPTIONS\r\n"
+                     "Content-Length: 0\r\n"
+                     "\r\n");
+            ret = SSL_write(ssl, msg.data(), (int)msg.size());
+            assert(ret == (int)msg.size());
+            // keep the connection up until the server has read it
+            while(!isShutdown())
+            {
+               sleepMs(10);
+            }
+            SSL_shutdown(ssl);
+         }
+         SSL_free(ssl);
+         closeSocket(fd);
+         mDone.store(true);
+      }
+
+   private:
+      int mPort;
+      int mId;
+      Atomic<int> mLocalPort;
+      Atomic<bool> mDone;
+};
+
+static void
+processFor(TlsTransport& transport, int ms)
+{
+   FdSet fdset;
+   transport.buildFdSet(fdset);
+   fdset.selectMilliSeconds(ms);
+   transport.process(fdset);
+}
+
+static void
+testHandshakes(TlsTransport& transport, Fifo<TransactionMessage>& fifo)
+{
+   const int numClients = 8;
+   std::vector<Client*> clients;
+   for(int i = 0; i < numClients; ++i)
+   {
+      clients.push_back(new Client(transport.port(), i));
+      clients.back()->run();
+   }
+
+   int received = 0;
+   UInt64 end = Timer::getTimeMs() + 10000;
+   while(received < numClients && Timer::getTimeMs() < end)
+   {
+      processFor(transport, 10);
+      TransactionMessage* msg;
+      while((msg = fifo.getNext(-1)) != 0)
+      {
+         SipMessage* sip = dynamic_cast<SipMessage*>(msg);
+         if(sip)
+         {
+            assert(sip->isRequest() && sip->method() == OPTIONS);
+            ++received;
+         }
+         delete msg;
+      }
+   }
+   assert(received == numClients);
+
+   TlsHandshakePool::Statistics stats = transport.getHandshakePool()->getStatistics();
+   cerr << "handshakes: submitted=" << stats.submitted << " rejected=" << stats.rejected
+        << " max queued=" << stats.maxQueued << endl;
+   assert(stats.threads == 2);
+   // each handshake takes more than one step, and at most 4 fit in the pool
+   assert(stats.submitted >= (unsigned long)numClients);
+   // steps are only handed out when a socket has something for them, so
+   // polling the transport must not turn into a stream of rejected steps
+   assert(stats.rejected <= 2 * (unsigned long)numClients);
+   assert(stats.queued == 0 && stats.running == 0);
+
+   // the stack statistics report the pools that exist now
+   TlsHandshakePool::Statistics total = TlsHandshakePool::getTotalStatistics();
+   assert(total.threads == stats.threads);
+   assert(total.submitted == stats.submitted && total.rejected == stats.rejected);
+
+   for(std::vector<Client*>::iterator it = clients.begin(); it != clients.end(); ++it)
+   {
+      (*it)->shutdown();
+      (*it)->join();
+      delete *it;
+   }
+}
+
+static void
+testCancelWhileRunning(TlsTransport& transport)
+{
+   {
+      Lock lock(gateMutex);
+      gateClosed = true;
+      inHandshake = false;
+   }
+
+   Client client(transport.port(), 100);
+   client.run();
+
+   // wait until a worker is stuck in the server's handshake
+   UInt64 end = Timer::getTimeMs() + 10000;
+   for(;;)
+   {
+      processFor(transport, 10);
+      Lock lock(gateMutex);
+      if(inHandshake)
+      {
+         break;
+      }
+      assert(Timer::getTimeMs() < end);
+   }
+   assert(transport.getHandshakePool()->getStatistics().running == 1);
+
+   Connection* conn = transport.getConnectionManager().findConnection(
+      Tuple("127.0.0.1", client.localPort(), V4, TLS));
+   assert(conn);
+
+   // Destroying the connection cancels its handshake, which has to wait
+   // for the worker to let go of the SSL object.
+   GateOpener opener(200);
+   opener.run();
+   delete conn;
+   {
+      Lock lock(gateMutex);
+      assert(gateOpened);
+   }
+   opener.join();
+
+   TlsHandshakePool::Statistics stats = transport.getHandshakePool()->getStatistics();
+   assert(stats.queued == 0 && stats.running == 0);
+   // the finished step of the destroyed connection is not handed back
+   assert(transport.getHandshakePool()->popCompleted() == 0);
+   assert(!transport.getConnectionManager().findConnection(
+      Tuple("127.0.0.1", client.localPort(), V4, TLS)));
+
+   // the client sees the connection go away
+   end = Timer::getTimeMs() + 10000;
+   while(!client.done())
+   {
+      processFor(transport, 10);
+      assert(Timer::getTimeMs() < end);
+   }
+   client.join();
+}
+
+int
+main(int argc, const char** argv)
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+
+   Data certFile("testTlsHandshakePool-" + Data((int)getpid()) + "-cert.pem");
+   Data keyFile("testTlsHandshakePool-" + Data((int)getpid()) + "-key.pem");
+   writeSelfSignedCert(certFile, keyFile);
+
+   clientCtx = SSL_CTX_new(SSLv23_method());
+   assert(clientCtx);
+   SSL_CTX_set_verify(clientCtx, SSL_VERIFY_NONE, 0);
+
+   {
+      Security security;
+      Fifo<TransactionMessage> fifo;
+      TlsBaseTransport::HandshakeWorkerThreads = 2;
+      TlsBaseTransport::MaxPendingHandshakes = 4;
+      TlsTransport transport(fifo, 0, V4, "127.0.0.1", security, "localhost",
+                             SecurityTypes::SSLv23, 0, Compression::Disabled, 0,
+                             SecurityTypes::None, false, certFile, keyFile);
+      assert(transport.getHandshakePool());
+      SSL_CTX_set_tlsext_servername_callback(transport.getCtx(), serverNameCallback);
+
+      testHandshakes(transport, fifo);
+      testCancelWhileRunning(transport);
+   }
+
+   SSL_CTX_free(clientCtx);
+   unlink(certFile.c_str());
+   unlink(keyFile.c_str());
+
+   cerr << "All OK" << endl;
+   return 0;
+}
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
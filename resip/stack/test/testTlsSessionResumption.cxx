@@ -0,0 +1,250 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <iostream>
+
+#include "resip/stack/ssl/Security.hxx"
+#include "rutil/Log.hxx"
+#include "rutil/Logger.hxx"
+
+#include <openssl/bio.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+using namespace std;
+using namespace resip;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::TEST
+
+// Checks that a second handshake with a context set up by
+// BaseSecurity::setSessionCaching resumes the first one's session.  The
+// client and server talk over an in-memory BIO pair.
+
+class TestSecurity : public Security
+{
+   public:
+      using BaseSecurity::setSessionCaching;
+};
+
+static X509* cert = 0;
+static EVP_PKEY* key = 0;
+
+static void
+makeSelfSignedCert()
+{
+   EC_KEY* ecKey = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+   assert(ecKey && EC_KEY_generate_key(ecKey) == 1);
+   key = EVP_PKEY_new();
+   EVP_PKEY_assign_EC_KEY(key, ecKey);
+
+   cert = X509_new();
+   X509_set_version(cert, 2);
+   ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+   X509_gmtime_adj(X509_get_notBefore(cert), 0);
+   X509_gmtime_adj(X509_get_notAfter(cert), 3600);
+   X509_set_pubkey(cert, key);
+   X509_NAME* name = X509_get_subject_name(cert);
+   X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0);
+   X509_set_issuer_name(cert, name);
+   assert(X509_sign(cert, key, EVP_sha256()) > 0);
+}
+
+static SSL_CTX*
+makeServerCtx(TestSecurity& security, const Data& sessionIdContext, bool tls13)
+{
+   SSL_CTX* ctx = SSL_CTX_new(SSLv23_method());
+   assert(ctx);
+   assert(SSL_CTX_use_certificate(ctx, cert) == 1);
+   assert(SSL_CTX_use_PrivateKey(ctx, key) == 1);
+#if defined(SSL_OP_NO_TLSv1_3)
+   if(!tls13)
+   {
+      SSL_CTX_set_options(ctx, SSL_OP_NO_TLSv1_3);
+   }
+#endif
+   security.setSessionCaching(ctx, sessionIdContext);
+   return ctx;
+}
+
+static bool
+pending(SSL* ssl, int ret)
+{
+   if(ret == 1)
+   {
+      return false;
+   }
+   int err = SSL_get_error(ssl, ret);
+   return err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE;
+}
+
+/// @return true if the handshake resumed {offer}; the client's session
+///         is stored in {session}
+static bool
+handshake(SSL_CTX* serverCtx, SSL_CTX* clientCtx, SSL_SESSION* offer, SSL_SESSION*& session)
+{
+   SSL* server = SSL_new(serverCtx);
+   SSL* client = SSL_new(clientCtx);
+   BIO* serverBio = 0;
+   BIO* clientBio = 0;
+   assert(BIO_new_bio_pair(&serverBio, 0, &clientBio, 0) == 1);
+   SSL_set_bio(server, serverBio, serverBio);
+   SSL_set_bio(client, clientBio, clientBio);
+   SSL_set_accept_state(server);
+   SSL_set_connect_state(client);
+   if(offer)
+   {
+      assert(SSL_set_session(client, offer) == 1);
+   }
+
+   int clientRet = 0;
+   int serverRet = 0;
+   for(int i = 0; i < 20 && (clientRet != 1 || serverRet != 1); ++i)
+   {
+      clientRet = SSL_do_handshake(client);
+      serverRet = SSL_do_handshake(server);
+      assert(clientRet == 1 || pending(client, clientRet));
+      assert(serverRet == 1 || pending(server, serverRet));
+   }
+   assert(clientRet == 1 && serverRet == 1);
+
+   // TLS 1.3 tickets follow the handshake; reading data makes the client
+   // take them
+   char c = 'x';
+   assert(SSL_write(server, &c, 1) == 1);
+   assert(SSL_read(client, &c, 1) == 1);
+
+   bool resumed = SSL_session_reused(client) != 0;
+   assert(resumed == (SSL_session_reused(server) != 0));
+   session = SSL_get1_session(client);
+   assert(session);
+
+   // OpenSSL drops the session of a connection freed without a close_notify
+   assert(SSL_shutdown(client) >= 0);
+   assert(SSL_shutdown(server) >= 0);
+   SSL_free(client);
+   SSL_free(server);
+   return resumed;
+}
+
+static void
+testResumption(TestSecurity& security, SSL_CTX* clientCtx, bool tls13)
+{
+   SSL_CTX* serverCtx = makeServerCtx(security, "test", tls13);
+   SSL_SESSION* first = 0;
+   SSL_SESSION* second = 0;
+   assert(!handshake(serverCtx, clientCtx, 0, first));
+   assert(handshake(serverCtx, clientCtx, first, second));
+   SSL_SESSION_free(second);
+
+   if(BaseSecurity::TlsTicketKeyLifetimeSeconds > 0)
+   {
+      // the ticket keys are shared, so another context with the same
+      // session id context resumes the session too...
+      SSL_CTX* otherCtx = makeServerCtx(security, "test", tls13);
+      assert(handshake(otherCtx, clientCtx, first, second));
+      SSL_SESSION_free(second);
+      SSL_CTX_free(otherCtx);
+   }
+
+   // ...but one with a different session id context does not
+   SSL_CTX* foreignCtx = makeServerCtx(security, "foreign", tls13);
+   assert(!handshake(foreignCtx, clientCtx, first, second));
+   SSL_SESSION_free(second);
+   SSL_CTX_free(foreignCtx);
+
+   SSL_SESSION_free(first);
+   SSL_CTX_free(serverCtx);
+}
+
+int
+main(int argc, const char** argv)
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+   TestSecurity security;
+   makeSelfSignedCert();
+
+   SSL_CTX* clientCtx = SSL_CTX_new(SSLv23_method());
+   assert(clientCtx);
+
+   // session tickets
+   testResumption(security, clientCtx, false);
+#if defined(TLS1_3_VERSION)
+   testResumption(security, clientCtx, true);
+#endif
+
+   // session ids
+   BaseSecurity::TlsTicketKeyLifetimeSeconds = 0;
+   testResumption(security, clientCtx, false);
+
+   // resumption off
+   BaseSecurity::TlsSessionCacheSize = 0;
+   {
+      SSL_CTX* serverCtx = makeServerCtx(security, "test", false);
+      SSL_SESSION* first = 0;
+      SSL_SESSION* second = 0;
+      assert(!handshake(serverCtx, clientCtx, 0, first));
+      assert(!handshake(serverCtx, clientCtx, first, second));
+      SSL_SESSION_free(second);
+      SSL_SESSION_free(first);
+      SSL_CTX_free(serverCtx);
+   }
+
+   SSL_CTX_free(clientCtx);
+   X509_free(cert);
+   EVP_PKEY_free(key);
+
+   cerr << "All OK" << endl;
+   return 0;
+}
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,192 @@
+#if !defined(RESIP_ATOMIC_HXX)
+#define RESIP_ATOMIC_HXX
+
+#if defined(WIN32) && !defined(__GNUC__)
+#include <winsock2.h>
+#include <windows.h>
+#include <string.h>
+#endif
+
+namespace resip
+{
+
+/**
+   @brief A value of integral or pointer type that can be read and modified
+   from several threads without a lock.
+
+   Every operation is sequentially consistent. T must be no wider than 64
+   bits.
+
+   @note Only what the lock-free containers in rutil need is provided; this
+   is not a general replacement for std::atomic.
+*/
+template <class T>
+class Atomic
+{
+   public:
+      explicit Atomic(T value=T()) : mValue(value) {}
+
+      T load() const
+      {
+#if defined(__GNUC__)
+         return __atomic_load_n(&mValue, __ATOMIC_SEQ_CST);
+#else
+         T value = mValue;
+         MemoryBarrier();
+         return value;
+#endif
+      }
+
+      void store(T value)
+      {
+#if defined(__GNUC__)
+         __atomic_store_n(&mValue, value, __ATOMIC_SEQ_CST);
+#else
+         exchange(value);
+#endif
+      }
+
+      /// @return the previous value
+      T exchange(T value)
+      {
+#if defined(__GNUC__)
+         return __atomic_exchange_n(&mValue, value, __ATOMIC_SEQ_CST);
+#else
+         if (sizeof(T) == 8)
+         {
+            return fromBits(InterlockedExchange64((volatile LONGLONG*)&mValue,
+                                                  (LONGLONG)toBits(value)));
+         }
+         return fromBits(InterlockedExchange((volatile LONG*)&mValue,
+                                             (LONG)toBits(value)));
+#endif
+      }
+
+      /// @brief stores {desired} if the current value is {expected};
+      /// otherwise loads the current value into {expected}
+      /// @return true if {desired} was stored
+      bool compareExchange(T& expected, T desired)
+      {
+#if defined(__GNUC__)
+         return __atomic_compare_exchange_n(&mValue, &expected, desired, false,
+                                            __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#else
+         T previous;
+         if (sizeof(T) == 8)
+         {
+            previous = fromBits(InterlockedCompareExchange64((volatile LONGLONG*)&mValue,
+                                                             (LONGLONG)toBits(desired),
+                                                             (LONGLONG)toBits(expected)));
+         }
+         else
+         {
+            previous = fromBits(InterlockedCompareExchange((volatile LONG*)&mValue,
+                                                           (LONG)toBits(desired),
+                                                           (LONG)toBits(expected)));
+         }
+         if (previous == expected)
+         {
+            return true;
+         }
+         expected = previous;
+         return false;
+#endif
+      }
+
+      /// @brief adds {delta}; integral types only
+      /// @return the previous value
+      T fetchAdd(T delta)
+      {
+#if defined(__GNUC__)
+         return __atomic_fetch_add(&mValue, delta, __ATOMIC_SEQ_CST);
+#else
+         if (sizeof(T) == 8)
+         {
+            return (T)InterlockedExchangeAdd64((volatile LONGLONG*)&mValue, (LONGLONG)delta);
+         }
+         return (T)InterlockedExchangeAdd((volatile LONG*)&mValue, (LONG)delta);
+#endif
+      }
+
+      /// @brief subtracts {delta}; integral types only
+      /// @return the previous value
+      T fetchSub(T delta)
+      {
+         return fetchAdd(T(0) - delta);
+      }
+
+   private:
+#if !defined(__GNUC__)
+      static unsigned __int64 toBits(T value)
+      {
+         unsigned __int64 bits = 0;
+         memcpy(&bits, &value, sizeof(T));
+         return bits;
+      }
+
+      static T fromBits(unsigned __int64 bits)
+      {
+         T value;
+         memcpy(&value, &bits, sizeof(T));
+         return value;
+      }
+#endif
+
+      volatile T mValue;
+
+      // disabled
+      Atomic(const Atomic&);
+      Atomic& operator=(const Atomic&);
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
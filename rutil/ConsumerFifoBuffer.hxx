@@ -5,11 +5,12 @@
 
 namespace resip
 {
-template<typename T>
+// FifoT may also be a LockFreeFifo<T>
+template<typename T, typename FifoT = Fifo<T> >
 class ConsumerFifoBuffer
 {
    public:
-      ConsumerFifoBuffer(Fifo<T>& fifo,
+      ConsumerFifoBuffer(FifoT& fifo,
                            unsigned int bufferSize=8) :
          mFifo(fifo),
          mBufferSize(bufferSize)
@@ -50,8 +51,8 @@ class ConsumerFifoBuffer
       }
 
    private:
-      Fifo<T>& mFifo;
-      typename Fifo<T>::Messages mBuffer;
+      FifoT& mFifo;
+      typename FifoT::Messages mBuffer;
       unsigned int mBufferSize;
 };
 }
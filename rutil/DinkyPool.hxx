@@ -15,13 +15,51 @@ namespace resip
    allocation will be performed, and fallback to the system new/delete will be 
    used (deallocating a pool allocated object will _not_ free up room in the 
    pool; the memory will be freed when the DinkyPool goes away).
+
+   Optionally, once the S bytes are used up, allocations can be carved out of
+   arena blocks of arenaBlockSize bytes taken from the heap, up to
+   maxArenaBytes in total, so that an overflowing object costs one heap
+   allocation per block rather than one per allocation. Arena blocks are
+   freed with the DinkyPool. Requests larger than a quarter of a block, or
+   beyond maxArenaBytes (or MaxArenaBlocks blocks), still use the system
+   new/delete.
+
+   Arena allocations are rounded up to one of a few size classes, and a
+   deallocated one goes on a free list for its class, so the storage left
+   behind when a vector or string in the object grows is reused instead of
+   adding to the arena. Objects are routinely handed to deallocate() that
+   were made with plain new, so deallocate() finds out whether a pointer is
+   in an arena block with a binary search over the blocks, which are kept
+   sorted by address; anything else is passed on to the system delete.
 */
 template<unsigned int S>
 class DinkyPool : public PoolBase
 {
    public:
-      DinkyPool() : count(0), heapBytes(0) {}
-      ~DinkyPool(){}
+      explicit DinkyPool(size_t arenaBlockSize=0, size_t maxArenaBytes=0) :
+         count(0),
+         heapBytes(0),
+         heapAllocations(0),
+         mArenaBlockSize((arenaBlockSize+7)/8*8),
+         mMaxArenaBytes(maxArenaBytes),
+         mArenaBlocks(0),
+         mArenaReuses(0),
+         mArenaNext(0),
+         mArenaEnd(0)
+      {
+         for(unsigned int i = 0; i < NumSizeClasses; ++i)
+         {
+            mFree[i] = 0;
+         }
+      }
+
+      ~DinkyPool()
+      {
+         for(unsigned int i = 0; i < mArenaBlocks; ++i)
+         {
+            ::operator delete(mBlocks[i]);
+         }
+      }
 
       void* allocate(size_t size)
       {
@@ -31,7 +69,34 @@ class DinkyPool : public PoolBase
             count+=(size+7)/8;
             return result;
          }
+
+         size_t bytes = sizeof(Chunk) + size;
+         unsigned int sizeClass = 0;
+         while(sizeClass < NumSizeClasses && classBytes(sizeClass) < bytes)
+         {
+            ++sizeClass;
+         }
+         if(sizeClass < NumSizeClasses)
+         {
+            Chunk* chunk = mFree[sizeClass];
+            if(chunk)
+            {
+               mFree[sizeClass] = chunk->next;
+               ++mArenaReuses;
+            }
+            else
+            {
+               chunk = carve(classBytes(sizeClass));
+            }
+            if(chunk)
+            {
+               chunk->sizeClass = sizeClass;
+               return chunk + 1;
+            }
+         }
+
          heapBytes += size;
+         ++heapAllocations;
          return ::operator new(size);
       }
 
@@ -41,6 +106,14 @@ class DinkyPool : public PoolBase
          {
             return;
          }
+         if(inArena(ptr))
+         {
+            Chunk* chunk = (Chunk*)ptr - 1;
+            size_t sizeClass = chunk->sizeClass;
+            chunk->next = mFree[sizeClass];
+            mFree[sizeClass] = chunk;
+            return;
+         }
          ::operator delete(ptr);
       }
 
@@ -50,17 +123,103 @@ class DinkyPool : public PoolBase
       }
 
       size_t getHeapBytes() const { return heapBytes; }
+      size_t getHeapAllocations() const { return heapAllocations; }
       size_t getPoolBytes() const { return count*8; }
       size_t getPoolSizeBytes() const { return sizeof(mBuf); }
+      size_t getArenaBytes() const { return mArenaBlocks*mArenaBlockSize; }
+      size_t getArenaBlocks() const { return mArenaBlocks; }
+      /// allocations served from a size class free list
+      size_t getArenaReuses() const { return mArenaReuses; }
+
+      /// arena blocks a pool will take, whatever maxArenaBytes says
+      enum { MaxArenaBlocks = 32 };
 
    private:
       // disabled
       DinkyPool& operator=(const DinkyPool& rhs);
       DinkyPool(const DinkyPool& other);
 
+      // Precedes every arena allocation; while the allocation is on a free
+      // list the same word links the list.
+      union Chunk
+      {
+         Chunk* next;
+         size_t sizeClass;
+         char align[8];
+      };
+
+      enum
+      {
+         NumSizeClasses = 15 // 16 .. 2048 bytes
+      };
+
+      // 16, 24, 32, 48, 64, 96 ...: at most a third of a chunk is rounding
+      static size_t classBytes(unsigned int sizeClass)
+      {
+         return size_t(sizeClass & 1 ? 24 : 16) << (sizeClass/2);
+      }
+
+      Chunk* carve(size_t bytes)
+      {
+         if(bytes > mArenaBlockSize/4)
+         {
+            return 0;
+         }
+         if(!mArenaNext || bytes > size_t(mArenaEnd - mArenaNext))
+         {
+            if(mArenaBlocks == MaxArenaBlocks ||
+               (mArenaBlocks+1)*mArenaBlockSize > mMaxArenaBytes)
+            {
+               return 0;
+            }
+            char* block = (char*)::operator new(mArenaBlockSize);
+            unsigned int i = mArenaBlocks++;
+            for(; i > 0 && mBlocks[i-1] > block; --i)
+            {
+               mBlocks[i] = mBlocks[i-1];
+            }
+            mBlocks[i] = block;
+            mArenaNext = block;
+            mArenaEnd = block + mArenaBlockSize;
+         }
+         Chunk* chunk = (Chunk*)mArenaNext;
+         mArenaNext += bytes;
+         return chunk;
+      }
+
+      bool inArena(void* ptr) const
+      {
+         // last block starting at or before ptr
+         unsigned int lo = 0;
+         unsigned int hi = mArenaBlocks;
+         while(lo < hi)
+         {
+            unsigned int mid = (lo+hi)/2;
+            if((void*)mBlocks[mid] <= ptr)
+            {
+               lo = mid+1;
+            }
+            else
+            {
+               hi = mid;
+            }
+         }
+         return lo > 0 && ptr < (void*)(mBlocks[lo-1] + mArenaBlockSize);
+      }
+
       size_t count; // 8-byte chunks alloced so far
       char mBuf[(S+7)/8][8]; // 8-byte chunks for alignment
       size_t heapBytes;
+      size_t heapAllocations;
+
+      const size_t mArenaBlockSize;
+      const size_t mMaxArenaBytes;
+      unsigned int mArenaBlocks;
+      size_t mArenaReuses;
+      char* mArenaNext;
+      char* mArenaEnd;
+      char* mBlocks[MaxArenaBlocks]; // sorted by address
+      Chunk* mFree[NumSizeClasses];
 };
 
 }
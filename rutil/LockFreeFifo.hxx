@@ -0,0 +1,498 @@
+#if !defined(RESIP_LOCKFREEFIFO_HXX)
+#define RESIP_LOCKFREEFIFO_HXX
+
+#include <deque>
+#include <time.h>
+#ifdef WIN32
+#include <winsock2.h>
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+
+#include "rutil/ResipAssert.h"
+#include "rutil/AbstractFifo.hxx"
+#include "rutil/AsyncProcessHandler.hxx"
+#include "rutil/Atomic.hxx"
+
+namespace resip
+{
+
+/**
+   @brief A multi-producer/single-consumer message queue with the same
+   interface as Fifo.
+
+   Adding never takes a lock: producers link their message onto the tail of
+   a singly linked list with an atomic exchange (Vyukov's MPSC queue). The
+   consumer unlinks from the head without a lock as well. Only when the
+   consumer finds the queue empty and has to block does it take mMutex and
+   wait on mCondition; producers check whether the consumer is waiting and
+   only then take mMutex to signal it. As with Fifo, the interruptor is
+   notified when the queue goes from empty to non-empty.
+
+   @note getNext(), getMultiple() and clear() must only ever be called from
+   one thread at a time. Use Fifo for queues that are drained by a pool of
+   threads.
+
+   Size, time depth and service time are kept for CongestionManager like
+   the other fifos, but getTimeDepth() is approximate while messages are
+   being added and removed concurrently.
+
+   @ingroup message_passing
+*/
+template <class Msg>
+class LockFreeFifo : public FifoStatsInterface
+{
+   public:
+      LockFreeFifo(AsyncProcessHandler* interruptor=0);
+      virtual ~LockFreeFifo();
+
+      typedef std::deque<Msg*> Messages;
+
+      /// Add a message to the fifo.
+      size_t add(Msg* msg);
+      size_t addMultiple(Messages& msgs);
+
+      /** Returns the first message available. It will wait if no
+       *  messages are available.
+       */
+      Msg* getNext();
+
+      /** Returns the next message available. Will wait up to
+       *  ms milliseconds if no information is available, and returns 0 if
+       *  none arrives. RESIP_FIFO_NOWAIT and RESIP_FIFO_FOREVER have the
+       *  same meaning as for Fifo.
+       */
+      Msg* getNext(int ms);
+
+      void getMultiple(Messages& other, unsigned int max);
+      bool getMultiple(int ms, Messages& other, unsigned int max);
+
+      bool empty() const;
+      virtual unsigned int size() const;
+      bool messageAvailable() const;
+
+      /// delete all elements in the queue; consumer thread only
+      virtual void clear();
+      void setInterruptor(AsyncProcessHandler* interruptor);
+
+      virtual time_t getTimeDepth() const;
+      virtual size_t getCountDepth() const;
+      virtual time_t expectedWaitTimeMilliSec() const;
+      virtual time_t averageServiceTimeMicroSec() const;
+
+   private:
+      class Node
+      {
+         public:
+            Node(Msg* msg, time_t when) : mNext(0), mMsg(msg), mTime(when) {}
+            Atomic<Node*> mNext;
+            Msg* mMsg;
+            time_t mTime;
+      };
+
+      // returns true if this made the queue go from empty to non-empty
+      bool push(Node* node);
+      void wakeConsumer();
+      bool waitForMessage(int ms);
+      static Node* nextOf(Node* node);
+      Msg* pop();
+      void onFifoPolled();
+
+      // producers swap themselves in here
+      Atomic<Node*> mTail;
+      // consumer only; the node whose message was taken last
+      Node* mHead;
+
+      Atomic<UInt32> mSize;
+      Atomic<int> mConsumerWaiting;
+      Atomic<time_t> mOldestTime;
+      Atomic<AsyncProcessHandler*> mInterruptor;
+
+      Mutex mMutex;
+      Condition mCondition;
+
+      // service time sampling; written by the consumer only
+      UInt64 mLastSampleTakenMicroSec;
+      UInt32 mCounter;
+      UInt32 mAverageServiceTimeMicroSec;
+
+      // disabled
+      LockFreeFifo(const LockFreeFifo&);
+      LockFreeFifo& operator=(const LockFreeFifo&);
+};
+
+template <class Msg>
+LockFreeFifo<Msg>::LockFreeFifo(AsyncProcessHandler* interruptor) :
+   FifoStatsInterface(),
+   mTail(0),
+   mHead(new Node(0, 0)),
+   mSize(0),
+   mConsumerWaiting(0),
+   mOldestTime(0),
+   mInterruptor(interruptor),
+   mLastSampleTakenMicroSec(0),
+   mCounter(0),
+   mAverageServiceTimeMicroSec(0)
+{
+   mTail.store(mHead);
+}
+
+template <class Msg>
+LockFreeFifo<Msg>::~LockFreeFifo()
+{
+   clear();
+   delete mHead;
+}
+
+template <class Msg>
+void
+LockFreeFifo<Msg>::setInterruptor(AsyncProcessHandler* interruptor)
+{
+   mInterruptor.store(interruptor);
+}
+
+template <class Msg>
+bool
+LockFreeFifo<Msg>::push(Node* node)
+{
+   Node* prev = mTail.exchange(node);
+   // Until this store the consumer cannot see node, or anything added
+   // after it; pop() waits out that window.
+   prev->mNext.store(node);
+   if (mSize.fetchAdd(1) == 0)
+   {
+      mOldestTime.store(node->mTime);
+      return true;
+   }
+   return false;
+}
+
+template <class Msg>
+void
+LockFreeFifo<Msg>::wakeConsumer()
+{
+   // The consumer raises mConsumerWaiting before its last look at mSize,
+   // and we look at mConsumerWaiting after raising mSize, so at least one
+   // of us sees the other.
+   if (mConsumerWaiting.load())
+   {
+      Lock lock(mMutex); (void)lock;
+      mCondition.signal();
+   }
+}
+
+template <class Msg>
+size_t
+LockFreeFifo<Msg>::add(Msg* msg)
+{
+   bool wasEmpty = push(new Node(msg, time(0)));
+   wakeConsumer();
+   AsyncProcessHandler* interruptor = mInterruptor.load();
+   if (wasEmpty && interruptor)
+   {
+      // Only do this when the queue goes from empty to not empty.
+      interruptor->handleProcessNotification();
+   }
+   return mSize.load();
+}
+
+template <class Msg>
+size_t
+LockFreeFifo<Msg>::addMultiple(Messages& msgs)
+{
+   if (msgs.empty())
+   {
+      return mSize.load();
+   }
+
+   time_t now = time(0);
+   bool wasEmpty = false;
+   while (!msgs.empty())
+   {
+      if (push(new Node(msgs.front(), now)))
+      {
+         wasEmpty = true;
+      }
+      msgs.pop_front();
+   }
+   wakeConsumer();
+   AsyncProcessHandler* interruptor = mInterruptor.load();
+   if (wasEmpty && interruptor)
+   {
+      interruptor->handleProcessNotification();
+   }
+   return mSize.load();
+}
+
+template <class Msg>
+bool
+LockFreeFifo<Msg>::waitForMessage(int ms)
+{
+   onFifoPolled();
+   if (mSize.load() > 0)
+   {
+      return true;
+   }
+   if (ms < 0)
+   {
+      return false;
+   }
+
+   const UInt64 end(Timer::getTimeMs() + (unsigned int)ms);
+   Lock lock(mMutex); (void)lock;
+   mConsumerWaiting.store(1);
+   while (mSize.load() == 0)
+   {
+      if (ms == 0)
+      {
+         mCondition.wait(mMutex);
+         continue;
+      }
+      const UInt64 now(Timer::getTimeMs());
+      if (now >= end)
+      {
+         break;
+      }
+      mCondition.wait(mMutex, (unsigned int)(end - now));
+   }
+   mConsumerWaiting.store(0);
+   return mSize.load() > 0;
+}
+
+template <class Msg>
+typename LockFreeFifo<Msg>::Node*
+LockFreeFifo<Msg>::nextOf(Node* node)
+{
+   Node* next;
+   while ((next = node->mNext.load()) == 0)
+   {
+      // A producer has swapped itself into mTail but not yet linked its
+      // node; this is a matter of a few instructions.
+#ifdef WIN32
+      Sleep(0);
+#else
+      sched_yield();
+#endif
+   }
+   return next;
+}
+
+template <class Msg>
+Msg*
+LockFreeFifo<Msg>::pop()
+{
+   resip_assert(mSize.load() > 0);
+   Node* next = nextOf(mHead);
+
+   Msg* msg = next->mMsg;
+   delete mHead;
+   mHead = next;
+   mHead->mMsg = 0;
+
+   if (mLastSampleTakenMicroSec == 0)
+   {
+      mLastSampleTakenMicroSec = Timer::getTimeMicroSec();
+   }
+   ++mCounter;
+
+   if (mSize.fetchSub(1) > 1)
+   {
+      // Only we shrink the queue, so the next node is on its way. When
+      // the queue has emptied instead, the next producer sets the time.
+      mOldestTime.store(nextOf(mHead)->mTime);
+   }
+   return msg;
+}
+
+template <class Msg>
+Msg*
+LockFreeFifo<Msg>::getNext()
+{
+   waitForMessage(RESIP_FIFO_FOREVER);
+   return pop();
+}
+
+template <class Msg>
+Msg*
+LockFreeFifo<Msg>::getNext(int ms)
+{
+   if (!waitForMessage(ms))
+   {
+      return 0;
+   }
+   return pop();
+}
+
+template <class Msg>
+void
+LockFreeFifo<Msg>::getMultiple(Messages& other, unsigned int max)
+{
+   getMultiple(RESIP_FIFO_FOREVER, other, max);
+}
+
+template <class Msg>
+bool
+LockFreeFifo<Msg>::getMultiple(int ms, Messages& other, unsigned int max)
+{
+   resip_assert(other.empty());
+   if (!waitForMessage(ms))
+   {
+      return false;
+   }
+   // take what is there now; stop early rather than wait for a producer
+   // that is half way through an add
+   do
+   {
+      other.push_back(pop());
+   }
+   while (other.size() < max && mSize.load() > 0 && mHead->mNext.load() != 0);
+   return true;
+}
+
+template <class Msg>
+bool
+LockFreeFifo<Msg>::empty() const
+{
+   return mSize.load() == 0;
+}
+
+template <class Msg>
+unsigned int
+LockFreeFifo<Msg>::size() const
+{
+   return mSize.load();
+}
+
+template <class Msg>
+bool
+LockFreeFifo<Msg>::messageAvailable() const
+{
+   return mSize.load() > 0;
+}
+
+template <class Msg>
+void
+LockFreeFifo<Msg>::clear()
+{
+   while (mSize.load() > 0)
+   {
+      delete pop();
+   }
+}
+
+template <class Msg>
+time_t
+LockFreeFifo<Msg>::getTimeDepth() const
+{
+   if (mSize.load() == 0)
+   {
+      return 0;
+   }
+   time_t oldest = mOldestTime.load();
+   time_t now = time(0);
+   return now > oldest ? now - oldest : 0;
+}
+
+template <class Msg>
+size_t
+LockFreeFifo<Msg>::getCountDepth() const
+{
+   return mSize.load();
+}
+
+template <class Msg>
+time_t
+LockFreeFifo<Msg>::expectedWaitTimeMilliSec() const
+{
+   return ((mAverageServiceTimeMicroSec*mSize.load())+500)/1000;
+}
+
+template <class Msg>
+time_t
+LockFreeFifo<Msg>::averageServiceTimeMicroSec() const
+{
+   return mAverageServiceTimeMicroSec;
+}
+
+template <class Msg>
+void
+LockFreeFifo<Msg>::onFifoPolled()
+{
+   // same sampling as AbstractFifo::onFifoPolled(), except that the sample
+   // starts when the consumer takes its first message rather than when the
+   // queue becomes non-empty, since producers do not touch these members
+   const UInt32 size = mSize.load();
+   if(mLastSampleTakenMicroSec &&
+      mCounter &&
+      (mCounter >= 64 || size == 0))
+   {
+      UInt64 now(Timer::getTimeMicroSec());
+      UInt64 diff = now-mLastSampleTakenMicroSec;
+
+      if(mCounter >= 4096)
+      {
+         mAverageServiceTimeMicroSec=(UInt32)resipIntDiv(diff, mCounter);
+      }
+      else
+      {
+         mAverageServiceTimeMicroSec=(UInt32)resipIntDiv(
+               diff+((4096-mCounter)*mAverageServiceTimeMicroSec),
+               4096U);
+      }
+      mCounter=0;
+      mLastSampleTakenMicroSec = (size == 0) ? 0 : now;
+   }
+}
+
+} // namespace resip
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
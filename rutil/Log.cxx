@@ -1,9 +1,11 @@
 #include "rutil/Socket.hxx"
 
 #include "rutil/ResipAssert.h"
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <stdio.h>
+#include <string.h>
 #include "rutil/Data.hxx"
 
 #ifndef WIN32
@@ -19,6 +21,7 @@
 #include "rutil/ThreadIf.hxx"
 #include "rutil/Subsystem.hxx"
 #include "rutil/SysLogStream.hxx"
+#include "rutil/Time.hxx"
 #include "rutil/WinLeakCheck.hxx"
 
 using namespace resip;
@@ -64,6 +67,127 @@ Log::mDescriptions[][32] = {"NONE", "EMERG", "ALERT", "CRIT", "ERR", "WARNING",
 
 Mutex Log::_mutex;
 
+Atomic<int> Log::mAsyncEnabled(0);
+Atomic<int> Log::mAsyncWriting(0);
+unsigned int Log::mAsyncRingSize = 0;
+Log::AsyncWriter* Log::mAsyncWriter = 0;
+std::vector<Log::AsyncRing*> Log::mAsyncRings;
+Mutex Log::mAsyncRingsMutex;
+Mutex Log::mAsyncDrainMutex;
+Atomic<unsigned long> Log::mAsyncDropped(0);
+ThreadIf::TlsKey* Log::mAsyncRingKey;
+
+/**
+   Lines one thread has logged that are not written yet. Only the owning
+   thread adds lines and only the thread holding Log::mAsyncDrainMutex takes
+   them out, so neither needs a lock.
+*/
+class Log::AsyncRing
+{
+   public:
+      explicit AsyncRing(unsigned int size)
+         : mDropped(0),
+           mOrphaned(0),
+           mSize(1),
+           mHead(0),
+           mTail(0)
+      {
+         while (mSize < size)
+         {
+            mSize <<= 1;
+         }
+         mBuffer = new char[mSize];
+      }
+      ~AsyncRing() { delete [] mBuffer; }
+
+      /// @return false if the line was dropped
+      bool push(ThreadData* target, Level level, const Data& line)
+      {
+         Header header;
+         header.target = target;
+         header.level = level;
+         header.length = (unsigned int)line.size();
+
+         const unsigned int head = mHead.load();
+         if (mSize - (head - mTail.load()) < sizeof(header) + header.length)
+         {
+            mDropped.fetchAdd(1);
+            return false;
+         }
+         copyIn(head, (const char*)&header, sizeof(header));
+         copyIn(head + sizeof(header), line.data(), header.length);
+         mHead.store(head + sizeof(header) + header.length);
+         return true;
+      }
+
+      /// @return false if there is nothing to take out
+      bool pop(ThreadData*& target, Level& level, Data& line)
+      {
+         const unsigned int tail = mTail.load();
+         if (tail == mHead.load())
+         {
+            return false;
+         }
+         Header header;
+         copyOut(tail, (char*)&header, sizeof(header));
+         line.clear();
+         const unsigned int offset = (tail + sizeof(header)) & (mSize - 1);
+         const unsigned int first = resipMin(header.length, mSize - offset);
+         line.append(mBuffer + offset, first);
+         line.append(mBuffer, header.length - first);
+         mTail.store(tail + sizeof(header) + header.length);
+         target = header.target;
+         level = header.level;
+         return true;
+      }
+
+      Atomic<unsigned long> mDropped; // since the last drainAsync()
+      Atomic<int> mOrphaned; // the owning thread has exited
+
+   private:
+      struct Header
+      {
+         ThreadData* target;
+         Level level;
+         unsigned int length;
+      };
+
+      void copyIn(unsigned int position, const char* data, unsigned int length)
+      {
+         const unsigned int offset = position & (mSize - 1);
+         const unsigned int first = resipMin(length, mSize - offset);
+         memcpy(mBuffer + offset, data, first);
+         memcpy(mBuffer, data + first, length - first);
+      }
+
+      void copyOut(unsigned int position, char* data, unsigned int length)
+      {
+         const unsigned int offset = position & (mSize - 1);
+         const unsigned int first = resipMin(length, mSize - offset);
+         memcpy(data, mBuffer + offset, first);
+         memcpy(data + first, mBuffer, length - first);
+      }
+
+      char* mBuffer;
+      unsigned int mSize; // a power of two
+      // free running; the bytes in use are mHead - mTail
+      Atomic<unsigned int> mHead;
+      Atomic<unsigned int> mTail;
+};
+
+class Log::AsyncWriter : public ThreadIf
+{
+   public:
+      void thread()
+      {
+         while (!waitForShutdown(20))
+         {
+            Log::drainAsync();
+         }
+         Log::drainAsync();
+      }
+};
+
 extern "C"
 {
    void freeThreadSetting(void* setting)
@@ -71,6 +195,15 @@ extern "C"
       delete static_cast<Log::ThreadSetting*>(setting);
    }
 
+   void freeAsyncRing(void* pRing)
+   {
+      if (pRing)
+      {
+         // drainAsync() frees it once it is empty
+         static_cast<Log::AsyncRing*>(pRing)->mOrphaned.store(1);
+      }
+   }
+
    void freeLocalLogger(void* pThreadData)
    {
       if (pThreadData)
@@ -94,6 +227,9 @@ LogStaticInitializer::LogStaticInitializer()
 
          Log::mLocalLoggerKey = new ThreadIf::TlsKey;
          ThreadIf::tlsKeyCreate(*Log::mLocalLoggerKey, freeLocalLogger);
+
+         Log::mAsyncRingKey = new ThreadIf::TlsKey;
+         ThreadIf::tlsKeyCreate(*Log::mAsyncRingKey, freeAsyncRing);
    }
 }
 LogStaticInitializer::~LogStaticInitializer()
@@ -107,6 +243,9 @@ LogStaticInitializer::~LogStaticInitializer()
 
       ThreadIf::tlsKeyDelete(*Log::mLocalLoggerKey);
       delete Log::mLocalLoggerKey;
+
+      ThreadIf::tlsKeyDelete(*Log::mAsyncRingKey);
+      delete Log::mAsyncRingKey;
    }
 }
 
@@ -705,11 +844,14 @@ int Log::localLoggerReinitialize(Log::LocalLoggerId loggerId,
                                  const char * logFileName,
                                  ExternalLogger* externalLogger)
 {
+   flushAsync();
    return mLocalLoggerMap.reinitialize(loggerId, type, level, logFileName, externalLogger);
 }
 
 int Log::localLoggerRemove(Log::LocalLoggerId loggerId)
 {
+   // queued lines refer to the logger
+   flushAsync();
    return mLocalLoggerMap.remove(loggerId);
 }
 
@@ -751,6 +893,125 @@ Log::droppingPrivileges(uid_t uid, pid_t pid)
 }
 #endif
 
+void
+Log::startAsyncWriter(unsigned int ringSize)
+{
+   resip_assert(ringSize > 0);
+   if (mAsyncWriter)
+   {
+      return;
+   }
+   // rings that already exist keep their size
+   mAsyncRingSize = ringSize;
+   mAsyncWriter = new AsyncWriter;
+   mAsyncWriter->run();
+   mAsyncEnabled.store(1);
+}
+
+void
+Log::stopAsyncWriter()
+{
+   if (!mAsyncWriter)
+   {
+      return;
+   }
+   mAsyncEnabled.store(0);
+   mAsyncWriter->shutdown();
+   mAsyncWriter->join();
+   delete mAsyncWriter;
+   mAsyncWriter = 0;
+   // a thread that saw mAsyncEnabled set may still be pushing; once
+   // mAsyncWriting is zero every later line is written synchronously
+   while (mAsyncWriting.load() != 0)
+   {
+      sleepMs(0);
+   }
+   drainAsync();
+}
+
+void
+Log::flushAsync()
+{
+   if (mAsyncWriter)
+   {
+      drainAsync();
+   }
+}
+
+bool
+Log::writeAsync(ThreadData& data, Level level, const Data& line)
+{
+   mAsyncWriting.fetchAdd(1);
+   if (!mAsyncEnabled.load())
+   {
+      // stopAsyncWriter() has started; write this line directly
+      mAsyncWriting.fetchSub(1);
+      return false;
+   }
+   AsyncRing* ring = static_cast<AsyncRing*>(ThreadIf::tlsGetValue(*mAsyncRingKey));
+   if (!ring)
+   {
+      ring = new AsyncRing(mAsyncRingSize);
+      {
+         Lock lock(mAsyncRingsMutex);
+         mAsyncRings.push_back(ring);
+      }
+      ThreadIf::tlsSetValue(*mAsyncRingKey, ring);
+   }
+   ring->push(&data, level, line);
+   mAsyncWriting.fetchSub(1);
+   return true;
+}
+
+void
+Log::drainAsync()
+{
+   unsigned long dropped = 0;
+   {
+      Lock drainLock(mAsyncDrainMutex);
+      std::vector<AsyncRing*> rings;
+      {
+         Lock lock(mAsyncRingsMutex);
+         rings = mAsyncRings;
+      }
+
+      ThreadData* target;
+      Level level;
+      Data line;
+      for (std::vector<AsyncRing*>::iterator it = rings.begin(); it != rings.end(); ++it)
+      {
+         AsyncRing* ring = *it;
+         // checked first; an orphaned ring gets no more lines
+         const bool orphaned = ring->mOrphaned.load() != 0;
+         {
+            Lock lock(_mutex);
+            while (ring->pop(target, level, line))
+            {
+               std::ostream& instance = target->Instance((unsigned int)line.size()+2);
+               if (target->type() == Syslog)
+               {
+                  instance << level;
+               }
+               instance << line << std::endl;
+            }
+         }
+         dropped += ring->mDropped.exchange(0);
+         if (orphaned)
+         {
+            Lock lock(mAsyncRingsMutex);
+            mAsyncRings.erase(std::find(mAsyncRings.begin(), mAsyncRings.end(), ring));
+            delete ring;
+         }
+      }
+   }
+
+   if (dropped)
+   {
+      mAsyncDropped.fetchAdd(dropped);
+      GenericLog(Subsystem::NONE, Log::Warning, << dropped << " log lines dropped, the log rings were full");
+   }
+}
+
 bool
 Log::isLogging(Log::Level level, const resip::Subsystem& sub)
 {
@@ -913,6 +1174,12 @@ Log::Guard::~Guard()
       return;
    }
 
+   if (logType != resip::Log::VSDebugWindow && resip::Log::mAsyncEnabled.load() &&
+       resip::Log::writeAsync(resip::Log::getLoggerData(), mLevel, mData))
+   {
+      return;
+   }
+
    resip::Lock lock(resip::Log::_mutex);
    // !dlb! implement VSDebugWindow as an external logger
    if (logType == resip::Log::VSDebugWindow)
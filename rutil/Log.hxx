@@ -9,7 +9,9 @@
 #endif
 
 #include <set>
+#include <vector>
 
+#include "rutil/Atomic.hxx"
 #include "rutil/Mutex.hxx"
 #include "rutil/Lock.hxx"
 #include "rutil/HashMap.hxx"
@@ -36,6 +38,7 @@ extern "C"
 {
    // Forward declaration to make it friend of Log class.
    void freeLocalLogger(void* pThreadData);
+   void freeAsyncRing(void* pRing);
 };
 
 
@@ -200,10 +203,10 @@ class Log
       /** @brief Return logging level for current thread.
       * If thread has no local logger attached, then return global logging level.
       */
-      static Level level() { Lock lock(_mutex); return getLoggerData().mLevel; }
+      static Level level() { return getLoggerData().mLevel; }
       /** Return logging level for given local logger. Use 0 to set global logging level. */
       static Level level(LocalLoggerId loggerId);
-      static LocalLoggerId id() { Lock lock(_mutex); return getLoggerData().id(); }
+      static LocalLoggerId id() { return getLoggerData().id(); }
       static void setMaxLineCount(unsigned int maxLineCount);
       static void setMaxLineCount(unsigned int maxLineCount, LocalLoggerId loggerId);
       static void setMaxByteCount(unsigned int maxByteCount);
@@ -259,6 +262,22 @@ class Log
       static bool isLogging(Log::Level level, const Subsystem&);
       static void OutputToWin32DebugWindow(const Data& result);      
       static void reset(); ///< Frees logger stream
+
+      /** @brief Write log lines on a thread of their own instead of on the
+          thread that logs them.
+
+          Each logging thread copies its lines into a ring of {ringSize}
+          bytes; lines that do not fit are dropped and counted. Cout, Cerr,
+          File and Syslog output is affected; an ExternalLogger is still
+          called on the logging thread.
+      */
+      static void startAsyncWriter(unsigned int ringSize = 256*1024);
+      /// Writes what is queued and goes back to writing on the logging thread.
+      static void stopAsyncWriter();
+      /// Writes what is queued so far.
+      static void flushAsync();
+      /// Lines dropped so far because a logging thread's ring was full.
+      static unsigned long getAsyncDroppedCount() { return mAsyncDropped.load(); }
 #ifndef WIN32
       static void droppingPrivileges(uid_t uid, pid_t pid);
 #endif
@@ -399,6 +418,7 @@ class Log
       };
 
       friend void ::freeLocalLogger(void* pThreadData);
+      friend void ::freeAsyncRing(void* pRing);
       friend class LogStaticInitializer;
       static LocalLoggerMap mLocalLoggerMap;
       static ThreadIf::TlsKey* mLocalLoggerKey;
@@ -411,6 +431,23 @@ class Log
       static ThreadIf::TlsKey* mLevelKey;
 #endif
       static HashMap<int, Level> mServiceToLevel;
+
+      /// see startAsyncWriter()
+      class AsyncRing;
+      class AsyncWriter;
+      friend class AsyncWriter;
+      /// @return false if the line must be written synchronously instead
+      static bool writeAsync(ThreadData& data, Level level, const Data& line);
+      static void drainAsync();
+      static Atomic<int> mAsyncEnabled;
+      static Atomic<int> mAsyncWriting; ///< threads inside writeAsync()
+      static unsigned int mAsyncRingSize;
+      static AsyncWriter* mAsyncWriter;
+      static std::vector<AsyncRing*> mAsyncRings;
+      static Mutex mAsyncRingsMutex; ///< protects mAsyncRings
+      static Mutex mAsyncDrainMutex; ///< held by the one thread emptying the rings
+      static Atomic<unsigned long> mAsyncDropped;
+      static ThreadIf::TlsKey* mAsyncRingKey;
 };
 
 /** @brief Interface functor for external logging.
@@ -2,6 +2,7 @@
 #define RESIP_SUBSYSTEM_HXX 
 
 #include <iostream>
+#include "rutil/Atomic.hxx"
 #include "rutil/Data.hxx"
 #include "rutil/Log.hxx"
 
@@ -49,15 +50,15 @@ class Subsystem
       static Subsystem REPRO;
       
       const Data& getSubsystem() const;
-      Log::Level getLevel() const { return mLevel; }
-      void setLevel(Log::Level level) { mLevel = level; }
+      Log::Level getLevel() const { return (Log::Level)mLevel.load(); }
+      void setLevel(Log::Level level) { mLevel.store(level); }
    protected:
       explicit Subsystem(const char* rhs) : mSubsystem(rhs), mLevel(Log::None) {};
       explicit Subsystem(const Data& rhs) : mSubsystem(rhs), mLevel(Log::None) {};
       Subsystem& operator=(const Data& rhs);
 
       Data mSubsystem;
-      Log::Level mLevel;
+      Atomic<int> mLevel; // read without a lock by every log statement
 
       friend EncodeStream& operator<<(EncodeStream& strm, const Subsystem& ss);
 };
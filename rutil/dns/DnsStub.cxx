@@ -115,6 +115,10 @@ DnsStub::~DnsStub()
    {
       delete *it;
    }
+   for (set<Refresh*>::iterator it = mRefreshes.begin(); it != mRefreshes.end(); ++it)
+   {
+      delete *it;
+   }
 
    setPollGrp(0);
    delete mDnsProvider;
@@ -373,6 +377,11 @@ DnsStub::removeQuery(Query* query)
    {
       mQueries.erase(it);
    }
+   QueryMap::iterator q = mQueryMap.find(QueryKey(query->target(), query->rrType(), query->proto()));
+   if (q != mQueryMap.end() && q->second == query)
+   {
+      mQueryMap.erase(q);
+   }
 }
 
 void
@@ -417,7 +426,7 @@ DnsStub::Query::Query(DnsStub& stub, ResultTransform* transform, ResultConverter
      mTarget(target),
      mProto(proto),
      mReQuery(0),
-     mSink(s),
+     mSinks(1, s),
      mFollowCname(followCname)
 {
    resip_assert(s);
@@ -469,7 +478,9 @@ DnsStub::Query::go()
    int status = 0;
    bool cached = false;
    Data targetToQuery = mTarget;
-   cached = mStub.mRRCache.lookup(mTarget, mRRType, mProto, records, status);
+   // set when the records handed out below are stale or about to expire
+   bool refresh = false;
+   cached = mStub.mRRCache.lookup(mTarget, mRRType, mProto, records, status, refresh);
 
    if (!cached)
    {
@@ -490,7 +501,7 @@ DnsStub::Query::go()
    if (targetToQuery != mTarget)
    {
       StackLog(<< mTarget << " mapped to CNAME " << targetToQuery);
-      cached = mStub.mRRCache.lookup(targetToQuery, mRRType, mProto, records, status);
+      cached = mStub.mRRCache.lookup(targetToQuery, mRRType, mProto, records, status, refresh);
    }
 
    if (!cached)
@@ -511,12 +522,12 @@ DnsStub::Query::go()
             {
                 mTransform->transform(mTarget, mRRType, result);
             }
-            mResultConverter->notifyUser(mTarget, queryStatus, mStub.errorMessage(queryStatus), result, mSink);
+            notifyUsers(queryStatus, mStub.errorMessage(queryStatus), result);
          }
          else
          {
             // Not in hosts file - return error - or.. we could fallback to doing the lookupRecords call on the local named
-            mResultConverter->notifyUser(mTarget, ARES_ENOTFOUND, mStub.errorMessage(ARES_ENOTFOUND), Empty, mSink);
+            notifyUsers(ARES_ENOTFOUND, mStub.errorMessage(ARES_ENOTFOUND), Empty);
          }
          mReQuery = 0;
          mStub.removeQuery(this);
@@ -535,7 +546,11 @@ DnsStub::Query::go()
       {
          mTransform->transform(mTarget, mRRType, records);
       }
-      mResultConverter->notifyUser(mTarget, status, mStub.errorMessage(status), records, mSink);
+      notifyUsers(status, mStub.errorMessage(status), records);
+      if (refresh)
+      {
+         mStub.refresh(targetToQuery, mRRType);
+      }
 
       mStub.removeQuery(this);
       delete this;
@@ -570,7 +585,7 @@ DnsStub::Query::process(int status, const unsigned char* abuf, const int alen)
                   {
                      mTransform->transform(mTarget, mRRType, result);
                   }
-                  mResultConverter->notifyUser(mTarget, queryStatus, mStub.errorMessage(queryStatus), result, mSink);
+                  notifyUsers(queryStatus, mStub.errorMessage(queryStatus), result);
                   mStub.removeQuery(this);
                   delete this;
                   return;
@@ -623,7 +638,7 @@ DnsStub::Query::process(int status, const unsigned char* abuf, const int alen)
 
       // For other error status values, we may also want to cacheTTL to delay
       // requeries. Especially if the server refuses.
-      mResultConverter->notifyUser(mTarget, status, mStub.errorMessage(status), Empty, mSink);
+      notifyUsers(status, mStub.errorMessage(status), Empty);
       mReQuery = 0;
       mStub.removeQuery(this);
       delete this;
@@ -645,7 +660,7 @@ DnsStub::Query::process(int status, const unsigned char* abuf, const int alen)
       catch (BaseException& e)
       {
          ErrLog(<< "Error parsing DNS record for " << mTarget << ": " << e.getMessage());
-         mResultConverter->notifyUser(mTarget, ARES_EFORMERR, e.getMessage(), Empty, mSink);
+         notifyUsers(ARES_EFORMERR, e.getMessage(), Empty);
          mStub.removeQuery(this);
          delete this;
          return;
@@ -655,7 +670,7 @@ DnsStub::Query::process(int status, const unsigned char* abuf, const int alen)
    int ancount = DNS_HEADER_ANCOUNT(abuf);
    if (ancount == 0)
    {
-      mResultConverter->notifyUser(mTarget, 0, mStub.errorMessage(0), Empty, mSink);
+      notifyUsers(0, mStub.errorMessage(0), Empty);
    }
    else
    {
@@ -675,7 +690,7 @@ DnsStub::Query::process(int status, const unsigned char* abuf, const int alen)
          {
             mTransform->transform(mTarget, mRRType, result);
          }
-         mResultConverter->notifyUser(mTarget, queryStatus, mStub.errorMessage(queryStatus), result, mSink);
+         notifyUsers(queryStatus, mStub.errorMessage(queryStatus), result);
       }
    }
 
@@ -686,6 +701,17 @@ DnsStub::Query::process(int status, const unsigned char* abuf, const int alen)
    }
 }
 
+void
+DnsStub::Query::notifyUsers(int status, const Data& msg, const DnsResourceRecordsByPtr& src)
+{
+   // Lookups made from the callbacks start a query of their own.
+   mStub.removeQuery(this);
+   for (std::vector<DnsResultSink*>::const_iterator it = mSinks.begin(); it != mSinks.end(); ++it)
+   {
+      mResultConverter->notifyUser(mTarget, status, msg, src, *it);
+   }
+}
+
 void
 DnsStub::Query::onDnsRaw(int status, const unsigned char* abuf, int alen)
 {
@@ -704,7 +730,7 @@ DnsStub::Query::followCname(const unsigned char* aptr, const unsigned char*abuf,
    if (ARES_SUCCESS != ares_expand_name(aptr, abuf, alen, &name, &len))
    {
       ErrLog(<< "Failed DNS preparse for " << targetToQuery);
-      mResultConverter->notifyUser(mTarget, ARES_EFORMERR, "Failed DNS preparse", Empty, mSink);
+      notifyUsers(ARES_EFORMERR, "Failed DNS preparse", Empty);
       bGotAnswers = false;
       return;
    }
@@ -719,7 +745,7 @@ DnsStub::Query::followCname(const unsigned char* aptr, const unsigned char*abuf,
    catch (BaseException& e)
    {
       ErrLog(<< "Failed to cache result for " << targetToQuery << ": " << e.getMessage());
-      mResultConverter->notifyUser(mTarget, ARES_EFORMERR, e.getMessage(), Empty, mSink);
+      notifyUsers(ARES_EFORMERR, e.getMessage(), Empty);
       bGotAnswers = false;
       return;
    }
@@ -756,7 +782,7 @@ DnsStub::Query::followCname(const unsigned char* aptr, const unsigned char*abuf,
          else
          {
             mReQuery = 0;
-            mResultConverter->notifyUser(mTarget, 1, mStub.errorMessage(1), Empty, mSink);
+            notifyUsers(1, mStub.errorMessage(1), Empty);
             bGotAnswers = false;
          }
       }
@@ -784,6 +810,48 @@ DnsStub::handleDnsRaw(ExternalDnsRawResult res)
    mDnsProvider->freeResult(res);
 }
 
+void
+DnsStub::refresh(const Data& target, int rrType)
+{
+   DebugLog(<< "Refreshing cached " << target << " " << typeToData(rrType));
+   mCacheRefreshes.fetchAdd(1);
+   Refresh* query = new Refresh(*this, target, rrType);
+   mRefreshes.insert(query);
+   lookupRecords(target, rrType, query);
+}
+
+void
+DnsStub::Refresh::onDnsRaw(int status, const unsigned char* abuf, int alen)
+{
+   try
+   {
+      if (status == 0)
+      {
+         if (DNS_HEADER_ANCOUNT(abuf) != 0)
+         {
+            mStub.cache(mTarget, abuf, alen);
+         }
+      }
+      else if (status == ARES_ENODATA || status == ARES_ENOTFOUND)
+      {
+         mStub.cacheTTL(mTarget, mRRType, status, abuf, alen);
+      }
+      else
+      {
+         // keep what is cached until it is too stale to be used
+         DebugLog(<< "Refresh of " << mTarget << " failed: " << mStub.errorMessage(status));
+      }
+   }
+   catch (BaseException& e)
+   {
+      ErrLog(<< "Failed to cache refreshed " << mTarget << ": " << e.getMessage());
+   }
+   // a failed or timed out query updated nothing; let the next lookup retry
+   mStub.mRRCache.refreshFinished(mTarget, mRRType);
+   mStub.mRefreshes.erase(this);
+   delete this;
+}
+
 void
 DnsStub::setEnumSuffixes(const std::vector<Data>& suffixes)
 {
@@ -846,6 +914,9 @@ void
 DnsStub::doLogDnsCache()
 {
    mRRCache.logCache();
+   InfoLog(<< mQueries.size() << " DNS queries in progress, "
+           << mMergedQueries.load() << " lookups merged into queries already in progress, "
+           << mCacheRefreshes.load() << " cached records refreshed in the background");
 }
 
 void 
@@ -876,6 +947,18 @@ DnsStub::setDnsCacheSize(int size)
    mRRCache.setSize(size);
 }
 
+void
+DnsStub::setDnsCacheStaleTime(int seconds)
+{
+   mRRCache.setStaleTime(seconds);
+}
+
+void
+DnsStub::setDnsCachePrefetch(int seconds, unsigned int minHits)
+{
+   mRRCache.setPrefetch(seconds, minHits);
+}
+
 /* ====================================================================
  * The Vovida Software License, Version 1.0 
  * 
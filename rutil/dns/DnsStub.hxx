@@ -11,6 +11,7 @@
 #include <map>
 #include <set>
 
+#include "rutil/Atomic.hxx"
 #include "rutil/FdPoll.hxx"
 #include "rutil/Fifo.hxx"
 #include "rutil/GenericIPAddress.hxx"
@@ -179,6 +180,19 @@ class DnsStub : public ExternalDnsHandler
       void getDnsCacheDump(std::pair<unsigned long, unsigned long> key, GetDnsCacheDumpHandler* handler);
       void setDnsCacheTTL(int ttl);
       void setDnsCacheSize(int size);
+      /// Expired records are still returned for up to {seconds} while a
+      /// query for them runs in the background; 0 (the default) disables this
+      void setDnsCacheStaleTime(int seconds);
+      /// Records looked up at least {minHits} times are queried again in the
+      /// background once less than {seconds} of their TTL remain; 0 (the
+      /// default) disables this
+      void setDnsCachePrefetch(int seconds, unsigned int minHits);
+      /// Background queries started by the two settings above.
+      unsigned long getCacheRefreshCount() const { return mCacheRefreshes.load(); }
+      /// Lookups that found a query for the same target, type and protocol
+      /// already in progress and were answered along with it instead of
+      /// sending one of their own.
+      unsigned long getMergedQueryCount() const { return mMergedQueries.load(); }
       bool checkDnsChange();
       bool supportedType(int);
 
@@ -264,11 +278,18 @@ class DnsStub : public ExternalDnsHandler
             enum {MAX_REQUERIES = 5};
 
             void go();
+            /// {sink} gets the same result as the sink this query was made for
+            void addSink(DnsResultSink* sink) { mSinks.push_back(sink); }
+            const Data& target() const { return mTarget; }
+            int rrType() const { return mRRType; }
+            int proto() const { return mProto; }
             void process(int status, const unsigned char* abuf, const int alen);
             void onDnsRaw(int status, const unsigned char* abuf, int alen);
             void followCname(const unsigned char* aptr, const unsigned char*abuf, const int alen, bool& bGotAnswers, bool& bDeleteThis, Data& targetToQuery);
 
          private:
+            void notifyUsers(int status, const Data& msg, const DnsResourceRecordsByPtr& src);
+
             static DnsResourceRecordsByPtr Empty;
             int mRRType;
             DnsStub& mStub;
@@ -277,10 +298,44 @@ class DnsStub : public ExternalDnsHandler
             Data mTarget;
             int mProto;
             int mReQuery;
-            DnsResultSink* mSink;
+            std::vector<DnsResultSink*> mSinks;
             bool mFollowCname;
       };
 
+      /// Queries records that RRCache asked to have refreshed; only updates
+      /// the cache, nobody is waiting for the result.
+      class Refresh : public DnsRawSink
+      {
+         public:
+            Refresh(DnsStub& stub, const Data& target, int rrType)
+               : mStub(stub), mTarget(target), mRRType(rrType) {}
+            void onDnsRaw(int status, const unsigned char* abuf, int alen);
+
+            DnsStub& mStub;
+            Data mTarget;
+            int mRRType;
+      };
+      void refresh(const Data& target, int rrType);
+
+      /// target (compared without regard to case), rrType, protocol
+      class QueryKey
+      {
+         public:
+            QueryKey(const Data& target, int rrType, int proto)
+               : mTarget(target), mRRType(rrType), mProto(proto) {}
+            bool operator<(const QueryKey& rhs) const
+            {
+               if (mRRType != rhs.mRRType) return mRRType < rhs.mRRType;
+               if (mProto != rhs.mProto) return mProto < rhs.mProto;
+               return isLessThanNoCase(mTarget, rhs.mTarget);
+            }
+         private:
+            Data mTarget;
+            int mRRType;
+            int mProto;
+      };
+      typedef std::map<QueryKey, Query*> QueryMap;
+
    private:
       DnsStub(const DnsStub&);   // disable copy ctor.
       DnsStub& operator=(const DnsStub&);
@@ -292,11 +347,21 @@ class DnsStub : public ExternalDnsHandler
       template<class QueryType>
       void query(const Data& target, int proto, DnsResultSink* sink)
       {
+         QueryMap::iterator it = mQueryMap.find(QueryKey(target, QueryType::getRRType(), proto));
+         if (it != mQueryMap.end())
+         {
+            // Answered from the same response; typically many transactions
+            // to a busy domain whose records just expired.
+            it->second->addSink(sink);
+            mMergedQueries.fetchAdd(1);
+            return;
+         }
          Query* query = new Query(*this, mTransform, 
                                   new ResultConverterImpl<QueryType>(), 
                                   target, QueryType::getRRType(),
                                   QueryType::SupportsCName, proto, sink);
          mQueries.insert(query);
+         mQueryMap.insert(std::make_pair(QueryKey(target, QueryType::getRRType(), proto), query));
          query->go();
       }
       
@@ -448,6 +513,10 @@ class DnsStub : public ExternalDnsHandler
       ExternalDns* mDnsProvider;
       FdPollGrp* mPollGrp;
       std::set<Query*> mQueries;
+      QueryMap mQueryMap; // the queries that lookups can still join
+      Atomic<unsigned long> mMergedQueries;
+      std::set<Refresh*> mRefreshes;
+      Atomic<unsigned long> mCacheRefreshes;
 
       std::vector<Data> mEnumSuffixes; // where to do enum lookups
       std::map<Data,Data> mEnumDomains;
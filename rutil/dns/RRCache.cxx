@@ -50,7 +50,10 @@ RRCache::RRCache()
    : mHead(),
      mLruHead(LruListType::makeList(&mHead)),
      mUserDefinedTTL(DEFAULT_USER_DEFINED_TTL),
-     mSize(DEFAULT_SIZE)
+     mSize(DEFAULT_SIZE),
+     mStaleTime(0),
+     mPrefetchTime(0),
+     mPrefetchHits(0)
 {
    mFactoryMap[T_CNAME] = &mCnameRecordFactory;
    mFactoryMap[T_NAPTR] = &mNaptrRecordFacotry;
@@ -152,6 +155,29 @@ RRCache::lookup(const Data& target,
                 const int protocol,
                 Result& records, 
                 int& status)
+{
+   return lookup(target, type, protocol, records, status, 0);
+}
+
+bool 
+RRCache::lookup(const Data& target, 
+                const int type, 
+                const int protocol,
+                Result& records, 
+                int& status,
+                bool& refresh)
+{
+   refresh = false;
+   return lookup(target, type, protocol, records, status, &refresh);
+}
+
+bool 
+RRCache::lookup(const Data& target, 
+                const int type, 
+                const int protocol,
+                Result& records, 
+                int& status,
+                bool* refresh)
 {
    records.empty();
    status = 0;
@@ -164,19 +190,48 @@ RRCache::lookup(const Data& target,
    }
    else
    {
-      if (Timer::getTimeSecs() >= (*it)->absoluteExpiry())
+      RRList* list = *it;
+      UInt64 now = Timer::getTimeSecs();
+      // only positive answers are served stale or prefetched
+      bool refreshable = refresh && list->status() == 0;
+      if (now >= list->absoluteExpiry())
       {
-         delete *it;
-         mRRSet.erase(it);
-         return false;
+         if (!refreshable || now >= list->absoluteExpiry() + mStaleTime)
+         {
+            delete list;
+            mRRSet.erase(it);
+            return false;
+         }
+         if (!list->refreshRequested())
+         {
+            list->setRefreshRequested();
+            *refresh = true;
+         }
       }
-      else
+      else if (refreshable && mPrefetchTime > 0 && !list->refreshRequested() &&
+               list->hits() + 1 >= mPrefetchHits &&
+               list->absoluteExpiry() - now <= (UInt64)mPrefetchTime)
       {
-         records = (*it)->records(protocol);
-         status = (*it)->status();
-         touch(*it);
-         return true;
+         list->setRefreshRequested();
+         *refresh = true;
       }
+      list->hit();
+      records = list->records(protocol);
+      status = list->status();
+      touch(list);
+      return true;
+   }
+}
+
+void
+RRCache::refreshFinished(const Data& target, const int type)
+{
+   RRList* key = new RRList(target, type);
+   RRSet::iterator it = mRRSet.find(key);
+   delete key;
+   if (it != mRRSet.end())
+   {
+      (*it)->setRefreshRequested(false);
    }
 }
 
@@ -241,7 +296,7 @@ RRCache::logCache()
    UInt64 now = Timer::getTimeSecs();
    for (std::set<RRList*, CompareT>::iterator it = mRRSet.begin(); it != mRRSet.end(); )
    {
-      if (now >= (*it)->absoluteExpiry())
+      if (now >= (*it)->absoluteExpiry() + mStaleTime)
       {
          delete *it;
          mRRSet.erase(it++);
@@ -261,7 +316,7 @@ RRCache::getCacheDump(Data& dnsCacheDump)
    DataStream strm(dnsCacheDump);
    for (std::set<RRList*, CompareT>::iterator it = mRRSet.begin(); it != mRRSet.end(); )
    {
-      if (now >= (*it)->absoluteExpiry())
+      if (now >= (*it)->absoluteExpiry() + mStaleTime)
       {
          delete *it;
          mRRSet.erase(it++);
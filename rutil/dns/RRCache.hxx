@@ -30,7 +30,15 @@ class RRCache
       RRCache();
       ~RRCache();
       void setTTL(int ttl) { if (ttl > 0) mUserDefinedTTL = ttl * MIN_TO_SEC; }
+      // As above, in seconds; 0 keeps records for no longer than their own TTL
+      void setMinimumTTLSecs(int seconds) { mUserDefinedTTL = seconds > 0 ? seconds : 0; }
       void setSize(int size) { mSize = size; }
+      // Serve records for up to {seconds} after they expire, while they are
+      // refreshed (see the lookup() with refresh below); 0 disables this
+      void setStaleTime(int seconds) { mStaleTime = seconds > 0 ? seconds : 0; }
+      // Refresh records that were looked up at least {minHits} times once
+      // less than {seconds} of their TTL remain; 0 disables this
+      void setPrefetch(int seconds, unsigned int minHits) { mPrefetchTime = seconds > 0 ? seconds : 0; mPrefetchHits = minHits; }
       // Update existing cache record, or add a new one
       void updateCache(const Data& target,
                        const int rrType,
@@ -43,6 +51,13 @@ class RRCache
                     const int status,
                     RROverlay overlay);
       bool lookup(const Data& target, const int type, const int proto, Result& records, int& status);
+      // As above, but may also return stale records (see setStaleTime).
+      // {refresh} is set when the caller should query target/type again to
+      // update the records; it is set at most once per update.
+      bool lookup(const Data& target, const int type, const int proto, Result& records, int& status, bool& refresh);
+      // Called once the query for a refresh has completed, whether or not it
+      // updated the records, so that a later lookup can ask again if it didn't
+      void refreshFinished(const Data& target, const int type);
       void clearCache();
       void logCache();
       void getCacheDump(Data& dnsCacheDump);
@@ -72,6 +87,7 @@ class RRCache
             }
       };
 
+      bool lookup(const Data& target, const int type, const int proto, Result& records, int& status, bool* refresh);
       void touch(RRList* node);
       void cleanup();
       int getTTL(const RROverlay& overlay);
@@ -95,6 +111,9 @@ class RRCache
       
       int mUserDefinedTTL; // used when the ttl in RR is 0 or less than default(60). in seconds.
       unsigned int mSize;
+      int mStaleTime; // in seconds
+      int mPrefetchTime; // in seconds
+      unsigned int mPrefetchHits;
 };
 
 }
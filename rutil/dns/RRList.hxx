@@ -52,6 +52,13 @@ class RRList : public IntrusiveListElement<RRList*>
       int rrType() const { return mRRType; }
       UInt64 absoluteExpiry() const { return mAbsoluteExpiry; }
       UInt64& absoluteExpiry() { return mAbsoluteExpiry; }
+      /// lookups served since the records were last updated
+      unsigned int hits() const { return mHits; }
+      void hit() { ++mHits; }
+      /// set once RRCache has asked for the records to be refreshed;
+      /// cleared when they are updated or the refresh has failed
+      bool refreshRequested() const { return mRefreshRequested; }
+      void setRefreshRequested(bool requested = true) { mRefreshRequested = requested; }
       void log();
       EncodeStream& encodeRRList(EncodeStream& strm);
 
@@ -73,6 +80,8 @@ class RRList : public IntrusiveListElement<RRList*>
 
       int mStatus; // dns query status.
       UInt64 mAbsoluteExpiry;
+      unsigned int mHits;
+      bool mRefreshRequested;
 
       RecordItr find(const Data&);
       void clear();
@@ -0,0 +1,176 @@
+#include "rutil/DinkyPool.hxx"
+
+#include <string.h>
+#include <iostream>
+#include "assert.h"
+
+using namespace resip;
+using namespace std;
+
+static bool
+aligned(void* p)
+{
+   return ((size_t)p & 7) == 0;
+}
+
+int main()
+{
+   {
+      // no arena: the embedded buffer, then the heap
+      DinkyPool<64> pool;
+      void* a = pool.allocate(40);
+      void* b = pool.allocate(24);
+      assert(aligned(a) && aligned(b));
+      assert(pool.getPoolBytes() == 64);
+      assert(pool.getHeapAllocations() == 0);
+
+      void* c = pool.allocate(8);
+      assert(aligned(c));
+      memset(c, 0xab, 8);
+      assert(pool.getHeapAllocations() == 1);
+      assert(pool.getHeapBytes() == 8);
+      assert(pool.getArenaBlocks() == 0);
+      pool.deallocate(c);
+      pool.deallocate(b);
+      pool.deallocate(a);
+      pool.deallocate(0);
+   }
+
+   {
+      // memory that never came from the pool is handed back to the heap
+      DinkyPool<16> pool(1024, 4096);
+      void* a = pool.allocate(100);
+      void* foreign = ::operator new(100);
+      pool.deallocate(foreign);
+      pool.deallocate(a);
+      assert(pool.allocate(100) == a);
+      assert(pool.getArenaReuses() == 1);
+   }
+
+   {
+      // arena blocks, with freed allocations reused by size class
+      DinkyPool<16> pool(1024, 2048);
+      pool.allocate(16);
+
+      void* a = pool.allocate(40);     // 48 byte class with its header
+      void* b = pool.allocate(100);    // 128 byte class
+      assert(aligned(a) && aligned(b));
+      assert(pool.getArenaBlocks() == 1);
+      memset(a, 0x11, 40);
+      memset(b, 0x22, 100);
+
+      pool.deallocate(a);
+      void* c = pool.allocate(10);     // different class, not a reuse
+      assert(c != a);
+      assert(pool.getArenaReuses() == 0);
+      void* d = pool.allocate(36);     // same class as a
+      assert(d == a);
+      assert(pool.getArenaReuses() == 1);
+
+      pool.deallocate(b);
+      pool.deallocate(c);
+      assert(pool.allocate(120) == b);
+      assert(pool.allocate(14) == c);
+      assert(pool.getArenaReuses() == 3);
+      assert(pool.getHeapAllocations() == 0);
+
+      // larger than a quarter of a block
+      void* big = pool.allocate(300);
+      assert(pool.getHeapAllocations() == 1);
+      memset(big, 0x33, 300);
+      pool.deallocate(big);
+
+      // three more fit in the first block, four in the second, which is
+      // the last one maxArenaBytes allows
+      for (int i = 0; i < 7; ++i)
+      {
+         pool.allocate(200);
+      }
+      assert(pool.getArenaBlocks() == 2);
+      assert(pool.getArenaBytes() == 2048);
+      assert(pool.getHeapAllocations() == 1);
+      void* e = pool.allocate(200);
+      assert(pool.getArenaBlocks() == 2);
+      assert(pool.getHeapAllocations() == 2);
+
+      // heap allocations are freed, never put on a free list
+      pool.deallocate(e);
+      size_t reuses = pool.getArenaReuses();
+      pool.allocate(200);
+      assert(pool.getArenaReuses() == reuses);
+      assert(pool.getHeapAllocations() == 3);
+   }
+
+   {
+      // many small allocations freed and made again stay in one block
+      DinkyPool<8> pool(4096, 65536);
+      void* ptrs[64];
+      for (int round = 0; round < 10; ++round)
+      {
+         for (int i = 0; i < 64; ++i)
+         {
+            ptrs[i] = pool.allocate(24);
+         }
+         for (int i = 0; i < 64; ++i)
+         {
+            pool.deallocate(ptrs[i]);
+         }
+      }
+      assert(pool.getArenaBlocks() == 1);
+      assert(pool.getArenaReuses() == 9*64);
+      assert(pool.getHeapAllocations() == 0);
+   }
+
+   cerr << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
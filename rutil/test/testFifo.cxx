@@ -1,8 +1,10 @@
 #include <iostream>
+#include <vector>
 #include "rutil/Log.hxx"
 #include "rutil/Fifo.hxx"
 #include "rutil/FiniteFifo.hxx"
 #include "rutil/TimeLimitFifo.hxx"
+#include "rutil/LockFreeFifo.hxx"
 #include "rutil/Data.hxx"
 #include "rutil/ThreadIf.hxx"
 #include "rutil/Timer.hxx"
@@ -146,6 +148,50 @@ void Producer::thread()
    }
 }
 
+class Seq
+{
+   public:
+      Seq(int producer, int n) : mProducer(producer), mN(n) {}
+      int mProducer;
+      int mN;
+};
+
+class LockFreeProducer : public ThreadIf
+{
+   public:
+      LockFreeProducer(LockFreeFifo<Seq>& f, int id, int count) :
+         mFifo(f), mId(id), mCount(count)
+      {}
+      virtual ~LockFreeProducer()
+      {
+         shutdown();
+         join();
+      }
+
+      void thread()
+      {
+         for (int n = 0; n < mCount; ++n)
+         {
+            if (n % 16 == 0)
+            {
+               LockFreeFifo<Seq>::Messages batch;
+               batch.push_back(new Seq(mId, n));
+               mFifo.addMultiple(batch);
+               assert(batch.empty());
+            }
+            else
+            {
+               mFifo.add(new Seq(mId, n));
+            }
+         }
+      }
+
+   private:
+      LockFreeFifo<Seq>& mFifo;
+      int mId;
+      int mCount;
+};
+
 bool
 isNear(int value, int reference, int epsilon=250)
 {
@@ -459,6 +505,87 @@ main()
       sleepMS(1000);
    }
 
+   {
+      cerr << "!! test LockFreeFifo" << endl;
+      LockFreeFifo<Seq> lf;
+      assert(lf.empty());
+      assert(lf.getNext(RESIP_FIFO_NOWAIT) == 0);
+      assert(lf.getTimeDepth() == 0);
+
+      UInt64 begin(Timer::getTimeMs());
+      assert(lf.getNext(500) == 0);
+      UInt64 end(Timer::getTimeMs());
+      assert(isNear((int)(end - begin), 500, 200));
+
+      for (int n = 0; n < 10; ++n)
+      {
+         assert(lf.add(new Seq(0, n)) == (size_t)n+1);
+      }
+      assert(lf.size() == 10);
+      assert(lf.getCountDepth() == 10);
+      assert(lf.messageAvailable());
+
+      LockFreeFifo<Seq>::Messages some;
+      lf.getMultiple(some, 4);
+      assert(some.size() == 4);
+      for (int n = 0; n < 4; ++n)
+      {
+         assert(some[n]->mN == n);
+         delete some[n];
+      }
+      some.clear();
+      assert(lf.getMultiple(RESIP_FIFO_NOWAIT, some, 100));
+      assert(some.size() == 6);
+      assert(some.front()->mN == 4 && some.back()->mN == 9);
+      while (!some.empty())
+      {
+         delete some.front();
+         some.pop_front();
+      }
+      assert(lf.empty());
+      assert(!lf.getMultiple(RESIP_FIFO_NOWAIT, some, 100));
+
+      lf.add(new Seq(0, 0));
+      lf.add(new Seq(0, 1));
+      lf.clear();
+      assert(lf.empty());
+      assert(lf.size() == 0);
+   }
+
+   {
+      cerr << "!! test LockFreeFifo with several producers" << endl;
+      const int numProducers = 4;
+      const int count = 50000;
+      LockFreeFifo<Seq> lf;
+      std::vector<LockFreeProducer*> producers;
+      for (int i = 0; i < numProducers; ++i)
+      {
+         producers.push_back(new LockFreeProducer(lf, i, count));
+      }
+      for (int i = 0; i < numProducers; ++i)
+      {
+         producers[i]->run();
+      }
+
+      // each producer's messages must come out in the order they went in
+      std::vector<int> expected(numProducers, 0);
+      for (int received = 0; received < numProducers*count; ++received)
+      {
+         Seq* seq = (received % 2) ? lf.getNext() : lf.getNext(5000);
+         assert(seq);
+         assert(seq->mN == expected[seq->mProducer]);
+         ++expected[seq->mProducer];
+         delete seq;
+      }
+      assert(lf.empty());
+      assert(lf.getNext(RESIP_FIFO_NOWAIT) == 0);
+
+      for (int i = 0; i < numProducers; ++i)
+      {
+         delete producers[i];
+      }
+   }
+
    cerr << "All OK" << endl;
    return 0;
 }
@@ -3,6 +3,10 @@
 #include "rutil/Data.hxx"
 #include "rutil/ThreadIf.hxx"
 #include "rutil/Timer.hxx"
+#include "rutil/ResipAssert.h"
+
+#include <fstream>
+#include <string>
 
 #include "TestSubsystemLogLevel.hxx"
 #include "rutil/WinLeakCheck.hxx"
@@ -130,6 +134,66 @@ testThreadLocalLoggers(const char *appname)
    }
 }
 
+class AsyncLogThread : public ThreadIf
+{
+   public:
+      AsyncLogThread(int lines) : mLines(lines) {}
+
+      void thread()
+      {
+         for (int i = 0; i < mLines; ++i)
+         {
+            InfoLog(<< "async line " << i);
+         }
+      }
+   private:
+      int mLines;
+};
+
+void
+testAsyncLogger(const char *appname)
+{
+   const char* fileName = "testLogger-async.txt";
+   remove(fileName);
+   Log::initialize(Log::File, Log::Info, appname, fileName);
+
+   // small enough for some lines to be dropped
+   Log::startAsyncWriter(4096);
+   const int numThreads = 4;
+   const int numLines = 2000;
+   AsyncLogThread* threads[numThreads];
+   for (int i = 0; i < numThreads; ++i)
+   {
+      threads[i] = new AsyncLogThread(numLines);
+      threads[i]->run();
+   }
+   for (int i = 0; i < numThreads; ++i)
+   {
+      threads[i]->join();
+      delete threads[i];
+   }
+   Log::stopAsyncWriter();
+
+   int written = 0;
+   std::ifstream file(fileName);
+   std::string line;
+   while (std::getline(file, line))
+   {
+      if (line.find("async line ") != std::string::npos)
+      {
+         ++written;
+      }
+   }
+   cerr << "Async logger wrote " << written << " lines, dropped "
+        << Log::getAsyncDroppedCount() << endl;
+   resip_assert(written + Log::getAsyncDroppedCount() == (unsigned long)(numThreads * numLines));
+   file.close();
+
+   Log::initialize(Log::Cout, Log::Info, appname);
+   InfoLog(<< "Written on the logging thread again");
+   remove(fileName);
+}
+
 int
 main(int argc, char* argv[])
 {
@@ -247,6 +311,7 @@ main(int argc, char* argv[])
 
    cout << endl;
    testThreadLocalLoggers(argv[0]);
+   testAsyncLogger(argv[0]);
 
    return 0;
 }
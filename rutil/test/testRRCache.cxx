@@ -0,0 +1,180 @@
+#include <iostream>
+#include <vector>
+#include "assert.h"
+
+#include "rutil/dns/AresCompat.hxx"
+#ifndef WIN32
+#include <arpa/inet.h>
+#include <arpa/nameser.h>
+#endif
+
+#include "rutil/BaseException.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/dns/DnsHostRecord.hxx"
+#include "rutil/dns/RRCache.hxx"
+#include "rutil/dns/RROverlay.hxx"
+
+using namespace resip;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::TEST
+
+static const Data Host("www.example.com");
+
+// Caches one A record for Host, as if it came from a DNS answer
+static void
+cacheAnswer(RRCache& cache, const char* address, unsigned int ttl)
+{
+   unsigned char rr[] = {
+      3, 'w', 'w', 'w', 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0,
+      0, T_A, 0, C_IN,
+      (unsigned char)(ttl >> 24), (unsigned char)(ttl >> 16), (unsigned char)(ttl >> 8), (unsigned char)ttl,
+      0, 4,
+      0, 0, 0, 0 };
+   in_addr addr;
+   inet_pton(AF_INET, address, &addr);
+   memcpy(rr + sizeof(rr) - 4, &addr, 4);
+
+   vector<RROverlay> overlays;
+   overlays.push_back(RROverlay(rr, rr, sizeof(rr)));
+   cache.updateCache(Host, T_A, overlays.begin(), overlays.end());
+}
+
+// @return the address cached for Host, or empty if there is none
+static Data
+lookup(RRCache& cache, bool& refresh)
+{
+   RRCache::Result records;
+   int status;
+   if (!cache.lookup(Host, T_A, 0, records, status, refresh))
+   {
+      return Data::Empty;
+   }
+   assert(status == 0);
+   assert(records.size() == 1);
+   return dynamic_cast<DnsHostRecord*>(records.front())->host();
+}
+
+int
+main(int argc, char* argv[])
+{
+   Log::initialize(Log::Cout, Log::Info, argv[0]);
+   bool refresh;
+
+   // prefetch: the records are still fresh, but looked up often enough
+   {
+      RRCache cache;
+      cache.setPrefetch(3600, 2);
+      cacheAnswer(cache, "192.0.2.1", 600);
+
+      assert(lookup(cache, refresh) == "192.0.2.1");
+      assert(!refresh);
+      assert(lookup(cache, refresh) == "192.0.2.1");
+      assert(refresh);
+      // asked for only once
+      assert(lookup(cache, refresh) == "192.0.2.1");
+      assert(!refresh);
+
+      // until the refresh fails
+      cache.refreshFinished(Host, T_A);
+      assert(lookup(cache, refresh) == "192.0.2.1");
+      assert(refresh);
+
+      // or updates the records, which start counting hits again
+      cacheAnswer(cache, "192.0.2.2", 600);
+      assert(lookup(cache, refresh) == "192.0.2.2");
+      assert(!refresh);
+      cache.refreshFinished(Host, T_A);
+      assert(lookup(cache, refresh) == "192.0.2.2");
+      assert(refresh);
+   }
+
+   // stale hits: expired records are served while they are refreshed
+   {
+      RRCache cache;
+      RRCache plainCache;
+      cache.setStaleTime(60);
+      plainCache.setStaleTime(60);
+      // records with a TTL of 0 expire as soon as they are cached
+      cache.setMinimumTTLSecs(0);
+      plainCache.setMinimumTTLSecs(0);
+      cacheAnswer(cache, "192.0.2.1", 0);
+      cacheAnswer(plainCache, "192.0.2.1", 0);
+
+      assert(lookup(cache, refresh) == "192.0.2.1");
+      assert(refresh);
+      assert(lookup(cache, refresh) == "192.0.2.1");
+      assert(!refresh);
+
+      // a failed refresh is asked for again by the next lookup
+      cache.refreshFinished(Host, T_A);
+      assert(lookup(cache, refresh) == "192.0.2.1");
+      assert(refresh);
+      assert(lookup(cache, refresh) == "192.0.2.1");
+      assert(!refresh);
+
+      // a successful one replaces the stale records
+      cacheAnswer(cache, "192.0.2.2", 600);
+      cache.refreshFinished(Host, T_A);
+      assert(lookup(cache, refresh) == "192.0.2.2");
+      assert(!refresh);
+
+      // a lookup that can't refresh the records doesn't get stale ones
+      RRCache::Result records;
+      int status;
+      assert(!plainCache.lookup(Host, T_A, 0, records, status));
+   }
+
+   resipCerr << "All OK" << endl;
+   return 0;
+}
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */